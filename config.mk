@@ -6,35 +6,58 @@ ASM_FLAGS=-f elf32 -isrc/kernel -isrc/kernel/include/kernel
 # i686 cross-compiler. See https://github.com/fs-os/cross-compiler
 CC=/usr/local/cross/bin/i686-elf-gcc
 
-# Global cflags. Other commands use specific ones not yet in the config
-CFLAGS=-Wall -Wextra -O2 -masm=intel -msse -msse2
+# Global cflags. Other commands use specific ones not yet in the config. The
+# frame pointers are needed for the backtraces of the profiler (perf command)
+CFLAGS=-Wall -Wextra -O2 -masm=intel -msse -msse2 -fno-omit-frame-pointer
+
+# Extra cflags of the kernel and libk objects, see the trace target
+TRACE_CFLAGS=
 
 # Cross-compiled ar for creating the static library (LIBC)
 AR=/usr/local/cross/bin/i686-elf-ar
 
+# Cross-compiled nm for generating the kernel symbol table
+NM=/usr/local/cross/bin/i686-elf-nm
+
 # Kernel binary and iso filenames
 KERNEL_BIN=fs-os.bin
 ISO=$(KERNEL_BIN:.bin=.iso)
 
 # List of object files to be linked with the kernel. Same for asm_objs but with
 # different compilation method.
-KERNEL_OBJS=obj/kernel/kernel.c.o obj/kernel/vga.c.o obj/kernel/paging.c.o obj/kernel/heap.c.o obj/kernel/multitask.c.o obj/kernel/framebuffer.c.o obj/kernel/framebuffer_console.c.o obj/kernel/idt.c.o obj/kernel/exceptions.c.o obj/kernel/rtc.c.o obj/kernel/pit.c.o obj/kernel/pcspkr.c.o obj/kernel/keyboard.c.o
+KERNEL_OBJS=obj/kernel/kernel.c.o obj/kernel/vga.c.o obj/kernel/paging.c.o obj/kernel/heap.c.o obj/kernel/multitask.c.o obj/kernel/framebuffer.c.o obj/kernel/bga.c.o obj/kernel/compositor.c.o obj/kernel/framebuffer_console.c.o obj/kernel/vt.c.o obj/kernel/waitqueue.c.o obj/kernel/poll.c.o obj/kernel/tty.c.o obj/kernel/idt.c.o obj/kernel/irq.c.o obj/kernel/irqoff.c.o obj/kernel/exceptions.c.o obj/kernel/ksyms.c.o obj/kernel/perf.c.o obj/kernel/pmu.c.o obj/kernel/trace.c.o obj/kernel/tracepoint.c.o obj/kernel/rtc.c.o obj/kernel/pit.c.o obj/kernel/tsc.c.o obj/kernel/serial.c.o obj/kernel/log.c.o obj/kernel/pcspkr.c.o obj/kernel/keyboard.c.o
 ASM_OBJS=obj/kernel/boot.asm.o obj/kernel/io.asm.o obj/kernel/gdt.asm.o obj/kernel/idt.asm.o obj/kernel/paging.asm.o obj/kernel/multitask.asm.o obj/kernel/rand.asm.o obj/kernel/asm_util.asm.o
 
+# Symbol table of the kernel, generated by scripts/gen_ksyms.py when linking
+KSYMS_SRC=obj/gen/ksyms_table.c
+KSYMS_OBJ=obj/gen/ksyms_table.c.o
+
 # List of object files containing the app functions. For now built into the kernel
 # until we have a proper userspace.
 # sh means src/apps/sh/sh.c will be compiled to obj/apps/sh.c.o
-APP_OBJS=obj/apps/sh/sh.c.o obj/apps/piano/piano.c.o obj/apps/minesweeper/minesweeper.c.o obj/apps/5x5/5x5.c.o
+APP_OBJS=obj/apps/sh/sh.c.o obj/apps/piano/piano.c.o obj/apps/minesweeper/minesweeper.c.o obj/apps/5x5/5x5.c.o obj/apps/bench_fb/bench_fb.c.o
 
 # Libk is the libc version (with some changes) that the kernel uses for building. We
 # don't need a static lib, because we can just link the kernel with these objs
 # instead.
-LIBK_OBJS=obj/libk/string.c.o obj/libk/stdlib.c.o obj/libk/stdio.c.o obj/libk/ctype.c.o obj/libk/time.c.o obj/libk/curses.c.o
+LIBK_OBJS=obj/libk/string.c.o obj/libk/stdlib.c.o obj/libk/stdio.c.o obj/libk/ctype.c.o obj/libk/time.c.o obj/libk/curses.c.o obj/libk/hashmap.c.o obj/libk/rbtree.c.o obj/libk/histogram.c.o
 
 # List of object files of our standard library, and the final static library
 LIBC_OBJS=obj/libc/string.c.o obj/libc/stdlib.c.o obj/libc/stdio.c.o obj/libc/ctype.c.o obj/libc/time.c.o obj/libc/curses.c.o
 LIBC=obj/libc.a
 
+# Host compiler, used for the libk tests and benchmarks (make test, make bench)
+HOST_CC=gcc
+HOST_OBJCOPY=objcopy
+HOST_CFLAGS=-Wall -Wextra -O2 -masm=intel -msse -msse2
+
+# Portable parts of libk that are built for the host. The symbols get a "libk_"
+# prefix, see test/libk.h
+HOST_LIBK_OBJS=obj/host/libk/string.c.o obj/host/libk/stdlib.c.o obj/host/libk/stdio.c.o obj/host/libk/ctype.c.o obj/host/libk/hashmap.c.o obj/host/libk/rbtree.c.o obj/host/libk/histogram.c.o
+HOST_TEST_OBJS=obj/host/test/shim.c.o
+HOST_TEST_BIN=obj/host/test_libk
+HOST_BENCH_BIN=obj/host/bench_libk
+
 # sysroot paths
 SYSROOT=./sysroot
 SYSROOT_INCLUDEDIR=$(SYSROOT)/usr/include
@@ -0,0 +1,46 @@
+#!/usr/bin/python3
+
+# Generate the C source of the kernel symbol table (see
+# src/kernel/include/kernel/ksyms.h) from the output of `nm -n` in stdin. With
+# an empty stdin, the table is empty. Used by the Makefile when linking the
+# kernel.
+
+import sys
+
+# Symbols of .text, global and local
+TEXT_TYPES = "Tt"
+
+def read_symbols(f):
+    syms = []
+    for line in f:
+        fields = line.split()
+        if len(fields) != 3 or fields[1] not in TEXT_TYPES:
+            continue
+
+        syms.append((int(fields[0], 16), fields[2]))
+
+    # Sorted by address. With duplicates, the last one wins in ksyms_find()
+    syms.sort(key=lambda s: s[0])
+    return syms
+
+def main():
+    syms = read_symbols(sys.stdin)
+
+    print("/* Generated by scripts/gen_ksyms.py, don't edit */")
+    print()
+    print("#include <stddef.h>")
+    print("#include <kernel/ksyms.h>")
+    print()
+
+    if len(syms) == 0:
+        print("const KSym ksyms_table[1] = { { 0, NULL } };")
+    else:
+        print("const KSym ksyms_table[] = {")
+        for addr, name in syms:
+            print("    { 0x%08X, \"%s\" }," % (addr, name))
+        print("};")
+
+    print()
+    print("const size_t ksyms_count = %d;" % len(syms))
+
+main()
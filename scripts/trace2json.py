@@ -0,0 +1,115 @@
+#!/usr/bin/python3
+
+# Convert the output of the "trace dump" command to the JSON of the Chrome
+# trace viewer (chrome://tracing or https://ui.perfetto.dev). The input is the
+# raw output of the serial port, for example from "qemu -serial file:out.bin".
+# See src/kernel/include/kernel/trace.h for the format.
+#
+# Usage: trace2json.py <serial output> <output json>
+
+import sys, json, struct
+
+MAGIC     = b"FSTRACE\0"
+END_MAGIC = b"FSTREND\0"
+VERSION   = 1
+
+def read_uleb(data, pos):
+    num   = 0
+    shift = 0
+    while True:
+        byte = data[pos]
+        pos += 1
+        num |= (byte & 0x7F) << shift
+        shift += 7
+        if not (byte & 0x80):
+            return num, pos
+
+def parse(data):
+    # Use the last dump of the file
+    pos = data.rfind(MAGIC)
+    if pos < 0:
+        sys.exit("No trace found in the input")
+    pos += len(MAGIC)
+
+    version, tsc_hz, start_tsc, nsyms, nevents = \
+        struct.unpack_from("<BQQII", data, pos)
+    pos += struct.calcsize("<BQQII")
+    if version != VERSION:
+        sys.exit("Unknown trace version %d" % version)
+
+    syms = []
+    for _ in range(nsyms):
+        addr, name_len = struct.unpack_from("<IB", data, pos)
+        pos += 5
+        name = data[pos:pos + name_len].decode("ascii", "replace")
+        pos += name_len
+        syms.append(name if name else "0x%08X" % addr)
+
+    events = []
+    tsc = start_tsc
+    for _ in range(nevents):
+        delta, pos = read_uleb(data, pos)
+        sym, pos   = read_uleb(data, pos)
+        tsc += delta >> 1
+        events.append((tsc, bool(delta & 1), syms[sym]))
+
+    if data[pos:pos + len(END_MAGIC)] != END_MAGIC:
+        sys.exit("The trace is truncated")
+
+    return tsc_hz, start_tsc, events
+
+def to_chrome(tsc_hz, start_tsc, events):
+    # Without the TSC frequency, the timestamps are in cycles
+    if tsc_hz == 0:
+        sys.stderr.write("TSC not calibrated, the times are in cycles\n")
+        scale = 1.0
+    else:
+        scale = 1000000.0 / tsc_hz
+
+    def ts(tsc):
+        return (tsc - start_tsc) * scale
+
+    # The ring can start or end in the middle of a call, and the task
+    # switches leave calls without exit. Each exit closes the calls above its
+    # enter, and exits without an enter are ignored.
+    out   = []
+    stack = []
+    for tsc, is_exit, name in events:
+        if not is_exit:
+            stack.append((name, tsc))
+            continue
+
+        if not any(s[0] == name for s in stack):
+            continue
+
+        while stack:
+            top, start = stack.pop()
+            out.append({ "name": top, "ph": "X", "pid": 0, "tid": 0,
+                         "ts": ts(start), "dur": ts(tsc) - ts(start) })
+            if top == name:
+                break
+
+    end = events[-1][0] if events else start_tsc
+    while stack:
+        top, start = stack.pop()
+        out.append({ "name": top, "ph": "X", "pid": 0, "tid": 0,
+                     "ts": ts(start), "dur": ts(end) - ts(start) })
+
+    return { "traceEvents": out, "displayTimeUnit": "ns" }
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit("Usage: %s <serial output> <output json>" % sys.argv[0])
+
+    with open(sys.argv[1], "rb") as f:
+        data = f.read()
+
+    trace = to_chrome(*parse(data))
+
+    with open(sys.argv[2], "w") as f:
+        json.dump(trace, f)
+
+    print("%d calls written to %s" % (len(trace["traceEvents"]),
+                                      sys.argv[2]))
+
+main()
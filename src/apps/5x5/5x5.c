@@ -10,7 +10,6 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h> /* tolower */
-#include <time.h>
 #include <curses.h>
 
 #include "defines.h"
@@ -96,7 +95,7 @@ static inline bool parse_args(int argc, char** argv, ctx_t* ctx) {
         } else if (!strcmp(argv[i], "-k") || !strcmp(argv[i], "--keys")) {
             puts("Controls:\n"
 
-                 "        hjkl - Move in the grid (vim-like)\n"
+                 "        hjkl - Move in the grid (vim-like), or the arrows\n"
                  "     <space> - Toggle selected cell (and adjacent)\n"
                  "           r - Generate random grid\n"
 #ifdef CHEAT
@@ -142,7 +141,7 @@ static inline void init_grid(ctx_t* ctx, bool random) {
     for (int y = 0; y < ctx->h; y++) {
         for (int x = 0; x < ctx->w; x++) {
             /* There is 50% chance a tile is turned on if random == true */
-            if (random && rand() % 2)
+            if (random && (rand_u32() & 1))
                 ctx->grid[y * ctx->w + x] = ON_CH;
             else
                 ctx->grid[y * ctx->w + x] = OFF_CH;
@@ -354,6 +353,7 @@ int main_5x5(int argc, char** argv) {
     initscr(); /* Init ncurses */
     raw();     /* Scan input without pressing enter */
     noecho();  /* Don't print when typing */
+    keypad(stdscr, true); /* Enable keypad (arrow keys) */
 
 #ifdef USE_COLOR
     /* Global used to indicate redraw_grid that color is supported at runtime */
@@ -367,9 +367,6 @@ int main_5x5(int argc, char** argv) {
     }
 #endif
 
-    /* Init random seed */
-    srand(time(NULL));
-
     /* Allocate and initialize grid */
     ctx.grid = calloc(ctx.w * ctx.h, sizeof(uint8_t));
     init_grid(&ctx, false);
@@ -392,18 +389,22 @@ int main_5x5(int argc, char** argv) {
         /* Parse input. 'q' quits and there is vim-like navigation */
         switch (c) {
             case 'k':
+            case KEY_UP:
                 if (ctx.cursor.y > 0)
                     ctx.cursor.y--;
                 break;
             case 'j':
+            case KEY_DOWN:
                 if (ctx.cursor.y < ctx.h - 1)
                     ctx.cursor.y++;
                 break;
             case 'h':
+            case KEY_LEFT:
                 if (ctx.cursor.x > 0)
                     ctx.cursor.x--;
                 break;
             case 'l':
+            case KEY_RIGHT:
                 if (ctx.cursor.x < ctx.w - 1)
                     ctx.cursor.x++;
                 break;
@@ -0,0 +1,252 @@
+/**
+ * @file      bench_fb.c
+ * @brief     Throughput benchmark of the framebuffer and the framebuffer
+ *            console.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <kernel/framebuffer.h>
+#include <kernel/framebuffer_console.h>
+#include <kernel/compositor.h> /* comp_damage, comp_compose */
+#include <kernel/serial.h>
+#include <kernel/tsc.h>
+
+#include "bench_fb.h"
+
+#define LENGTH(arr) (sizeof(arr) / sizeof(arr[0]))
+
+/**
+ * @brief Result of a single test.
+ */
+typedef struct {
+    const char* name; /**< @brief Name of the test */
+    uint32_t ops;     /**< @brief Number of operations (clears, chars, etc.) */
+    uint64_t bytes;   /**< @brief Bytes written to the framebuffer. Can be 0 */
+    uint64_t cycles;  /**< @brief TSC cycles for all the operations */
+} bench_result;
+
+/**
+ * @brief Sizes in px of the squares used for the rectangle tests, and the
+ * number of rectangles of each size.
+ */
+static const struct {
+    const char* name;
+    uint32_t sz;
+    uint32_t ops;
+} rect_tests[] = {
+    { "rect_8", 8, 20000 },
+    { "rect_64", 64, 2000 },
+    { "rect_256", 256, 200 },
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Full screen clears with fb_drawrect_fast()
+ * @param[out] res Result of the test
+ */
+static void bench_clear(bench_result* res) {
+    const uint32_t h = fb_get_height();
+    const uint32_t w = fb_get_width();
+
+    res->name  = "clear";
+    res->ops   = 20;
+    res->bytes = (uint64_t)res->ops * h * w * sizeof(uint32_t);
+
+    const uint64_t start = tsc_read();
+    for (uint32_t i = 0; i < res->ops; i++)
+        fb_drawrect_fast(0, 0, h, w, (i & 1) ? COLOR_BLUE : COLOR_BLACK);
+    res->cycles = tsc_read() - start;
+}
+
+/**
+ * @brief Square fills of the specified size in different positions of the
+ * screen.
+ * @param[out] res Result of the test
+ * @param[in] name Name of the test
+ * @param sz Size of the squares in px
+ * @param ops Number of squares
+ */
+static void bench_rect(bench_result* res, const char* name, uint32_t sz,
+                       uint32_t ops) {
+    const uint32_t max_y = fb_get_height() - sz;
+    const uint32_t max_x = fb_get_width() - sz;
+
+    res->name  = name;
+    res->ops   = ops;
+    res->bytes = (uint64_t)ops * sz * sz * sizeof(uint32_t);
+
+    const uint64_t start = tsc_read();
+    for (uint32_t i = 0; i < ops; i++)
+        fb_drawrect_fast((i * 37) % max_y, (i * 53) % max_x, sz, sz,
+                         (i & 1) ? COLOR_RED : COLOR_GREEN);
+    res->cycles = tsc_read() - start;
+}
+
+/**
+ * @brief Chars printed with fbc_putchar() without scrolling.
+ * @param[out] res Result of the test
+ */
+static void bench_glyphs(bench_result* res) {
+    const fbc_ctx* ctx = fbc_get_ctx();
+
+    /* Leave the last row empty, so we never shift */
+    const uint32_t per_screen = (ctx->ch_h - 1) * ctx->ch_w;
+    const uint32_t font_px    = ctx->font->h * ctx->font->w;
+
+    res->name  = "glyphs";
+    res->ops   = per_screen * 4;
+    res->bytes = (uint64_t)res->ops * font_px * sizeof(uint32_t);
+
+    const uint64_t start = tsc_read();
+    for (uint32_t i = 0; i < res->ops; i++) {
+        if (i % per_screen == 0)
+            fbc_clear();
+
+        fbc_putchar('!' + i % ('~' - '!'));
+    }
+    res->cycles = tsc_read() - start;
+}
+
+/**
+ * @brief Lines printed with fbc_sprint() at the bottom of the console, so each
+ * one scrolls.
+ * @param[out] res Result of the test
+ */
+static void bench_scroll(bench_result* res) {
+    const fbc_ctx* ctx = fbc_get_ctx();
+
+    /* Go to the last row, the next newline will shift */
+    fbc_clear();
+    for (uint32_t i = 0; i < ctx->ch_h; i++)
+        fbc_putchar('\n');
+
+    res->name  = "scroll";
+    res->ops   = 200;
+    res->bytes = (uint64_t)res->ops * ctx->h * ctx->w * sizeof(uint32_t);
+
+    const uint64_t start = tsc_read();
+    for (uint32_t i = 0; i < res->ops; i++)
+        fbc_sprint("The quick brown fox jumps over the lazy dog\n");
+    res->cycles = tsc_read() - start;
+}
+
+/**
+ * @brief Full console redraws with fbc_refresh_raw()
+ * @param[out] res Result of the test
+ */
+static void bench_refresh(bench_result* res) {
+    const fbc_ctx* ctx = fbc_get_ctx();
+
+    res->name  = "refresh_raw";
+    res->ops   = 20;
+    res->bytes = (uint64_t)res->ops * ctx->ch_h * ctx->font->h * ctx->ch_w *
+                 ctx->font->w * sizeof(uint32_t);
+
+    const uint64_t start = tsc_read();
+    for (uint32_t i = 0; i < res->ops; i++)
+        fbc_refresh_raw();
+    res->cycles = tsc_read() - start;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Print the result of a test to the console, and optionally to the
+ * serial port.
+ * @param[in] res Result of the test
+ * @param to_serial If true, also send it to the serial port as a single line of
+ * "key=value" pairs, for diffing between builds.
+ */
+static void print_result(const bench_result* res, bool to_serial) {
+    const uint64_t hz            = tsc_get_hz();
+    const uint64_t cycles        = (res->cycles > 0) ? res->cycles : 1;
+    const uint64_t cycles_per_op = cycles / res->ops;
+    const uint64_t ops_per_sec   = (uint64_t)res->ops * hz / cycles;
+    const uint64_t kib_per_sec   = res->bytes / 1024 * hz / cycles;
+
+    fbc_setfore(COLOR_WHITE_B);
+    printf("\t%s: ", res->name);
+    fbc_setfore(COLOR_GRAY);
+    printf("%llu ops/s, %llu MiB/s, %llu cycles/op\n", ops_per_sec,
+           kib_per_sec / 1024, cycles_per_op);
+    fbc_setfore(COLOR_WHITE);
+
+    if (to_serial) {
+        char line[256];
+        snprintf(line, sizeof(line),
+                 "bench_fb %s ops=%u bytes=%llu cycles=%llu "
+                 "cycles_per_op=%llu ops_per_sec=%llu kib_per_sec=%llu\n",
+                 res->name, res->ops, res->bytes, res->cycles, cycles_per_op,
+                 ops_per_sec, kib_per_sec);
+        serial_sprint(line);
+    }
+}
+
+int bench_fb_main(int argc, char** argv) {
+    bool to_serial = false;
+
+    if (argc > 1) {
+        if (strcmp(argv[1], "--serial") == 0) {
+            to_serial = true;
+        } else {
+            printf("Usage:\n"
+                   "\t%s --help    - Show this help\n"
+                   "\t%s           - Run the benchmark\n"
+                   "\t%s --serial  - Also send the results to the serial "
+                   "port\n",
+                   argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    if (tsc_get_hz() == 0) {
+        puts("The TSC was not calibrated.");
+        return 1;
+    }
+
+    if (to_serial && !serial_available()) {
+        puts("Serial port not available.");
+        return 1;
+    }
+
+    /* Use a new context with the same size, like curses, so the tests don't
+     * overwrite the shell history. Draw each char so we measure the drawing
+     * and not only the fbc array. */
+    fbc_ctx* old_ctx = fbc_get_ctx();
+    fbc_ctx bench_ctx;
+    fbc_init_ctx(&bench_ctx, old_ctx->y, old_ctx->x, old_ctx->h, old_ctx->w,
+                 old_ctx->font, 0, old_ctx->vt);
+    fbc_change_ctx(&bench_ctx);
+
+    bench_result results[LENGTH(rect_tests) + 4];
+    size_t n = 0;
+
+    bench_clear(&results[n++]);
+    for (size_t i = 0; i < LENGTH(rect_tests); i++, n++)
+        bench_rect(&results[n], rect_tests[i].name, rect_tests[i].sz,
+                   rect_tests[i].ops);
+    bench_glyphs(&results[n++]);
+    bench_scroll(&results[n++]);
+    bench_refresh(&results[n++]);
+
+    fbc_change_ctx(old_ctx);
+    fbc_free_ctx(&bench_ctx);
+
+    /* Redraw the whole screen: the surfaces (logo) and the console */
+    comp_damage(0, 0, fb_get_height(), fb_get_width());
+    comp_compose();
+    fbc_refresh_raw();
+
+    fbc_setfore(COLOR_WHITE_B);
+    printf("Results (TSC at %llu MHz):\n", tsc_get_hz() / 1000000);
+    fbc_setfore(COLOR_WHITE);
+
+    for (size_t i = 0; i < n; i++)
+        print_result(&results[i], to_serial);
+
+    return 0;
+}
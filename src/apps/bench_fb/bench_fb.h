@@ -0,0 +1,13 @@
+
+#ifndef _APPS_BENCH_FB_H
+#define _APPS_BENCH_FB_H 1
+
+/**
+ * @brief Entry point of the framebuffer and console benchmark
+ * @param argc Number of arguments
+ * @param argv Vector of string arguments
+ * @return Exit code
+ */
+int bench_fb_main(int argc, char** argv);
+
+#endif /* _APPS_BENCH_FB_H */
@@ -20,7 +20,7 @@
  * @details If you compile the program with `USE_ARROWS`, you will be able to
  * navigate with the arrows.
  */
-/* #define USE_ARROWS */
+#define USE_ARROWS
 
 /**
  * @def USE_COLOR
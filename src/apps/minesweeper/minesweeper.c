@@ -7,7 +7,6 @@
 #include <stdlib.h>
 #include <string.h>
 
-#include <time.h>  /* time */
 #include <ctype.h> /* tolower */
 #include <curses.h>
 
@@ -121,8 +120,7 @@ static inline bool parse_args(int argc, char** argv, ms_t* ms) {
             }
         } else if (!strcmp(argv[i], "-k") || !strcmp(argv[i], "--keys")) {
             printf("Controls:\n"
-                   "    <arrows> - Move in the grid (unsupported)\n"
-                   "        hjkl - Move in the grid (vim-like)\n"
+                   "        hjkl - Move in the grid (vim-like), or the arrows\n"
                    "     <space> - Reveal tile\n"
                    "           f - Flag bomb\n"
 #ifdef USE_MOUSE
@@ -337,8 +335,8 @@ static void generate_grid(ms_t* ms, point_t start, int bomb_percent) {
         total_bombs = max_bombs;
 
     for (int bombs = 0; bombs < total_bombs; bombs++) {
-        int bomb_y = rand() % ms->h;
-        int bomb_x = rand() % ms->w;
+        int bomb_y = rand_range(ms->h);
+        int bomb_x = rand_range(ms->w);
 
         /* Leave an empty zone around cursor */
         if (bomb_y > start.y - BOMB_MARGIN && bomb_y < start.y + BOMB_MARGIN &&
@@ -503,9 +501,6 @@ int minesweeper_main(int argc, char** argv) {
     }
 #endif
 
-    /* Init random seed */
-    srand(time(NULL));
-
     /* Allocate and initialize grid */
     ms.grid = malloc(ms.w * ms.h * sizeof(tile_t));
     init_grid(&ms);
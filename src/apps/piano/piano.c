@@ -5,7 +5,8 @@
 #include <string.h>
 #include <time.h> /* sleep_ms */
 
-#include <kernel/keyboard.h> /* kb_noecho, kb_held */
+#include <kernel/keyboard.h> /* kb_held */
+#include <kernel/tty.h>      /* tty_set_mode, tty_flush */
 #include <kernel/pcspkr.h>   /* pcspkr_play, pcspkr_clear */
 
 #include "piano.h"
@@ -41,6 +42,34 @@ static inline void print_piano(void) {
     putchar('\n');
 }
 
+/**
+ * @brief Stop echoing the keys, since we read them with kb_held()
+ * @return Old mode of stdin, for restore_mode()
+ */
+static TtyMode noecho_mode(void) {
+    Tty* const tty = tty_stdin();
+
+    TtyMode old_mode, mode;
+    tty_get_mode(tty, &old_mode);
+
+    mode = old_mode;
+    mode.lflag &= ~TTY_ECHO;
+    tty_set_mode(tty, &mode);
+
+    return old_mode;
+}
+
+/**
+ * @brief Restore the mode of stdin, and discard the keys we didn't read.
+ * @param[in] old_mode Value returned by noecho_mode()
+ */
+static void restore_mode(const TtyMode* old_mode) {
+    Tty* const tty = tty_stdin();
+
+    tty_flush(tty);
+    tty_set_mode(tty, old_mode);
+}
+
 static inline int get_octave_notes(int octave, Piano_note* piano_notes,
                                    size_t piano_notes_len) {
     switch (octave) {
@@ -114,9 +143,8 @@ int piano_main(int argc, char** argv) {
         }
     }
 
-    const bool restore_echo = kb_getecho();
+    const TtyMode old_mode = noecho_mode();
 
-    kb_noecho();
     printf("\n\tPress \'%c\' to exit...\n", EXIT_CH);
     print_piano();
 
@@ -203,9 +231,7 @@ int piano_main(int argc, char** argv) {
 
     printf("\r\tGoodbye.\n");
 
-    /* If we were echoing the keyboard before the program, restore it */
-    if (restore_echo)
-        kb_echo();
+    restore_mode(&old_mode);
 
     return 0;
 }
@@ -285,8 +311,7 @@ int piano_random(int argc, char** argv) {
         }     /* argv for */
     }         /* argc if */
 
-    const bool restore_echo = kb_getecho();
-    kb_noecho();
+    const TtyMode old_mode = noecho_mode();
     printf("\n\tHold \'%c\' to exit...\n", EXIT_CH);
 
     /* Main song loop */
@@ -295,16 +320,14 @@ int piano_random(int argc, char** argv) {
             note_count++;
 
         const Beep beep_info = {
-            piano_notes[rand() % LENGTH(piano_notes)].freq,
+            piano_notes[rand_range(LENGTH(piano_notes))].freq,
             100,
         };
         pcspkr_beep_custom(beep_info);
         sleep_ms(75);
     }
 
-    /* If we were echoing the keyboard before the program, restore it */
-    if (restore_echo)
-        kb_echo();
+    restore_mode(&old_mode);
 
     return 0;
 }
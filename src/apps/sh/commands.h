@@ -6,6 +6,8 @@
 #include <time.h> /* sleep */
 
 #include <kernel/framebuffer_console.h> /* fbc_setfore, fbc_clear */
+#include <kernel/framebuffer.h>         /* fb_has_pages */
+#include <kernel/bga.h>                 /* bga_available, bga_version */
 #include <kernel/paging.h>              /* paging_show_map */
 #include <kernel/heap.h>                /* heap_dump_headers */
 #include <kernel/pit.h>                 /* pit_get_ticks */
@@ -14,12 +16,23 @@
 #include <kernel/keyboard.h>            /* kb_setlayout, Layout */
 #include <kernel/rand.h>                /* cpu_rand */
 #include <kernel/multitask.h>           /* mt_newtask, mt_endtask */
+#include <kernel/log.h>                 /* log_read, LogRecord */
+#include <kernel/tsc.h>                 /* tsc_to_us */
+#include <kernel/serial.h>              /* serial_get_stats */
+#include <kernel/irq.h>                 /* irq_get_stats */
+#include <kernel/irqoff.h>              /* irqoff_get_stats */
+#include <kernel/ksyms.h>               /* ksyms_find */
+#include <kernel/perf.h>                /* perf_start, perf_report */
+#include <kernel/pmu.h>                 /* pmu_start, pmu_stop */
+#include <kernel/trace.h>               /* trace_start, trace_dump */
+#include <kernel/tracepoint.h>          /* tp_enable, tp_read */
 
 #include "sh.h"
 
 #include "../piano/piano.h"
 #include "../minesweeper/minesweeper.h"
 #include "../5x5/5x5.h"
+#include "../bench_fb/bench_fb.h"
 #include "../../media/soviet_anthem.h"
 #include "../../media/thunderstruck.h"
 
@@ -38,6 +51,14 @@
 extern Layout us_layout;
 extern Layout es_layout;
 
+/**
+ * @brief Compare a name with an item of a table sorted by name, for bsearch().
+ * @details The first member of the items needs to be the `const char*` name.
+ */
+static int cmp_name(const void* name, const void* item) {
+    return strcmp(name, *(const char* const*)item);
+}
+
 /* -------------------------------------------------------------------------- */
 
 /* Used in sh_main and cmd_quit */
@@ -52,9 +73,21 @@ static int cmd_quit();
 static int cmd_last();
 static int cmd_clear();
 static int cmd_ref();
+static int cmd_render(int argc, char** argv);
+static int cmd_bga();
+static int cmd_vsync(int argc, char** argv);
 static int cmd_loadkeys(int argc, char** argv);
 static int cmd_ticks();
 static int cmd_date();
+static int cmd_dmesg(int argc, char** argv);
+static int cmd_serial(int argc, char** argv);
+static int cmd_kblat(int argc, char** argv);
+static int cmd_irqs(int argc, char** argv);
+static int cmd_irqoff(int argc, char** argv);
+static int cmd_perf(int argc, char** argv);
+static int cmd_perfstat(int argc, char** argv);
+static int cmd_trace(int argc, char** argv);
+static int cmd_tp(int argc, char** argv);
 static int cmd_timer(int argc, char** argv);
 static int cmd_beep(int argc, char** argv);
 static int cmd_metronome(int argc, char** argv);
@@ -62,12 +95,16 @@ static int cmd_metronome(int argc, char** argv);
 /* piano_random */
 /* minesweeper_main */
 /* main_5x5 */
+/* bench_fb_main */
 static int cmd_page_map();
 static int cmd_heap_headers();
 static int cmd_test_libk();
 static int cmd_test_multitask();
 static int cmd_play(int argc, char** argv);
 
+/* Defined in sh.c, for commands that run other commands */
+static Command* find_cmd(const char* name);
+
 /*
  * Structure of the array:
  *   command name, description, command function pointer
@@ -100,6 +137,21 @@ static Command cmd_list[] = {
       "Refresh the console",
       &cmd_ref,
     },
+    {
+      "render",
+      "Change the console rendering mode (sync or async)",
+      &cmd_render,
+    },
+    {
+      "bga",
+      "Print information about the Bochs graphics adaptor",
+      &cmd_bga,
+    },
+    {
+      "vsync",
+      "Enable or disable vsync, or show the frame timing",
+      &cmd_vsync,
+    },
     {
       "loadkeys",
       "Changes the current keyboard layout",
@@ -115,6 +167,51 @@ static Command cmd_list[] = {
       "Display current date and time",
       &cmd_date,
     },
+    {
+      "dmesg",
+      "Print the kernel log",
+      &cmd_dmesg,
+    },
+    {
+      "serial",
+      "Show the serial port stats, or send stdout/stderr there",
+      &cmd_serial,
+    },
+    {
+      "kblat",
+      "Show the input latency of the keyboard (p50, p99, max)",
+      &cmd_kblat,
+    },
+    {
+      "irqs",
+      "Show the number of IRQs of each line and their handler time",
+      &cmd_irqs,
+    },
+    {
+      "irqoff",
+      "Show the longest windows with the interrupts disabled",
+      &cmd_irqoff,
+    },
+    {
+      "perf",
+      "Sample where the kernel spends its time, and show the hot functions",
+      &cmd_perf,
+    },
+    {
+      "perfstat",
+      "Run a command and show its hardware performance counters",
+      &cmd_perfstat,
+    },
+    {
+      "trace",
+      "Record the kernel function calls, and send them through serial",
+      &cmd_trace,
+    },
+    {
+      "tp",
+      "Enable the kernel tracepoints, and show their last events",
+      &cmd_tp,
+    },
     {
       "timer",
       "Simple timer command (Wrapper for time.h functions)",
@@ -150,6 +247,11 @@ static Command cmd_list[] = {
       "Simple 5x5 game",
       &main_5x5,
     },
+    {
+      "bench_fb",
+      "Measure the framebuffer and console rendering speed",
+      &bench_fb_main,
+    },
     {
       "page_map",
       "Display the page director and page table layout",
@@ -225,6 +327,126 @@ static int cmd_ref() {
     return 0;
 }
 
+static int cmd_render(int argc, char** argv) {
+    if (argc <= 1 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
+        printf("Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s sync    - Draw each char as soon as it's printed\n"
+               "\t%s async   - Only redraw the changed lines every %dms\n",
+               argv[0], argv[0], argv[0], FBC_RENDER_INTERVAL);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "sync") == 0) {
+        fbc_defer(false);
+    } else if (strcmp(argv[1], "async") == 0) {
+        fbc_defer(true);
+    } else {
+        printf("Invalid option \"%s\"\n"
+               "Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s sync    - Draw each char as soon as it's printed\n"
+               "\t%s async   - Only redraw the changed lines every %dms\n",
+               argv[1], argv[0], argv[0], argv[0], FBC_RENDER_INTERVAL);
+        return 1;
+    }
+
+    return 0;
+}
+
+static int cmd_bga() {
+    if (!bga_available()) {
+        puts("BGA not available.");
+        return 1;
+    }
+
+    fbc_setfore(COLOR_WHITE_B);
+    printf("Version: ");
+    fbc_setfore(COLOR_GRAY);
+    printf("0x%X\n", bga_version());
+
+    fbc_setfore(COLOR_WHITE_B);
+    printf("Video memory: ");
+    fbc_setfore(COLOR_GRAY);
+    printf("%ldKiB\n", bga_get_vram() / 1024);
+
+    fbc_setfore(COLOR_WHITE_B);
+    printf("Resolution: ");
+    fbc_setfore(COLOR_GRAY);
+    printf("%ldx%ld\n", fb_get_width(), fb_get_height());
+
+    fbc_setfore(COLOR_WHITE_B);
+    printf("Page flipping: ");
+    fbc_setfore(COLOR_GRAY);
+    puts(fb_has_pages() ? "enabled" : "disabled");
+    fbc_setfore(COLOR_WHITE);
+
+    return 0;
+}
+
+static int cmd_vsync(int argc, char** argv) {
+    if (argc <= 1 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
+        printf("Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s on      - Present the frames during the vertical retrace\n"
+               "\t%s off     - Present the frames as soon as possible\n"
+               "\t%s stats   - Show the frame timing\n"
+               "\t%s reset   - Reset the frame timing\n",
+               argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "on") == 0) {
+        fb_set_vsync(true);
+    } else if (strcmp(argv[1], "off") == 0) {
+        fb_set_vsync(false);
+    } else if (strcmp(argv[1], "reset") == 0) {
+        fb_reset_frame_stats();
+    } else if (strcmp(argv[1], "stats") == 0) {
+        const fb_frame_stats* stats = fb_get_frame_stats();
+        const uint32_t frames       = (stats->frames > 0) ? stats->frames : 1;
+
+        fbc_setfore(COLOR_WHITE_B);
+        printf("VSync: ");
+        fbc_setfore(COLOR_GRAY);
+        puts(fb_get_vsync() ? "on" : "off");
+
+        fbc_setfore(COLOR_WHITE_B);
+        printf("Frames: ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%ld (%ld missed retraces)\n", stats->frames, stats->missed);
+
+        fbc_setfore(COLOR_WHITE_B);
+        printf("Draw time: ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%lldus avg, %lldus max\n", stats->draw_us / frames,
+               stats->max_us);
+
+        fbc_setfore(COLOR_WHITE_B);
+        printf("Last frame interval: ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%lldus\n", stats->last_us);
+
+        fbc_setfore(COLOR_WHITE_B);
+        printf("Retrace wait: ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%lldus avg\n", stats->wait_us / frames);
+        fbc_setfore(COLOR_WHITE);
+    } else {
+        printf("Invalid option \"%s\"\n"
+               "Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s on      - Present the frames during the vertical retrace\n"
+               "\t%s off     - Present the frames as soon as possible\n"
+               "\t%s stats   - Show the frame timing\n"
+               "\t%s reset   - Reset the frame timing\n",
+               argv[1], argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    return 0;
+}
+
 static int cmd_loadkeys(int argc, char** argv) {
     if (argc <= 1 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
         printf("Usage:\n"
@@ -240,9 +462,10 @@ static int cmd_loadkeys(int argc, char** argv) {
         Layout* layout;
     } layout_pair_t;
 
-    layout_pair_t layouts[] = {
-        { "us", &us_layout },
+    /* Sorted by name, for bsearch() */
+    static const layout_pair_t layouts[] = {
         { "es", &es_layout },
+        { "us", &us_layout },
     };
 
     if (strcmp(argv[1], "--list") == 0) {
@@ -255,11 +478,11 @@ static int cmd_loadkeys(int argc, char** argv) {
 
         return 0;
     } else {
-        for (size_t i = 0; i < LENGTH(layouts); i++) {
-            if (strcmp(argv[1], layouts[i].name) == 0) {
-                kb_setlayout(layouts[i].layout);
-                return 0;
-            }
+        const layout_pair_t* pair = bsearch(argv[1], layouts, LENGTH(layouts),
+                                            sizeof(layouts[0]), cmp_name);
+        if (pair != NULL) {
+            kb_setlayout(pair->layout);
+            return 0;
         }
     }
 
@@ -295,6 +518,575 @@ static int cmd_date() {
     return 0;
 }
 
+/**
+ * @brief Get a log level from its name, for cmd_dmesg.
+ * @return The level, or -1 if the name is not valid.
+ */
+static int parse_log_level(const char* name) {
+    for (int level = LOG_ERR; level <= LOG_DEBUG; level++)
+        if (strcmp(name, log_level_name(level)) == 0)
+            return level;
+
+    return -1;
+}
+
+static int cmd_dmesg(int argc, char** argv) {
+    int max_level = LOG_DEBUG;
+
+    if (argc > 1) {
+        const int level = (argc == 3) ? parse_log_level(argv[2]) : -1;
+
+        if (level >= 0 && strcmp(argv[1], "-l") == 0) {
+            max_level = level;
+        } else if (level >= 0 && strcmp(argv[1], "-n") == 0) {
+            log_set_console_level(level);
+            return 0;
+        } else {
+            printf("Usage:\n"
+                   "\t%s --help      - Show this help\n"
+                   "\t%s             - Print the kernel log\n"
+                   "\t%s -l <level>  - Print up to the specified level\n"
+                   "\t%s -n <level>  - Set the level printed to the console\n"
+                   "Levels: err, warn, info, debug\n",
+                   argv[0], argv[0], argv[0], argv[0]);
+            return 1;
+        }
+    }
+
+    LogReader reader;
+    log_reader_init(&reader);
+
+    LogRecord rec;
+    while (log_read(&reader, &rec)) {
+        if (rec.level > max_level)
+            continue;
+
+        const uint64_t us = tsc_to_us(rec.tsc);
+        fbc_setfore(COLOR_GRAY_B);
+        printf("[%5llu.%06llu] ", us / 1000000, us % 1000000);
+
+        switch (rec.level) {
+            case LOG_ERR:
+                fbc_setfore(COLOR_RED);
+                break;
+            case LOG_WARN:
+                fbc_setfore(COLOR_YELLOW);
+                break;
+            case LOG_DEBUG:
+                fbc_setfore(COLOR_GRAY_B);
+                break;
+            default:
+                fbc_setfore(COLOR_GRAY);
+                break;
+        }
+        puts(rec.msg);
+    }
+
+    if (reader.lost > 0) {
+        fbc_setfore(COLOR_YELLOW);
+        printf("%ld records were overwritten while reading\n", reader.lost);
+    }
+
+    fbc_setfore(COLOR_WHITE);
+    return 0;
+}
+
+/**
+ * @brief Names of the stdio sinks, for cmd_serial. Indexed by the bitwise OR
+ * of stdio_sinks.
+ */
+static const char* sink_names[] = {
+    [0]                                      = "none",
+    [STDIO_SINK_CONSOLE]                     = "console",
+    [STDIO_SINK_SERIAL]                      = "serial",
+    [STDIO_SINK_CONSOLE | STDIO_SINK_SERIAL] = "both",
+};
+
+static int cmd_serial(int argc, char** argv) {
+    if (argc == 1) {
+        if (!serial_available()) {
+            puts("Serial port not available.");
+            return 1;
+        }
+
+        SerialStats stats;
+        serial_get_stats(&stats);
+
+        fbc_setfore(COLOR_WHITE_B);
+        printf("Sent:     ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%lu bytes, the ring was full %lu times\n", stats.tx_bytes,
+               stats.tx_waits);
+        fbc_setfore(COLOR_WHITE_B);
+        printf("Received: ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%lu bytes, %lu dropped\n", stats.rx_bytes, stats.rx_dropped);
+        fbc_setfore(COLOR_WHITE_B);
+        printf("IRQs:     ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%lu\n", stats.irqs);
+        fbc_setfore(COLOR_WHITE_B);
+        printf("stdout:   ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%s\n", sink_names[stdio_get_sinks(stdout)]);
+        fbc_setfore(COLOR_WHITE_B);
+        printf("stderr:   ");
+        fbc_setfore(COLOR_GRAY);
+        printf("%s\n", sink_names[stdio_get_sinks(stderr)]);
+
+        fbc_setfore(COLOR_WHITE);
+        return 0;
+    }
+
+    FILE* stream = NULL;
+    int sinks    = -1;
+
+    if (argc == 3) {
+        if (strcmp(argv[1], "stdout") == 0)
+            stream = stdout;
+        else if (strcmp(argv[1], "stderr") == 0)
+            stream = stderr;
+
+        for (size_t i = 0; i < LENGTH(sink_names); i++)
+            if (strcmp(argv[2], sink_names[i]) == 0)
+                sinks = i;
+    }
+
+    if (stream == NULL || sinks < 0) {
+        printf("Usage:\n"
+               "\t%s --help                 - Show this help\n"
+               "\t%s                        - Show the stats of the port\n"
+               "\t%s <stdout|stderr> <sink> - Select where a stream goes\n"
+               "Sinks: console, serial, both, none\n",
+               argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if ((sinks & STDIO_SINK_SERIAL) && !serial_available()) {
+        puts("Serial port not available.");
+        return 1;
+    }
+
+    stdio_set_sinks(stream, sinks);
+    return 0;
+}
+
+static int cmd_kblat(int argc, char** argv) {
+    static const char* stage_names[] = {
+        [KB_LAT_ECHO]  = "echo",
+        [KB_LAT_READ]  = "read",
+        [KB_LAT_EVENT] = "event",
+    };
+
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        kb_reset_latency();
+        return 0;
+    }
+
+    if (argc > 1) {
+        printf("Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s         - Show the latency since the keyboard IRQ\n"
+               "\t%s reset   - Empty the histograms\n"
+               "Stages:\n"
+               "\techo   - Until the typed char is on the screen\n"
+               "\tread   - Until tty_read() returns the line\n"
+               "\tevent  - Until kb_poll_event() returns the key event\n",
+               argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if (tsc_get_hz() == 0) {
+        puts("TSC not calibrated.");
+        return 1;
+    }
+
+    fbc_setfore(COLOR_WHITE_B);
+    puts("stage     samples     p50 (us)     p99 (us)     max (us)");
+    fbc_setfore(COLOR_GRAY);
+
+    for (size_t i = 0; i < LENGTH(stage_names); i++) {
+        static Histogram hist;
+        kb_get_latency(i, &hist);
+
+        printf("%-6s %10lu %12llu %12llu %12llu\n", stage_names[i],
+               hist.count, tsc_to_us(hist_percentile(&hist, 50)),
+               tsc_to_us(hist_percentile(&hist, 99)), tsc_to_us(hist.max));
+    }
+
+    fbc_setfore(COLOR_WHITE);
+    return 0;
+}
+
+static int cmd_irqs(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        irq_reset_stats();
+        return 0;
+    }
+
+    if (argc > 1) {
+        printf("Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s         - Show the stats of the lines that were used\n"
+               "\t%s reset   - Reset the counters\n",
+               argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    fbc_setfore(COLOR_WHITE_B);
+    puts("irq  handler        count  spurious   total (us)  avg (cycles)  "
+         "max (cycles)");
+    fbc_setfore(COLOR_GRAY);
+
+    for (uint8_t i = 0; i < IRQ_COUNT; i++) {
+        IrqStats stats;
+        irq_get_stats(i, &stats);
+
+        if (stats.name == NULL && stats.count == 0 && stats.spurious == 0)
+            continue;
+
+        const uint64_t avg = (stats.count > 0) ? stats.cycles / stats.count : 0;
+        printf("%3d  %-8s %11lu %9lu %12llu %13llu %13llu\n", i,
+               (stats.name != NULL) ? stats.name : "-", stats.count,
+               stats.spurious, tsc_to_us(stats.cycles), avg,
+               stats.max_cycles);
+    }
+
+    fbc_setfore(COLOR_WHITE);
+    return 0;
+}
+
+static int cmd_irqoff(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "reset") == 0) {
+        irqoff_reset();
+        return 0;
+    }
+
+    if (argc == 3 && strcmp(argv[1], "threshold") == 0) {
+        if (argv[2][0] < '0' || argv[2][0] > '9') {
+            printf("Invalid threshold \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        irqoff_set_threshold(atoi(argv[2]));
+        return 0;
+    }
+
+    if (argc > 1) {
+        printf("Usage:\n"
+               "\t%s --help          - Show this help\n"
+               "\t%s                 - Show the longest windows of each site\n"
+               "\t%s reset           - Reset the counters and the windows\n"
+               "\t%s threshold <us>  - Log the windows longer than us, 0 to\n"
+               "\t                      disable the warnings\n",
+               argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    IrqOffStats stats;
+    irqoff_get_stats(&stats);
+
+    printf("%lu windows, %lu over the threshold of %lu us, %lu logged\n\n",
+           stats.windows, stats.over, irqoff_get_threshold(), stats.warnings);
+
+    fbc_setfore(COLOR_WHITE_B);
+    puts("      us        cycles  site");
+    fbc_setfore(COLOR_GRAY);
+
+    for (int i = 0; i < IRQOFF_TOP && stats.top[i].site != 0; i++) {
+        const IrqOffWindow* w = &stats.top[i];
+        printf("%8llu  %12llu  ", tsc_to_us(w->cycles), w->cycles);
+
+        const KSym* sym = ksyms_find(w->site);
+        if (sym != NULL)
+            printf("%s+0x%lX\n", sym->name, w->site - sym->addr);
+        else
+            printf("0x%lX\n", w->site);
+    }
+
+    fbc_setfore(COLOR_WHITE);
+    return 0;
+}
+
+static int cmd_perf(int argc, char** argv) {
+    if (argc == 1) {
+        size_t count;
+        uint32_t dropped;
+        perf_get_samples(&count, &dropped);
+
+        printf("Profiler %s, %lu samples, %lu dropped\n",
+               perf_running() ? "running" : "stopped", count, dropped);
+        return 0;
+    }
+
+    if (argc <= 3 && strcmp(argv[1], "start") == 0) {
+        const int period = (argc == 3) ? atoi(argv[2]) : 1;
+        if (period <= 0) {
+            printf("Invalid period \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        perf_start(period);
+        return 0;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "stop") == 0) {
+        perf_stop();
+        return 0;
+    }
+
+    if (argc <= 3 && strcmp(argv[1], "report") == 0) {
+        const int top = (argc == 3) ? atoi(argv[2]) : 10;
+        if (top <= 0) {
+            printf("Invalid number of lines \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        if (!perf_report(top)) {
+            puts("No samples, or not enough memory for the report.");
+            return 1;
+        }
+
+        return 0;
+    }
+
+    printf("Usage:\n"
+           "\t%s --help       - Show this help\n"
+           "\t%s              - Show the state of the profiler\n"
+           "\t%s start [ms]   - Start sampling every ms ticks (default 1)\n"
+           "\t%s stop         - Stop sampling\n"
+           "\t%s report [n]   - Stop, and show the top n functions and call\n"
+           "\t                    chains (default 10)\n",
+           argv[0], argv[0], argv[0], argv[0], argv[0]);
+    return 1;
+}
+
+static int cmd_perfstat(int argc, char** argv) {
+    if (argc < 2 || strcmp(argv[1], "--help") == 0) {
+        printf("Usage:\n"
+               "\t%s --help         - Show this help\n"
+               "\t%s <cmd> [args]   - Run cmd, and show the cycles,\n"
+               "\t                      instructions, LLC misses and branch\n"
+               "\t                      misses of the whole system meanwhile\n",
+               argv[0], argv[0]);
+        return 1;
+    }
+
+    const Command* cmd = find_cmd(argv[1]);
+    if (cmd == NULL) {
+        printf("Unknown command \"%s\"\n", argv[1]);
+        return 1;
+    }
+
+    if (!pmu_available())
+        puts("No performance counters (e.g. QEMU without KVM), only the time "
+             "is measured.");
+
+    const bool counting  = pmu_start();
+    const uint64_t start = tsc_read();
+
+    const int ret = cmd->func(argc - 1, &argv[1]);
+
+    const uint64_t elapsed = tsc_read() - start;
+    /* Don't stop the counters of an outer perfstat if we didn't get them */
+    PmuCounts counts = { 0 };
+    if (counting)
+        pmu_stop(&counts);
+
+    printf("\nPerformance counter stats for '%s':\n\n", argv[1]);
+
+    if (pmu_available() && !counting)
+        puts("  Counters busy, already in perfstat.");
+
+    for (uint8_t i = 0; counting && i < PMU_EVENT_COUNT; i++) {
+        if (!(counts.counted & (1 << i))) {
+            printf("%16s  %s\n", "<not supported>", pmu_event_name(i));
+            continue;
+        }
+
+        printf("%16llu  %s", counts.values[i], pmu_event_name(i));
+
+        /* Instructions per cycle with 2 decimals */
+        const uint64_t cycles = counts.values[PMU_CYCLES];
+        if (i == PMU_INSTRUCTIONS && (counts.counted & (1 << PMU_CYCLES)) &&
+            cycles > 0) {
+            const uint64_t ipc = counts.values[i] * 100 / cycles;
+            printf("  # %llu.%02llu insn per cycle", ipc / 100, ipc % 100);
+        }
+
+        putchar('\n');
+    }
+
+    printf("\n%16llu  us elapsed\n", tsc_to_us(elapsed));
+    return ret;
+}
+
+static int cmd_trace(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && strcmp(argv[1], "on") != 0 &&
+                     strcmp(argv[1], "off") != 0 &&
+                     strcmp(argv[1], "dump") != 0)) {
+        printf("Usage:\n"
+               "\t%s --help  - Show this help\n"
+               "\t%s         - Show the state of the trace ring\n"
+               "\t%s on      - Empty the ring and start recording\n"
+               "\t%s off     - Stop recording\n"
+               "\t%s dump    - Stop, and send the ring through serial. See\n"
+               "\t              scripts/trace2json.py\n",
+               argv[0], argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if (!trace_available()) {
+        puts("The kernel was not built with tracing, see \"make trace\".");
+        return 1;
+    }
+
+    if (argc == 1) {
+        uint32_t overwritten;
+        const size_t count = trace_count(&overwritten);
+
+        printf("Tracing %s, %lu events, %lu overwritten\n",
+               trace_running() ? "running" : "stopped", count, overwritten);
+        return 0;
+    }
+
+    if (strcmp(argv[1], "on") == 0) {
+        trace_start();
+    } else if (strcmp(argv[1], "off") == 0) {
+        trace_stop();
+    } else {
+        /* Stop first, so the message is not in the trace */
+        trace_stop();
+        printf("Sending %lu events...\n", trace_count(NULL));
+
+        if (!trace_dump()) {
+            puts("Serial port not available, or not enough memory.");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Print the arguments of a tracepoint event, for cmd_tp.
+ */
+static void print_tp_args(const TpEvent* ev) {
+    switch (ev->id) {
+        case TP_MT_SWITCH:
+            printf("%s -> %s", (const char*)ev->arg0, (const char*)ev->arg1);
+            break;
+        case TP_IRQ_ENTRY:
+            printf("irq %lu, eip 0x%lX", ev->arg0, ev->arg1);
+            break;
+        case TP_IRQ_EXIT:
+            printf("irq %lu, %lu cycles", ev->arg0, ev->arg1);
+            break;
+        case TP_HEAP_ALLOC:
+            printf("%lu bytes at 0x%lX", ev->arg0, ev->arg1);
+            break;
+        case TP_HEAP_FREE:
+            printf("0x%lX, %lu bytes", ev->arg0, ev->arg1);
+            break;
+        case TP_FBC_SHIFT:
+            printf("%lu rows", ev->arg0);
+            break;
+        case TP_KB_EVENT:
+            printf("key 0x%lX %s, mods 0x%lX", ev->arg0,
+                   (ev->arg1 & 1) ? "pressed" : "released", ev->arg1 >> 8);
+            break;
+        default:
+            printf("0x%lX 0x%lX", ev->arg0, ev->arg1);
+            break;
+    }
+}
+
+static int cmd_tp(int argc, char** argv) {
+    if (argc == 1) {
+        for (uint8_t i = 0; i < TP_COUNT; i++)
+            printf("%-16s %s\n", tp_name(i),
+                   (tp_enabled & (1u << i)) ? "on" : "off");
+
+        return 0;
+    }
+
+    if (argc == 3 &&
+        (strcmp(argv[1], "on") == 0 || strcmp(argv[1], "off") == 0)) {
+        const bool on  = strcmp(argv[1], "on") == 0;
+        const bool all = strcmp(argv[2], "all") == 0;
+        bool found     = false;
+
+        for (uint8_t i = 0; i < TP_COUNT; i++) {
+            if (all || strcmp(argv[2], tp_name(i)) == 0) {
+                tp_enable(i, on);
+                found = true;
+            }
+        }
+
+        if (!found) {
+            printf("Unknown tracepoint \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        return 0;
+    }
+
+    if (argc == 2 && strcmp(argv[1], "clear") == 0) {
+        tp_clear();
+        return 0;
+    }
+
+    if (argc <= 3 && strcmp(argv[1], "show") == 0) {
+        const int max = (argc == 3) ? atoi(argv[2]) : 20;
+        if (max <= 0 || max > TP_RING_SZ) {
+            printf("Invalid number of events \"%s\"\n", argv[2]);
+            return 1;
+        }
+
+        TpEvent* events = malloc(max * sizeof(TpEvent));
+        if (events == NULL) {
+            puts("Not enough memory.");
+            return 1;
+        }
+
+        uint32_t lost;
+        const size_t n = tp_read(events, max, &lost);
+
+        fbc_setfore(COLOR_WHITE_B);
+        puts("   time (us)  delta (us)  tracepoint");
+        fbc_setfore(COLOR_GRAY);
+
+        for (size_t i = 0; i < n; i++) {
+            const uint64_t delta =
+              (i > 0) ? events[i].tsc - events[i - 1].tsc : 0;
+
+            printf("%12llu %11llu  %-16s ",
+                   tsc_to_us(events[i].tsc - events[0].tsc),
+                   tsc_to_us(delta), tp_name(events[i].id));
+            print_tp_args(&events[i]);
+            putchar('\n');
+        }
+
+        if (lost > 0) {
+            fbc_setfore(COLOR_YELLOW);
+            printf("%lu older events were overwritten\n", lost);
+        }
+
+        fbc_setfore(COLOR_WHITE);
+        free(events);
+        return 0;
+    }
+
+    printf("Usage:\n"
+           "\t%s --help            - Show this help\n"
+           "\t%s                   - List the tracepoints\n"
+           "\t%s <on|off> <name>   - Enable or disable a tracepoint, or all\n"
+           "\t%s show [n]          - Show the last n events (default 20)\n"
+           "\t%s clear             - Discard the events\n",
+           argv[0], argv[0], argv[0], argv[0], argv[0]);
+    return 1;
+}
+
 static int cmd_timer(int argc, char** argv) {
     if (argc <= 1 || !strcmp(argv[1], "-h") || !strcmp(argv[1], "--help")) {
         printf("Usage:\n"
@@ -560,7 +1352,8 @@ static int cmd_play(int argc, char** argv) {
         void (*func)(void);
     } song_pair_t;
 
-    song_pair_t songs[] = {
+    /* Sorted by name, for bsearch() */
+    static const song_pair_t songs[] = {
         { "soviet", &play_soviet_anthem },
         { "thunder", &play_thunderstruck },
         { "thunderstruck", &play_thunderstruck },
@@ -576,13 +1369,13 @@ static int cmd_play(int argc, char** argv) {
 
         return 0;
     } else {
-        for (size_t i = 0; i < LENGTH(songs); i++) {
-            if (strcmp(argv[1], songs[i].name) == 0) {
-                /* Call the function */
-                (*songs[i].func)();
+        const song_pair_t* pair = bsearch(argv[1], songs, LENGTH(songs),
+                                          sizeof(songs[0]), cmp_name);
+        if (pair != NULL) {
+            /* Call the function */
+            (*pair->func)();
 
-                return 0;
-            }
+            return 0;
         }
     }
 
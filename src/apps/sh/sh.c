@@ -4,7 +4,8 @@
 #include <stdbool.h>
 #include <string.h>
 
-#include <kernel/color.h> /* color palette */
+#include <kernel/color.h>   /* color palette */
+#include <kernel/hashmap.h> /* HashMap */
 
 #include "sh.h"
 #include "commands.h"
@@ -14,6 +15,48 @@
 
 #define LENGTH(arr) (sizeof(arr) / sizeof(arr[0]))
 
+/**
+ * @brief Commands of cmd_list by name. Shared by the shells of all the
+ * virtual terminals.
+ */
+static HashMap cmd_map;
+static bool cmd_map_ready = false;
+
+/**
+ * @brief Fill cmd_map with the commands of cmd_list, if it's not ready yet.
+ * @return False if it could not be allocated.
+ */
+static bool init_cmd_map(void) {
+    if (cmd_map_ready)
+        return true;
+
+    if (!hashmap_init(&cmd_map, LENGTH(cmd_list), true))
+        return false;
+
+    for (size_t i = 0; i < LENGTH(cmd_list); i++)
+        hashmap_put_str(&cmd_map, cmd_list[i].cmd, &cmd_list[i]);
+
+    cmd_map_ready = true;
+    return true;
+}
+
+/**
+ * @brief Get the command with the specified name.
+ * @param[in] name Name of the command, argv[0]
+ * @return Command of cmd_list, or NULL if there isn't one.
+ */
+static Command* find_cmd(const char* name) {
+    if (cmd_map_ready)
+        return hashmap_get_str(&cmd_map, name);
+
+    /* Could not allocate the map, search the list */
+    for (size_t i = 0; i < LENGTH(cmd_list); i++)
+        if (strcmp(name, cmd_list[i].cmd) == 0)
+            return &cmd_list[i];
+
+    return NULL;
+}
+
 int sh_main(void) {
     int c = 0;
 
@@ -21,6 +64,8 @@ int sh_main(void) {
     char* argv[MAX_ARGC]     = { 0 };
     int argc                 = 0;
 
+    init_cmd_map();
+
     while (!quit_sh) {
         fbc_setfore(COLOR_WHITE_B);
         printf("\n$ ");
@@ -62,18 +107,16 @@ int sh_main(void) {
         printf("%p ]\n", argv[argv_i]); /* Last one is supposed to be NULL */
 #endif
 
-        bool valid_cmd = false;
-        for (size_t i = 0; i < LENGTH(cmd_list); i++) {
-            if (strcmp(argv[0], cmd_list[i].cmd) == 0) {
-                /* Call the function with the args and store the return value */
-                last_ret  = (*cmd_list[i].func)(argc, argv);
-                valid_cmd = true;
-                break;
-            }
-        }
+        /* Empty command */
+        if (argc == 0)
+            continue;
 
-        /* If none of the cmds of cmd_list were valid, error */
-        if (!valid_cmd && cur_cmd[0] != '\0')
+        /* Call the function with the args and store the return value. If none
+         * of the cmds of cmd_list were valid, error */
+        const Command* cmd = find_cmd(argv[0]);
+        if (cmd != NULL)
+            last_ret = (*cmd->func)(argc, argv);
+        else
             cmd_unk();
     }
 
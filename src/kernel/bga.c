@@ -0,0 +1,76 @@
+
+/**
+ * @brief Bochs Graphics Adaptor.
+ *
+ * See: https://wiki.osdev.org/Bochs_VBE_Extensions
+ *
+ * @file
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/bga.h>
+#include <kernel/io.h>
+
+/**
+ * @brief Writes \p data to the specified BGA register
+ * @param reg Register index. See bga_regs
+ * @param data Value to write
+ */
+static inline void bga_write(uint16_t reg, uint16_t data) {
+    io_outw(BGA_PORT_INDEX, reg);
+    io_outw(BGA_PORT_DATA, data);
+}
+
+/**
+ * @brief Reads from the specified BGA register
+ * @param reg Register index. See bga_regs
+ * @return Value of the register
+ */
+static inline uint16_t bga_read(uint16_t reg) {
+    io_outw(BGA_PORT_INDEX, reg);
+    return io_inw(BGA_PORT_DATA);
+}
+
+bool bga_available(void) {
+    const uint16_t id = bga_version();
+    return id >= BGA_ID_MIN && id <= BGA_ID_MAX;
+}
+
+uint16_t bga_version(void) {
+    return bga_read(BGA_REG_ID);
+}
+
+uint32_t bga_get_vram(void) {
+    /* Older versions don't have the register */
+    if (bga_version() < 0xB0C4)
+        return 0;
+
+    return bga_read(BGA_REG_VIDEO_MEM) * 0x10000;
+}
+
+bool bga_set_mode(uint16_t w, uint16_t h, uint16_t bpp, uint16_t virt_h) {
+    /* We need to disable the display before changing the mode */
+    bga_write(BGA_REG_ENABLE, BGA_DISABLED);
+
+    bga_write(BGA_REG_XRES, w);
+    bga_write(BGA_REG_YRES, h);
+    bga_write(BGA_REG_BPP, bpp);
+    bga_write(BGA_REG_VIRT_WIDTH, w);
+    bga_write(BGA_REG_VIRT_HEIGHT, virt_h);
+    bga_write(BGA_REG_X_OFFSET, 0);
+    bga_write(BGA_REG_Y_OFFSET, 0);
+
+    /* Keep whatever we had drawn */
+    bga_write(BGA_REG_ENABLE, BGA_ENABLED | BGA_LFB_ENABLED | BGA_NOCLEARMEM);
+
+    /* The BGA will clamp the values it doesn't support, so check if it's what
+     * we asked for */
+    return bga_read(BGA_REG_XRES) == w && bga_read(BGA_REG_YRES) == h &&
+           bga_read(BGA_REG_BPP) == bpp &&
+           bga_read(BGA_REG_VIRT_HEIGHT) >= virt_h;
+}
+
+void bga_set_yoffset(uint16_t y) {
+    bga_write(BGA_REG_Y_OFFSET, y);
+}
@@ -0,0 +1,411 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <kernel/compositor.h>
+#include <kernel/framebuffer.h>
+#include <kernel/irq.h> /* irq_save, irq_restore, irq_enable */
+
+/**
+ * @brief List of surfaces, sorted by z from bottom to top.
+ */
+static Surface* surfaces = NULL;
+
+/**
+ * @brief Damaged columns of a row of the screen, from x0 to x1 (not included).
+ * @details The row is not damaged if x0 >= x1.
+ */
+typedef struct {
+    uint32_t x0, x1;
+} row_damage;
+
+/**
+ * @name Damaged regions of the screen
+ * @details Damaged columns of each row. Rows are not merged with each other,
+ * so we never compose rows that were not damaged (e.g. the console rows
+ * between two damaged surfaces). comp_damage() writes to `damage`, and
+ * comp_compose() swaps it with `composed`, which only it uses. Allocated by
+ * damage_alloc()
+ * @{ */
+static row_damage* damage   = NULL;
+static row_damage* composed = NULL;
+static volatile uint32_t damage_y0 = UINT32_MAX; /**< @brief First row */
+static volatile uint32_t damage_y1 = 0;          /**< @brief Last row + 1 */
+/** @} */
+
+/**
+ * @brief True while comp_compose() is drawing.
+ * @details Used so the PIT interrupt doesn't start a composition while we are
+ * already composing. See comp_render_tick()
+ */
+static volatile bool composing = false;
+
+/**
+ * @brief PIT tick of the last composition from comp_render_tick()
+ */
+static uint64_t last_render = 0;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Get the area of the screen covered by a surface.
+ * @param[in] s Target surface
+ * @return Rectangle of the surface
+ */
+static inline comp_rect surface_rect(const Surface* s) {
+    return (comp_rect){ s->y, s->x, s->h, s->w };
+}
+
+/**
+ * @brief Check if two rectangles overlap.
+ * @param[in] a, b Rectangles to check
+ * @return True if they share at least one px
+ */
+static inline bool rect_overlap(const comp_rect* a, const comp_rect* b) {
+    return a->y < b->y + b->h && b->y < a->y + a->h && a->x < b->x + b->w &&
+           b->x < a->x + a->w;
+}
+
+/**
+ * @brief Check if \p outer contains all of \p inner
+ * @param[in] outer, inner Rectangles to check
+ * @return True if every px of \p inner is inside \p outer
+ */
+static inline bool rect_contains(const comp_rect* outer,
+                                 const comp_rect* inner) {
+    return inner->y >= outer->y && inner->x >= outer->x &&
+           inner->y + inner->h <= outer->y + outer->h &&
+           inner->x + inner->w <= outer->x + outer->w;
+}
+
+/**
+ * @brief Get the intersection of two rectangles
+ * @param[in] a, b Rectangles to intersect
+ * @param[out] out Intersection, only written if they overlap
+ * @return True if they overlap
+ */
+static inline bool rect_intersect(const comp_rect* a, const comp_rect* b,
+                                  comp_rect* out) {
+    if (!rect_overlap(a, b))
+        return false;
+
+    const uint32_t y0 = (a->y > b->y) ? a->y : b->y;
+    const uint32_t x0 = (a->x > b->x) ? a->x : b->x;
+    const uint32_t y1 = (a->y + a->h < b->y + b->h) ? a->y + a->h : b->y + b->h;
+    const uint32_t x1 = (a->x + a->w < b->x + b->w) ? a->x + a->w : b->x + b->w;
+
+    *out = (comp_rect){ y0, x0, y1 - y0, x1 - x0 };
+    return true;
+}
+
+/**
+ * @brief Allocate the damage arrays, with an item for each row of the screen.
+ * @details Called when creating the first surface, so it never allocates from
+ * the PIT interrupt.
+ * @return False if there was not enough memory
+ */
+static bool damage_alloc(void) {
+    if (damage != NULL)
+        return true;
+
+    const uint32_t fb_h = fb_get_height();
+
+    row_damage* a = malloc(fb_h * sizeof(row_damage));
+    row_damage* b = malloc(fb_h * sizeof(row_damage));
+    if (a == NULL || b == NULL) {
+        free(a);
+        free(b);
+        return false;
+    }
+
+    for (uint32_t y = 0; y < fb_h; y++) {
+        a[y] = (row_damage){ UINT32_MAX, 0 };
+        b[y] = (row_damage){ UINT32_MAX, 0 };
+    }
+
+    composed = b;
+    damage   = a;
+    return true;
+}
+
+/**
+ * @brief Insert a surface in the list, after the ones with the same z.
+ * @details The PIT might compose while we change the list, see
+ * comp_render_tick()
+ * @param[out] s Surface to insert
+ */
+static void surface_insert(Surface* s) {
+    const uint32_t eflags = irq_save();
+
+    Surface** cur = &surfaces;
+    while (*cur != NULL && (*cur)->z <= s->z)
+        cur = &(*cur)->next;
+
+    s->next = *cur;
+    *cur    = s;
+
+    irq_restore(eflags);
+}
+
+/**
+ * @brief Remove a surface from the list.
+ * @details Same as surface_insert(), protected from the PIT composition.
+ * @param[in] s Surface to remove
+ */
+static void surface_remove(const Surface* s) {
+    const uint32_t eflags = irq_save();
+
+    for (Surface** cur = &surfaces; *cur != NULL; cur = &(*cur)->next) {
+        if (*cur == s) {
+            *cur = s->next;
+            break;
+        }
+    }
+
+    irq_restore(eflags);
+}
+
+/**
+ * @brief Draw a damaged region of the screen.
+ * @details Surfaces below the topmost one that covers the whole region are
+ * hidden, so we start from that one. If none of them covers it, we fill the
+ * region with COMP_BG first.
+ * @param[out] fb_ptr Page of the framebuffer to draw into.
+ * @param[in] r Region of the screen, inside the framebuffer.
+ */
+static void compose_rect(uint32_t* fb_ptr, const comp_rect* r) {
+    const uint32_t fb_w = fb_get_width();
+
+    Surface* first = NULL;
+    for (Surface* s = surfaces; s != NULL; s = s->next) {
+        const comp_rect sr = surface_rect(s);
+        if (s->visible && rect_contains(&sr, r))
+            first = s;
+    }
+
+    if (first == NULL) {
+        for (uint32_t y = r->y; y < r->y + r->h; y++)
+            for (uint32_t x = r->x; x < r->x + r->w; x++)
+                fb_ptr[y * fb_w + x] = COMP_BG;
+
+        first = surfaces;
+    }
+
+    for (Surface* s = first; s != NULL; s = s->next) {
+        const comp_rect sr = surface_rect(s);
+        comp_rect i;
+
+        if (!s->visible || !rect_intersect(&sr, r, &i))
+            continue;
+
+        /* Copy each row of the intersection */
+        for (uint32_t y = i.y; y < i.y + i.h; y++)
+            memcpy(&fb_ptr[y * fb_w + i.x],
+                   &s->px[(y - s->y) * s->w + (i.x - s->x)],
+                   i.w * sizeof(uint32_t));
+    }
+}
+
+/**
+ * @brief Draw a damaged region into the pages of the framebuffer.
+ * @details With page flipping, we draw into both pages so the other one is not
+ * stale after the next flip.
+ * @param[in] r Region of the screen, inside the framebuffer.
+ */
+static void compose_pages(const comp_rect* r) {
+    uint32_t* const other = fb_get_other_ptr();
+
+    compose_rect(fb_get_ptr(), r);
+
+    if (other != NULL)
+        compose_rect(other, r);
+}
+
+/* -------------------------------------------------------------------------- */
+
+Surface* comp_surface_new(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
+                          int32_t z) {
+    if (!damage_alloc())
+        return NULL;
+
+    Surface* s = malloc(sizeof(Surface));
+    if (s == NULL)
+        return NULL;
+
+    s->px = malloc(h * w * sizeof(uint32_t));
+    if (s->px == NULL) {
+        free(s);
+        return NULL;
+    }
+
+    for (uint32_t i = 0; i < h * w; i++)
+        s->px[i] = COMP_BG;
+
+    s->y       = y;
+    s->x       = x;
+    s->h       = h;
+    s->w       = w;
+    s->z       = z;
+    s->visible = true;
+
+    surface_insert(s);
+    comp_damage(y, x, h, w);
+
+    return s;
+}
+
+void comp_surface_free(Surface* s) {
+    surface_remove(s);
+
+    if (s->visible)
+        comp_damage(s->y, s->x, s->h, s->w);
+
+    free(s->px);
+    free(s);
+}
+
+void comp_surface_move(Surface* s, uint32_t y, uint32_t x) {
+    if (s->visible)
+        comp_damage(s->y, s->x, s->h, s->w);
+
+    /* Don't let the PIT compose with half of the new position */
+    const uint32_t eflags = irq_save();
+
+    s->y = y;
+    s->x = x;
+
+    irq_restore(eflags);
+
+    if (s->visible)
+        comp_damage(s->y, s->x, s->h, s->w);
+}
+
+void comp_surface_show(Surface* s, bool visible) {
+    if (s->visible == visible)
+        return;
+
+    s->visible = visible;
+    comp_damage(s->y, s->x, s->h, s->w);
+}
+
+void comp_surface_damage(const Surface* s, uint32_t y, uint32_t x, uint32_t h,
+                         uint32_t w) {
+    if (!s->visible || y >= s->h || x >= s->w)
+        return;
+
+    /* Clip to the surface size */
+    if (y + h > s->h)
+        h = s->h - y;
+    if (x + w > s->w)
+        w = s->w - x;
+
+    comp_damage(s->y + y, s->x + x, h, w);
+}
+
+void comp_damage(uint32_t y, uint32_t x, uint32_t h, uint32_t w) {
+    const uint32_t fb_h = fb_get_height();
+    const uint32_t fb_w = fb_get_width();
+
+    if (y >= fb_h || x >= fb_w || h == 0 || w == 0)
+        return;
+
+    /* Clip to the screen size */
+    if (y + h > fb_h)
+        h = fb_h - y;
+    if (x + w > fb_w)
+        w = fb_w - x;
+
+    /* Nothing to compose without surfaces, see damage_alloc() */
+    if (damage == NULL)
+        return;
+
+    /* The PIT might compose while we change the rows. We might be called
+     * with the interrupts disabled, so don't enable them after it */
+    const uint32_t eflags = irq_save();
+
+    for (uint32_t row = y; row < y + h; row++) {
+        row_damage* const d = &damage[row];
+
+        if (x < d->x0)
+            d->x0 = x;
+        if (x + w > d->x1)
+            d->x1 = x + w;
+    }
+
+    if (y < damage_y0)
+        damage_y0 = y;
+    if (y + h > damage_y1)
+        damage_y1 = y + h;
+
+    irq_restore(eflags);
+}
+
+bool comp_has_damage(void) {
+    return damage_y0 < damage_y1;
+}
+
+void comp_compose(void) {
+    /* The PIT might start composing between the check and the set */
+    const uint32_t eflags = irq_save();
+
+    if (composing || damage_y0 >= damage_y1) {
+        irq_restore(eflags);
+        return;
+    }
+
+    composing = true;
+
+    /* Take the damaged rows and give comp_damage() the clear array before
+     * drawing, so rows that get damaged while we are drawing are not lost */
+    row_damage* const rows = damage;
+    const uint32_t y0      = damage_y0;
+    const uint32_t y1      = damage_y1;
+
+    damage    = composed;
+    composed  = rows;
+    damage_y0 = UINT32_MAX;
+    damage_y1 = 0;
+
+    irq_restore(eflags);
+
+    /* Compose the runs of rows with the same damaged columns as a single
+     * region, and clear them for the next swap */
+    comp_rect r = { y0, 0, 0, 0 };
+
+    for (uint32_t y = y0; y < y1; y++) {
+        const row_damage d = rows[y];
+        rows[y]            = (row_damage){ UINT32_MAX, 0 };
+
+        if (r.h > 0 && d.x0 == r.x && d.x1 == r.x + r.w) {
+            r.h++;
+            continue;
+        }
+
+        if (r.h > 0)
+            compose_pages(&r);
+
+        if (d.x0 < d.x1)
+            r = (comp_rect){ y, d.x0, 1, d.x1 - d.x0 };
+        else
+            r.h = 0;
+    }
+
+    if (r.h > 0)
+        compose_pages(&r);
+
+    composing = false;
+}
+
+void comp_render_tick(uint64_t ticks) {
+    if (damage_y0 >= damage_y1 || composing ||
+        ticks - last_render < COMP_RENDER_INTERVAL)
+        return;
+
+    last_render = ticks;
+
+    /* Called from the PIT interrupt, after the EOI. See fbc_render_tick() */
+    irq_enable();
+
+    comp_compose();
+}
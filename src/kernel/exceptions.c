@@ -1,6 +1,7 @@
 
 #include <stdlib.h>
 #include <kernel/exceptions.h>
+#include <kernel/irq.h> /* irq_disable */
 
 static char* exceptions[] = {
     [0]  = "division by zero",
@@ -26,11 +27,8 @@ static char* exceptions[] = {
 };
 
 void handle_exception(int exc) {
-    /*
-     * See:
-     *   https://gcc.gnu.org/onlinedocs/gcc/Using-Assembly-Language-with-C.html
-     */
-    asm("cli");
+    /* Never enabled again, so the `irqoff` stats show where we panicked */
+    irq_disable();
 
     panic_line("exception: %s\n", exceptions[exc]);
 }
@@ -1,5 +1,12 @@
 
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
 #include <kernel/framebuffer.h>
+#include <kernel/bga.h>
+#include <kernel/vga.h> /* vga_in_retrace */
+#include <kernel/tsc.h>
+#include <kernel/irq.h> /* irq_save, irq_restore */
 
 /* Framebuffer globals */
 static uint32_t* g_fb;
@@ -8,6 +15,27 @@ static uint32_t g_width;
 static uint32_t g_height;
 static uint32_t g_bpp;
 
+/* Page flipping globals. g_pages[0] is the framebuffer from the bootloader. g_fb
+ * will point to the page we are drawing into. */
+static bool g_has_pages = false;
+static uint32_t* g_pages[2];
+static uint8_t g_front = 0;
+
+/* Rows drawn since the last fb_begin_frame(), from g_damage_y0 to
+ * g_damage_y1 (not included). Either into the visible page, or into the back
+ * page during the frame, which is visible after the flip. The other page
+ * doesn't have them, so the next fb_begin_frame() copies them. */
+static bool g_in_frame      = false;
+static uint32_t g_damage_y0 = UINT32_MAX;
+static uint32_t g_damage_y1 = 0;
+
+/* VSync and frame timing globals. g_frame_start is the TSC of the last
+ * fb_begin_frame(), g_last_frame the TSC of the last fb_frame_done(). */
+static bool g_vsync           = false;
+static uint64_t g_frame_start = 0;
+static uint64_t g_last_frame  = 0;
+static fb_frame_stats g_stats = { 0 };
+
 void fb_init(uint32_t* fb, uint32_t pitch, uint32_t w, uint32_t h,
              uint32_t bpp) {
     /* Set globals to the parameter values we received from main (multiboot
@@ -37,11 +65,27 @@ uint32_t fb_get_height(void) {
     return g_height;
 }
 
+void fb_damage_rows(uint32_t y, uint32_t h) {
+    if (!g_has_pages || h == 0)
+        return;
+
+    /* The console also draws from the PIT interrupt */
+    const uint32_t eflags = irq_save();
+
+    if (y < g_damage_y0)
+        g_damage_y0 = y;
+    if (y + h > g_damage_y1)
+        g_damage_y1 = y + h;
+
+    irq_restore(eflags);
+}
+
 void fb_setpx_col(uint32_t y, uint32_t x, uint32_t col) {
     if (y >= g_height || x >= g_width)
         return;
 
     g_fb[y * g_width + x] = col;
+    fb_damage_rows(y, 1);
 }
 
 void fb_drawrect_col(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
@@ -58,6 +102,8 @@ void fb_drawrect_col(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
     for (uint32_t cur_y = y; cur_y < y + h; cur_y++)
         for (uint32_t cur_x = x; cur_x < x + w; cur_x++)
             g_fb[cur_y * g_width + cur_x] = col;
+
+    fb_damage_rows(y, h);
 }
 
 void fb_drawrect_fast(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
@@ -65,5 +111,148 @@ void fb_drawrect_fast(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
     for (uint32_t cur_y = y; cur_y < y + h; cur_y++)
         for (uint32_t cur_x = x; cur_x < x + w; cur_x++)
             g_fb[cur_y * g_width + cur_x] = col;
+
+    fb_damage_rows(y, h);
+}
+
+bool fb_init_pages(void) {
+    if (!bga_available())
+        return false;
+
+    /* Make sure we have enough video memory for both pages, if the BGA can
+     * tell us */
+    const uint32_t page_sz = g_height * g_width * sizeof(uint32_t);
+    const uint32_t vram    = bga_get_vram();
+    if (vram != 0 && vram < page_sz * 2)
+        return false;
+
+    if (!bga_set_mode(g_width, g_height, g_bpp, g_height * 2))
+        return false;
+
+    g_pages[0] = g_fb;
+    g_pages[1] = g_fb + g_height * g_width;
+    g_front    = 0;
+
+    /* Both pages start with the same contents, so the parts of the screen
+     * that are not redrawn each frame are the same after flipping */
+    memcpy(g_pages[1], g_pages[0], page_sz);
+
+    g_has_pages = true;
+    return true;
+}
+
+bool fb_has_pages(void) {
+    return g_has_pages;
 }
 
+uint32_t* fb_get_other_ptr(void) {
+    if (!g_has_pages)
+        return NULL;
+
+    return (g_fb == g_pages[0]) ? g_pages[1] : g_pages[0];
+}
+
+void fb_begin_frame(void) {
+    g_frame_start = tsc_read();
+
+    if (!g_has_pages)
+        return;
+
+    /* Bring the rows drawn since the last frame started, including the ones
+     * of that frame, to the back page. The
+     * interrupts stay disabled so the PIT can't draw into the page we are
+     * copying to. */
+    const uint32_t eflags = irq_save();
+
+    if (g_damage_y0 < g_damage_y1) {
+        if (g_damage_y1 > g_height)
+            g_damage_y1 = g_height;
+
+        memcpy(&g_pages[!g_front][g_damage_y0 * g_width],
+               &g_pages[g_front][g_damage_y0 * g_width],
+               (g_damage_y1 - g_damage_y0) * g_width * sizeof(uint32_t));
+    }
+
+    g_damage_y0 = UINT32_MAX;
+    g_damage_y1 = 0;
+
+    g_fb       = g_pages[!g_front];
+    g_in_frame = true;
+
+    irq_restore(eflags);
+}
+
+void fb_end_frame(void) {
+    if (!g_has_pages)
+        return;
+
+    /* Flipping is a single register write, so it won't tear if we do it
+     * during the retrace */
+    fb_vsync_wait();
+
+    /* Display the back page and keep drawing into it, since it's now the
+     * visible one */
+    g_front = !g_front;
+    bga_set_yoffset(g_front * g_height);
+    g_fb       = g_pages[g_front];
+    g_in_frame = false;
+
+    fb_frame_done(g_frame_start);
+}
+
+bool fb_in_frame(void) {
+    return g_in_frame;
+}
+
+void fb_set_vsync(bool enable) {
+    g_vsync = enable;
+}
+
+bool fb_get_vsync(void) {
+    return g_vsync;
+}
+
+bool fb_vsync_ready(void) {
+    return !g_vsync || vga_in_retrace();
+}
+
+bool fb_vsync_wait(void) {
+    if (fb_vsync_ready())
+        return true;
+
+    const uint64_t start   = tsc_read();
+    const uint64_t timeout = tsc_get_hz() / 1000 * FB_VSYNC_TIMEOUT_MS;
+
+    while (!vga_in_retrace()) {
+        if (tsc_read() - start > timeout) {
+            g_stats.missed++;
+            return false;
+        }
+    }
+
+    g_stats.wait_us += tsc_to_us(tsc_read() - start);
+    return true;
+}
+
+void fb_frame_done(uint64_t start_tsc) {
+    const uint64_t now     = tsc_read();
+    const uint64_t draw_us = tsc_to_us(now - start_tsc);
+
+    if (g_stats.frames > 0)
+        g_stats.last_us = tsc_to_us(now - g_last_frame);
+
+    g_stats.frames++;
+    g_stats.draw_us += draw_us;
+    if (draw_us > g_stats.max_us)
+        g_stats.max_us = draw_us;
+
+    g_last_frame = now;
+}
+
+const fb_frame_stats* fb_get_frame_stats(void) {
+    return &g_stats;
+}
+
+void fb_reset_frame_stats(void) {
+    g_stats = (fb_frame_stats){ 0 };
+}
@@ -2,10 +2,15 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <kernel/color.h>
 #include <kernel/vga.h> /* VGA_CONSOLE_ADDR */
 #include <kernel/framebuffer.h>
 #include <kernel/framebuffer_console.h>
+#include <kernel/tsc.h>
+#include <kernel/keyboard.h> /* kb_echo_presented */
+#include <kernel/tracepoint.h>
+#include <kernel/irq.h> /* irq_enable, irq_save, irq_restore */
 
 /**
  * @brief Converts a char Y position in the fbc to a pixel position
@@ -21,6 +26,11 @@
  */
 #define CHAR_X_TO_PX(fx) (ctx->x + ((fx)*ctx->font->w))
 
+/**
+ * @brief Number of items of an array known at compile-time
+ */
+#define LENGTH(arr) (sizeof(arr) / sizeof(arr[0]))
+
 /*
  * Current context of the framebuffer console. For more information see:
  *   src/kernel/include/kernel/framebuffer_console.h
@@ -29,24 +39,125 @@
  *   - uint32_t y, x, h, w
  *   - uint32_t ch_h, ch_w
  *   - Font* font
- *   - color_pair cur_cols
+ *   - uint32_t palette[FBC_PALETTE_SZ]
+ *   - uint16_t palette_sz
+ *   - uint8_t cur_fg, cur_bg, cur_attr
  *   - uint32_t cur_y, cur_x
+ *   - bool should_shift
+ *   - bool deferred
+ *   - bool* dirty
+ *   - bool has_dirty
+ *   - uint8_t vt
+ *   - fbc_entry* sb
+ *   - uint32_t sb_rows, sb_head, sb_count, sb_view
  */
 static fbc_ctx _first_ctx;
 static fbc_ctx* ctx = &_first_ctx;
 
+/**
+ * @brief Last context used by each virtual terminal. See fbc_change_ctx()
+ */
+static fbc_ctx* vt_top[VT_COUNT] = { &_first_ctx };
+
+/**
+ * @brief Virtual terminal being displayed. Contexts of other terminals don't
+ * draw to the framebuffer.
+ */
+static uint8_t shown_vt = 0;
+
+/**
+ * @brief Colors used to fill the palette of new contexts.
+ * @details The first items need to match the fbc_palette_idx enum.
+ */
+static const uint32_t default_palette[] = {
+    [FBC_PAL_DEFAULT_BG] = DEFAULT_BG,
+    [FBC_PAL_DEFAULT_FG] = DEFAULT_FG,
+    COLOR_BLACK,
+    COLOR_RED,
+    COLOR_GREEN,
+    COLOR_YELLOW,
+    COLOR_BLUE,
+    COLOR_MAGENTA,
+    COLOR_CYAN,
+    COLOR_GRAY,
+    COLOR_WHITE,
+    COLOR_BLACK_B,
+    COLOR_RED_B,
+    COLOR_GREEN_B,
+    COLOR_YELLOW_B,
+    COLOR_BLUE_B,
+    COLOR_MAGENTA_B,
+    COLOR_CYAN_B,
+    COLOR_GRAY_B,
+    COLOR_WHITE_B,
+};
+
+/**
+ * @brief True while fbc_flush() is redrawing.
+ * @details Used so the PIT interrupt doesn't start a redraw while we are
+ * already redrawing. Only tested and set with the interrupts disabled, see
+ * fbc_render_tick()
+ */
+static volatile bool flushing = false;
+
+/**
+ * @brief True if the displayed context needs a full redraw.
+ * @details Set by fbc_show_vt() and fbc_scrollback(), which are called from
+ * the keyboard interrupt. The redraw is done by fbc_render_tick(), see
+ * redraw_view()
+ */
+static volatile bool redraw_pending = false;
+
+/**
+ * @brief PIT tick of the last redraw from fbc_render_tick()
+ */
+static uint64_t last_render = 0;
+
 /* -------------------------------------------------------------------------- */
 
 /**
- * @brief Refreshes the pixels on the screen corresponding to the specified fbc
- * character.
- * @param cy, cx Position of the character we want to refresh in the fbc array
+ * @brief Check if the current context can draw to the framebuffer.
+ * @return True if its virtual terminal is being displayed and we are not
+ * scrolled back.
  */
-static inline void fbc_refresh_entry(uint32_t cy, uint32_t cx) {
-    /* Get the current fbc_entry */
-    const fbc_entry cur_entry = ctx->fbc[cy * ctx->ch_w + cx];
-    uint32_t* const fb_ptr    = fb_get_ptr();
-    const uint32_t fb_w       = fb_get_width();
+static inline bool is_visible(void) {
+    return ctx->vt == shown_vt && ctx->sb_view == 0;
+}
+
+/**
+ * @brief Mark the pixels of some rows of the current context as drawn.
+ * @details See fb_damage_rows(). Called once after drawing a batch of entries,
+ * instead of for each of them.
+ * @param cy0, cy1 First and last row of the fbc array (not included)
+ */
+static inline void damage_rows(uint32_t cy0, uint32_t cy1) {
+    fb_damage_rows(CHAR_Y_TO_PX(cy0), (cy1 - cy0) * ctx->font->h);
+}
+
+/**
+ * @brief Draws the specified entry at the specified position of the current
+ * context.
+ * @details Doesn't mark the rows as drawn, the callers do it once for all the
+ * entries they draw. See damage_rows()
+ * @param[in] cur_entry Entry to draw. Doesn't need to be from the fbc array.
+ * @param cy, cx Position of the character in the fbc array
+ */
+static inline void draw_entry(fbc_entry cur_entry, uint32_t cy, uint32_t cx) {
+    uint32_t* const fb_ptr = fb_get_ptr();
+    const uint32_t fb_w    = fb_get_width();
+
+    /* Get the real colors from the palette of the context */
+    uint32_t fg = ctx->palette[cur_entry.fg];
+    uint32_t bg = ctx->palette[cur_entry.bg];
+    if (cur_entry.attr & FBC_ATTR_REVERSE) {
+        const uint32_t tmp = fg;
+        fg                 = bg;
+        bg                 = tmp;
+    }
+
+    /* Last row of the char, only drawn with the foreground if underlined */
+    const uint8_t underline_y =
+      (cur_entry.attr & FBC_ATTR_UNDERLINE) ? ctx->font->h - 1 : ctx->font->h;
 
     /* Then iterate each pixel that forms the font char */
     for (uint8_t fy = 0; fy < ctx->font->h; fy++) {
@@ -60,66 +171,356 @@ static inline void fbc_refresh_entry(uint32_t cy, uint32_t cx) {
              * Depending on that, set it to foreground or background. For
              * more information see: src/kernel/include/kernel/font.h */
             fb_ptr[final_y * fb_w + final_x] =
-              (get_font_bit(ctx->font, cur_entry.c, fy, fx)) ? cur_entry.fg
-                                                             : cur_entry.bg;
+              (fy == underline_y || get_font_bit(ctx->font, cur_entry.c, fy, fx))
+                ? fg
+                : bg;
         }
     }
 }
 
+/**
+ * @brief Draws a whole row of entries at the specified row of the current
+ * context.
+ * @param[in] row Array of `ch_w` entries. Doesn't need to be from the fbc
+ * array.
+ * @param cy Row of the fbc array.
+ */
+static inline void draw_row(const fbc_entry* row, uint32_t cy) {
+    for (uint32_t cx = 0; cx < ctx->ch_w; cx++)
+        draw_entry(row[cx], cy, cx);
+}
+
+/**
+ * @brief Refreshes the pixels on the screen corresponding to the specified fbc
+ * character.
+ * @param cy, cx Position of the character we want to refresh in the fbc array
+ */
+static inline void fbc_refresh_entry(uint32_t cy, uint32_t cx) {
+    draw_entry(ctx->fbc[cy * ctx->ch_w + cx], cy, cx);
+}
+
+/**
+ * @brief Refreshes the pixels of all the characters in the specified row.
+ * @param cy Row of the fbc array.
+ */
+static inline void fbc_refresh_row(uint32_t cy) {
+    draw_row(&ctx->fbc[cy * ctx->ch_w], cy);
+}
+
+/**
+ * @brief Refreshes the characters of a row until the null byte, and fills the
+ * rest of the row with the background.
+ * @details Faster than fbc_refresh_row() for the rows that are not full, since
+ * the fill doesn't need the font. Only valid for rows that end with a null
+ * byte followed by default entries, like the ones of fbc_shift_rows(): text
+ * after a null byte and the background of the entries are ignored.
+ * @param cy Row of the fbc array.
+ */
+static inline void fbc_refresh_row_fast(uint32_t cy) {
+    /* '\0' denotes the end of the valid line */
+    uint32_t cx;
+    for (cx = 0; cx < ctx->ch_w && ctx->fbc[cy * ctx->ch_w + cx].c != '\0';
+         cx++)
+        fbc_refresh_entry(cy, cx);
+
+    /* Fill from last valid to the end of the line */
+    const uint32_t fill_y = CHAR_Y_TO_PX(cy);
+    const uint32_t fill_x = CHAR_X_TO_PX(cx);
+    const uint32_t fill_h = ctx->font->h;
+    const uint32_t fill_w = ctx->w + ctx->x - fill_x;
+    fb_drawrect_fast(fill_y, fill_x, fill_h, fill_w, DEFAULT_BG);
+}
+
+/**
+ * @brief Marks the specified row of the current context as dirty, so it gets
+ * redrawn on the next fbc_flush()
+ * @param cy Row of the fbc array.
+ */
+static inline void mark_dirty(uint32_t cy) {
+    ctx->dirty[cy] = true;
+    ctx->has_dirty = true;
+}
+
+/**
+ * @brief Marks all the rows of the current context as dirty.
+ */
+static inline void mark_all_dirty(void) {
+    for (uint32_t cy = 0; cy < ctx->ch_h; cy++)
+        ctx->dirty[cy] = true;
+
+    ctx->has_dirty = true;
+}
+
+/**
+ * @brief Draws the specified fbc character, or marks its row as dirty if the
+ * current context is deferred.
+ * @param cy, cx Position of the character in the fbc array
+ */
+static inline void fbc_update_entry(uint32_t cy, uint32_t cx) {
+    if (ctx->deferred) {
+        mark_dirty(cy);
+    } else if (is_visible()) {
+        fbc_refresh_entry(cy, cx);
+        damage_rows(cy, cy + 1);
+    }
+}
+
+/**
+ * @brief Move the cursor to the start of the next row, after writing the last
+ * char of a row.
+ * @details If we are on the last row, we stay there and shift on the next
+ * char. See fbc_putchar()
+ */
+static inline void wrap_line(void) {
+    ctx->cur_x = 0;
+
+    if (ctx->cur_y + 1 < ctx->ch_h)
+        ctx->cur_y++;
+    else
+        ctx->should_shift = true;
+}
+
+/**
+ * @brief Saves the first \p n rows of the current context in its scrollback
+ * buffer, if it has one.
+ * @param n Number of rows
+ */
+static void sb_push_rows(uint8_t n) {
+    if (ctx->sb == NULL)
+        return;
+
+    for (uint32_t y = 0; y < n && y < ctx->ch_h; y++) {
+        memcpy(&ctx->sb[ctx->sb_head * ctx->ch_w], &ctx->fbc[y * ctx->ch_w],
+               ctx->ch_w * sizeof(fbc_entry));
+
+        ctx->sb_head = (ctx->sb_head + 1) % ctx->sb_rows;
+        if (ctx->sb_count < ctx->sb_rows)
+            ctx->sb_count++;
+    }
+}
+
+/**
+ * @brief Redraws every row of the current context, scrolled back
+ * `ctx->sb_view` rows.
+ * @details Rows above the live console are read from the scrollback buffer.
+ * Called from fbc_render_tick() when redraw_pending is set. The caller needs
+ * to own the flushing variable.
+ */
+static void redraw_view(void) {
+    const uint64_t start = tsc_read();
+
+    /* We draw every row, so nothing is left for fbc_flush() */
+    ctx->has_dirty = false;
+
+    uint32_t cy;
+    for (cy = 0; cy < ctx->ch_h; cy++) {
+        /* We switched or scrolled again from the keyboard interrupt, the next
+         * tick will redraw everything */
+        if (redraw_pending)
+            break;
+
+        ctx->dirty[cy] = false;
+
+        if (cy >= ctx->sb_view) {
+            fbc_refresh_row(cy);
+            continue;
+        }
+
+        /* Number of rows from the newest one of the scrollback buffer */
+        const uint32_t back = ctx->sb_view - cy;
+        const uint32_t sb_y =
+          (ctx->sb_head + ctx->sb_rows - back) % ctx->sb_rows;
+
+        draw_row(&ctx->sb[sb_y * ctx->ch_w], cy);
+    }
+
+    damage_rows(0, cy);
+
+    if (cy == ctx->ch_h)
+        fb_frame_done(start);
+}
+
+/**
+ * @brief Redraw the dirty rows of the current context.
+ * @details The caller needs to own the flushing variable. See fbc_flush()
+ */
+static void flush_rows(void) {
+    const uint64_t start = tsc_read();
+
+    /* Clear the flag before drawing, so rows that get marked while we are
+     * drawing (e.g. from the keyboard interrupt) are not lost */
+    ctx->has_dirty = false;
+
+    /* Range of the rows we draw, marked as drawn at the end */
+    uint32_t drawn_y0 = ctx->ch_h;
+    uint32_t drawn_y1 = 0;
+
+    for (uint32_t cy = 0; cy < ctx->ch_h; cy++) {
+        /* We might switch terminals from the keyboard interrupt while drawing
+         */
+        if (!is_visible())
+            break;
+
+        if (ctx->dirty[cy]) {
+            ctx->dirty[cy] = false;
+            fbc_refresh_row(cy);
+
+            if (cy < drawn_y0)
+                drawn_y0 = cy;
+            drawn_y1 = cy + 1;
+        }
+    }
+
+    /* Only count the flushes that changed the screen */
+    if (drawn_y0 < drawn_y1) {
+        damage_rows(drawn_y0, drawn_y1);
+        fb_frame_done(start);
+        kb_echo_presented(start);
+    }
+}
+
 /* -------------------------------------------------------------------------- */
 
 void fbc_init(uint32_t y, uint32_t x, uint32_t h, uint32_t w, Font* font) {
-    ctx->y = y;
-    ctx->x = x;
-    ctx->h = h;
-    ctx->w = w;
+    fbc_init_ctx(ctx, y, x, h, w, font, FBC_SCROLLBACK_ROWS, 0);
+    fbc_refresh_raw();
+}
+
+void fbc_init_ctx(fbc_ctx* new_ctx, uint32_t y, uint32_t x, uint32_t h,
+                  uint32_t w, Font* font, uint32_t sb_rows, uint8_t vt) {
+    new_ctx->y = y;
+    new_ctx->x = x;
+    new_ctx->h = h;
+    new_ctx->w = w;
 
     /* We get the font size but we save the console char dimensions */
-    ctx->ch_h = h / font->h;
-    ctx->ch_w = w / font->w;
-    ctx->font = font;
+    new_ctx->ch_h = h / font->h;
+    new_ctx->ch_w = w / font->w;
+    new_ctx->font = font;
 
-    ctx->cur_cols.fg = DEFAULT_FG;
-    ctx->cur_cols.bg = DEFAULT_BG;
+    /* Fill the palette with the default colors */
+    for (size_t i = 0; i < LENGTH(default_palette); i++)
+        new_ctx->palette[i] = default_palette[i];
+    new_ctx->palette_sz = LENGTH(default_palette);
 
-    ctx->cur_y = 0;
-    ctx->cur_x = 0;
+    new_ctx->cur_fg   = FBC_PAL_DEFAULT_FG;
+    new_ctx->cur_bg   = FBC_PAL_DEFAULT_BG;
+    new_ctx->cur_attr = FBC_ATTR_NONE;
 
-    ctx->should_shift = false;
+    new_ctx->cur_y = 0;
+    new_ctx->cur_x = 0;
 
-    /* Allocate the number of fbc_entry's. Rows and cols of the console */
-    ctx->fbc = malloc(ctx->ch_h * ctx->ch_w * sizeof(fbc_entry));
+    new_ctx->should_shift = false;
+
+    /* We draw each char by default, see fbc_defer() */
+    new_ctx->deferred  = false;
+    new_ctx->has_dirty = false;
+
+    new_ctx->vt = vt;
 
+    /* Allocate the number of fbc_entry's. Rows and cols of the console */
+    new_ctx->fbc   = malloc(new_ctx->ch_h * new_ctx->ch_w * sizeof(fbc_entry));
+    new_ctx->dirty = calloc(new_ctx->ch_h, sizeof(bool));
+
+    new_ctx->sb = (sb_rows > 0)
+                    ? malloc(sb_rows * new_ctx->ch_w * sizeof(fbc_entry))
+                    : NULL;
+    new_ctx->sb_rows  = sb_rows;
+    new_ctx->sb_head  = 0;
+    new_ctx->sb_count = 0;
+    new_ctx->sb_view  = 0;
+
+    /* fbc_clear() only works with the current context */
+    fbc_ctx* const old_ctx = ctx;
+    ctx                    = new_ctx;
     fbc_clear();
-    fbc_refresh_raw();
+    ctx = old_ctx;
+}
+
+void fbc_free_ctx(fbc_ctx* old_ctx) {
+    /* Make sure the PIT doesn't start flushing it. A flush from the PIT runs
+     * on top of the code it interrupted, so none is in progress once we get
+     * here */
+    const uint32_t eflags = irq_save();
+    old_ctx->deferred     = false;
+    old_ctx->has_dirty    = false;
+    irq_restore(eflags);
+
+    free(old_ctx->fbc);
+    free(old_ctx->dirty);
+    free(old_ctx->sb);
 }
 
 void fbc_change_ctx(fbc_ctx* new_ctx) {
-    ctx = new_ctx;
+    ctx                 = new_ctx;
+    vt_top[new_ctx->vt] = new_ctx;
 }
 
 fbc_ctx* fbc_get_ctx(void) {
     return ctx;
 }
 
+fbc_ctx* fbc_get_vt_ctx(uint8_t vt) {
+    return (vt < VT_COUNT) ? vt_top[vt] : NULL;
+}
+
+void fbc_show_vt(uint8_t vt) {
+    if (vt >= VT_COUNT || vt_top[vt] == NULL)
+        return;
+
+    /* The context was only updating its fbc array. We are called from the
+     * keyboard interrupt, so the next PIT tick redraws it once */
+    shown_vt            = vt;
+    vt_top[vt]->sb_view = 0;
+    redraw_pending      = true;
+}
+
+uint8_t fbc_shown_vt(void) {
+    return shown_vt;
+}
+
+void fbc_scrollback(int32_t delta) {
+    fbc_ctx* const old_ctx = ctx;
+    ctx                    = vt_top[shown_vt];
+
+    if (ctx->sb != NULL) {
+        int64_t view = (int64_t)ctx->sb_view + delta;
+        if (view < 0)
+            view = 0;
+        else if (view > ctx->sb_count)
+            view = ctx->sb_count;
+
+        /* Drawn on the next PIT tick, see fbc_show_vt() */
+        if (view != ctx->sb_view) {
+            ctx->sb_view   = view;
+            redraw_pending = true;
+        }
+    }
+
+    ctx = old_ctx;
+}
+
 void fbc_clear(void) {
-    ctx->cur_x = 0;
-    ctx->cur_y = 0;
+    ctx->cur_x   = 0;
+    ctx->cur_y   = 0;
+    ctx->sb_view = 0;
 
     for (uint32_t cy = 0; cy < ctx->ch_h; cy++) {
         /* First entry is newline, rest spaces. We dont need to call
          * fbc_refresh_entry because we know the whole line is empty */
         ctx->fbc[cy * ctx->ch_w + 0] = (fbc_entry){
             '\n',
-            DEFAULT_FG,
-            DEFAULT_BG,
+            FBC_PAL_DEFAULT_FG,
+            FBC_PAL_DEFAULT_BG,
+            FBC_ATTR_NONE,
         };
 
         for (uint32_t cx = 1; cx < ctx->ch_w; cx++) {
             ctx->fbc[cy * ctx->ch_w + cx] = (fbc_entry){
                 '\0',
-                DEFAULT_FG,
-                DEFAULT_BG,
+                FBC_PAL_DEFAULT_FG,
+                FBC_PAL_DEFAULT_BG,
+                FBC_ATTR_NONE,
             };
         }
     }
@@ -129,28 +530,41 @@ void fbc_clrtoeol(void) {
     /* Current position will be the end of the current line */
     ctx->fbc[ctx->cur_y * ctx->ch_w + ctx->cur_x] = (fbc_entry){
         '\n',
-        DEFAULT_FG,
-        DEFAULT_BG,
+        FBC_PAL_DEFAULT_FG,
+        FBC_PAL_DEFAULT_BG,
+        FBC_ATTR_NONE,
     };
-    fbc_refresh_entry(ctx->cur_y, ctx->cur_x);
 
     /* Rest of them as '\0' */
     for (uint32_t cx = ctx->cur_x + 1; cx < ctx->ch_w; cx++) {
         ctx->fbc[ctx->cur_y * ctx->ch_w + cx] = (fbc_entry){
             '\0',
-            DEFAULT_FG,
-            DEFAULT_BG,
+            FBC_PAL_DEFAULT_FG,
+            FBC_PAL_DEFAULT_BG,
+            FBC_ATTR_NONE,
         };
-        fbc_refresh_entry(ctx->cur_y, cx);
+    }
+
+    /* Draw the pixels on the screen, all of them at once */
+    if (ctx->deferred) {
+        mark_dirty(ctx->cur_y);
+    } else if (is_visible()) {
+        for (uint32_t cx = ctx->cur_x; cx < ctx->ch_w; cx++)
+            fbc_refresh_entry(ctx->cur_y, cx);
+
+        damage_rows(ctx->cur_y, ctx->cur_y + 1);
     }
 }
 
 void fbc_sprint(const char* s) {
-    while (*s > '\0')
-        fbc_putchar(*s++);
+    fbc_write(s, strlen(s));
 }
 
 void fbc_putchar(char c) {
+    /* If the user was reading the scrollback, go back to the live console */
+    if (ctx->sb_view > 0)
+        fbc_refresh_raw();
+
     /* First of all, check if we need to shift the array. We need this kind of
      * "queue" system so the array doesn't immediately shift when a line ends
      * with
@@ -166,8 +580,9 @@ void fbc_putchar(char c) {
             /* Save newline char (don't display anything) */
             ctx->fbc[ctx->cur_y * ctx->ch_w + ctx->cur_x] = (fbc_entry){
                 '\n',
-                DEFAULT_FG,
-                DEFAULT_BG,
+                FBC_PAL_DEFAULT_FG,
+                FBC_PAL_DEFAULT_BG,
+                FBC_ATTR_NONE,
             };
 
             /* If we have rows left on the terminal, go down, if we are on the
@@ -202,27 +617,34 @@ void fbc_putchar(char c) {
             /* Clear the char we just deleted */
             ctx->fbc[ctx->cur_y * ctx->ch_w + ctx->cur_x] = (fbc_entry){
                 ' ',
-                DEFAULT_FG,
-                DEFAULT_BG,
+                FBC_PAL_DEFAULT_FG,
+                FBC_PAL_DEFAULT_BG,
+                FBC_ATTR_NONE,
             };
 
             /* Draw the pixels on the screen */
-            fbc_refresh_entry(ctx->cur_y, ctx->cur_x);
+            fbc_update_entry(ctx->cur_y, ctx->cur_x);
 
             return;
         case '\r':
             /* Fill from start of the line to the cursor pos */
-            const uint32_t fill_y = CHAR_Y_TO_PX(ctx->cur_y);
-            const uint32_t fill_x = CHAR_X_TO_PX(0);
-            const uint32_t fill_h = ctx->font->h;
-            const uint32_t fill_w = CHAR_X_TO_PX(ctx->cur_x) - fill_x;
-            fb_drawrect_fast(fill_y, fill_x, fill_h, fill_w, ctx->cur_cols.bg);
+            if (ctx->deferred) {
+                mark_dirty(ctx->cur_y);
+            } else if (is_visible()) {
+                const uint32_t fill_y = CHAR_Y_TO_PX(ctx->cur_y);
+                const uint32_t fill_x = CHAR_X_TO_PX(0);
+                const uint32_t fill_h = ctx->font->h;
+                const uint32_t fill_w = CHAR_X_TO_PX(ctx->cur_x) - fill_x;
+                fb_drawrect_fast(fill_y, fill_x, fill_h, fill_w,
+                                 ctx->palette[ctx->cur_bg]);
+            }
 
             for (uint32_t tmp_x = 0; tmp_x < ctx->cur_x; tmp_x++) {
                 ctx->fbc[ctx->cur_y * ctx->ch_w + tmp_x] = (fbc_entry){
                     ' ',
-                    ctx->cur_cols.fg,
-                    ctx->cur_cols.bg,
+                    ctx->cur_fg,
+                    ctx->cur_bg,
+                    ctx->cur_attr,
                 };
             }
 
@@ -234,33 +656,90 @@ void fbc_putchar(char c) {
 
     ctx->fbc[ctx->cur_y * ctx->ch_w + ctx->cur_x] = (fbc_entry){
         c,
-        ctx->cur_cols.fg,
-        ctx->cur_cols.bg,
+        ctx->cur_fg,
+        ctx->cur_bg,
+        ctx->cur_attr,
     };
 
     /* Draw the pixels on the screen */
-    fbc_refresh_entry(ctx->cur_y, ctx->cur_x);
+    fbc_update_entry(ctx->cur_y, ctx->cur_x);
 
     /* If we reach the end of the line, reset x and increase y */
-    if (++(ctx->cur_x) >= ctx->ch_w) {
-        ctx->cur_x = 0;
-
-        /* See comment on newline conditional */
-        if (ctx->cur_y + 1 < ctx->ch_h)
-            ctx->cur_y++;
-        else
-            ctx->should_shift = true;
+    if (++(ctx->cur_x) >= ctx->ch_w)
+        wrap_line();
+}
+
+void fbc_write(const char* s, size_t len) {
+    const char* end = s + len;
+
+    while (s < end) {
+        /* Special chars, pending shifts and the scrollback view are handled by
+         * fbc_putchar() */
+        if (ctx->should_shift || ctx->sb_view > 0 || (unsigned char)*s < ' ') {
+            fbc_putchar(*s++);
+            continue;
+        }
+
+        /* Store the run of normal chars that fits in the current row, and draw
+         * them (or mark the row as dirty) once */
+        fbc_entry* row       = &ctx->fbc[ctx->cur_y * ctx->ch_w];
+        const uint32_t first = ctx->cur_x;
+
+        while (s < end && (unsigned char)*s >= ' ' && ctx->cur_x < ctx->ch_w) {
+            row[ctx->cur_x++] = (fbc_entry){
+                *s++,
+                ctx->cur_fg,
+                ctx->cur_bg,
+                ctx->cur_attr,
+            };
+        }
+
+        if (ctx->deferred) {
+            mark_dirty(ctx->cur_y);
+        } else if (is_visible()) {
+            for (uint32_t cx = first; cx < ctx->cur_x; cx++)
+                fbc_refresh_entry(ctx->cur_y, cx);
+
+            damage_rows(ctx->cur_y, ctx->cur_y + 1);
+        }
+
+        if (ctx->cur_x >= ctx->ch_w)
+            wrap_line();
     }
 }
 
 void fbc_refresh_raw(void) {
+    ctx->sb_view = 0;
+
+    /* The next fbc_flush() will redraw everything */
+    if (ctx->deferred) {
+        mark_all_dirty();
+        return;
+    }
+
+    /* We will redraw everything when switching to its virtual terminal */
+    if (!is_visible())
+        return;
+
     /* Iterate each char of the framebuffer console */
     for (uint32_t cy = 0; cy < ctx->ch_h; cy++)
-        for (uint32_t cx = 0; cx < ctx->ch_w; cx++)
-            fbc_refresh_entry(cy, cx);
+        fbc_refresh_row(cy);
+
+    damage_rows(0, ctx->ch_h);
 }
 
 void fbc_refresh(void) {
+    ctx->sb_view = 0;
+
+    /* Deferred contexts always redraw whole rows, see fbc_shift_rows() */
+    if (ctx->deferred) {
+        mark_all_dirty();
+        return;
+    }
+
+    if (!is_visible())
+        return;
+
     /* Iterate each char of the framebuffer console */
     for (uint32_t cy = 0; cy < ctx->ch_h; cy++) {
         for (uint32_t cx = 0; cx < ctx->ch_w; cx++) {
@@ -274,69 +753,143 @@ void fbc_refresh(void) {
                 const uint32_t fill_h = ctx->font->h;
                 const uint32_t fill_w = CHAR_X_TO_PX(ctx->ch_w) - fill_x;
                 fb_drawrect_fast(fill_y, fill_x, fill_h, fill_w,
-                                 ctx->cur_cols.bg);
+                                 ctx->palette[ctx->cur_bg]);
                 break;
             }
         }
     }
+
+    damage_rows(0, ctx->ch_h);
+}
+
+void fbc_defer(bool enable) {
+    ctx->deferred = enable;
+
+    /* Draw whatever was left */
+    if (!enable)
+        fbc_flush();
+}
+
+void fbc_flush(void) {
+    /* The PIT might start a flush between the check and the set */
+    const uint32_t eflags = irq_save();
+
+    /* Rows of hidden contexts stay dirty until we display them */
+    if (flushing || !ctx->has_dirty || !is_visible()) {
+        irq_restore(eflags);
+        return;
+    }
+
+    flushing = true;
+    irq_restore(eflags);
+
+    flush_rows();
+
+    flushing = false;
+}
+
+void fbc_render_tick(uint64_t ticks) {
+    /* Only the displayed context can draw, even if the interrupted task is
+     * using another one */
+    fbc_ctx* const shown_ctx = vt_top[shown_vt];
+
+    if (flushing || ticks - last_render < FBC_RENDER_INTERVAL)
+        return;
+
+    /* Switching terminals and scrolling redraw every context, deferred or
+     * not. Don't draw into the visible page while the interrupted code is
+     * drawing a frame, try again on the next tick */
+    const bool redraw = redraw_pending;
+    if (redraw) {
+        if (fb_in_frame())
+            return;
+    } else if (!shown_ctx->deferred || !shown_ctx->has_dirty ||
+               shown_ctx->sb_view > 0) {
+        return;
+    }
+
+    /* With vsync, try again on the next tick if we are not in the retrace.
+     * Don't wait more than another interval */
+    if (!fb_vsync_ready() && ticks - last_render < FBC_RENDER_INTERVAL * 2)
+        return;
+
+    last_render = ticks;
+
+    /* Interrupts are still disabled, so nothing else can take it */
+    flushing       = true;
+    redraw_pending = false;
+
+    fbc_ctx* const old_ctx = ctx;
+    ctx                    = shown_ctx;
+
+    /* We are called from the PIT interrupt, after the EOI. Enable interrupts
+     * so we don't block the keyboard or the PIT itself while drawing. Nested
+     * calls will return because of the flushing variable. */
+    irq_enable();
+
+    if (redraw)
+        redraw_view();
+    else
+        flush_rows();
+
+    ctx      = old_ctx;
+    flushing = false;
 }
 
 /**
  * @todo Still not very fast. Optimize.
  */
 void fbc_shift_rows(uint8_t n) {
-    /* Used to count the position of the last valid char in the line */
-    uint32_t char_count = 0;
-
-    /* Shift n rows. We go to the newline instead of always ctx->ch_w because
-     * that will be the last valid char we care about. We can fill the rest
-     * faster with fb_drawrect_fast */
-    for (uint32_t y = 0; y < ctx->ch_h - n; y++) {
-        /* Update valid entries until we encounter a null byte. '\0' denotes the
-         * end of the valid line. */
-        for (uint32_t x = 0; x < ctx->ch_w; x++) {
-            ctx->fbc[y * ctx->ch_w + x] = ctx->fbc[(y + n) * ctx->ch_w + x];
-
-            /* We need to check after the assignment and not in the for because
-             * we want to also copy the null byte to keep where the line ends */
-            if (ctx->fbc[(y + n) * ctx->ch_w + x].c == '\0')
-                break;
+    TRACEPOINT(TP_FBC_SHIFT, n, 0);
 
-            fbc_refresh_entry(y, x);
+    /* Save the rows we are about to lose */
+    sb_push_rows(n);
 
-            char_count++;
-        }
-
-        /* Fill from last valid to the end of the line */
-        const uint32_t fill_y = CHAR_Y_TO_PX(y);
-        const uint32_t fill_x = CHAR_X_TO_PX(char_count);
-        const uint32_t fill_h = ctx->font->h;
-        const uint32_t fill_w = ctx->w + ctx->x - fill_x;
-        fb_drawrect_fast(fill_y, fill_x, fill_h, fill_w, DEFAULT_BG);
+    /* Shift the fbc array n rows. We copy the whole row and not just until the
+     * null byte, so there are no old entries after it. This is needed because
+     * deferred contexts redraw the whole row. */
+    for (uint32_t y = 0; y < ctx->ch_h - n; y++)
+        memcpy(&ctx->fbc[y * ctx->ch_w], &ctx->fbc[(y + n) * ctx->ch_w],
+               ctx->ch_w * sizeof(fbc_entry));
 
-        char_count = 0;
-    }
-
-    /* Clear last n rows with clean entries. Only change the ones that were
-     * full */
+    /* Clear last n rows with clean entries */
     for (uint32_t y = ctx->ch_h - n; y < ctx->ch_h; y++) {
-        /* First entry is newline, rest spaces. We dont need to call
-         * fbc_refresh_entry because we know the whole line is empty */
+        /* First entry is newline, rest null bytes */
         ctx->fbc[y * ctx->ch_w + 0] = (fbc_entry){
             '\n',
-            DEFAULT_FG,
-            DEFAULT_BG,
+            FBC_PAL_DEFAULT_FG,
+            FBC_PAL_DEFAULT_BG,
+            FBC_ATTR_NONE,
         };
 
         for (uint32_t x = 1; x < ctx->ch_w; x++) {
             ctx->fbc[y * ctx->ch_w + x] = (fbc_entry){
                 '\0',
-                DEFAULT_FG,
-                DEFAULT_BG,
+                FBC_PAL_DEFAULT_FG,
+                FBC_PAL_DEFAULT_BG,
+                FBC_ATTR_NONE,
             };
         }
     }
 
+    /* Every row changed. The pixels will be drawn on the next flush, so we
+     * don't care about how many times we shift before that. */
+    if (ctx->deferred) {
+        mark_all_dirty();
+        return;
+    }
+
+    if (!is_visible())
+        return;
+
+    /* Redraw the shifted rows. We go to the newline instead of always
+     * ctx->ch_w because that will be the last valid char we care about. We can
+     * fill the rest faster with fb_drawrect_fast */
+    for (uint32_t y = 0; y < ctx->ch_h - n; y++)
+        fbc_refresh_row_fast(y);
+
+    damage_rows(0, ctx->ch_h - n);
+
     /* Fill last empty lines with background color */
     const uint32_t fill_y = CHAR_Y_TO_PX(ctx->ch_h - n);
     const uint32_t fill_x = CHAR_X_TO_PX(0);
@@ -347,26 +900,70 @@ void fbc_shift_rows(uint8_t n) {
 
 /* -------------------------------------------------------------------------- */
 
+uint8_t fbc_color_idx(uint32_t col) {
+    /* Most calls will be for the color we are already using */
+    if (ctx->palette[ctx->cur_fg] == col)
+        return ctx->cur_fg;
+
+    for (uint16_t i = 0; i < ctx->palette_sz; i++)
+        if (ctx->palette[i] == col)
+            return i;
+
+    /* Not in the palette, add it if we have space */
+    if (ctx->palette_sz < FBC_PALETTE_SZ) {
+        ctx->palette[ctx->palette_sz] = col;
+        return ctx->palette_sz++;
+    }
+
+    /* Palette is full, use the closest color. We can't overwrite a slot
+     * because there might be entries using it. */
+    uint8_t r, g, b;
+    col2rgb(&r, &g, &b, col);
+
+    uint8_t best_idx   = 0;
+    uint32_t best_dist = UINT32_MAX;
+    for (uint16_t i = 0; i < ctx->palette_sz; i++) {
+        uint8_t pr, pg, pb;
+        col2rgb(&pr, &pg, &pb, ctx->palette[i]);
+
+        const int32_t dr    = r - pr;
+        const int32_t dg    = g - pg;
+        const int32_t db    = b - pb;
+        const uint32_t dist = dr * dr + dg * dg + db * db;
+
+        if (dist < best_dist) {
+            best_dist = dist;
+            best_idx  = i;
+        }
+    }
+
+    return best_idx;
+}
+
+void fbc_setattr(uint8_t attr) {
+    ctx->cur_attr = attr;
+}
+
 void fbc_getcols(uint32_t* fg, uint32_t* bg) {
-    *fg = ctx->cur_cols.fg;
-    *bg = ctx->cur_cols.bg;
+    *fg = ctx->palette[ctx->cur_fg];
+    *bg = ctx->palette[ctx->cur_bg];
 }
 
 void fbc_setcol(uint32_t fg, uint32_t bg) {
-    ctx->cur_cols.fg = fg;
-    ctx->cur_cols.bg = bg;
+    ctx->cur_fg = fbc_color_idx(fg);
+    ctx->cur_bg = fbc_color_idx(bg);
 }
 
 void fbc_setfore(uint32_t fg) {
-    ctx->cur_cols.fg = fg;
+    ctx->cur_fg = fbc_color_idx(fg);
 }
 
 void fbc_setback(uint32_t bg) {
-    ctx->cur_cols.bg = bg;
+    ctx->cur_bg = fbc_color_idx(bg);
 }
 
 void fbc_setcol_rgb(uint8_t fore_r, uint8_t fore_g, uint8_t fore_b,
                     uint8_t back_r, uint8_t back_g, uint8_t back_b) {
-    ctx->cur_cols.fg = rgb2col(fore_r, fore_g, fore_b);
-    ctx->cur_cols.bg = rgb2col(back_r, back_g, back_b);
+    fbc_setcol(rgb2col(fore_r, fore_g, fore_b),
+               rgb2col(back_r, back_g, back_b));
 }
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <kernel/heap.h>
+#include <kernel/tracepoint.h>
 
 /**
  * @brief Returns the pointer to the actual usable memory of a Block
@@ -63,6 +64,8 @@ void* heap_alloc(size_t sz) {
         blk->sz   = sz;
         blk->free = 0;
 
+        TRACEPOINT(TP_HEAP_ALLOC, sz, HEADER_TO_PTR(blk));
+
         /* Return the pointer to the actual usable memory:
          * (blk + sizeof(Block)) */
         return HEADER_TO_PTR(blk);
@@ -81,6 +84,8 @@ void heap_free(void* ptr) {
 
     Block* blk = (Block*)(ptr - sizeof(Block));
 
+    TRACEPOINT(TP_HEAP_FREE, ptr, blk->sz);
+
     /* If this is not the last block, and the next block is free, merge */
     if (blk->next != NULL && blk->next->free) {
         /* Add deleted header size and size of old block */
@@ -7,13 +7,19 @@
         iretd                       ; Return doubleword interrupt (32bit)
 %endmacro
 
+%macro IRQ_STUB 1
+    global irq_%1:function
+    irq_%1:
+        push    %1                  ; IRQ number, IrqFrame.irq
+        jmp     irq_common
+%endmacro
+
 bits 32
 
 section .text
     align 8
     extern handle_exception     ; src/kernel/exceptions.c
-    extern pit_inc              ; src/kernel/idt.c
-    extern kb_handler           ; src/kernel/keyboard.c
+    extern irq_dispatch         ; src/kernel/irq.c
 
 ; void idt_load(void* idt_desc)
 global idt_load:function
@@ -51,44 +57,66 @@ EXC_WRAPPER 19
 EXC_WRAPPER 20
 EXC_WRAPPER 30
 
-; void irq_pit(void)
-; First IRQ we remapped to 0x20. Calls the pit_inc C function, located in:
-; src/kernel/pit.c
-global irq_pit:function
-irq_pit:
-    pusha
-    call    pit_inc     ; Increment the static counter from src/kernel/idt.c
-    popa
-    iretd
+; The C code of the IRQ handlers can use the SSE registers (e.g. memcpy from
+; src/libk/string.c), so we save them with the rest of the registers. fxsave
+; needs a 512 byte area aligned to 16 bytes, so we align the stack and restore
+; it from ebp, which is preserved by the C functions and restored by popa.
+%macro SSE_SAVE 0
+    mov     ebp, esp
+    sub     esp, 512
+    and     esp, 0xFFFFFFF0
+    fxsave  [esp]
+%endmacro
 
-; void irq_kb(void)
-; Second IRQ we remapped to 0x21. Calls the kb_handler C function, located in:
-; src/kernel/keyboard.c
-global irq_kb:function
-irq_kb:
+%macro SSE_RESTORE 0
+    fxrstor [esp]
+    mov     esp, ebp
+%endmacro
+
+; irq_X: push the IRQ number and go to irq_common. Used as ISR offsets for the
+; idt, see irq_stubs.
+IRQ_STUB 0
+IRQ_STUB 1
+IRQ_STUB 2
+IRQ_STUB 3
+IRQ_STUB 4
+IRQ_STUB 5
+IRQ_STUB 6
+IRQ_STUB 7
+IRQ_STUB 8
+IRQ_STUB 9
+IRQ_STUB 10
+IRQ_STUB 11
+IRQ_STUB 12
+IRQ_STUB 13
+IRQ_STUB 14
+IRQ_STUB 15
+
+; Common part of the IRQ stubs. Saves the registers after the IRQ number, so
+; the stack has the IrqFrame from src/kernel/include/kernel/irq.h, and calls
+; irq_dispatch with a pointer to it.
+irq_common:
     pusha
-    cld                 ; Clear direction flag. The flag is used to specify the
-                        ; string order for operations that use the 'edi' and
-                        ; 'esi' registers. Tells the CPU that it should increase
-                        ; or decrease the pointer for strings.
-    call    kb_handler  ; src/kernel/keyboard.c
+    SSE_SAVE                ; ebp now points to the IrqFrame
+    cld                     ; Clear direction flag. The flag is used to specify
+                            ; the string order for operations that use the
+                            ; 'edi' and 'esi' registers. Tells the CPU that it
+                            ; should increase or decrease the pointer for
+                            ; strings.
+    push    ebp
+    call    irq_dispatch    ; src/kernel/irq.c
+    add     esp, 4
+    SSE_RESTORE
     popa
+    add     esp, 4          ; Pop the IRQ number
     iretd
 
-; void irq_default_master(void)
-; Ignore all IRQs we didn't add from master PIC
-global irq_default_master:function
-irq_default_master:
-    mov     al, 0x20
-	out     0x20, al
-    iretd
-
-; void irq_default_slave(void)
-; Ignore all IRQs we didn't add from slave PIC
-global irq_default_slave:function
-irq_default_slave:
-	mov     al, 0x20
-	out     0xa0, al
-	out     0x20, al
-    iretd
+section .rodata
+    align 4
 
+; const uint32_t irq_stubs[IRQ_COUNT]
+; Addresses of the IRQ stubs, registered by idt_init in src/kernel/idt.c
+global irq_stubs:data
+irq_stubs:
+    dd irq_0, irq_1, irq_2, irq_3, irq_4, irq_5, irq_6, irq_7
+    dd irq_8, irq_9, irq_10, irq_11, irq_12, irq_13, irq_14, irq_15
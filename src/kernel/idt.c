@@ -10,6 +10,7 @@
 #include <kernel/io.h>
 #include <kernel/idt.h>
 #include <kernel/exceptions.h>
+#include <kernel/irq.h> /* irq_init, irq_enable */
 
 #define IDT_SZ 256
 
@@ -64,10 +65,6 @@ static inline void pic_remap(void) {
     /* We are in 32 bits */
     io_outb(PIC_MASTER_DATA, ICW4_8086);
     io_outb(PIC_SLAVE_DATA, ICW4_8086);
-
-    /* We don't need to restore saved masks because they are not masked */
-    io_outb(PIC_MASTER_DATA, 0);
-    io_outb(PIC_SLAVE_DATA, 0);
 }
 
 void idt_init(void) {
@@ -79,6 +76,10 @@ void idt_init(void) {
      * with the CPU exceptions. See comment inside function. */
     pic_remap();
 
+    /* Mask all the IRQ lines until they have a handler. See
+     * src/kernel/irq.c */
+    irq_init();
+
     /* Exception Handling. exc_* defined in src/kernel/idt.asm */
     register_isr(0, (uint32_t)&exc_0);
     register_isr(1, (uint32_t)&exc_1);
@@ -102,19 +103,14 @@ void idt_init(void) {
     register_isr(20, (uint32_t)&exc_20);
     register_isr(30, (uint32_t)&exc_30);
 
-    /* IRQs. See src/kernel/idt.asm */
-    register_isr(32, (uint32_t)&irq_pit); /* PIT. IRQ 0 */
-    register_isr(33, (uint32_t)&irq_kb);  /* Keyboard. IRQ 1 */
-
-    /* Unused IRQs, just ignore. See src/kernel/idt.asm */
-    for (int i = 34; i < 40; i++)
-        register_isr(i, (uint32_t)&irq_default_master);
-    for (int i = 40; i < 48; i++)
-        register_isr(i, (uint32_t)&irq_default_slave);
+    /* IRQs, remapped to 32..47. The drivers register their handlers with
+     * irq_register(). See src/kernel/idt.asm */
+    for (int i = 0; i < IRQ_COUNT; i++)
+        register_isr(32 + i, irq_stubs[i]);
 
     /* See src/kernel/idt.asm */
     idt_load(&descriptor);
 
     /* Enable interrupts (opposite of cli) */
-    asm("sti");
+    irq_enable();
 }
@@ -0,0 +1,103 @@
+
+#ifndef _KERNEL_BGA_H
+#define _KERNEL_BGA_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Bochs Graphics Adaptor driver.
+ * @details Used by the Bochs and QEMU std VGA cards. See:
+ *   https://wiki.osdev.org/Bochs_VBE_Extensions
+ * @file
+ */
+
+/**
+ * @name Supported BGA versions
+ * @brief Values returned by the BGA_REG_ID register.
+ * @details Version 0xB0C2 is needed for 32 bpp, and 0xB0C3 for reading back
+ * the capabilities.
+ * @{ */
+#define BGA_ID_MIN 0xB0C2
+#define BGA_ID_MAX 0xB0C5
+/** @} */
+
+/**
+ * @enum bga_io_ports
+ * @brief I/O ports used by the BGA.
+ */
+enum bga_io_ports {
+    BGA_PORT_INDEX = 0x1CE, /**< @brief Write. Register index */
+    BGA_PORT_DATA  = 0x1CF, /**< @brief Read/Write. Register data */
+};
+
+/**
+ * @enum bga_regs
+ * @brief Register indexes written to BGA_PORT_INDEX.
+ */
+enum bga_regs {
+    BGA_REG_ID          = 0x0, /**< @brief Version of the BGA */
+    BGA_REG_XRES        = 0x1, /**< @brief Width in px */
+    BGA_REG_YRES        = 0x2, /**< @brief Height in px */
+    BGA_REG_BPP         = 0x3, /**< @brief Bits per pixel */
+    BGA_REG_ENABLE      = 0x4, /**< @brief See bga_enable_flags */
+    BGA_REG_BANK        = 0x5, /**< @brief Unused, we use the LFB */
+    BGA_REG_VIRT_WIDTH  = 0x6, /**< @brief Width of the virtual screen */
+    BGA_REG_VIRT_HEIGHT = 0x7, /**< @brief Height of the virtual screen */
+    BGA_REG_X_OFFSET    = 0x8, /**< @brief X offset of the displayed area */
+    BGA_REG_Y_OFFSET    = 0x9, /**< @brief Y offset of the displayed area */
+    BGA_REG_VIDEO_MEM   = 0xA, /**< @brief Video memory in 64KiB blocks */
+};
+
+/**
+ * @enum bga_enable_flags
+ * @brief Flags for the BGA_REG_ENABLE register.
+ */
+enum bga_enable_flags {
+    BGA_DISABLED    = 0x00,
+    BGA_ENABLED     = 0x01,
+    BGA_GETCAPS     = 0x02, /**< @brief Read the max values of XRES, etc. */
+    BGA_8BIT_DAC    = 0x20,
+    BGA_LFB_ENABLED = 0x40, /**< @brief Use the linear framebuffer */
+    BGA_NOCLEARMEM  = 0x80, /**< @brief Don't clear the video memory */
+};
+
+/**
+ * @brief Check if the BGA is present.
+ * @return True if the BGA_REG_ID register returns a supported version.
+ */
+bool bga_available(void);
+
+/**
+ * @brief Get the version of the BGA.
+ * @return Value of the BGA_REG_ID register.
+ */
+uint16_t bga_version(void);
+
+/**
+ * @brief Get the size of the video memory.
+ * @details Returns 0 if the version doesn't support reading it.
+ * @return Video memory in bytes.
+ */
+uint32_t bga_get_vram(void);
+
+/**
+ * @brief Change the current video mode.
+ * @details The contents of the video memory are kept. The virtual width is the
+ * same as \p w, so the pitch will be `w * bpp / 8`.
+ * @param[in] w, h Resolution in px.
+ * @param[in] bpp Bits per pixel.
+ * @param[in] virt_h Height of the virtual screen in px. Should be a multiple of
+ * \p h for page flipping.
+ * @return True if the BGA accepted the mode.
+ */
+bool bga_set_mode(uint16_t w, uint16_t h, uint16_t bpp, uint16_t virt_h);
+
+/**
+ * @brief Set the first line of the virtual screen that will be displayed.
+ * @details Used for page flipping. See fb_end_frame()
+ * @param[in] y Line of the virtual screen in px.
+ */
+void bga_set_yoffset(uint16_t y);
+
+#endif /* _KERNEL_BGA_H */
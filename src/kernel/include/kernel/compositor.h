@@ -0,0 +1,141 @@
+
+#ifndef _KERNEL_COMPOSITOR_H
+#define _KERNEL_COMPOSITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Framebuffer compositor.
+ * @details Keeps a z-ordered list of rectangular surfaces, each with its own
+ * pixels, and the damaged columns of each row of the screen. comp_compose() only
+ * copies the damaged rows to the framebuffer.
+ *
+ * Parts of the screen that are drawn directly (e.g. a console without a
+ * surface) should not overlap any surface, or they will be overwritten.
+ * @file
+ */
+
+/**
+ * @brief Minimum number of PIT ticks (ms) between two compositions from the
+ * PIT. See comp_render_tick()
+ */
+#define COMP_RENDER_INTERVAL 16
+
+/**
+ * @brief Color used for the damaged parts of the screen that are not covered
+ * by any surface.
+ */
+#define COMP_BG 0x000000
+
+typedef struct Surface Surface;
+
+/**
+ * @struct Surface
+ * @brief Rectangular area of the screen with its own pixels.
+ */
+struct Surface {
+    /** @brief Next surface of the list. It has the same or higher z */
+    Surface* next;
+
+    /** @name Position and size of the surface on the screen in px
+     * @{ */
+    uint32_t y, x, h, w;
+    /** @} */
+
+    /** @brief Surfaces with higher z are drawn on top */
+    int32_t z;
+
+    /** @brief If false, the surface is not drawn */
+    bool visible;
+
+    /** @brief Array of `h * w` 32 bit colors. Call comp_surface_damage() after
+     * changing them */
+    uint32_t* px;
+};
+
+/**
+ * @brief Rectangle in px.
+ */
+typedef struct {
+    uint32_t y, x, h, w;
+} comp_rect;
+
+/**
+ * @brief Create a new visible surface.
+ * @details The pixels are initialized to COMP_BG. The area is damaged, but it
+ * won't be drawn until the next composition.
+ * @param y, x Position on the screen in px
+ * @param h, w Size in px
+ * @param z Order of the surface. Surfaces with higher z are drawn on top, and
+ * surfaces with the same z are drawn in creation order.
+ * @return The new surface, or NULL if we could not allocate it.
+ */
+Surface* comp_surface_new(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
+                          int32_t z);
+
+/**
+ * @brief Remove the surface from the list and free it.
+ * @details The area it covered is damaged.
+ * @param[out] s Surface to free
+ */
+void comp_surface_free(Surface* s);
+
+/**
+ * @brief Move the surface to a new position of the screen.
+ * @details The old and new areas are damaged.
+ * @param[out] s Surface to move
+ * @param y, x New position in px
+ */
+void comp_surface_move(Surface* s, uint32_t y, uint32_t x);
+
+/**
+ * @brief Show or hide a surface.
+ * @param[out] s Target surface
+ * @param visible True for showing the surface
+ */
+void comp_surface_show(Surface* s, bool visible);
+
+/**
+ * @brief Mark a region of a surface as damaged.
+ * @details Should be called after changing the pixels of the surface.
+ * @param[in] s Target surface
+ * @param y, x Position inside the surface in px
+ * @param h, w Size of the region in px. Clipped to the surface size
+ */
+void comp_surface_damage(const Surface* s, uint32_t y, uint32_t x, uint32_t h,
+                         uint32_t w);
+
+/**
+ * @brief Mark a region of the screen as damaged.
+ * @details Each row keeps a single range of damaged columns, so regions in
+ * the same rows are merged, but the rows between them are not damaged. Does
+ * nothing before the first surface is created.
+ * @param y, x Position on the screen in px
+ * @param h, w Size of the region in px
+ */
+void comp_damage(uint32_t y, uint32_t x, uint32_t h, uint32_t w);
+
+/**
+ * @brief Check if there are damaged regions.
+ * @return True if the next comp_compose() will draw something.
+ */
+bool comp_has_damage(void);
+
+/**
+ * @brief Draw the damaged regions to the framebuffer.
+ * @details For each region we only draw the topmost surface that covers all of
+ * it and the ones above. With page flipping, draws into both pages, so the
+ * composition is not lost after the next flip.
+ */
+void comp_compose(void);
+
+/**
+ * @brief Called on each PIT tick to compose the damaged regions.
+ * @details Will only compose if COMP_RENDER_INTERVAL ticks passed since the
+ * last composition. Called from pit_inc(), see src/kernel/pit.c
+ * @param[in] ticks Current tick count since boot.
+ */
+void comp_render_tick(uint64_t ticks);
+
+#endif /* _KERNEL_COMPOSITOR_H */
@@ -15,6 +15,9 @@
  * @file
  */
 
+#include <stdint.h>
+#include <kernel/irq.h> /* IRQ_COUNT */
+
 /**
  * @brief Disables interrupts and panics with the specified exception.
  * @details Defined in src/kernel/exceptions.c
@@ -53,27 +56,10 @@ void exc_30(void);
 /**  @} */
 
 /**
- * @brief Assembly wrapper for the PIT IRQ.
- * @details Defined in src/kernel/idt.asm
- */
-void irq_pit(void);
-
-/**
- * @brief Assembly wrapper for the keyboard IRQ.
- * @details Defined in src/kernel/idt.asm
- */
-void irq_kb(void);
-
-/**
- * @brief Generic ISR for ignoring all unhandled IRQs from master PIC.
- * @details Defined in src/kernel/idt.asm
- */
-void irq_default_master(void);
-
-/**
- * @brief Generic ISR for ignoring all unhandled IRQs from slave PIC.
- * @details Defined in src/kernel/idt.asm
+ * @brief Addresses of the assembly entry stubs of the IRQs, indexed by line.
+ * @details Each one saves an IrqFrame and calls irq_dispatch(). Defined in
+ * src/kernel/idt.asm
  */
-void irq_default_slave(void);
+extern const uint32_t irq_stubs[IRQ_COUNT];
 
 #endif /* _KERNEL_EXCEPTIONS_H */
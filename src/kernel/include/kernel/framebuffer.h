@@ -3,6 +3,7 @@
 #define _KERNEL_FRAMEBUFFER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <kernel/color.h>
 
 /**
@@ -16,6 +17,25 @@ enum fb_types {
     FB_TYPE_EGA     = 2,
 };
 
+/**
+ * @brief Max time in ms that fb_vsync_wait() waits for the vertical retrace.
+ * @details At 60Hz there is one every 16ms, so the adapter probably doesn't
+ * emulate it if we reach this.
+ */
+#define FB_VSYNC_TIMEOUT_MS 50
+
+/**
+ * @brief Timing of the presented frames. See fb_frame_done()
+ */
+typedef struct {
+    uint32_t frames;  /**< @brief Number of presented frames */
+    uint32_t missed;  /**< @brief Times we didn't see a retrace in time */
+    uint64_t last_us; /**< @brief Time between the last two frames */
+    uint64_t draw_us; /**< @brief Total time drawing the frames */
+    uint64_t max_us;  /**< @brief Max time drawing a single frame */
+    uint64_t wait_us; /**< @brief Total time waiting for the retrace */
+} fb_frame_stats;
+
 /**
  * @brief Initialize global framebuffer variables and clear the framebuffer
  * @details See Multiboot struct for more info
@@ -95,4 +115,112 @@ static inline void fb_drawrect(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
 void fb_drawrect_fast(uint32_t y, uint32_t x, uint32_t h, uint32_t w,
                       uint32_t col);
 
+/**
+ * @brief Get the page we are not drawing into.
+ * @details Used for keeping both pages up to date, see comp_compose().
+ * @return Pointer to the other page, or NULL without page flipping.
+ */
+uint32_t* fb_get_other_ptr(void);
+
+/**
+ * @brief Mark rows of the framebuffer as drawn.
+ * @details Needed after writing to fb_get_ptr() directly, the rest of the
+ * fb_* drawing functions call it. With page flipping, the rows drawn since the
+ * last fb_begin_frame(), inside or outside of a frame, are copied to the other
+ * page by the next fb_begin_frame(), so it doesn't show them stale. It
+ * disables the interrupts, so call it once for everything drawn in a batch.
+ * @param y, h First row and number of rows in px
+ */
+void fb_damage_rows(uint32_t y, uint32_t h);
+
+/**
+ * @brief Try to enable page flipping using the BGA.
+ * @details Sets the same video mode with a virtual height of twice the screen,
+ * and copies the current contents of the framebuffer to the second page. Should
+ * be called after drawing the static parts of the screen (e.g. the logo).
+ *
+ * See src/kernel/bga.c
+ * @return True if page flipping is available.
+ */
+bool fb_init_pages(void);
+
+/**
+ * @brief Check if page flipping was enabled with fb_init_pages()
+ * @return True if we have 2 pages.
+ */
+bool fb_has_pages(void);
+
+/**
+ * @brief Start drawing into the off-screen page.
+ * @details Everything drawn until fb_end_frame() won't be visible. The rows
+ * marked with fb_damage_rows() since the last call are copied to the
+ * off-screen page first, so it has the same contents as the visible one. Does
+ * nothing without page flipping.
+ */
+void fb_begin_frame(void);
+
+/**
+ * @brief Display the page we were drawing into since fb_begin_frame().
+ * @details Only a register write, the pixels are not copied. After the flip,
+ * we keep drawing into the visible page until the next fb_begin_frame().
+ */
+void fb_end_frame(void);
+
+/**
+ * @brief Check if we are between fb_begin_frame() and fb_end_frame().
+ * @details Used for not drawing into the visible page from an interrupt while
+ * the interrupted code is drawing a frame. See fbc_render_tick()
+ * @return True if we are drawing into the off-screen page.
+ */
+bool fb_in_frame(void);
+
+/**
+ * @brief Enable or disable vsync.
+ * @details When enabled, the frames are presented during the vertical retrace,
+ * so they don't tear: fb_end_frame() waits for it before flipping, and the
+ * deferred console waits for it before redrawing the dirty rows. Disabled by
+ * default.
+ * @param enable True for enabling vsync.
+ */
+void fb_set_vsync(bool enable);
+
+/**
+ * @brief Check if vsync is enabled. See fb_set_vsync()
+ * @return True if vsync is enabled.
+ */
+bool fb_get_vsync(void);
+
+/**
+ * @brief Check if we can present a frame without waiting.
+ * @return True if vsync is disabled or if we are in the vertical retrace.
+ */
+bool fb_vsync_ready(void);
+
+/**
+ * @brief Wait for the vertical retrace if vsync is enabled.
+ * @details Returns immediately if we are already in the retrace. Gives up after
+ * FB_VSYNC_TIMEOUT_MS.
+ * @return False if we gave up.
+ */
+bool fb_vsync_wait(void);
+
+/**
+ * @brief Add a presented frame to the frame stats.
+ * @details Called by fb_end_frame() and by the console after redrawing the
+ * dirty rows.
+ * @param start_tsc Value of tsc_read() when we started drawing the frame.
+ */
+void fb_frame_done(uint64_t start_tsc);
+
+/**
+ * @brief Get the timing of the presented frames.
+ * @return Pointer to the frame stats.
+ */
+const fb_frame_stats* fb_get_frame_stats(void);
+
+/**
+ * @brief Reset the frame stats to 0.
+ */
+void fb_reset_frame_stats(void);
+
 #endif /* _KERNEL_FRAMEBUFFER_H */
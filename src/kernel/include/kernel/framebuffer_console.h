@@ -4,21 +4,66 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 #include <kernel/font.h>
-#include <kernel/color.h> /* color_pair */
+#include <kernel/color.h>
+#include <kernel/vt.h> /* VT_COUNT */
 
 /**
  * @brief Number of spaces per tab to be displayed
  */
 #define FBC_TABSIZE 4
 
+/**
+ * @brief Minimum number of PIT ticks (ms) between two redraws of a deferred
+ * console.
+ * @details 16ms is about 60 redraws per second. See fbc_render_tick()
+ */
+#define FBC_RENDER_INTERVAL 16
+
+/**
+ * @brief Number of colors in the palette of each context.
+ * @details Must fit in the uint8_t indexes of fbc_entry.
+ */
+#define FBC_PALETTE_SZ 256
+
+/**
+ * @brief Number of rows saved in the scrollback buffer of each virtual
+ * terminal.
+ * @details See fbc_scrollback()
+ */
+#define FBC_SCROLLBACK_ROWS 200
+
+/**
+ * @brief Fixed indexes of the context palette.
+ * @details The rest of the slots are filled with the color.h palette and with
+ * the colors used by fbc_setcol(). See fbc_color_idx()
+ */
+enum fbc_palette_idx {
+    FBC_PAL_DEFAULT_BG = 0, /**< @brief Always DEFAULT_BG */
+    FBC_PAL_DEFAULT_FG = 1, /**< @brief Always DEFAULT_FG */
+};
+
+/**
+ * @brief Attribute flags of each fbc_entry.
+ */
+enum fbc_attr_flags {
+    FBC_ATTR_NONE      = 0x0,
+    FBC_ATTR_REVERSE   = 0x1, /**< @brief Swap foreground and background */
+    FBC_ATTR_UNDERLINE = 0x2, /**< @brief Draw the last row of the char with
+                                 the foreground color */
+};
+
 /**
  * @brief Framebuffer console entry.
+ * @details The colors are indexes of the palette of the context, so each entry
+ * is 4 bytes instead of 12.
  */
 typedef struct {
-    uint8_t c;   /**< @brief Char of the entry */
-    uint32_t fg; /**< @brief 32 bit foreground color */
-    uint32_t bg; /**< @brief 32 bit background color */
+    uint8_t c;    /**< @brief Char of the entry */
+    uint8_t fg;   /**< @brief Foreground index in the context palette */
+    uint8_t bg;   /**< @brief Background index in the context palette */
+    uint8_t attr; /**< @brief Attribute flags. See fbc_attr_flags */
 } fbc_entry;
 
 /**
@@ -42,9 +87,16 @@ typedef struct {
     /** @brief Global pointer to the font the framebufer console is using */
     Font* font;
 
-    /** @brief Current color_pair we are using when printing. Foreground and
-     * background */
-    color_pair cur_cols;
+    /** @brief 32 bit colors referenced by the fbc_entry's of this context */
+    uint32_t palette[FBC_PALETTE_SZ];
+
+    /** @brief Number of used items of the palette array */
+    uint16_t palette_sz;
+
+    /** @name Palette indexes and attributes we are using when printing
+     * @{ */
+    uint8_t cur_fg, cur_bg, cur_attr;
+    /** @} */
 
     /** @name Current character position on the console
      * @{ */
@@ -54,6 +106,39 @@ typedef struct {
     /** @brief Will be set to true if we know we are going to shift the
      * console of this context. See framebuffer console wiki page. */
     bool should_shift;
+
+    /** @brief If true, the functions that write to the console only update
+     * the fbc array and mark the rows as dirty instead of drawing the pixels.
+     * See fbc_defer() */
+    bool deferred;
+
+    /** @brief Array of `ch_h` bools. True if the row needs to be redrawn */
+    bool* dirty;
+
+    /** @brief True if at least one item of the dirty array is set */
+    volatile bool has_dirty;
+
+    /** @brief Virtual terminal of this context. The pixels are only drawn if
+     * it's the one being displayed. See fbc_show_vt() */
+    uint8_t vt;
+
+    /** @brief Ring buffer of `sb_rows` rows that were shifted out of the
+     * console. NULL if the context has no scrollback */
+    fbc_entry* sb;
+
+    /** @brief Max number of rows of the scrollback buffer */
+    uint32_t sb_rows;
+
+    /** @brief Index of the row of the scrollback buffer that will be written
+     * next */
+    uint32_t sb_head;
+
+    /** @brief Number of valid rows in the scrollback buffer */
+    uint32_t sb_count;
+
+    /** @brief Number of rows we are scrolled back. 0 if we are displaying the
+     * live console */
+    uint32_t sb_view;
 } fbc_ctx;
 
 /**
@@ -64,8 +149,33 @@ typedef struct {
  */
 void fbc_init(uint32_t y, uint32_t x, uint32_t h, uint32_t w, Font* font);
 
+/**
+ * @brief Initialize the specified framebuffer console context.
+ * @details Allocates the arrays and clears the console, but doesn't change the
+ * current context or draw anything. The palette is filled with the default
+ * colors.
+ * @param[out] new_ctx Context to initialize
+ * @param y, x Position of the console in px
+ * @param h, w Size of the console in px
+ * @param[in] font Pointer to the font
+ * @param sb_rows Number of rows of the scrollback buffer. Can be 0
+ * @param vt Virtual terminal the context belongs to
+ */
+void fbc_init_ctx(fbc_ctx* new_ctx, uint32_t y, uint32_t x, uint32_t h,
+                  uint32_t w, Font* font, uint32_t sb_rows, uint8_t vt);
+
+/**
+ * @brief Free the arrays allocated by fbc_init_ctx().
+ * @details Doesn't free the context itself. It should not be the current one.
+ * The context stops being deferred, so the PIT never redraws it after this.
+ * @param[out] old_ctx Context to free
+ */
+void fbc_free_ctx(fbc_ctx* old_ctx);
+
 /**
  * @brief Switches to the specified framebuffer console context
+ * @details The context will also be the one displayed when switching to its
+ * virtual terminal. See fbc_get_vt_ctx()
  * @param[in] new_ctx New framebuffer console context
  */
 void fbc_change_ctx(fbc_ctx* new_ctx);
@@ -76,6 +186,39 @@ void fbc_change_ctx(fbc_ctx* new_ctx);
  */
 fbc_ctx* fbc_get_ctx(void);
 
+/**
+ * @brief Get the last context used by the specified virtual terminal
+ * @param vt Virtual terminal index
+ * @return Last context passed to fbc_change_ctx() with that virtual terminal.
+ * NULL if there was none
+ */
+fbc_ctx* fbc_get_vt_ctx(uint8_t vt);
+
+/**
+ * @brief Display the specified virtual terminal.
+ * @details Contexts of the rest of virtual terminals only update their fbc
+ * array, so we just need to redraw the whole console once. Called from the
+ * keyboard interrupt, so the redraw is done by the next fbc_render_tick().
+ * @param vt Virtual terminal index
+ */
+void fbc_show_vt(uint8_t vt);
+
+/**
+ * @brief Get the virtual terminal being displayed
+ * @return Virtual terminal index
+ */
+uint8_t fbc_shown_vt(void);
+
+/**
+ * @brief Scroll the view of the displayed virtual terminal.
+ * @details Displays the rows of the scrollback buffer. Printing to the
+ * context or refreshing it goes back to the live console. Like fbc_show_vt(),
+ * the rows are drawn by the next fbc_render_tick().
+ * @param delta Number of rows to scroll. Positive for going back, negative for
+ * going forward
+ */
+void fbc_scrollback(int32_t delta);
+
 /**
  * @brief Clears the framebuffer console and moves cursor to the first char
  */
@@ -89,11 +232,20 @@ void fbc_clrtoeol(void);
 
 /**
  * @brief prints zero-terminated string to the framebuffer console using
- * fbc_putchar()
+ * fbc_write()
  * @param s Zero-terminated string to print
  */
 void fbc_sprint(const char* s);
 
+/**
+ * @brief Prints \p len chars of \p s to the framebuffer console.
+ * @details Same as calling fbc_putchar() for each char, but the runs of normal
+ * chars are stored and drawn in a single pass for each row.
+ * @param s String to print, doesn't need to be zero-terminated
+ * @param len Number of chars
+ */
+void fbc_write(const char* s, size_t len);
+
 /**
  * @brief Prints \p c to the framebuffer console
  * @param c Char to print
@@ -118,13 +270,59 @@ void fbc_refresh_raw(void);
  */
 void fbc_refresh(void);
 
+/**
+ * @brief Enable or disable deferred rendering for the current context.
+ * @details When enabled, fbc_putchar() and the rest of the functions that
+ * change the console only update the fbc_entry array and mark the rows as
+ * dirty. The rows are then redrawn at most once every FBC_RENDER_INTERVAL ms
+ * from the PIT interrupt (see fbc_render_tick()), or when calling fbc_flush().
+ *
+ * Disabling it will flush the pending rows.
+ * @param[in] enable True for deferred rendering, false for drawing each char.
+ */
+void fbc_defer(bool enable);
+
+/**
+ * @brief Redraw the dirty rows of the current context.
+ * @details Does nothing if there are no dirty rows, or if another flush is
+ * already redrawing (e.g. the one from the PIT interrupted us).
+ */
+void fbc_flush(void);
+
+/**
+ * @brief Called on each PIT tick to redraw the dirty rows of a deferred
+ * context.
+ * @details Will only redraw if FBC_RENDER_INTERVAL ticks passed since the last
+ * redraw. Also redraws the whole displayed context after fbc_show_vt() or
+ * fbc_scrollback(), unless the interrupted code is drawing a frame (see
+ * fb_in_frame()). Never waits for vsync. Called from pit_inc(), see
+ * src/kernel/pit.c
+ * @param[in] ticks Current tick count since boot.
+ */
+void fbc_render_tick(uint64_t ticks);
+
 /**
  * @brief Scrolls the framebuffer terminal \p n rows.
  * @param n Number of rows to shift
  */
 void fbc_shift_rows(uint8_t n);
 
-/* fbc_getcols:  */
+/**
+ * @brief Get the palette index of the specified color in the current context.
+ * @details If the color is not in the palette, it will be added to a free
+ * slot. If there are no free slots left, returns the index of the closest
+ * color.
+ * @param[in] col 32 bit color.
+ * @return Index in the palette of the current context.
+ */
+uint8_t fbc_color_idx(uint32_t col);
+
+/**
+ * @brief Sets the attribute flags used for the next printed chars.
+ * @param[in] attr Attribute flags. See fbc_attr_flags
+ */
+void fbc_setattr(uint8_t attr);
+
 /**
  * @brief Writes the current colors of the terminal to \p fg and \p bg.
  * @param[out] fg Foreground color dst pointer
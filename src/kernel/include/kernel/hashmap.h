@@ -0,0 +1,138 @@
+
+#ifndef _KERNEL_HASHMAP_H
+#define _KERNEL_HASHMAP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Open addressing hash map.
+ * @details Linear probing over a power of 2 array, with backward shift
+ * deletion so there are no tombstones. The keys are either integers (or
+ * pointers compared by address) or zero-terminated strings. The map doesn't
+ * copy the string keys, they need to live as long as the entry.
+ *
+ * Each entry stores the full hash of its key, so string lookups only call
+ * strcmp() when the hashes match. Lookups never allocate.
+ * @file
+ */
+
+/**
+ * @brief Entry of a HashMap.
+ */
+typedef struct {
+    uintptr_t key; /**< @brief Integer key, or pointer to the string key */
+    void* val;     /**< @brief Value of the entry */
+    uint32_t hash; /**< @brief Hash of the key. 0 if the slot is empty */
+} HashMapEntry;
+
+/**
+ * @brief Hash map. Initialize with hashmap_init() or hashmap_init_static().
+ */
+typedef struct {
+    HashMapEntry* entries; /**< @brief Array of `cap` slots */
+    uint32_t cap;          /**< @brief Number of slots, power of 2 */
+    uint32_t count;        /**< @brief Number of used slots */
+    bool str_keys;         /**< @brief The keys are strings */
+    bool fixed;            /**< @brief Entries from the caller, can't grow */
+} HashMap;
+
+/**
+ * @brief Initialize an empty hash map, allocating the entries in the heap.
+ * @details It grows when it's 3/4 full.
+ * @param[out] map Hash map to initialize.
+ * @param n Expected number of entries. Used for the initial size, can be 0.
+ * Must be less than 3/4 of 2^31.
+ * @param str_keys If true, the keys are `const char*` compared with strcmp()
+ * @return True if the entries could be allocated, false if they couldn't or
+ * if \p n is too big.
+ */
+bool hashmap_init(HashMap* map, uint32_t n, bool str_keys);
+
+/**
+ * @brief Initialize an empty hash map using the caller's entries.
+ * @details The map never allocates and doesn't grow, so it can be used before
+ * the heap or from interrupts. It can hold `cap - 1` entries.
+ * @param[out] map Hash map to initialize.
+ * @param[out] entries Array of \p cap entries.
+ * @param cap Size of \p entries. Needs to be a power of 2.
+ * @param str_keys If true, the keys are `const char*` compared with strcmp()
+ */
+void hashmap_init_static(HashMap* map, HashMapEntry* entries, uint32_t cap,
+                         bool str_keys);
+
+/**
+ * @brief Free the entries of a map from hashmap_init().
+ * @details Doesn't free the keys or values.
+ * @param[inout] map Hash map to destroy.
+ */
+void hashmap_destroy(HashMap* map);
+
+/**
+ * @brief Add an entry, or replace the value if the key is already there.
+ * @param[inout] map Hash map.
+ * @param key Integer key, or `const char*` for maps with string keys.
+ * @param[in] val Value of the entry.
+ * @return False if the map is full and can't grow.
+ */
+bool hashmap_put(HashMap* map, uintptr_t key, void* val);
+
+/**
+ * @brief Get the value of a key.
+ * @param[in] map Hash map.
+ * @param key Integer key, or `const char*` for maps with string keys.
+ * @return Value of the entry, or NULL if the key is not in the map.
+ */
+void* hashmap_get(const HashMap* map, uintptr_t key);
+
+/**
+ * @brief Get the entry of a key.
+ * @details For telling apart missing keys from NULL values, or for changing
+ * the value in place.
+ * @param[in] map Hash map.
+ * @param key Integer key, or `const char*` for maps with string keys.
+ * @return Entry of the key, or NULL if the key is not in the map. Valid until
+ * the next hashmap_put() or hashmap_del()
+ */
+HashMapEntry* hashmap_find(const HashMap* map, uintptr_t key);
+
+/**
+ * @brief Remove the entry of a key.
+ * @param[inout] map Hash map.
+ * @param key Integer key, or `const char*` for maps with string keys.
+ * @return True if the key was in the map.
+ */
+bool hashmap_del(HashMap* map, uintptr_t key);
+
+/**
+ * @brief Add an entry to a map with string keys. See hashmap_put()
+ */
+static inline bool hashmap_put_str(HashMap* map, const char* key, void* val) {
+    return hashmap_put(map, (uintptr_t)key, val);
+}
+
+/**
+ * @brief Get the value of a string key. See hashmap_get()
+ */
+static inline void* hashmap_get_str(const HashMap* map, const char* key) {
+    return hashmap_get(map, (uintptr_t)key);
+}
+
+/**
+ * @brief 32 bit FNV-1a hash of a zero-terminated string.
+ * @param[in] str String to hash.
+ * @return Hash of the string.
+ */
+uint32_t hash_str(const char* str) __attribute__((pure));
+
+/**
+ * @brief Hash of an integer or pointer.
+ * @details Mixes all the bits, so keys that only differ in the high bits (like
+ * aligned pointers) still go to different slots.
+ * @param key Integer to hash.
+ * @return Hash of the integer.
+ */
+uint32_t hash_int(uintptr_t key) __attribute__((const));
+
+#endif /* _KERNEL_HASHMAP_H */
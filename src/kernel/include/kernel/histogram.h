@@ -0,0 +1,67 @@
+
+#ifndef _KERNEL_HISTOGRAM_H
+#define _KERNEL_HISTOGRAM_H
+
+#include <stdint.h>
+
+/**
+ * @brief Log-linear histogram of 64-bit values, like TSC cycles.
+ * @details Each power of 2 is split in HIST_SUB_BUCKETS buckets of the same
+ * width, so the values returned by hist_percentile() are at most 1/8 above
+ * the real ones, whatever their magnitude. The values smaller than
+ * HIST_SUB_BUCKETS are exact. Adding a value is O(1) and never allocates, but
+ * it's not atomic: callers shared with IRQ handlers need to disable the
+ * interrupts.
+ * @file
+ */
+
+/**
+ * @brief Bits of the buckets inside each power of 2.
+ */
+#define HIST_SUB_BITS 3
+
+/**
+ * @brief Buckets inside each power of 2.
+ */
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+
+/**
+ * @brief Total number of buckets, enough for any 64-bit value.
+ */
+#define HIST_BUCKETS ((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+/**
+ * @brief Histogram. Initialize with hist_init().
+ */
+typedef struct {
+    uint32_t buckets[HIST_BUCKETS]; /**< @brief Values in each bucket */
+    uint32_t count;                 /**< @brief Number of values */
+    uint64_t min;                   /**< @brief Smallest value */
+    uint64_t max;                   /**< @brief Biggest value */
+    uint64_t sum;                   /**< @brief Sum of the values */
+} Histogram;
+
+/**
+ * @brief Initialize or reset a histogram.
+ * @param[out] hist Histogram to initialize.
+ */
+void hist_init(Histogram* hist);
+
+/**
+ * @brief Add a value to a histogram.
+ * @param[inout] hist Target histogram.
+ * @param val New value.
+ */
+void hist_add(Histogram* hist, uint64_t val);
+
+/**
+ * @brief Get a percentile of the values of a histogram.
+ * @details Returns the upper bound of the bucket containing the percentile,
+ * but never more than the max.
+ * @param[in] hist Target histogram.
+ * @param pct Percentile, from 0 to 100.
+ * @return Value of the percentile, or 0 if the histogram is empty.
+ */
+uint64_t hist_percentile(const Histogram* hist, uint32_t pct);
+
+#endif /* _KERNEL_HISTOGRAM_H */
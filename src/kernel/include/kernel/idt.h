@@ -62,6 +62,8 @@ enum pic_flags {
     ICW4_BUF_MASTER = 0x0C, /**< @brief Buffered mode/master */
     ICW4_SFNM       = 0x10, /**< @brief Special fully nested (not) */
 
+    OCW2_EOI      = 0x20, /**< @brief End of interrupt */
+    OCW3_READ_ISR = 0x0B, /**< @brief Read the In-Service Register */
 };
 
 /**
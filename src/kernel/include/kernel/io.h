@@ -13,6 +13,15 @@
  */
 uint8_t io_inb(uint16_t port);
 
+/**
+ * @brief Reads a word from an I/O port.
+ * @details C wrapper for the `in` assembly instruction. Defined in
+ * src/kernel/io.asm
+ * @param[in] port I/O port to read from.
+ * @return Word from that port.
+ */
+uint16_t io_inw(uint16_t port);
+
 /**
  * @brief Reads a dword from an I/O port.
  * @details C wrapper for the `in` assembly instruction. Defined in
@@ -31,6 +40,15 @@ uint32_t io_inl(uint16_t port);
  */
 void io_outb(uint16_t port, uint8_t data);
 
+/**
+ * @brief Writes a word to an I/O port.
+ * @details C wrapper for the `out` assembly instruction. Defined in
+ * src/kernel/io.asm
+ * @param[out] port I/O port to write to.
+ * @param[in] data Word to be written.
+ */
+void io_outw(uint16_t port, uint16_t data);
+
 /**
  * @brief Writes a dword to an I/O port.
  * @details C wrapper for the `out` assembly instruction. Defined in
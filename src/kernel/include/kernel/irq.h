@@ -0,0 +1,187 @@
+
+#ifndef _KERNEL_IRQ_H
+#define _KERNEL_IRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <kernel/irqoff.h> /* irqoff_begin, irqoff_end */
+
+/**
+ * @brief Hardware interrupts of the PICs, and helpers for disabling the
+ * interrupts in critical sections.
+ * @details All the IRQs go through the same entry stub in src/kernel/idt.asm,
+ * which calls irq_dispatch(). It sends the EOI, calls the handler registered
+ * with irq_register() and measures it. The lines without a handler are masked
+ * in the PICs.
+ *
+ * The interrupts are only disabled and enabled with the helpers below, so
+ * kernel/irqoff.h can measure how long they stay disabled.
+ * @file
+ */
+
+/**
+ * @def IRQ_COUNT
+ * @brief Number of IRQ lines of the master and slave PICs.
+ */
+#define IRQ_COUNT 16
+
+/**
+ * @enum irq_lines
+ * @brief IRQ lines we use.
+ */
+enum irq_lines {
+    IRQ_PIT     = 0, /**< @brief Programmable Interval Timer */
+    IRQ_KB      = 1, /**< @brief PS/2 keyboard */
+    IRQ_CASCADE = 2, /**< @brief Slave PIC, never raised */
+    IRQ_COM1    = 4, /**< @brief First serial port */
+};
+
+/**
+ * @brief Registers of the interrupted code, saved by the IRQ stubs.
+ * @details The order is the one of the stack: pusha, then the IRQ number
+ * pushed by the stub and the frame pushed by the CPU.
+ */
+typedef struct {
+    uint32_t edi, esi, ebp, esp, ebx, edx, ecx, eax;
+    uint32_t irq; /**< @brief IRQ line, 0..15 */
+    uint32_t eip, cs, eflags;
+} IrqFrame;
+
+/**
+ * @brief Stats of an IRQ line, see irq_get_stats()
+ */
+typedef struct {
+    const char* name;    /**< @brief Name of the handler, or NULL */
+    uint32_t count;      /**< @brief IRQs received, excluding the spurious */
+    uint32_t spurious;   /**< @brief Spurious IRQs, only on lines 7 and 15 */
+    uint64_t cycles;     /**< @brief TSC cycles spent in the handler */
+    uint64_t max_cycles; /**< @brief Slowest call to the handler */
+} IrqStats;
+
+/**
+ * @brief Handler of an IRQ line.
+ * @details Called with the interrupts disabled, after the EOI. It can get
+ * the interrupted registers with irq_get_frame().
+ */
+typedef void (*irq_handler_t)(void);
+
+/**
+ * @brief Interrupt flag of EFLAGS.
+ */
+#define EFLAGS_IF 0x200
+
+/**
+ * @brief Disable the interrupts and return the old EFLAGS.
+ * @details Used with irq_restore(), so the sections can be nested and called
+ * with the interrupts already disabled.
+ * @return EFLAGS before disabling the interrupts.
+ */
+static inline uint32_t irq_save(void) {
+    uint32_t eflags;
+    asm volatile("pushfd\n\t"
+                 "pop %0\n\t"
+                 "cli"
+                 : "=r"(eflags)
+                 :
+                 : "memory");
+
+    if (eflags & EFLAGS_IF)
+        irqoff_begin();
+
+    return eflags;
+}
+
+/**
+ * @brief Enable the interrupts again if they were enabled in \p eflags.
+ * @param eflags Value returned by irq_save().
+ */
+static inline void irq_restore(uint32_t eflags) {
+    if (eflags & EFLAGS_IF) {
+        irqoff_end();
+        asm volatile("sti" : : : "memory");
+    }
+}
+
+/**
+ * @brief Disable the interrupts.
+ * @details For the sections that always run with the interrupts enabled, or
+ * that never enable them again. Otherwise, use irq_save().
+ */
+static inline void irq_disable(void) {
+    asm volatile("cli" : : : "memory");
+    irqoff_begin();
+}
+
+/**
+ * @brief Enable the interrupts.
+ * @details Also used by the IRQ handlers that want to be interrupted, e.g. for
+ * rendering.
+ */
+static inline void irq_enable(void) {
+    irqoff_end();
+    asm volatile("sti" : : : "memory");
+}
+
+/**
+ * @brief Check if the interrupts are enabled.
+ * @return True if the IF flag is set.
+ */
+static inline bool irq_enabled(void) {
+    uint32_t eflags;
+    asm volatile("pushfd\n\t"
+                 "pop %0"
+                 : "=r"(eflags)
+                 :
+                 : "memory");
+    return eflags & EFLAGS_IF;
+}
+
+/**
+ * @brief Mask all the IRQ lines in the PICs, except the cascade.
+ * @details Called by idt_init() after remapping the PICs.
+ */
+void irq_init(void);
+
+/**
+ * @brief Set the handler of an IRQ line and unmask it.
+ * @param irq Line, 0..15.
+ * @param[in] name Name shown in the stats, needs to stay valid.
+ * @param handler Function to call on each IRQ.
+ * @return False if the line is out of bounds or already has a handler.
+ */
+bool irq_register(uint8_t irq, const char* name, irq_handler_t handler);
+
+/**
+ * @brief Remove the handler of an IRQ line and mask it.
+ * @details The stats of the line are kept.
+ * @param irq Line, 0..15.
+ */
+void irq_unregister(uint8_t irq);
+
+/**
+ * @brief Get the registers saved by the IRQ being handled.
+ * @details Only valid inside an irq_handler_t.
+ * @return Pointer to the frame, or NULL outside of the handlers.
+ */
+const IrqFrame* irq_get_frame(void);
+
+/**
+ * @brief Get the stats of an IRQ line.
+ * @param irq Line, 0..15.
+ * @param[out] out Copy of the stats.
+ */
+void irq_get_stats(uint8_t irq, IrqStats* out);
+
+/**
+ * @brief Reset the counters of all the IRQ lines.
+ */
+void irq_reset_stats(void);
+
+/**
+ * @brief Send the EOI and call the handler of an IRQ.
+ * @details Called by the IRQ stubs, see src/kernel/idt.asm
+ * @param[in] frame Registers saved by the stub.
+ */
+void irq_dispatch(IrqFrame* frame);
+
+#endif /* _KERNEL_IRQ_H */
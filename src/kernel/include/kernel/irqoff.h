@@ -0,0 +1,103 @@
+
+#ifndef _KERNEL_IRQOFF_H
+#define _KERNEL_IRQOFF_H
+
+#include <stdint.h>
+
+/**
+ * @brief Watchdog of the windows with the interrupts disabled.
+ * @details The helpers of kernel/irq.h call irqoff_begin() when they disable
+ * the interrupts and irqoff_end() right before enabling them again, and
+ * irq_dispatch() does the same for the IRQ handlers. Each window is measured
+ * with the TSC and attributed to the code that disabled the interrupts. The
+ * longest ones are kept for the `irqoff` command, and the ones over the
+ * threshold are logged.
+ *
+ * There is a single CPU and the interrupt flag is not a counter, so there is
+ * at most one window at a time.
+ * @file
+ */
+
+/**
+ * @brief Number of windows kept by irqoff_get_stats(), at most one per site.
+ */
+#define IRQOFF_TOP 8
+
+/**
+ * @brief Default threshold of the warnings, in microseconds. A longer window
+ * can make us miss a PIT tick.
+ */
+#define IRQOFF_THRESHOLD_US 1000
+
+/**
+ * @brief Min PIT ticks (ms) between two warnings in the log.
+ */
+#define IRQOFF_WARN_INTERVAL 1000
+
+/**
+ * @brief Longest window of a site.
+ */
+typedef struct {
+    uint32_t site;   /**< @brief Address that disabled the interrupts */
+    uint64_t cycles; /**< @brief Duration in TSC cycles */
+} IrqOffWindow;
+
+/**
+ * @brief Stats of the watchdog, see irqoff_get_stats()
+ */
+typedef struct {
+    uint32_t windows;  /**< @brief Windows measured */
+    uint32_t over;     /**< @brief Windows longer than the threshold */
+    uint32_t warnings; /**< @brief Windows logged, see IRQOFF_WARN_INTERVAL */
+
+    /** @brief Longest windows, sorted from the longest. Unused entries have a
+     * `site` of 0 */
+    IrqOffWindow top[IRQOFF_TOP];
+} IrqOffStats;
+
+/**
+ * @brief Start a window, attributed to the caller.
+ * @details Called right after disabling the interrupts. Does nothing if there
+ * is already a window.
+ */
+void irqoff_begin(void);
+
+/**
+ * @brief Start a window attributed to a specific address.
+ * @details Same as irqoff_begin(), for callers that know better than their
+ * return address, e.g. irq_dispatch() uses the handler.
+ * @param site Address that disabled the interrupts.
+ */
+void irqoff_begin_at(uint32_t site);
+
+/**
+ * @brief End the current window and measure it.
+ * @details Called with the interrupts disabled, right before enabling them.
+ * Does nothing if there is no window, e.g. before the first sti of idt_init().
+ */
+void irqoff_end(void);
+
+/**
+ * @brief Get a copy of the stats of the watchdog.
+ * @param[out] out Copy of the stats.
+ */
+void irqoff_get_stats(IrqOffStats* out);
+
+/**
+ * @brief Clear the counters and the longest windows.
+ */
+void irqoff_reset(void);
+
+/**
+ * @brief Change the threshold of the warnings.
+ * @param us Threshold in microseconds. 0 disables the warnings.
+ */
+void irqoff_set_threshold(uint32_t us);
+
+/**
+ * @brief Get the threshold of the warnings.
+ * @return Threshold in microseconds, 0 if the warnings are disabled.
+ */
+uint32_t irqoff_get_threshold(void);
+
+#endif /* _KERNEL_IRQOFF_H */
@@ -4,12 +4,116 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <kernel/histogram.h>
 
 /**
- * @def KB_GETCHAR_BUFSZ
- * @brief Max length of an input line
+ * @def KB_EVENT_RING_SZ
+ * @brief Key events that can be waiting in each virtual terminal. Needs to be a
+ * power of 2.
  */
-#define KB_GETCHAR_BUFSZ 1000
+#define KB_EVENT_RING_SZ 64
+
+/**
+ * @def KB_LAYOUT_KEYS
+ * @brief Number of key codes in the arrays of a Layout, up to F12.
+ */
+#define KB_LAYOUT_KEYS 0x59
+
+/**
+ * @def KB_KEY_EXTENDED
+ * @brief Bit of the key codes of the keys with a 0xE0 prefix.
+ */
+#define KB_KEY_EXTENDED 0x80
+
+/**
+ * @enum kb_keys
+ * @brief Key codes of KbEvent.
+ * @details The key codes are the make codes of scancode set 1, and the keys
+ * with a 0xE0 prefix have the KB_KEY_EXTENDED bit set. This way the keypad and
+ * the arrows are different keys. Only the keys without a char in the layouts
+ * are listed here.
+ */
+enum kb_keys {
+    KB_KEY_ESC         = 0x01,
+    KB_KEY_BACKSPACE   = 0x0E,
+    KB_KEY_TAB         = 0x0F,
+    KB_KEY_ENTER       = 0x1C,
+    KB_KEY_LCTRL       = 0x1D,
+    KB_KEY_LSHIFT      = 0x2A,
+    KB_KEY_RSHIFT      = 0x36,
+    KB_KEY_LALT        = 0x38,
+    KB_KEY_SPACE       = 0x39,
+    KB_KEY_CAPSLOCK    = 0x3A,
+    KB_KEY_F1          = 0x3B, /**< @brief F2..F10 follow */
+    KB_KEY_NUMLOCK     = 0x45,
+    KB_KEY_SCROLL_LOCK = 0x46,
+    KB_KEY_KP_7        = 0x47, /**< @brief Home of the keypad */
+    KB_KEY_KP_8        = 0x48, /**< @brief Up arrow of the keypad */
+    KB_KEY_KP_9        = 0x49, /**< @brief Page up of the keypad */
+    KB_KEY_KP_4        = 0x4B, /**< @brief Left arrow of the keypad */
+    KB_KEY_KP_5        = 0x4C,
+    KB_KEY_KP_6        = 0x4D, /**< @brief Right arrow of the keypad */
+    KB_KEY_KP_1        = 0x4F, /**< @brief End of the keypad */
+    KB_KEY_KP_2        = 0x50, /**< @brief Down arrow of the keypad */
+    KB_KEY_KP_3        = 0x51, /**< @brief Page down of the keypad */
+    KB_KEY_KP_0        = 0x52, /**< @brief Insert of the keypad */
+    KB_KEY_KP_DOT      = 0x53, /**< @brief Delete of the keypad */
+    KB_KEY_F11         = 0x57,
+    KB_KEY_F12         = 0x58,
+
+    KB_KEY_KP_ENTER = KB_KEY_EXTENDED | 0x1C,
+    KB_KEY_RCTRL    = KB_KEY_EXTENDED | 0x1D,
+    KB_KEY_KP_SLASH = KB_KEY_EXTENDED | 0x35,
+    KB_KEY_PRTSC    = KB_KEY_EXTENDED | 0x37,
+    KB_KEY_RALT     = KB_KEY_EXTENDED | 0x38,
+    KB_KEY_PAUSE    = KB_KEY_EXTENDED | 0x45, /**< @brief Sent with 0xE1 */
+    KB_KEY_HOME     = KB_KEY_EXTENDED | 0x47,
+    KB_KEY_UP       = KB_KEY_EXTENDED | 0x48,
+    KB_KEY_PAGE_UP  = KB_KEY_EXTENDED | 0x49,
+    KB_KEY_LEFT     = KB_KEY_EXTENDED | 0x4B,
+    KB_KEY_RIGHT    = KB_KEY_EXTENDED | 0x4D,
+    KB_KEY_END      = KB_KEY_EXTENDED | 0x4F,
+    KB_KEY_DOWN     = KB_KEY_EXTENDED | 0x50,
+    KB_KEY_PAGE_DN  = KB_KEY_EXTENDED | 0x51,
+    KB_KEY_INSERT   = KB_KEY_EXTENDED | 0x52,
+    KB_KEY_DELETE   = KB_KEY_EXTENDED | 0x53,
+    KB_KEY_LGUI     = KB_KEY_EXTENDED | 0x5B,
+    KB_KEY_RGUI     = KB_KEY_EXTENDED | 0x5C,
+    KB_KEY_MENU     = KB_KEY_EXTENDED | 0x5D,
+};
+
+/**
+ * @enum kb_mods
+ * @brief Bits of KbEvent.mods
+ */
+enum kb_mods {
+    KB_MOD_SHIFT    = 0x01, /**< @brief Any shift held */
+    KB_MOD_CTRL     = 0x02, /**< @brief Any control held */
+    KB_MOD_ALT      = 0x04, /**< @brief Any alt held */
+    KB_MOD_CAPSLOCK = 0x08, /**< @brief Caps lock on */
+};
+
+/**
+ * @brief Stages measured by the input latency histograms, see kb_get_latency()
+ * @details All of them start at the keyboard IRQ.
+ */
+enum kb_latency_stages {
+    KB_LAT_ECHO  = 0, /**< @brief Until the echoed char is on the screen */
+    KB_LAT_READ  = 1, /**< @brief Until tty_read() returns a line */
+    KB_LAT_EVENT = 2, /**< @brief Until kb_poll_event() returns the event */
+    KB_LAT_COUNT,
+};
+
+/**
+ * @brief Key press or release, see kb_poll_event()
+ */
+typedef struct {
+    uint64_t tsc;    /**< @brief TSC when the IRQ was received */
+    uint8_t keycode; /**< @brief See kb_keys */
+    uint8_t mods;    /**< @brief Bitwise OR of kb_mods, after this event */
+    bool pressed;    /**< @brief False if the key was released */
+    char ch;         /**< @brief Char of the key in the layout, or 0 */
+} KbEvent;
 
 /**
  * @enum kb_special_indexes
@@ -66,8 +170,8 @@ typedef struct {
 } Layout;
 
 /**
- * @brief Actual C handler for the keyboard exceptions received from irq_kb().
- * @details See src/kernel/idt.asm
+ * @brief Handler of the keyboard IRQ.
+ * @details Registered with irq_register() by kb_init()
  */
 void kb_handler(void);
 
@@ -80,57 +184,105 @@ void kb_handler(void);
 bool kb_held(unsigned char c);
 
 /**
- * @brief Disable char printing on key press.
- * @details Sets the print_chars static var declared in keyboard.c
+ * @brief Set the current active keyboard layout to the specified Layout ptr
+ * @param[in] ptr Description
  */
-void kb_noecho(void);
+void kb_setlayout(const Layout* ptr);
 
 /**
- * @brief Enable char printing on key press.
- * @details Sets the print_chars static var declared in keyboard.c
+ * @brief Initialize the key events of each virtual terminal and the input
+ * latency histograms, and register the keyboard IRQ.
+ * @details The terminals need to be initialized first, see tty_init()
  */
-void kb_echo(void);
+void kb_init(void);
 
 /**
- * @brief Get the static print_chars variable.
- * @details The print_chars static var is declared in keyboard.c
- * @return True if we are displaying chars on input.
+ * @brief Start storing the key events of the current virtual terminal.
+ * @details Discards the old ones. While they are enabled, the typed chars are
+ * not sent to the Tty of the virtual terminal. Disabled by default, and by
+ * endwin().
  */
-bool kb_getecho(void);
+void kb_events_on(void);
 
 /**
- * @brief Don't wait for newline when getting chars.
- * @details Sets the wait_for_eol static var declared in keyboard.c
+ * @brief Stop storing the key events of the current virtual terminal.
  */
-void kb_raw(void);
+void kb_events_off(void);
 
 /**
- * @brief Wait for newline when getting chars.
- * @details Sets the wait_for_eol static var declared in keyboard.c
+ * @brief Get the next key event of the current virtual terminal, if there is
+ * one.
+ * @details Doesn't block. The events are only stored after kb_events_on(). If
+ * the buffer was full, the newest events were dropped.
+ * @param[out] out Next event.
+ * @return False if there are no events.
  */
-void kb_noraw(void);
+bool kb_poll_event(KbEvent* out);
 
 /**
- * @brief Set the current active keyboard layout to the specified Layout ptr
- * @param[in] ptr Description
+ * @brief Get the next key event of the current virtual terminal, blocking
+ * until there is one. See kb_poll_event()
+ * @param[out] out Next event.
  */
-void kb_setlayout(const Layout* ptr);
+void kb_wait_event(KbEvent* out);
+
+/**
+ * @brief Check if kb_poll_event() would return an event.
+ * @return True if the current virtual terminal has events.
+ */
+bool kb_has_event(void);
+
+/**
+ * @brief Check if a key is being held, by key code.
+ * @details Unlike kb_held(), it doesn't depend on the layout or shift.
+ * @param keycode Key code, see kb_keys.
+ * @return True if the key is pressed.
+ */
+bool kb_key_down(uint8_t keycode);
+
+/**
+ * @brief Get the modifiers being held.
+ * @return Bitwise OR of kb_mods.
+ */
+uint8_t kb_mods(void);
+
+/**
+ * @brief Add a value to an input latency histogram.
+ * @details Safe from IRQ handlers.
+ * @param stage Target histogram, see kb_latency_stages.
+ * @param cycles Latency in TSC cycles.
+ */
+void kb_latency_add(enum kb_latency_stages stage, uint64_t cycles);
+
+/**
+ * @brief Measure the KB_LAT_ECHO latency of a char that was just echoed.
+ * @details Called by tty_input(). If the console of the displayed virtual
+ * terminal is deferred, the latency ends in kb_echo_presented().
+ * @param tsc TSC of the keyboard IRQ.
+ */
+void kb_echo_done(uint64_t tsc);
+
+/**
+ * @brief Tell the keyboard that the console finished drawing a frame.
+ * @details Called by fbc_flush(). With deferred rendering, the echoed chars are
+ * only on the screen after the next redraw, so that's where their KB_LAT_ECHO
+ * latency ends.
+ * @param start_tsc Value of tsc_read() when we started drawing the frame. Chars
+ * echoed after it might not be in the frame.
+ */
+void kb_echo_presented(uint64_t start_tsc);
 
 /**
- * @brief Initialize the static getchar arrays to EOF.
+ * @brief Get a copy of the histogram of an input latency stage.
+ * @details The values are in TSC cycles, see tsc_to_us().
+ * @param stage Stage of the latency, see kb_latency_stages.
+ * @param[out] out Copy of the histogram.
  */
-void kb_getchar_init(void);
+void kb_get_latency(enum kb_latency_stages stage, Histogram* out);
 
 /**
- * @brief Get input chars from the keyboard once the user wrote a line
- * @details First it tells the kb_handler function that we are waiting for
- * input, then read from the getchar_buf until there is a char. If wait_for_eol
- * is false, getchar_buf will be filled instantly, otherwise it will wait for
- * the user to type a full line.
- *
- * See the fs-os wiki for more info.
- * @return Next user input char from the keyboard.
+ * @brief Empty the input latency histograms.
  */
-int kb_getchar(void);
+void kb_reset_latency(void);
 
 #endif /* _KERNEL_KEYBOARD_H */
@@ -0,0 +1,48 @@
+
+#ifndef _KERNEL_KSYMS_H
+#define _KERNEL_KSYMS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Symbol table of the kernel functions.
+ * @details The table is generated at link time by scripts/gen_ksyms.py from
+ * the `nm` output of the kernel binary, see the Makefile. It's sorted by
+ * address, and it only has the symbols of .text.
+ * @file
+ */
+
+/**
+ * @brief Symbol of the table.
+ */
+typedef struct {
+    uint32_t addr;    /**< @brief Start address */
+    const char* name; /**< @brief Name of the function */
+} KSym;
+
+/**
+ * @name Generated table
+ * @brief Defined in the generated source, see scripts/gen_ksyms.py
+ * @{ */
+extern const KSym ksyms_table[];
+extern const size_t ksyms_count;
+/** @} */
+
+/**
+ * @brief Get the function that contains an address.
+ * @param addr Address inside .text
+ * @return Symbol with the closest address below or equal to \p addr, or NULL
+ * if \p addr is outside of .text.
+ */
+const KSym* ksyms_find(uint32_t addr);
+
+/**
+ * @brief Check if an address is inside .text
+ * @param addr Target address.
+ * @return True if it could be the address of an instruction of the kernel.
+ */
+bool ksyms_in_text(uint32_t addr);
+
+#endif /* _KERNEL_KSYMS_H */
@@ -0,0 +1,124 @@
+
+#ifndef _KERNEL_LOG_H
+#define _KERNEL_LOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+/**
+ * @brief Kernel log.
+ * @details Fixed-size ring buffer of records with a level and a TSC timestamp.
+ * Writing never blocks and doesn't touch any device, so it's safe from any
+ * context, including IRQ handlers: the slot is reserved with an atomic
+ * increment and published with a sequence number once it's filled.
+ *
+ * Each consumer has its own LogReader. The console and the serial port are
+ * drained by log_drain() outside of the hot paths, and the `dmesg` command
+ * reads the whole buffer. When the writers lap a reader, the oldest records
+ * are lost and counted in the reader.
+ * @file
+ */
+
+/**
+ * @brief Number of records in the ring buffer. Needs to be a power of 2.
+ */
+#define LOG_SLOTS 256
+
+/**
+ * @brief Max chars of a message, including the '\0'. Longer ones are
+ * truncated.
+ */
+#define LOG_MSG_SZ 115
+
+/**
+ * @enum log_level
+ * @brief Severity of a record. Lower is more important.
+ */
+enum log_level {
+    LOG_ERR   = 0, /**< @brief Something failed */
+    LOG_WARN  = 1, /**< @brief Something is missing or degraded */
+    LOG_INFO  = 2, /**< @brief Normal messages, like the boot steps */
+    LOG_DEBUG = 3, /**< @brief Only for the serial port and dmesg */
+};
+
+/**
+ * @brief Record of the log, the size of a slot of the ring buffer.
+ */
+typedef struct {
+    uint64_t tsc;         /**< @brief TSC when it was written */
+    uint32_t seq;         /**< @brief Position + 1 once published */
+    uint8_t level;        /**< @brief See log_level */
+    char msg[LOG_MSG_SZ]; /**< @brief Zero-terminated message */
+} LogRecord;
+
+/**
+ * @brief Position of a consumer of the log.
+ */
+typedef struct {
+    uint32_t next; /**< @brief Position of the next record to read */
+    uint32_t lost; /**< @brief Records overwritten before being read */
+} LogReader;
+
+/**
+ * @brief Add a formatted record to the log.
+ * @details Safe from any context. The message is formatted with vsnprintf()
+ * directly into the slot. Doesn't print anything, see log_drain().
+ * @param level Severity of the record, see log_level.
+ * @param[in] fmt Format string.
+ */
+void log_write(enum log_level level, const char* fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Add a formatted record to the log using the specified variable
+ * argument list. See log_write()
+ * @param level Severity of the record, see log_level.
+ * @param[in] fmt Format string.
+ * @param[in] va Variable argument list.
+ */
+void log_vwrite(enum log_level level, const char* fmt, va_list va);
+
+/**
+ * @brief Initialize a reader at the oldest record still in the log.
+ * @param[out] reader Reader to initialize.
+ */
+void log_reader_init(LogReader* reader);
+
+/**
+ * @brief Copy the next record of a reader.
+ * @param[inout] reader Reader of the log.
+ * @param[out] out Copy of the record.
+ * @return False if there are no more published records.
+ */
+bool log_read(LogReader* reader, LogRecord* out);
+
+/**
+ * @brief Print the new records to the console and the serial port.
+ * @details The console only gets the records up to the level of
+ * log_set_console_level(). Should not be called from IRQ handlers, it's called
+ * while booting and by vt_yield() on the console of the first virtual
+ * terminal.
+ */
+void log_drain(void);
+
+/**
+ * @brief Send the new records to the serial port, but not to the console.
+ * @details For panics, where the message was already printed.
+ */
+void log_flush_serial(void);
+
+/**
+ * @brief Set the most verbose level printed to the console by log_drain()
+ * @param level Most verbose level, LOG_INFO by default.
+ */
+void log_set_console_level(enum log_level level);
+
+/**
+ * @brief Get the name of a level, like "info".
+ * @param level Level of a record.
+ * @return Zero-terminated name.
+ */
+const char* log_level_name(enum log_level level);
+
+#endif /* _KERNEL_LOG_H */
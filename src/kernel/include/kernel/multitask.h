@@ -3,21 +3,34 @@
 #define _KERNEL_MULTITASK_H
 
 #include <stdint.h>
+#include <stdlib.h> /* RandState */
 
 typedef struct Ctx Ctx;
 
+/**
+ * @enum task_state
+ * @brief Values of Ctx.state
+ */
+enum task_state {
+    TASK_READY   = 0, /**< @brief Can run, the default */
+    TASK_BLOCKED = 1, /**< @brief In a WaitQueue, skipped by mt_yield() */
+};
+
 /**
  * @struct Task context struct
  * @details We could add more stuff like parent task and priority
  */
 struct Ctx {
-    Ctx* next;      /**< @brief Pointer to next task */
-    Ctx* prev;      /**< @brief Pointer to next task */
-    uint32_t stack; /**< @brief Pointer to the allocated stack for the task */
-    uint32_t esp;   /**< @brief Stack top */
-    uint32_t cr3;   /**< @brief cr3 register (page directory) */
-    uint32_t state; /**< @brief Unused for now. */
-    char* name;     /**< @brief Task name */
+    Ctx* next;       /**< @brief Pointer to next task */
+    Ctx* prev;       /**< @brief Pointer to next task */
+    uint32_t stack;  /**< @brief Pointer to the allocated stack for the task */
+    uint32_t esp;    /**< @brief Stack top */
+    uint32_t cr3;    /**< @brief cr3 register (page directory) */
+    uint32_t state;  /**< @brief See task_state */
+    char* name;      /**< @brief Task name */
+    RandState rand;  /**< @brief Generator of rand(). Seeded on the first use */
+    Ctx* wait_next;  /**< @brief Next task of the WaitQueue it's blocked in */
+    struct Tty* tty; /**< @brief Stdin, see tty_stdin(). Copied to new tasks */
 };
 
 typedef struct tss_t Tss;
@@ -112,9 +125,18 @@ Ctx* mt_newtask(const char* name, void* entry);
  */
 void mt_switch(Ctx* next);
 
+/**
+ * @brief Switch to the next task that is not blocked.
+ * @details If all of them are blocked, including the current one, halts until
+ * an interrupt wakes one. Returns once the current task is ready and it's its
+ * turn again. Defined in src/kernel/multitask.c
+ */
+void mt_yield(void);
+
 /**
  * @brief Frees the stack and ends the task passed as parameter.
- * @details The task should not be the current working task.
+ * @details The task should not be the current working task, and it should not
+ * be blocked in a WaitQueue.
  * @param[out] task Task to kill.
  */
 void mt_endtask(Ctx* task);
@@ -0,0 +1,85 @@
+
+#ifndef _KERNEL_PERF_H
+#define _KERNEL_PERF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Sampling profiler of the kernel.
+ * @details While it's running, the PIT IRQ records the interrupted EIP and
+ * the return addresses of its callers, following the saved frame pointers.
+ * perf_report() resolves them with the kernel symbol table (see
+ * kernel/ksyms.h) and prints the functions and the call chains with the most
+ * samples. Code that runs with the interrupts disabled is not sampled.
+ * @file
+ */
+
+/**
+ * @def PERF_MAX_SAMPLES
+ * @brief Size of the sample buffer. When it's full, the new samples are
+ * dropped.
+ */
+#define PERF_MAX_SAMPLES 4096
+
+/**
+ * @def PERF_STACK_DEPTH
+ * @brief Max number of callers stored in each sample.
+ */
+#define PERF_STACK_DEPTH 4
+
+/**
+ * @brief Sample of the profiler.
+ */
+typedef struct {
+    uint32_t eip; /**< @brief Interrupted instruction */
+
+    /** @brief Return addresses of the callers, from the closest one. Unused
+     * entries are 0 */
+    uint32_t callers[PERF_STACK_DEPTH];
+} PerfSample;
+
+/**
+ * @brief Discard the old samples and start sampling.
+ * @param period PIT ticks (ms) between samples, at least 1.
+ */
+void perf_start(uint32_t period);
+
+/**
+ * @brief Stop sampling. The samples are kept for perf_report()
+ */
+void perf_stop(void);
+
+/**
+ * @brief Check if the profiler is sampling.
+ * @return True between perf_start() and perf_stop()
+ */
+bool perf_running(void);
+
+/**
+ * @brief Get the samples recorded since the last perf_start()
+ * @details Only stable while the profiler is stopped.
+ * @param[out] count Number of samples.
+ * @param[out] dropped Samples dropped because the buffer was full.
+ * @return Pointer to the samples.
+ */
+const PerfSample* perf_get_samples(size_t* count, uint32_t* dropped);
+
+/**
+ * @brief Record a sample of the interrupted code if it's time to.
+ * @details Called by the PIT IRQ handler.
+ * @param ticks Current PIT ticks.
+ */
+void perf_tick(uint64_t ticks);
+
+/**
+ * @brief Print the functions and the call chains with the most samples.
+ * @details Stops the profiler first. Needs to allocate memory for the
+ * report.
+ * @param top Max number of lines of each table.
+ * @return False if there are no samples, or we couldn't allocate the memory.
+ */
+bool perf_report(size_t top);
+
+#endif /* _KERNEL_PERF_H */
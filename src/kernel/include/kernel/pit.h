@@ -79,7 +79,7 @@ void pit_dec(void);
 
 /**
  * @brief increase the current tick count.
- * @details Called from the PIT interrupt, on: src/kernel/idt.asm
+ * @details Handler of the PIT IRQ, registered by pit_init()
  */
 void pit_inc(void);
 
@@ -0,0 +1,105 @@
+
+#ifndef _KERNEL_PMU_H
+#define _KERNEL_PMU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Hardware performance counters.
+ * @details Uses the architectural performance monitoring of Intel CPUs,
+ * detected with cpuid leaf 0xA. Each event of pmu_events gets a general
+ * purpose counter, programmed through the IA32_PERFEVTSELx and IA32_PMCx
+ * MSRs.
+ *
+ * QEMU only has a PMU with KVM (e.g. `-enable-kvm -cpu host`). Under TCG the
+ * version is 0, and pmu_init() returns false without touching any MSR.
+ *
+ * The counters are global: they count the IRQs and the other tasks too.
+ * @file
+ */
+
+/**
+ * @name Architectural MSRs
+ * @{ */
+#define MSR_PERFEVTSEL0      0x186 /**< @brief Event of PMC0, PMC1 is +1... */
+#define MSR_PMC0             0x0C1 /**< @brief Counter 0, PMC1 is +1... */
+#define MSR_PERF_GLOBAL_CTRL 0x38F /**< @brief Enable bits, since version 2 */
+/** @} */
+
+/**
+ * @name Bits of IA32_PERFEVTSELx
+ * @{ */
+#define PERFEVTSEL_USR (1 << 16) /**< @brief Count in ring 3 */
+#define PERFEVTSEL_OS  (1 << 17) /**< @brief Count in ring 0 */
+#define PERFEVTSEL_EN  (1 << 22) /**< @brief Enable the counter */
+/** @} */
+
+/**
+ * @enum pmu_events
+ * @brief Events counted by pmu_start()
+ */
+enum pmu_events {
+    PMU_CYCLES        = 0, /**< @brief Core cycles, not counted while halted */
+    PMU_INSTRUCTIONS  = 1, /**< @brief Instructions retired */
+    PMU_LLC_MISSES    = 2, /**< @brief Last level cache misses */
+    PMU_BRANCH_MISSES = 3, /**< @brief Mispredicted branches retired */
+    PMU_EVENT_COUNT   = 4,
+};
+
+/**
+ * @brief Values read by pmu_stop()
+ */
+typedef struct {
+    /** @brief Value of each event of pmu_events */
+    uint64_t values[PMU_EVENT_COUNT];
+
+    /** @brief Bit N is set if event N was counted. The others are not
+     * supported by the CPU, or there were not enough counters */
+    uint32_t counted;
+} PmuCounts;
+
+/**
+ * @brief Detect the performance counters.
+ * @return False if the CPU doesn't have architectural performance monitoring.
+ */
+bool pmu_init(void);
+
+/**
+ * @brief Check if pmu_init() found the performance counters.
+ * @return True if pmu_start() can count something.
+ */
+bool pmu_available(void);
+
+/**
+ * @brief Get the version of the architectural performance monitoring.
+ * @return Version from cpuid leaf 0xA, 0 if not available.
+ */
+uint8_t pmu_version(void);
+
+/**
+ * @brief Get the number of general purpose counters.
+ * @return Number of counters, 0 if not available.
+ */
+uint8_t pmu_counters(void);
+
+/**
+ * @brief Get the name of an event, in the style of `perf stat`.
+ * @param id Event of pmu_events.
+ * @return Name of the event, or NULL if it's out of bounds.
+ */
+const char* pmu_event_name(uint8_t id);
+
+/**
+ * @brief Reset the counters and start counting the events of pmu_events.
+ * @return False if the counters are not available, or already counting.
+ */
+bool pmu_start(void);
+
+/**
+ * @brief Stop counting and read the counters.
+ * @param[out] out Values of the events.
+ */
+void pmu_stop(PmuCounts* out);
+
+#endif /* _KERNEL_PMU_H */
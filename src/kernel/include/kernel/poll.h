@@ -0,0 +1,80 @@
+
+#ifndef _KERNEL_POLL_H
+#define _KERNEL_POLL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/waitqueue.h> /* wq_cond_t */
+#include <kernel/tty.h>
+
+/**
+ * @brief Waiting for input from several sources, with timeouts.
+ * @details All the tasks waiting for input block in the same WaitQueue. The
+ * producers call poll_notify() when they have something new, and the PIT calls
+ * poll_tick() for the timeouts. The woken tasks check their own conditions
+ * again, so there can be spurious wakeups but no missed ones.
+ * @file
+ */
+
+/**
+ * @def POLL_FOREVER
+ * @brief Deadline of poll_wait() that never expires.
+ */
+#define POLL_FOREVER UINT64_MAX
+
+/**
+ * @enum poll_sources
+ * @brief Values of PollFd.source
+ */
+enum poll_sources {
+    POLL_TTY       = 0, /**< @brief Chars for tty_read() of PollFd.tty */
+    POLL_KB_EVENTS = 1, /**< @brief Events for kb_poll_event() */
+    POLL_SERIAL    = 2, /**< @brief Bytes for serial_getchar() */
+};
+
+/**
+ * @brief Source of input for poll()
+ */
+typedef struct {
+    uint8_t source; /**< @brief See poll_sources */
+    Tty* tty;       /**< @brief For POLL_TTY. If NULL, tty_stdin() */
+    bool ready;     /**< @brief Set by poll() if it has input */
+} PollFd;
+
+/**
+ * @brief Wait until some of the sources have input.
+ * @param[inout] fds Sources to check. Their `ready` member is updated.
+ * @param n Number of sources.
+ * @param timeout_ms Max milliseconds to wait. 0 returns without blocking, and
+ * negative values wait forever.
+ * @return Number of sources with input, 0 if it timed out.
+ */
+int poll(PollFd* fds, size_t n, int32_t timeout_ms);
+
+/**
+ * @brief Block the current task until a condition is true or a deadline
+ * passes.
+ * @details The condition is checked with the interrupts disabled, and after
+ * each poll_notify(). Other tasks run in the meantime.
+ * @param cond Condition to wait for.
+ * @param[in] arg Argument for \p cond.
+ * @param deadline PIT tick when we stop waiting, or POLL_FOREVER.
+ * @return Value of \p cond when we stopped waiting.
+ */
+bool poll_wait(wq_cond_t cond, const void* arg, uint64_t deadline);
+
+/**
+ * @brief Wake the tasks in poll_wait() so they check their conditions.
+ * @details Safe from IRQ handlers.
+ */
+void poll_notify(void);
+
+/**
+ * @brief Wake the tasks in poll_wait() if a deadline passed.
+ * @details Called on each PIT tick.
+ * @param ticks Current PIT ticks.
+ */
+void poll_tick(uint64_t ticks);
+
+#endif /* _KERNEL_POLL_H */
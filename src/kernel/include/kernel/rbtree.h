@@ -0,0 +1,123 @@
+
+#ifndef _KERNEL_RBTREE_H
+#define _KERNEL_RBTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Intrusive red-black tree.
+ * @details The nodes are embedded in the structures stored in the tree, and
+ * the tree never allocates. Use RB_ENTRY() to get the structure of a node.
+ * Insertion, search and removal are O(log n).
+ * @file
+ */
+
+/**
+ * @brief Get the structure containing a node.
+ * @param ptr Pointer to the RbNode
+ * @param type Type of the structure
+ * @param member Name of the RbNode member in the structure
+ */
+#define RB_ENTRY(ptr, type, member) \
+    ((type*)((char*)(ptr) - offsetof(type, member)))
+
+typedef struct RbNode RbNode;
+/**
+ * @struct RbNode
+ * @brief Node of a red-black tree, embedded in the stored structures.
+ */
+struct RbNode {
+    RbNode* parent; /**< @brief Parent node, NULL for the root */
+    RbNode* left;   /**< @brief Left child, smaller nodes */
+    RbNode* right;  /**< @brief Right child, bigger nodes */
+    bool red;       /**< @brief Color of the node */
+};
+
+/**
+ * @brief Red-black tree. Initialize with `RbTree tree = { NULL };`
+ */
+typedef struct {
+    RbNode* root; /**< @brief Root node, NULL if empty */
+} RbTree;
+
+/**
+ * @brief Compare 2 nodes of the tree.
+ * @return Less than, equal to or greater than 0 if \p a goes before, is equal
+ * to or goes after \p b
+ */
+typedef int (*rb_cmp_t)(const RbNode* a, const RbNode* b);
+
+/**
+ * @brief Compare a key with a node of the tree.
+ * @return Less than, equal to or greater than 0 if \p key goes before, is
+ * equal to or goes after \p node
+ */
+typedef int (*rb_key_cmp_t)(const void* key, const RbNode* node);
+
+/**
+ * @brief Insert a node in the tree.
+ * @param[inout] tree Red-black tree.
+ * @param[out] node Node to insert, not in any tree.
+ * @param[in] cmp Comparison function between nodes.
+ * @return NULL if the node was inserted, or the node of the tree equal to
+ * \p node, and then \p node is not inserted.
+ */
+RbNode* rb_insert(RbTree* tree, RbNode* node, rb_cmp_t cmp);
+
+/**
+ * @brief Remove a node from the tree.
+ * @param[inout] tree Red-black tree.
+ * @param[inout] node Node of the tree to remove.
+ */
+void rb_remove(RbTree* tree, RbNode* node);
+
+/**
+ * @brief Search the node equal to a key.
+ * @param[in] tree Red-black tree.
+ * @param[in] key Key to search. First argument of \p cmp.
+ * @param[in] cmp Comparison function between keys and nodes.
+ * @return Node equal to the key, or NULL if there isn't one.
+ */
+RbNode* rb_find(const RbTree* tree, const void* key, rb_key_cmp_t cmp);
+
+/**
+ * @brief Search the last node that is less than or equal to a key.
+ * @details For looking up ranges, like the symbol of an address.
+ * @param[in] tree Red-black tree.
+ * @param[in] key Key to search. First argument of \p cmp.
+ * @param[in] cmp Comparison function between keys and nodes.
+ * @return Last node less than or equal to the key, or NULL if all of them are
+ * bigger.
+ */
+RbNode* rb_floor(const RbTree* tree, const void* key, rb_key_cmp_t cmp);
+
+/**
+ * @brief Get the smallest node of the tree.
+ * @param[in] tree Red-black tree.
+ * @return First node, or NULL if the tree is empty.
+ */
+RbNode* rb_first(const RbTree* tree);
+
+/**
+ * @brief Get the biggest node of the tree.
+ * @param[in] tree Red-black tree.
+ * @return Last node, or NULL if the tree is empty.
+ */
+RbNode* rb_last(const RbTree* tree);
+
+/**
+ * @brief Get the next node in order.
+ * @param[in] node Node of a tree.
+ * @return Next node, or NULL if \p node is the last one.
+ */
+RbNode* rb_next(const RbNode* node);
+
+/**
+ * @brief Get the previous node in order.
+ * @param[in] node Node of a tree.
+ * @return Previous node, or NULL if \p node is the first one.
+ */
+RbNode* rb_prev(const RbNode* node);
+
+#endif /* _KERNEL_RBTREE_H */
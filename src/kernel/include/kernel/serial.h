@@ -0,0 +1,187 @@
+
+#ifndef _KERNEL_SERIAL_H
+#define _KERNEL_SERIAL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Serial port driver for the 16550 UART.
+ * @details The sent bytes go to a ring buffer, and the THRE interrupt refills
+ * the 16-byte TX FIFO from it, so writers only wait when the ring is full. The
+ * received bytes are stored in another ring buffer by the same interrupt.
+ * With the interrupts disabled (while booting or in a panic), the bytes are
+ * sent by polling the UART.
+ *
+ * See: https://wiki.osdev.org/Serial_Ports
+ * @file
+ */
+
+/**
+ * @brief Baud rate used for the serial port.
+ */
+#define SERIAL_BAUD 115200
+
+/**
+ * @brief Base I/O port of the serial port we use (COM1).
+ */
+#define SERIAL_PORT 0x3F8
+
+/**
+ * @brief Size of the TX ring buffer. Needs to be a power of 2.
+ */
+#define SERIAL_TX_SZ 4096
+
+/**
+ * @brief Size of the RX ring buffer. Needs to be a power of 2.
+ */
+#define SERIAL_RX_SZ 256
+
+/**
+ * @brief Size of the TX FIFO of the 16550.
+ */
+#define SERIAL_FIFO_SZ 16
+
+/**
+ * @enum serial_regs
+ * @brief Offsets of the UART registers from the base port.
+ */
+enum serial_regs {
+    SERIAL_REG_DATA   = 0, /**< @brief Read/Write. RX/TX buffer */
+    SERIAL_REG_IER    = 1, /**< @brief Write. Interrupt enable */
+    SERIAL_REG_DIV_LO = 0, /**< @brief Divisor low byte, if DLAB is set */
+    SERIAL_REG_DIV_HI = 1, /**< @brief Divisor high byte, if DLAB is set */
+    SERIAL_REG_IIR    = 2, /**< @brief Read. Interrupt identification */
+    SERIAL_REG_FCR    = 2, /**< @brief Write. FIFO control */
+    SERIAL_REG_LCR    = 3, /**< @brief Line control */
+    SERIAL_REG_MCR    = 4, /**< @brief Modem control */
+    SERIAL_REG_LSR    = 5, /**< @brief Read. Line status */
+    SERIAL_REG_MSR    = 6, /**< @brief Read. Modem status */
+};
+
+/**
+ * @enum serial_ier_flags
+ * @brief Flags of the SERIAL_REG_IER register.
+ */
+enum serial_ier_flags {
+    SERIAL_IER_RX   = 0x01, /**< @brief Received data available */
+    SERIAL_IER_THRE = 0x02, /**< @brief Transmitter holding register empty */
+};
+
+/**
+ * @enum serial_iir_flags
+ * @brief Values of the SERIAL_REG_IIR register.
+ */
+enum serial_iir_flags {
+    SERIAL_IIR_NONE       = 0x01, /**< @brief No interrupt pending */
+    SERIAL_IIR_ID         = 0x0E, /**< @brief Mask of the interrupt id */
+    SERIAL_IIR_MODEM      = 0x00, /**< @brief Modem status changed */
+    SERIAL_IIR_THRE       = 0x02, /**< @brief TX FIFO empty */
+    SERIAL_IIR_RX         = 0x04, /**< @brief RX FIFO reached the trigger */
+    SERIAL_IIR_LINE       = 0x06, /**< @brief Line status error */
+    SERIAL_IIR_RX_TIMEOUT = 0x0C, /**< @brief Data in the RX FIFO for a while */
+};
+
+/**
+ * @enum serial_lsr_flags
+ * @brief Flags of the SERIAL_REG_LSR register.
+ */
+enum serial_lsr_flags {
+    SERIAL_LSR_DATA_READY = 0x01, /**< @brief There is data to read */
+    SERIAL_LSR_THRE       = 0x20, /**< @brief Transmitter holding register
+                                     empty. We can send a new byte */
+    SERIAL_LSR_TEMT       = 0x40, /**< @brief Transmitter empty, the last
+                                     byte was sent */
+};
+
+/**
+ * @brief Counters of the serial driver, for the `serial` command.
+ */
+typedef struct {
+    uint32_t tx_bytes;   /**< @brief Bytes added to the TX ring */
+    uint32_t tx_waits;   /**< @brief Times a writer found the TX ring full */
+    uint32_t rx_bytes;   /**< @brief Bytes received */
+    uint32_t rx_dropped; /**< @brief Bytes received with the RX ring full */
+    uint32_t irqs;       /**< @brief Calls to serial_handler() */
+} SerialStats;
+
+/**
+ * @brief Initialize the serial port.
+ * @details 8 bits, no parity and one stop bit at SERIAL_BAUD. Checks that the
+ * UART works with the loopback mode, and enables its interrupts and its
+ * IRQ.
+ * @return True if the serial port is available.
+ */
+bool serial_init(void);
+
+/**
+ * @brief Check if the serial port was initialized by serial_init()
+ * @return True if we can write to the serial port.
+ */
+bool serial_available(void);
+
+/**
+ * @brief Handler of the COM1 IRQ, registered by serial_init().
+ * @details Refills the TX FIFO and empties the RX FIFO.
+ */
+void serial_handler(void);
+
+/**
+ * @brief Sends \p len chars through the serial port.
+ * @details Does nothing if the serial port is not available. Newlines are sent
+ * as "\r\n". The chars are added to the TX ring buffer, and this only waits
+ * if it's full. Safe to call with the interrupts disabled, but then it waits
+ * until all the ring is sent.
+ * @param[in] s Chars to send, don't need to be zero-terminated.
+ * @param len Number of chars
+ */
+void serial_write(const char* s, size_t len);
+
+/**
+ * @brief Sends \p len bytes through the serial port, without changing the
+ * newlines. See serial_write()
+ * @param[in] data Bytes to send.
+ * @param len Number of bytes.
+ */
+void serial_write_raw(const void* data, size_t len);
+
+/**
+ * @brief Sends \p c through the serial port. See serial_write()
+ * @param c Char to send
+ */
+void serial_putchar(char c);
+
+/**
+ * @brief Sends a zero-terminated string through the serial port using
+ * serial_write()
+ * @param[in] s Zero-terminated string to send
+ */
+void serial_sprint(const char* s);
+
+/**
+ * @brief Wait until all the chars of the TX ring buffer are sent.
+ * @details For panics, before halting.
+ */
+void serial_flush(void);
+
+/**
+ * @brief Get the next received char.
+ * @return The char, or -1 if there isn't one. Doesn't block.
+ */
+int serial_getchar(void);
+
+/**
+ * @brief Check if serial_getchar() would return a char.
+ * @details Use poll() with POLL_SERIAL for waiting for one.
+ * @return True if the RX ring is not empty.
+ */
+bool serial_rx_ready(void);
+
+/**
+ * @brief Get the counters of the driver.
+ * @param[out] out Copy of the counters.
+ */
+void serial_get_stats(SerialStats* out);
+
+#endif /* _KERNEL_SERIAL_H */
@@ -0,0 +1,84 @@
+
+#ifndef _KERNEL_TRACE_H
+#define _KERNEL_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Function-level tracing of the kernel.
+ * @details With `make trace`, the kernel and libk are built with
+ * `-finstrument-functions`, and each function call adds an enter and an exit
+ * event with its TSC to a ring buffer. Only the last TRACE_RING_SZ events are
+ * kept. Tracing starts enabled, so the ring has the boot, and kernel_main()
+ * stops it before starting the shell.
+ *
+ * trace_dump() sends the ring through the serial port with this format, all
+ * little endian:
+ *   - Header: TRACE_MAGIC (8 bytes), TRACE_VERSION (u8), TSC frequency in Hz
+ *     or 0 (u64), TSC of the first event (u64), number of symbols (u32) and
+ *     number of events (u32).
+ *   - Symbols of the traced functions: address (u32), name length (u8) and
+ *     the name, without the NUL.
+ *   - Events, from the oldest: ULEB128 of the TSC delta from the previous
+ *     event shifted left once, with the lowest bit set for exits. Then
+ *     ULEB128 of the index of the function in the symbols.
+ *   - TRACE_END_MAGIC (8 bytes).
+ *
+ * scripts/trace2json.py converts it to the JSON of the Chrome trace viewer.
+ * @file
+ */
+
+/**
+ * @def TRACE_RING_SZ
+ * @brief Number of events in the ring. Needs to be a power of 2.
+ */
+#define TRACE_RING_SZ 32768
+
+/**
+ * @name Markers of the trace_dump() stream
+ * @{ */
+#define TRACE_MAGIC     "FSTRACE"
+#define TRACE_END_MAGIC "FSTREND"
+#define TRACE_VERSION   1
+/** @} */
+
+/**
+ * @brief Check if the kernel was built with `make trace`
+ * @return True if there are events to record.
+ */
+bool trace_available(void);
+
+/**
+ * @brief Discard the old events and start recording.
+ */
+void trace_start(void);
+
+/**
+ * @brief Stop recording. The events are kept for trace_dump()
+ */
+void trace_stop(void);
+
+/**
+ * @brief Check if the events are being recorded.
+ * @return True between trace_start() and trace_stop()
+ */
+bool trace_running(void);
+
+/**
+ * @brief Get the number of events in the ring.
+ * @param[out] overwritten Old events that didn't fit in the ring.
+ * @return Number of events.
+ */
+size_t trace_count(uint32_t* overwritten);
+
+/**
+ * @brief Stop recording, and send the events of the ring through the serial
+ * port. See the format above.
+ * @return False if the serial port is not available, or we couldn't allocate
+ * the symbols.
+ */
+bool trace_dump(void);
+
+#endif /* _KERNEL_TRACE_H */
@@ -0,0 +1,108 @@
+
+#ifndef _KERNEL_TRACEPOINT_H
+#define _KERNEL_TRACEPOINT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Static tracepoints of the kernel.
+ * @details The tracepoints are always compiled in, and each one can be enabled
+ * at runtime with tp_enable(). A disabled tracepoint is a single test of
+ * tp_enabled, and an enabled one adds a TpEvent with the TSC and 2 arguments
+ * to a ring buffer. Only the last TP_RING_SZ events are kept.
+ * @file
+ */
+
+/**
+ * @def TP_RING_SZ
+ * @brief Number of events in the ring. Needs to be a power of 2.
+ */
+#define TP_RING_SZ 4096
+
+/**
+ * @enum tracepoint_ids
+ * @brief Tracepoints, and the arguments of their events.
+ * @details TP_MT_SWITCH is also used in src/kernel/multitask.asm
+ */
+enum tracepoint_ids {
+    TP_MT_SWITCH  = 0, /**< @brief Names of the previous and next tasks */
+    TP_IRQ_ENTRY  = 1, /**< @brief IRQ line and interrupted EIP */
+    TP_IRQ_EXIT   = 2, /**< @brief IRQ line and TSC cycles in the handler */
+    TP_HEAP_ALLOC = 3, /**< @brief Size and address */
+    TP_HEAP_FREE  = 4, /**< @brief Address and size */
+    TP_FBC_SHIFT  = 5, /**< @brief Number of rows, and 0 */
+    TP_KB_EVENT   = 6, /**< @brief Keycode, and kb_mods << 8 | pressed */
+    TP_COUNT      = 7,
+};
+
+/**
+ * @brief Event of a tracepoint.
+ */
+typedef struct {
+    uint64_t tsc;  /**< @brief TSC when it was added */
+    uint32_t arg0; /**< @brief See tracepoint_ids */
+    uint32_t arg1; /**< @brief See tracepoint_ids */
+    uint8_t id;    /**< @brief See tracepoint_ids */
+} TpEvent;
+
+/**
+ * @var tp_enabled
+ * @brief Enabled tracepoints, bit N is the tracepoint N. Use tp_enable() for
+ * changing it.
+ */
+extern volatile uint32_t tp_enabled;
+
+/**
+ * @def TRACEPOINT
+ * @brief Add an event if the tracepoint is enabled.
+ * @param id Tracepoint, see tracepoint_ids.
+ * @param arg0 First argument, cast to uint32_t.
+ * @param arg1 Second argument, cast to uint32_t.
+ */
+#define TRACEPOINT(id, arg0, arg1)                               \
+    do {                                                         \
+        if (__builtin_expect(tp_enabled & (1u << (id)), 0))      \
+            tp_record((id), (uint32_t)(arg0), (uint32_t)(arg1)); \
+    } while (0)
+
+/**
+ * @brief Add an event to the ring. Use the TRACEPOINT macro instead.
+ * @details Safe from IRQ handlers.
+ * @param id Tracepoint, see tracepoint_ids.
+ * @param arg0 First argument.
+ * @param arg1 Second argument.
+ */
+void tp_record(uint32_t id, uint32_t arg0, uint32_t arg1)
+  __attribute__((cold, noinline));
+
+/**
+ * @brief Enable or disable a tracepoint.
+ * @param id Tracepoint, see tracepoint_ids.
+ * @param on True for enabling it.
+ */
+void tp_enable(uint8_t id, bool on);
+
+/**
+ * @brief Get the name of a tracepoint.
+ * @param id Tracepoint, see tracepoint_ids.
+ * @return Name, or NULL if \p id is out of bounds.
+ */
+const char* tp_name(uint8_t id);
+
+/**
+ * @brief Copy the last events of the ring, from the oldest.
+ * @param[out] out Where to copy the events.
+ * @param max Max number of events to copy.
+ * @param[out] lost Events overwritten since the last tp_clear(), or NULL.
+ * @return Number of events copied.
+ */
+size_t tp_read(TpEvent* out, size_t max, uint32_t* lost);
+
+/**
+ * @brief Discard all the events of the ring.
+ */
+void tp_clear(void);
+
+#endif /* _KERNEL_TRACEPOINT_H */
@@ -0,0 +1,49 @@
+
+#ifndef _KERNEL_TSC_H
+#define _KERNEL_TSC_H
+
+#include <stdint.h>
+
+/**
+ * @brief Time Stamp Counter.
+ * @details Used for measuring short durations in CPU cycles. The frequency is
+ * calibrated with the PIT, see tsc_calibrate()
+ * @file
+ */
+
+/**
+ * @brief Number of PIT ticks (ms) used for calibrating the TSC.
+ */
+#define TSC_CALIBRATE_MS 50
+
+/**
+ * @brief Read the Time Stamp Counter.
+ * @return Number of cycles since the CPU was reset.
+ */
+static inline uint64_t tsc_read(void) {
+    uint64_t ret;
+    asm volatile("rdtsc" : "=A"(ret));
+    return ret;
+}
+
+/**
+ * @brief Measure the frequency of the TSC using the PIT.
+ * @details The PIT and interrupts need to be enabled, since we wait for
+ * TSC_CALIBRATE_MS ticks. See pit_init()
+ */
+void tsc_calibrate(void);
+
+/**
+ * @brief Get the frequency of the TSC measured by tsc_calibrate()
+ * @return TSC frequency in Hz, or 0 if it was not calibrated.
+ */
+uint64_t tsc_get_hz(void);
+
+/**
+ * @brief Convert a number of TSC cycles to microseconds.
+ * @param cycles Number of cycles
+ * @return Microseconds, or 0 if the TSC was not calibrated.
+ */
+uint64_t tsc_to_us(uint64_t cycles);
+
+#endif /* _KERNEL_TSC_H */
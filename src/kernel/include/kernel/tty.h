@@ -0,0 +1,145 @@
+
+#ifndef _KERNEL_TTY_H
+#define _KERNEL_TTY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Terminals between the keyboard and the tasks reading input.
+ * @details Each virtual terminal has a Tty with its own line discipline: in
+ * canonical mode the chars are edited in a line and become readable on '\n',
+ * in raw mode each char is readable when typed. The VMIN and VTIME settings
+ * of TtyMode control when tty_read() returns in raw mode, like in termios(3).
+ *
+ * Each task has its own stdin, inherited from the task that created it. See
+ * tty_stdin(). Readers block with poll_wait(), so they can also wait on other
+ * sources with poll().
+ * @file
+ */
+
+/**
+ * @def TTY_LINE_SZ
+ * @brief Max length of a canonical line, including the '\n'. Extra chars are
+ * dropped.
+ */
+#define TTY_LINE_SZ 1000
+
+/**
+ * @def TTY_BUF_SZ
+ * @brief Chars that can be waiting for tty_read() in each terminal. Needs to
+ * be a power of 2, and at least TTY_LINE_SZ.
+ */
+#define TTY_BUF_SZ 1024
+
+/**
+ * @def TTY_STAMP_RING_SZ
+ * @brief Lines waiting for tty_read() whose latency is measured, in each
+ * terminal. Needs to be a power of 2. See KB_LAT_READ
+ */
+#define TTY_STAMP_RING_SZ 32
+
+typedef struct Tty Tty;
+
+/**
+ * @enum tty_lflags
+ * @brief Bits of TtyMode.lflag
+ */
+enum tty_lflags {
+    TTY_ICANON = 0x1, /**< @brief Canonical mode, read full lines */
+    TTY_ECHO   = 0x2, /**< @brief Print the chars when they are typed */
+};
+
+/**
+ * @brief Settings of a terminal. See tty_get_mode() and tty_set_mode()
+ */
+typedef struct {
+    uint32_t lflag; /**< @brief Bitwise OR of tty_lflags */
+    uint8_t vmin;   /**< @brief Raw mode: chars needed by tty_read() */
+    uint8_t vtime;  /**< @brief Raw mode: timeout in tenths of a second */
+} TtyMode;
+
+/**
+ * @brief Initialize the terminal of each virtual terminal.
+ * @details Canonical mode with echo, and empty buffers.
+ */
+void tty_init(void);
+
+/**
+ * @brief Get the terminal of a virtual terminal.
+ * @param vt Virtual terminal index.
+ * @return Pointer to the terminal, or NULL if \p vt is out of bounds.
+ */
+Tty* tty_get(uint8_t vt);
+
+/**
+ * @brief Get the stdin of the current task.
+ * @details Tasks without one use the terminal of vt_current()
+ * @return Pointer to the terminal.
+ */
+Tty* tty_stdin(void);
+
+/**
+ * @brief Get the settings of a terminal.
+ * @param[in] tty Target terminal.
+ * @param[out] out Current settings.
+ */
+void tty_get_mode(const Tty* tty, TtyMode* out);
+
+/**
+ * @brief Change the settings of a terminal.
+ * @details When leaving canonical mode, the line being edited becomes
+ * readable.
+ * @param[inout] tty Target terminal.
+ * @param[in] mode New settings.
+ */
+void tty_set_mode(Tty* tty, const TtyMode* mode);
+
+/**
+ * @brief Discard the input of a terminal that was not read yet.
+ * @param[inout] tty Target terminal.
+ */
+void tty_flush(Tty* tty);
+
+/**
+ * @brief Check if tty_read() would return chars without blocking.
+ * @param[in] tty Target terminal.
+ * @return True if there are chars ready.
+ */
+bool tty_readable(const Tty* tty);
+
+/**
+ * @brief Read chars from a terminal.
+ * @details In canonical mode, blocks until there is a line and stops after
+ * its '\n'. In raw mode, it depends on VMIN and VTIME:
+ *   - VMIN = 0, VTIME = 0: Returns the chars that are ready, without blocking.
+ *   - VMIN = 0, VTIME > 0: Waits up to VTIME for the first char.
+ *   - VMIN > 0, VTIME = 0: Blocks until there are VMIN chars.
+ *   - VMIN > 0, VTIME > 0: Blocks until the first char, then returns after
+ *     VMIN chars or when VTIME passes without a new one.
+ * @param[inout] tty Target terminal.
+ * @param[out] buf Where to store the chars.
+ * @param sz Max number of chars to read.
+ * @return Number of chars read. Can be 0 if VMIN is 0.
+ */
+size_t tty_read(Tty* tty, char* buf, size_t sz);
+
+/**
+ * @brief Read a char from a terminal. See tty_read()
+ * @param[inout] tty Target terminal.
+ * @return The char as an unsigned char, or -1 (EOF) if nothing was read.
+ */
+int tty_getchar(Tty* tty);
+
+/**
+ * @brief Add a typed char to a terminal.
+ * @details Called from kb_handler(), with the interrupts disabled. Edits the
+ * line in canonical mode and echoes the char if needed.
+ * @param[inout] tty Terminal of the displayed virtual terminal.
+ * @param c Typed char.
+ * @param tsc TSC of the keyboard IRQ, for the input latency.
+ */
+void tty_input(Tty* tty, char c, uint64_t tsc);
+
+#endif /* _KERNEL_TTY_H */
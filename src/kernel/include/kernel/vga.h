@@ -4,6 +4,7 @@
 
 #include <stddef.h> /* size_t */
 #include <stdint.h> /* uintX_t */
+#include <stdbool.h>
 
 /**
  * @enum vga_color
@@ -34,6 +35,20 @@ enum vga_color {
  */
 #define VGA_CONSOLE_ADDR 0xB8000
 
+/**
+ * @def VGA_PORT_INPUT_STATUS
+ * @brief Read. VGA input status register 1.
+ * @details Also emulated by the BGA. See:
+ *   https://wiki.osdev.org/VGA_Hardware#Port_0x3C8-0x3DA
+ */
+#define VGA_PORT_INPUT_STATUS 0x3DA
+
+/**
+ * @def VGA_STATUS_VRETRACE
+ * @brief Bit of VGA_PORT_INPUT_STATUS that is set during the vertical retrace.
+ */
+#define VGA_STATUS_VRETRACE 0x08
+
 /**
  * @name Width and height of the VGA console.
  * @brief Defined in vga.c
@@ -132,4 +147,11 @@ void vga_write(const char* s, size_t len);
  */
 void vga_sprint(const char* s);
 
+/**
+ * @brief Check if the display is in the vertical retrace period.
+ * @details Anything drawn during the retrace won't tear.
+ * @return True if the VGA_STATUS_VRETRACE bit is set.
+ */
+bool vga_in_retrace(void);
+
 #endif /* _KERNEL_VGA_H */
@@ -0,0 +1,61 @@
+
+#ifndef _KERNEL_VT_H
+#define _KERNEL_VT_H
+
+#include <stdint.h>
+
+/**
+ * @brief Virtual terminals.
+ * @details Each virtual terminal has its own framebuffer console context,
+ * Tty and scrollback, and a shell task. Only the displayed one
+ * draws to the framebuffer. Switched with Alt+F1..F6, see kb_handler()
+ * @file
+ */
+
+/**
+ * @brief Number of virtual terminals.
+ * @details Should not be greater than the number of F keys we check in
+ * kb_handler()
+ */
+#define VT_COUNT 6
+
+/**
+ * @brief Initialize the virtual terminals.
+ * @details The current framebuffer console context will be the one of the
+ * first virtual terminal. For the rest, it creates a context with the same
+ * size and a task that runs \p shell.
+ * @param[in] shell Entry point of the tasks of each virtual terminal.
+ */
+void vt_init(int (*shell)(void));
+
+/**
+ * @brief Display the specified virtual terminal, and send the keyboard input
+ * to it.
+ * @param vt Virtual terminal index. Ignored if out of bounds.
+ */
+void vt_switch(uint8_t vt);
+
+/**
+ * @brief Get the virtual terminal being displayed.
+ * @details This is the one receiving the keyboard input.
+ * @return Virtual terminal index.
+ */
+uint8_t vt_active(void);
+
+/**
+ * @brief Get the virtual terminal of the current context.
+ * @details Usually the one of the current task.
+ * @return Virtual terminal index.
+ */
+uint8_t vt_current(void);
+
+/**
+ * @brief Switch to the next task that is not blocked, keeping the current
+ * framebuffer console context.
+ * @details Used while waiting for input, so other virtual terminals can run.
+ * See mt_yield() and wq_wait(). The first virtual terminal also prints the new
+ * kernel log records, see log_drain()
+ */
+void vt_yield(void);
+
+#endif /* _KERNEL_VT_H */
@@ -0,0 +1,51 @@
+
+#ifndef _KERNEL_WAITQUEUE_H
+#define _KERNEL_WAITQUEUE_H
+
+#include <stdbool.h>
+#include <kernel/multitask.h>
+
+/**
+ * @brief Wait queues for blocking tasks until an event.
+ * @details A task waiting for a condition is marked as TASK_BLOCKED and added
+ * to the queue, so mt_yield() skips it instead of switching to it just to check
+ * the condition again. Whoever makes the condition true (usually an IRQ
+ * handler) calls wq_wake_all().
+ * @file
+ */
+
+/**
+ * @brief List of tasks blocked in the same event. Initialize with
+ * `WaitQueue wq = { NULL };`
+ */
+typedef struct {
+    Ctx* head; /**< @brief First blocked task, linked by Ctx.wait_next */
+} WaitQueue;
+
+/**
+ * @brief Condition checked by wq_wait().
+ * @param[in] arg Argument passed to wq_wait().
+ * @return True if the task can stop waiting.
+ */
+typedef bool (*wq_cond_t)(const void* arg);
+
+/**
+ * @brief Block the current task until \p cond returns true.
+ * @details The condition is checked with the interrupts disabled, so an IRQ
+ * can't make it true and call wq_wake_all() before the task is in the queue.
+ * Should not be called from IRQ handlers.
+ * @param[inout] wq Wait queue of the event.
+ * @param[in] cond Condition to wait for.
+ * @param[in] arg Argument of \p cond.
+ */
+void wq_wait(WaitQueue* wq, wq_cond_t cond, const void* arg);
+
+/**
+ * @brief Wake all the tasks of the queue.
+ * @details They check their conditions again when they run. Safe from IRQ
+ * handlers.
+ * @param[inout] wq Wait queue of the event.
+ */
+void wq_wake_all(WaitQueue* wq);
+
+#endif /* _KERNEL_WAITQUEUE_H */
@@ -5,8 +5,10 @@
 
 section .text:
     global io_inb
+    global io_inw
     global io_inl
     global io_outb
+    global io_outw
     global io_outl
 
 ; uint8_t io_inb(uint16_t port)
@@ -26,6 +28,21 @@ io_inb:
     pop     ebp
     ret
 
+; uint16_t io_inw(uint16_t port)
+io_inw:
+    push    ebp
+    mov     ebp, esp
+
+    ; First arg, port (uint16_t)
+    mov     edx, [esp + 8]
+
+    ; Copy to ax because we want the word
+    xor     eax, eax
+    in      ax, dx
+
+    pop     ebp
+    ret
+
 ; uint32_t io_inl(uint16_t port)
 io_inl:
     push    ebp
@@ -58,6 +75,23 @@ io_outb:
     pop     ebp
     ret
 
+; void io_outw(uint16_t port, uint16_t data)
+io_outw:
+    push    ebp
+    mov     ebp, esp
+
+    ; First arg, port (uint16_t)
+    mov     edx, [esp + 8]
+
+    ; Second arg, data (uint16_t)
+    mov     eax, [esp + 12]
+
+    ; Copy from ax because we want the word
+    out     dx, ax
+
+    pop     ebp
+    ret
+
 ; void io_outl(uint16_t port, uint32_t data)
 io_outl:
     push    ebp
@@ -0,0 +1,214 @@
+
+/**
+ * @brief Dispatching of the hardware interrupts of the PICs.
+ *
+ * See: https://wiki.osdev.org/8259_PIC
+ *
+ * @file
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/irq.h>
+#include <kernel/idt.h> /* PIC_MASTER_CMD, OCW2_EOI */
+#include <kernel/io.h>
+#include <kernel/tsc.h> /* tsc_read */
+#include <kernel/tracepoint.h>
+
+/**
+ * @brief Handler of each IRQ line, NULL if it's masked.
+ */
+static irq_handler_t handlers[IRQ_COUNT] = { NULL };
+
+/**
+ * @brief Stats of each IRQ line. Only changed with the interrupts disabled.
+ */
+static IrqStats stats[IRQ_COUNT] = { 0 };
+
+/**
+ * @brief Masked lines, bit N is IRQ N. The slave PIC goes through the cascade,
+ * so it's never masked.
+ */
+static uint16_t masked = 0xFFFF & ~(1 << IRQ_CASCADE);
+
+/**
+ * @brief Frame of the IRQ being handled, for irq_get_frame()
+ */
+static const IrqFrame* cur_frame = NULL;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Write the masks of both PICs.
+ */
+static inline void write_masks(void) {
+    io_outb(PIC_MASTER_DATA, masked & 0xFF);
+    io_outb(PIC_SLAVE_DATA, (masked >> 8) & 0xFF);
+}
+
+/**
+ * @brief Check if an IRQ was spurious.
+ * @details The PIC raises IRQ 7 or 15 when a line goes down before the CPU
+ * acknowledges it. In that case the line is not in service, and it doesn't
+ * need an EOI. A spurious IRQ 15 still needs the EOI of the cascade in the
+ * master PIC.
+ * @param irq Line of the IRQ.
+ * @return True if the IRQ was spurious.
+ */
+static bool is_spurious(uint8_t irq) {
+    if (irq != 7 && irq != 15)
+        return false;
+
+    const uint16_t cmd = (irq == 7) ? PIC_MASTER_CMD : PIC_SLAVE_CMD;
+    io_outb(cmd, OCW3_READ_ISR);
+    if (io_inb(cmd) & 0x80)
+        return false;
+
+    if (irq == 15)
+        io_outb(PIC_MASTER_CMD, OCW2_EOI);
+
+    return true;
+}
+
+/**
+ * @brief Tell the PICs that the IRQ was handled, so they can send the next
+ * ones.
+ * @param irq Line of the IRQ.
+ */
+static inline void send_eoi(uint8_t irq) {
+    if (irq >= 8)
+        io_outb(PIC_SLAVE_CMD, OCW2_EOI);
+
+    io_outb(PIC_MASTER_CMD, OCW2_EOI);
+}
+
+/**
+ * @brief Send the EOI and call the handler of an IRQ. See irq_dispatch()
+ * @param[in] frame Registers saved by the stub.
+ */
+static void dispatch(IrqFrame* frame) {
+    const uint8_t irq = frame->irq;
+
+    if (is_spurious(irq)) {
+        stats[irq].spurious++;
+        return;
+    }
+
+    /* The EOI goes first because some handlers enable the interrupts (e.g.
+     * the deferred rendering of pit_inc), and the PIC would hold the IRQs
+     * with lower priority until it gets it */
+    send_eoi(irq);
+
+    TRACEPOINT(TP_IRQ_ENTRY, irq, frame->eip);
+
+    const irq_handler_t handler = handlers[irq];
+    if (handler == NULL) {
+        stats[irq].count++;
+        TRACEPOINT(TP_IRQ_EXIT, irq, 0);
+        return;
+    }
+
+    const IrqFrame* old_frame = cur_frame;
+    cur_frame                 = frame;
+
+    const uint64_t start = tsc_read();
+    handler();
+    const uint64_t cycles = tsc_read() - start;
+
+    TRACEPOINT(TP_IRQ_EXIT, irq, cycles);
+
+    /* The handler might have left the interrupts enabled, and a nested IRQ of
+     * the same line would update the same stats */
+    const uint32_t eflags = irq_save();
+
+    cur_frame = old_frame;
+
+    stats[irq].count++;
+    stats[irq].cycles += cycles;
+    if (cycles > stats[irq].max_cycles)
+        stats[irq].max_cycles = cycles;
+
+    irq_restore(eflags);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void irq_init(void) {
+    write_masks();
+}
+
+bool irq_register(uint8_t irq, const char* name, irq_handler_t handler) {
+    if (irq >= IRQ_COUNT || irq == IRQ_CASCADE || handler == NULL)
+        return false;
+
+    const uint32_t eflags = irq_save();
+
+    const bool ret = (handlers[irq] == NULL);
+    if (ret) {
+        handlers[irq]   = handler;
+        stats[irq].name = name;
+
+        masked &= ~(1 << irq);
+        write_masks();
+    }
+
+    irq_restore(eflags);
+    return ret;
+}
+
+void irq_unregister(uint8_t irq) {
+    if (irq >= IRQ_COUNT || irq == IRQ_CASCADE)
+        return;
+
+    const uint32_t eflags = irq_save();
+
+    masked |= 1 << irq;
+    write_masks();
+
+    handlers[irq]   = NULL;
+    stats[irq].name = NULL;
+
+    irq_restore(eflags);
+}
+
+const IrqFrame* irq_get_frame(void) {
+    return cur_frame;
+}
+
+void irq_get_stats(uint8_t irq, IrqStats* out) {
+    if (irq >= IRQ_COUNT)
+        return;
+
+    const uint32_t eflags = irq_save();
+    *out                  = stats[irq];
+    irq_restore(eflags);
+}
+
+void irq_reset_stats(void) {
+    const uint32_t eflags = irq_save();
+
+    for (int i = 0; i < IRQ_COUNT; i++) {
+        stats[i].count      = 0;
+        stats[i].spurious   = 0;
+        stats[i].cycles     = 0;
+        stats[i].max_cycles = 0;
+    }
+
+    irq_restore(eflags);
+}
+
+void irq_dispatch(IrqFrame* frame) {
+    /* The CPU disabled the interrupts. The window is attributed to the
+     * handler, since the stubs are the same for all of them */
+    const irq_handler_t handler = handlers[frame->irq];
+    irqoff_begin_at((handler != NULL) ? (uint32_t)handler
+                                      : (uint32_t)irq_dispatch);
+
+    dispatch(frame);
+
+    /* If the handler didn't enable them, iretd does. Otherwise, the window
+     * already ended */
+    if (!irq_enabled())
+        irqoff_end();
+}
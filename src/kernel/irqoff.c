@@ -0,0 +1,168 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/irqoff.h>
+#include <kernel/irq.h>   /* irq_save, irq_restore */
+#include <kernel/tsc.h>   /* tsc_read, tsc_get_hz, tsc_to_us */
+#include <kernel/pit.h>   /* pit_get_ticks */
+#include <kernel/ksyms.h> /* ksyms_find */
+#include <kernel/log.h>   /* log_write */
+
+/**
+ * @brief Current window. `start` is 0 if there is none. Only used with the
+ * interrupts disabled.
+ */
+static uint64_t start = 0;
+static uint32_t site  = 0;
+
+/**
+ * @brief Stats returned by irqoff_get_stats(). Only changed with the
+ * interrupts disabled.
+ */
+static IrqOffStats stats = { 0 };
+
+static uint32_t threshold_us = IRQOFF_THRESHOLD_US;
+
+/**
+ * @brief Threshold converted to cycles, 0 until the TSC is calibrated. See
+ * over_threshold()
+ */
+static uint64_t threshold_cycles = 0;
+
+/**
+ * @brief PIT tick of the next warning we can log, see IRQOFF_WARN_INTERVAL
+ */
+static uint64_t next_warn = 0;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Check if a window is longer than the threshold.
+ * @details The threshold is converted to cycles on the first call after the
+ * calibration of the TSC, so the windows don't need a division.
+ * @param cycles Duration of the window.
+ * @return True if it's over the threshold.
+ */
+static bool over_threshold(uint64_t cycles) {
+    if (threshold_cycles == 0) {
+        if (threshold_us == 0 || tsc_get_hz() == 0)
+            return false;
+
+        threshold_cycles = tsc_get_hz() / 1000000 * threshold_us;
+    }
+
+    return cycles > threshold_cycles;
+}
+
+/**
+ * @brief Add a window to the longest ones, keeping only the longest of each
+ * site.
+ * @param addr Site of the window.
+ * @param cycles Duration of the window.
+ */
+static void add_top(uint32_t addr, uint64_t cycles) {
+    IrqOffWindow* const top = stats.top;
+
+    /* Shorter than all of them, and than the one of its own site if it's
+     * there */
+    if (cycles <= top[IRQOFF_TOP - 1].cycles)
+        return;
+
+    /* Replace the entry of the same site, or the shortest one */
+    int slot = IRQOFF_TOP - 1;
+    for (int i = 0; i < IRQOFF_TOP; i++) {
+        if (top[i].site == addr) {
+            if (cycles <= top[i].cycles)
+                return;
+
+            slot = i;
+            break;
+        }
+    }
+
+    /* Keep them sorted */
+    while (slot > 0 && top[slot - 1].cycles < cycles) {
+        top[slot] = top[slot - 1];
+        slot--;
+    }
+
+    top[slot] = (IrqOffWindow){ addr, cycles };
+}
+
+/**
+ * @brief Log a window over the threshold, at most once per
+ * IRQOFF_WARN_INTERVAL.
+ * @param addr Site of the window.
+ * @param cycles Duration of the window.
+ */
+static void warn(uint32_t addr, uint64_t cycles) {
+    const uint64_t ticks = pit_get_ticks();
+    if (ticks < next_warn)
+        return;
+
+    next_warn = ticks + IRQOFF_WARN_INTERVAL;
+    stats.warnings++;
+
+    const KSym* sym = ksyms_find(addr);
+    if (sym != NULL)
+        log_write(LOG_WARN,
+                  "irqoff: interrupts disabled for %llu us in %s+0x%lX",
+                  tsc_to_us(cycles), sym->name, addr - sym->addr);
+    else
+        log_write(LOG_WARN, "irqoff: interrupts disabled for %llu us at 0x%lX",
+                  tsc_to_us(cycles), addr);
+}
+
+/* -------------------------------------------------------------------------- */
+
+__attribute__((noinline)) void irqoff_begin(void) {
+    irqoff_begin_at((uint32_t)__builtin_return_address(0));
+}
+
+void irqoff_begin_at(uint32_t addr) {
+    if (start != 0)
+        return;
+
+    site  = addr;
+    start = tsc_read();
+}
+
+void irqoff_end(void) {
+    if (start == 0)
+        return;
+
+    const uint64_t cycles = tsc_read() - start;
+    start                 = 0;
+
+    stats.windows++;
+    add_top(site, cycles);
+
+    if (over_threshold(cycles)) {
+        stats.over++;
+        warn(site, cycles);
+    }
+}
+
+void irqoff_get_stats(IrqOffStats* out) {
+    const uint32_t eflags = irq_save();
+    *out                  = stats;
+    irq_restore(eflags);
+}
+
+void irqoff_reset(void) {
+    const uint32_t eflags = irq_save();
+    stats                 = (IrqOffStats){ 0 };
+    irq_restore(eflags);
+}
+
+void irqoff_set_threshold(uint32_t us) {
+    const uint32_t eflags = irq_save();
+    threshold_us          = us;
+    threshold_cycles      = 0;
+    irq_restore(eflags);
+}
+
+uint32_t irqoff_get_threshold(void) {
+    return threshold_us;
+}
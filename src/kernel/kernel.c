@@ -13,13 +13,22 @@
 #include <kernel/vga.h>                 /* vga_init, vga_sprint */
 #include <kernel/framebuffer.h>         /* fb_init, fb_setpx */
 #include <kernel/framebuffer_console.h> /* fbc_init */
+#include <kernel/bga.h>                 /* bga_version */
+#include <kernel/compositor.h>          /* comp_surface_new, comp_compose */
 #include <kernel/idt.h>                 /* idt_init */
 #include <kernel/pit.h>                 /* pit_init */
+#include <kernel/tsc.h>                 /* tsc_calibrate */
+#include <kernel/serial.h>              /* serial_init */
+#include <kernel/log.h>                 /* log_write, log_drain */
 #include <kernel/rand.h>                /* check_rand */
+#include <kernel/pmu.h>                 /* pmu_init */
 #include <kernel/rtc.h>                 /* rtc_get_datetime */
 #include <kernel/pcspkr.h>              /* pcspkr_beep */
-#include <kernel/keyboard.h>            /* kb_setlayout, kb_getchar_init */
+#include <kernel/keyboard.h>            /* kb_setlayout, kb_init */
+#include <kernel/tty.h>                 /* tty_init */
 #include <kernel/multitask.h>           /* mt_init */
+#include <kernel/trace.h>               /* trace_stop */
+#include <kernel/vt.h>                  /* vt_init, vt_yield */
 
 #include <kernel/multiboot.h> /* Multiboot info structure */
 #include <fonts/main_font.h>
@@ -45,30 +54,23 @@
         fbc_setfore(COLOR_GRAY);    \
     }
 
+/* Boot messages go to the kernel log, and we print them right away */
 #define LOAD_INFO(s)                  \
     {                                 \
-        fbc_setfore(COLOR_MAGENTA_B); \
-        printf(" * ");                \
-        fbc_setfore(COLOR_MAGENTA);   \
-        puts(s);                      \
-        fbc_setfore(COLOR_WHITE);     \
+        log_write(LOG_INFO, "%s", s); \
+        log_drain();                  \
     }
 
-#define LOAD_IGNORE(s)             \
-    {                              \
-        fbc_setfore(COLOR_GRAY_B); \
-        printf(" * ");             \
-        puts(s);                   \
-        fbc_setfore(COLOR_WHITE);  \
+#define LOAD_IGNORE(s)                \
+    {                                 \
+        log_write(LOG_WARN, "%s", s); \
+        log_drain();                  \
     }
 
-#define LOAD_ERROR(s)             \
-    {                             \
-        fbc_setfore(COLOR_RED_B); \
-        printf(" * ");            \
-        fbc_setfore(COLOR_RED);   \
-        puts(s);                  \
-        fbc_setfore(COLOR_WHITE); \
+#define LOAD_ERROR(s)                 \
+    {                                 \
+        log_write(LOG_ERR, "%s", s);  \
+        log_drain();                  \
     }
 
 #define SYSTEM_INFO(s1, s2fmt, ...) \
@@ -80,31 +82,12 @@
         putchar('\n');              \
     }
 
-/* Need tmp to remove NULL from itoa */
-#define PAD_ZEROS(n, p)                \
-    {                                  \
-        if (n < 10) {                  \
-            *p       = '0';            \
-            *(p + 1) = n + '0';        \
-        } else {                       \
-            const char tmp = *(p + 2); \
-            itoa(p, n);                \
-            *(p + 2) = tmp;            \
-        }                              \
-    }
-
 /* Default layout, declared in keyboard.c */
 extern Layout us_layout;
 
-static inline void format_date(char* str, DateTime now) {
-    /* "00/00/00 - 00:00:00" */
-
-    PAD_ZEROS(now.date.d, &str[0]);
-    PAD_ZEROS(now.date.m, &str[3]);
-    PAD_ZEROS(now.date.y, &str[6]);
-    PAD_ZEROS(now.time.h, &str[11]);
-    PAD_ZEROS(now.time.m, &str[14]);
-    PAD_ZEROS(now.time.s, &str[17]);
+static inline void format_date(char* str, size_t sz, DateTime now) {
+    snprintf(str, sz, "%02d/%02d/%02d - %02d:%02d:%02d", now.date.d,
+             now.date.m, now.date.y, now.time.h, now.time.m, now.time.s);
 }
 
 static inline void test_colors(void) {
@@ -154,10 +137,11 @@ static inline void test_colors(void) {
 
 /**
  * @brief Prints the OS logo using the GIMP macro
+ * @param[out] s Surface where we draw the logo
  * @param ypad Top padding in px
  * @param xpad Left padding in px
  */
-static void print_logo(unsigned int ypad, unsigned int xpad) {
+static void print_logo(Surface* s, unsigned int ypad, unsigned int xpad) {
     char rgb[3] = { 0 };
     /* Copy ptr because HEADER_PIXEL increases it */
     char* logo_ptr = fsos_logo_s;
@@ -165,9 +149,12 @@ static void print_logo(unsigned int ypad, unsigned int xpad) {
     for (unsigned int y = 0; y < fsos_logo_s_h; y++) {
         for (unsigned int x = 0; x < fsos_logo_s_w; x++) {
             HEADER_PIXEL(logo_ptr, rgb);
-            fb_setpx(y + ypad, x + xpad, rgb[0], rgb[1], rgb[2]);
+            s->px[(y + ypad) * s->w + x + xpad] =
+              rgb2col(rgb[0], rgb[1], rgb[2]);
         }
     }
+
+    comp_surface_damage(s, ypad, xpad, fsos_logo_s_h, fsos_logo_s_w);
 }
 
 /**
@@ -196,9 +183,17 @@ void kernel_main(Multiboot* mb_info) {
             mb_info->framebuffer_height, mb_info->framebuffer_bpp);
     vga_sprint("Framebuffer initialized.\n");
 
-    print_logo(5, 0);
-    print_logo(5, 100);
-    print_logo(5, 200);
+    /* The logo area has its own surface, so it can be updated without touching
+     * the console below it */
+    Surface* logo_surface =
+      comp_surface_new(0, 0, 110, mb_info->framebuffer_width, 0);
+    print_logo(logo_surface, 5, 0);
+    print_logo(logo_surface, 5, 100);
+    print_logo(logo_surface, 5, 200);
+    comp_compose();
+
+    /* After drawing the logo, so both pages have it */
+    const bool fb_pages = fb_init_pages();
 
     fbc_init(110, 3, mb_info->framebuffer_height - 110 - 5,
              mb_info->framebuffer_width - 3 * 2, &main_font);
@@ -211,10 +206,28 @@ void kernel_main(Multiboot* mb_info) {
     LOAD_INFO("Framebuffer initialized.");
     LOAD_INFO("Framebuffer console initialized.");
 
+    if (fb_pages) {
+        LOAD_INFO("BGA page flipping enabled.");
+    } else {
+        LOAD_IGNORE("BGA page flipping not available.");
+    }
+
     /* Init PIT with 1ms interval (1/1000 of a sec) */
     pit_init(1000);
     LOAD_INFO("PIT initialized.");
 
+    /* Needs the PIT */
+    tsc_calibrate();
+    LOAD_INFO("TSC calibrated.");
+
+    if (serial_init()) {
+        /* Errors can be captured without looking at the screen */
+        stdio_set_sinks(stderr, STDIO_SINK_CONSOLE | STDIO_SINK_SERIAL);
+        LOAD_INFO("Serial port initialized.");
+    } else {
+        LOAD_IGNORE("Serial port not available.");
+    }
+
     if (check_rdseed()) {
         LOAD_INFO("RDSEED supported.");
     } else {
@@ -227,9 +240,20 @@ void kernel_main(Multiboot* mb_info) {
         LOAD_IGNORE("RDRAND not supported.");
     }
 
+    if (pmu_init()) {
+        LOAD_INFO("Performance counters initialized.");
+    } else {
+        LOAD_IGNORE("Performance counters not available.");
+    }
+
     kb_setlayout(&us_layout);
-    kb_getchar_init();
+    tty_init();
+    kb_init();
     LOAD_INFO("Keyboard initialized.");
+
+    /* The tasks of the other terminals will run once we wait for input */
+    vt_init(&sh_main);
+    LOAD_INFO("Virtual terminals initialized.");
     putchar('\n');
 
     LOAD_INFO("System info:");
@@ -237,8 +261,9 @@ void kernel_main(Multiboot* mb_info) {
     SYSTEM_INFO("Resolution:\t", "%ldx%ld", mb_info->framebuffer_width,
                 mb_info->framebuffer_height);
     SYSTEM_INFO("Font:\t\t", "%s", main_font.name);
-    char date_fmt[] = "00/00/00 - 00:00:00";
-    format_date(date_fmt, rtc_get_datetime());
+    /* "00/00/00 - 00:00:00" */
+    char date_fmt[20];
+    format_date(date_fmt, sizeof(date_fmt), rtc_get_datetime());
     SYSTEM_INFO("Time:\t\t", "%s", date_fmt);
     putchar('\n');
 
@@ -254,11 +279,16 @@ void kernel_main(Multiboot* mb_info) {
     puts("https://github.com/fs-os/fs-os");
     fbc_setfore(COLOR_WHITE);
 
-    /* Main shell */
+    /* Keep the boot in the trace ring, if the kernel was built with
+     * `make trace` */
+    trace_stop();
+
+    /* Main shell, in the first virtual terminal */
     sh_main();
 
+    /* Don't block the shells of the other virtual terminals */
     for (;;)
-        asm("hlt");
+        vt_yield();
 
     __builtin_unreachable();
 }
@@ -1,10 +1,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
 #include <kernel/keyboard.h>
 #include <kernel/io.h>
+#include <kernel/vt.h>
+#include <kernel/framebuffer_console.h>
+#include <kernel/tty.h>
+#include <kernel/poll.h> /* poll_wait, poll_notify */
+#include <kernel/tsc.h> /* tsc_read */
+#include <kernel/irq.h> /* irq_register, irq_save, irq_restore */
+#include <kernel/histogram.h>
+#include <kernel/tracepoint.h>
 
 /**
  * @brief Keyboard source
@@ -54,6 +60,23 @@ enum kb_flags {
                              pressed */
 };
 
+/**
+ * @brief Key events of each virtual terminal.
+ * @details Lock-free ring with a single producer, kb_handler(), and a single
+ * consumer, the task of the virtual terminal. The positions only increment,
+ * the index of position `pos` is `pos % KB_EVENT_RING_SZ`. The typed chars go
+ * to the Tty of the virtual terminal instead, see tty_input()
+ */
+typedef struct {
+    KbEvent events[KB_EVENT_RING_SZ];
+    volatile uint32_t events_head; /**< @brief Only written by kb_handler() */
+    volatile uint32_t events_tail; /**< @brief Only written by readers */
+    volatile bool events_on;       /**< @brief Set by kb_events_on() */
+
+    /** @brief Events dropped because the ring was full */
+    uint32_t dropped;
+} kb_input;
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -74,38 +97,53 @@ static uint8_t key_flags[128] = { 0 };
 static bool capslock_on = false, shift_held = false;
 
 /**
- * @brief Store if we should print the characters to screen when receiving them.
- * @details Modified by kb_echo() and kb_noecho()
+ * @brief Store if alt is being held, for switching virtual terminals.
  */
-static bool print_chars = true;
+static bool alt_held = false;
 
 /**
- * @brief If true, kb_getchar() will wait for the user to input newline instead
- * of instantly returning each char.
- * @details Modified by kb_raw() and kb_noraw()
+ * @brief Store if any control is being held, for KbEvent.mods
  */
-static bool wait_for_eol = true;
+static bool ctrl_held = false;
 
 /**
- * @brief True if a program is waiting for kb_getchar()
+ * @brief Bitmap of the pressed keys, indexed by key code. See kb_key_down()
  */
-static volatile bool getting_char = false;
+static uint32_t keys_down[256 / 32] = { 0 };
 
 /**
- * @name Buffers for the getchar functions.
- * @details Since kb_handler only reads 8 bit chars, we don't need bigger
- * arrays. We need to use signed chars because of EOF, though.
- * @{ */
-static int8_t getchar_buf[KB_GETCHAR_BUFSZ]      = { EOF };
-static uint16_t getchar_buf_pos                  = 0;
-static int8_t getchar_line_buf[KB_GETCHAR_BUFSZ] = { EOF };
-static uint16_t getchar_line_buf_pos             = 0;
-/** @} */
+ * @brief True if the last byte was the 0xE0 prefix.
+ */
+static bool extended_prefix = false;
+
+/**
+ * @brief Bytes left of the 0xE1 sequence of the pause key.
+ */
+static uint8_t pause_bytes = 0;
+
+/**
+ * @brief Key events of each virtual terminal. Initialized by kb_init()
+ * @details The keyboard handler only writes to the one of vt_active(), and the
+ * rest of the functions use the one of vt_current().
+ */
+static kb_input inputs[VT_COUNT];
+
+/**
+ * @brief Input latency histograms, indexed by kb_latency_stages. Only changed
+ * with the interrupts disabled, see kb_latency_add()
+ */
+static Histogram latency[KB_LAT_COUNT];
+
+/**
+ * @brief IRQ TSC of the oldest echoed char that is not on the screen yet, or 0.
+ * See kb_echo_presented()
+ */
+static volatile uint64_t echo_pending = 0;
 
 /**
  * @brief Toggle variables like capslock_on or shift_held if needed
  * @param released Release bit from kb_handler()
- * @param key Key to be checked
+ * @param key Key code to be checked, with KB_KEY_EXTENDED for the prefixed keys
  */
 static inline void check_special(bool released, uint8_t key) {
     /* We can't use a case because they indexes are not constant at compile
@@ -114,6 +152,8 @@ static inline void check_special(bool released, uint8_t key) {
         key == cur_layout->special[KB_SPECIAL_IDX_RSHIFT]) {
         /* Store that shift is being held */
         shift_held = !released;
+    } else if (key == cur_layout->special[KB_SPECIAL_IDX_LALT]) {
+        alt_held = !released;
     } else if (key == cur_layout->special[KB_SPECIAL_IDX_CAPSLOCK]) {
         /* Toggle capslock_on when we press the key */
         if (!released)
@@ -132,172 +172,315 @@ static inline unsigned char* get_layout(void) {
     return (capslock_on || shift_held) ? cur_layout->shift : cur_layout->def;
 }
 
-/* -------------------------------------------------------------------------- */
+/**
+ * @brief Get the char of a key code, using the layout from get_layout()
+ * @details The byte after the 0xE0 prefix is the scancode of a different key
+ * (e.g. E0 37 is print screen, and 0x37 is the '*' of the keypad), so the
+ * extended keys don't use the layout. Only the enter and the slash of the
+ * keypad have a char.
+ * @param keycode Key code, with KB_KEY_EXTENDED for the prefixed keys
+ * @return Char to display, or 0 if the key doesn't have one
+ */
+static inline unsigned char key_char(uint8_t keycode) {
+    switch (keycode) {
+        case KB_KEY_KP_ENTER:
+            return '\n';
+        case KB_KEY_KP_SLASH:
+            return '/';
+        default:
+            break;
+    }
+
+    return (keycode < KB_LAYOUT_KEYS) ? get_layout()[keycode] : 0;
+}
 
-/* io_outb call is used to tell CPU that it's okay to resume interrupts. See:
- * https://wiki.osdev.org/Interrupts#From_the_OS.27s_perspective */
-#define KB_HANDLER_RETURN()  \
-    {                        \
-        io_outb(0x20, 0x20); \
-        return;              \
+/**
+ * @brief Switch virtual terminals or scroll the console if needed
+ * @param key Key code of the pressed key
+ * @return True if the key was used and should not be sent to the programs.
+ */
+static inline bool check_vt_keys(uint8_t key) {
+    if (alt_held) {
+        for (uint8_t i = 0; i < VT_COUNT; i++) {
+            if (key == cur_layout->special[KB_SPECIAL_IDX_F1 + i]) {
+                vt_switch(i);
+                return true;
+            }
+        }
+    }
+
+    if (shift_held) {
+        const int32_t page = fbc_get_vt_ctx(vt_active())->ch_h / 2;
+
+        if (key == cur_layout->special[KB_SPECIAL_IDX_PAGE_UP]) {
+            fbc_scrollback(page);
+            return true;
+        } else if (key == cur_layout->special[KB_SPECIAL_IDX_PAGE_DOWN]) {
+            fbc_scrollback(-page);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Get the modifiers being held, for KbEvent.mods
+ * @return Bitwise OR of kb_mods
+ */
+static inline uint8_t cur_mods(void) {
+    return (shift_held ? KB_MOD_SHIFT : 0) | (ctrl_held ? KB_MOD_CTRL : 0) |
+           (alt_held ? KB_MOD_ALT : 0) | (capslock_on ? KB_MOD_CAPSLOCK : 0);
+}
+
+/**
+ * @brief Store a key event if the virtual terminal wants them, and wake the
+ * readers.
+ * @details Dropped if the ring is full.
+ * @param[inout] in Input state of the virtual terminal
+ * @param[in] ev Event to store
+ */
+static void push_event(kb_input* in, const KbEvent* ev) {
+    if (!in->events_on)
+        return;
+
+    const uint32_t head = in->events_head;
+    const uint32_t tail = __atomic_load_n(&in->events_tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= KB_EVENT_RING_SZ) {
+        in->dropped++;
+        return;
     }
 
+    in->events[head & (KB_EVENT_RING_SZ - 1)] = *ev;
+    __atomic_store_n(&in->events_head, head + 1, __ATOMIC_RELEASE);
+
+    poll_notify();
+}
+
+/**
+ * @brief Condition of poll_wait() in kb_wait_event()
+ * @param[in] arg Input state of the virtual terminal
+ * @return True if there are events
+ */
+static bool events_ready(const void* arg) {
+    const kb_input* in = arg;
+    return __atomic_load_n(&in->events_head, __ATOMIC_ACQUIRE) !=
+           in->events_tail;
+}
+
+/* -------------------------------------------------------------------------- */
+
 void kb_handler(void) {
+    const uint64_t tsc = tsc_read();
+
     uint8_t status = io_inb(KB_PORT_STATUS);
     if (!(status & KB_STATUS_BUFFER_OUT))
-        KB_HANDLER_RETURN();
+        return;
+
+    const uint8_t scancode = io_inb(KB_PORT_DATA);
+
+    /* Prefixes of the next byte */
+    if (scancode == 0xE0) {
+        extended_prefix = true;
+        return;
+    } else if (scancode == 0xE1) {
+        /* Pause sends E1 1D 45 E1 9D C5 when pressed, and nothing when
+         * released */
+        pause_bytes = 2;
+        return;
+    }
+
+    /* Highest bit is 1 if the key is released, store it and clear it from
+     * the key */
+    const bool released = scancode & 0x80;
+    uint8_t key         = scancode & 0x7F;
+    uint8_t keycode     = key;
+
+    if (pause_bytes > 0) {
+        if (--pause_bytes > 0 || released)
+            return;
+
+        keycode = KB_KEY_PAUSE;
+        key     = 0; /* No char or special key */
+    } else if (extended_prefix) {
+        extended_prefix = false;
 
-    uint8_t key = io_inb(KB_PORT_DATA);
+        /* Print screen and the arrows send fake shifts with num lock */
+        if (key == KB_KEY_LSHIFT || key == KB_KEY_RSHIFT)
+            return;
 
-    /* Highest bit is 1 if the key is released, store it and clear it from key
-     */
-    uint8_t released = (key >> 7) & 1;
-    key &= 0x7f;
+        keycode = KB_KEY_EXTENDED | key;
+    }
+
+    if (released)
+        keys_down[keycode / 32] &= ~(1u << (keycode % 32));
+    else
+        keys_down[keycode / 32] |= 1u << (keycode % 32);
+
+    if (keycode == KB_KEY_LCTRL || keycode == KB_KEY_RCTRL)
+        ctrl_held = kb_key_down(KB_KEY_LCTRL) || kb_key_down(KB_KEY_RCTRL);
 
     /* Check if we should toggle global variables for caps, etc. */
-    check_special(released, key);
+    check_special(released, keycode);
 
-    /* Check if we need to use an alternative layout when using shift, ctrl,
+    /* Alt+F1..F6 and Shift+PgUp/PgDn. Not sent to the programs */
+    if (!released && check_vt_keys(key))
+        return;
+
+    /* Char of the key, using an alternative layout when using shift, ctrl,
      * etc. */
-    const unsigned char* final_layout = get_layout();
-    const unsigned char final_key     = final_layout[key];
+    const unsigned char final_key = key_char(keycode);
+
+    /* Key events of the terminal we are displaying */
+    kb_input* const in = &inputs[vt_active()];
+
+    const KbEvent ev = {
+        .tsc     = tsc,
+        .keycode = keycode,
+        .mods    = cur_mods(),
+        .pressed = !released,
+        .ch      = final_key,
+    };
+    push_event(in, &ev);
+
+    TRACEPOINT(TP_KB_EVENT, keycode, (ev.mods << 8) | ev.pressed);
 
     /* Store the current key as pressed or released in the key_flags array */
     if (released) {
         key_flags[final_key] &= ~KB_FLAG_PRESSED;
 
         /* We only want to go to the next part if the key was pressed */
-        KB_HANDLER_RETURN();
+        return;
     } else {
         key_flags[final_key] |= KB_FLAG_PRESSED;
     }
 
     /* We only want to go to the next part if the key can be displayed */
     if (final_key == 0)
-        KB_HANDLER_RETURN();
-
-    /* If a program called kb_getchar */
-    if (getting_char) {
-        /* If this variable is not set, kb_raw has been called. kb_getchar will
-         * need to return each character inmediately, so we don't use the line
-         * buffer. */
-        if (!wait_for_eol) {
-            /* getchar_buf_pos will always be 0. See kb_getchar comment */
-            getchar_buf[getchar_buf_pos++] = final_key;
-
-            /* We don't use line buffer, we just print here and return */
-            if (print_chars)
-                putchar(final_key);
-
-            KB_HANDLER_RETURN();
-        }
-
-        if (getchar_line_buf_pos >= KB_GETCHAR_BUFSZ)
-            panic_line("getchar buffer out of bounds");
+        return;
 
-        /* Store the current char to the getchar line buffer */
-        getchar_line_buf[getchar_line_buf_pos++] = final_key;
+    /* With key events, the program reads the chars from them */
+    if (!in->events_on)
+        tty_input(tty_get(vt_active()), final_key, tsc);
+}
 
-        /* If the key we just saved is '\n', the user is done with the input
-         * line so we can move the chars to the final buffer */
-        if (final_key == '\n') {
-            for (int i = 0; i < getchar_line_buf_pos; i++) {
-                getchar_buf[i]      = getchar_line_buf[i];
-                getchar_line_buf[i] = EOF;
-            }
+bool kb_held(unsigned char c) {
+    if (c >= 128)
+        return 0;
 
-            getchar_buf_pos      = 0; /* Not needed */
-            getchar_line_buf_pos = 0;
+    return key_flags[c] & KB_FLAG_PRESSED;
+}
 
-            putchar(final_key);
-        } else if (final_key == '\b') {
-            /* Delete last char from line buffer if we detect '\b' */
+void kb_setlayout(const Layout* ptr) {
+    cur_layout = ptr;
+}
 
-            /* Remove the '\b' we just added */
-            getchar_line_buf[--getchar_line_buf_pos] = EOF;
+void kb_init(void) {
+    for (size_t vt = 0; vt < LENGTH(inputs); vt++) {
+        kb_input* const in = &inputs[vt];
 
-            /* Delete the last char and print '\b', only if we have something to
-             * delete */
-            if (getchar_line_buf_pos > 0) {
-                getchar_line_buf[--getchar_line_buf_pos] = EOF;
-                putchar(final_key);
-            }
-        } else if (print_chars) {
-            /* We print the typed char here for:
-             *   - Only printing keyboard input when a program asks for it
-             *   - Handle special cases like:
-             *     - '\n': Just print
-             *     - '\b': Only print if we have something to delete
-             *   - In those special cases, print them inside that block */
-            putchar(final_key);
-        }
+        in->events_head = 0;
+        in->events_tail = 0;
+        in->events_on   = false;
+        in->dropped     = 0;
     }
 
-    /* Tell CPU that it's okay to resume interrupts. See:
-     * https://wiki.osdev.org/Interrupts#From_the_OS.27s_perspective */
-    io_outb(0x20, 0x20);
+    for (size_t i = 0; i < LENGTH(latency); i++)
+        hist_init(&latency[i]);
+
+    irq_register(IRQ_KB, "keyboard", kb_handler);
 }
 
-bool kb_held(unsigned char c) {
-    if (c >= 128)
-        return 0;
+void kb_events_on(void) {
+    kb_input* const in = &inputs[vt_current()];
 
-    return key_flags[c] & KB_FLAG_PRESSED;
+    /* Discard the old events. The handler doesn't write while it's disabled */
+    in->events_on   = false;
+    in->events_tail = in->events_head;
+    in->events_on   = true;
+}
+
+void kb_events_off(void) {
+    inputs[vt_current()].events_on = false;
+}
+
+bool kb_poll_event(KbEvent* out) {
+    kb_input* const in = &inputs[vt_current()];
+
+    if (!events_ready(in))
+        return false;
+
+    const uint32_t tail = in->events_tail;
+    *out                = in->events[tail & (KB_EVENT_RING_SZ - 1)];
+
+    /* Free the slot after reading it */
+    __atomic_store_n(&in->events_tail, tail + 1, __ATOMIC_RELEASE);
+
+    kb_latency_add(KB_LAT_EVENT, tsc_read() - out->tsc);
+    return true;
 }
 
-void kb_noecho(void) {
-    print_chars = false;
+void kb_wait_event(KbEvent* out) {
+    kb_input* const in = &inputs[vt_current()];
+
+    while (!kb_poll_event(out))
+        poll_wait(events_ready, in, POLL_FOREVER);
 }
 
-void kb_echo(void) {
-    print_chars = true;
+bool kb_has_event(void) {
+    return events_ready(&inputs[vt_current()]);
 }
 
-bool kb_getecho(void) {
-    return print_chars;
+bool kb_key_down(uint8_t keycode) {
+    return keys_down[keycode / 32] & (1u << (keycode % 32));
 }
 
-void kb_raw(void) {
-    wait_for_eol = false;
+uint8_t kb_mods(void) {
+    return cur_mods();
 }
 
-void kb_noraw(void) {
-    wait_for_eol = true;
+void kb_latency_add(enum kb_latency_stages stage, uint64_t cycles) {
+    const uint32_t eflags = irq_save();
+    hist_add(&latency[stage], cycles);
+    irq_restore(eflags);
 }
 
-void kb_setlayout(const Layout* ptr) {
-    cur_layout = ptr;
+void kb_echo_done(uint64_t tsc) {
+    /* Deferred contexts draw it on the next redraw, see kb_echo_presented() */
+    if (!fbc_get_vt_ctx(vt_active())->deferred)
+        kb_latency_add(KB_LAT_ECHO, tsc_read() - tsc);
+    else if (echo_pending == 0)
+        echo_pending = tsc;
 }
 
-void kb_getchar_init(void) {
-    for (size_t i = 0; i < LENGTH(getchar_buf); i++) {
-        /* Both buffers should have the same length... */
-        getchar_buf[i]      = EOF;
-        getchar_line_buf[i] = EOF;
+void kb_echo_presented(uint64_t start_tsc) {
+    const uint32_t eflags = irq_save();
+
+    if (echo_pending != 0 && echo_pending < start_tsc) {
+        hist_add(&latency[KB_LAT_ECHO], tsc_read() - echo_pending);
+        echo_pending = 0;
     }
-}
 
-int kb_getchar(void) {
-    /* Tell the keyboard handler to store the key presses */
-    getting_char = true;
+    irq_restore(eflags);
+}
 
-    /* Wait until we read a valid char */
-    volatile int8_t* tmp = &getchar_buf[getchar_buf_pos];
-    while (*tmp == EOF)
-        ;
+void kb_get_latency(enum kb_latency_stages stage, Histogram* out) {
+    if ((unsigned)stage >= KB_LAT_COUNT) {
+        hist_init(out);
+        return;
+    }
 
-    int c                        = getchar_buf[getchar_buf_pos];
-    getchar_buf[getchar_buf_pos] = EOF;
+    const uint32_t eflags = irq_save();
+    *out                  = latency[stage];
+    irq_restore(eflags);
+}
 
-    /* Try to increase the buffer position. If the next char is EOF, reset the
-     * pos to 0. If wait_for_eol is false, getchar_buf_pos will always be 0
-     * because the next char will always be EOF. */
-    if (getchar_buf[++getchar_buf_pos] == EOF)
-        getchar_buf_pos = 0;
+void kb_reset_latency(void) {
+    const uint32_t eflags = irq_save();
 
-    /* We don't want to read keys anymore (if we do, enable in next getchar
-     * call) */
-    getting_char = false;
+    for (size_t i = 0; i < LENGTH(latency); i++)
+        hist_init(&latency[i]);
+    echo_pending = 0;
 
-    return c;
+    irq_restore(eflags);
 }
@@ -0,0 +1,35 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/ksyms.h>
+
+/**
+ * @name Symbols from linker script
+ * @{ */
+extern uint8_t _text_start;
+extern uint8_t _text_end;
+/**  @} */
+
+bool ksyms_in_text(uint32_t addr) {
+    return addr >= (uint32_t)&_text_start && addr < (uint32_t)&_text_end;
+}
+
+const KSym* ksyms_find(uint32_t addr) {
+    if (!ksyms_in_text(addr) || ksyms_count == 0 || addr < ksyms_table[0].addr)
+        return NULL;
+
+    /* Last symbol with an address below or equal to addr */
+    size_t lo = 0;
+    size_t hi = ksyms_count;
+    while (hi - lo > 1) {
+        const size_t mid = lo + (hi - lo) / 2;
+
+        if (ksyms_table[mid].addr <= addr)
+            lo = mid;
+        else
+            hi = mid;
+    }
+
+    return &ksyms_table[lo];
+}
@@ -0,0 +1,227 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <kernel/log.h>
+#include <kernel/tsc.h>
+#include <kernel/serial.h>
+#include <kernel/framebuffer_console.h> /* fbc_setfore */
+#include <kernel/color.h>
+
+/**
+ * @brief Ring buffer of records. Slot of position `pos` is `pos % LOG_SLOTS`
+ */
+static LogRecord log_ring[LOG_SLOTS];
+
+/**
+ * @brief Position of the next record to reserve. Only increments.
+ */
+static uint32_t log_head = 0;
+
+/**
+ * @brief Most verbose level printed to the console by log_drain()
+ */
+static enum log_level console_level = LOG_INFO;
+
+/**
+ * @brief Readers of log_drain(). They start at the first record, so the
+ * messages written before the console and the serial port were ready still
+ * get printed.
+ */
+static LogReader console_reader = { 0, 0 };
+static LogReader serial_reader  = { 0, 0 };
+
+static const char* level_names[] = {
+    [LOG_ERR]   = "err",
+    [LOG_WARN]  = "warn",
+    [LOG_INFO]  = "info",
+    [LOG_DEBUG] = "debug",
+};
+
+/* -------------------------------------------------------------------------- */
+
+void log_vwrite(enum log_level level, const char* fmt, va_list va) {
+    /* Reserve the position. A single instruction, so an IRQ can't get the same
+     * one */
+    const uint32_t pos = __atomic_fetch_add(&log_head, 1, __ATOMIC_RELAXED);
+    LogRecord* slot    = &log_ring[pos % LOG_SLOTS];
+
+    /* Unpublish the old record before changing it, so readers copying it know
+     * it changed */
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    slot->tsc   = tsc_read();
+    slot->level = level;
+
+    /* The consumers add their own newline */
+    int len = vsnprintf(slot->msg, LOG_MSG_SZ, fmt, va);
+    if (len >= LOG_MSG_SZ)
+        len = LOG_MSG_SZ - 1;
+    if (len > 0 && slot->msg[len - 1] == '\n')
+        slot->msg[len - 1] = '\0';
+
+    /* Publish */
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+void log_write(enum log_level level, const char* fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+
+    log_vwrite(level, fmt, va);
+
+    va_end(va);
+}
+
+void log_reader_init(LogReader* reader) {
+    const uint32_t head = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+
+    reader->next = (head > LOG_SLOTS) ? head - LOG_SLOTS : 0;
+    reader->lost = 0;
+}
+
+bool log_read(LogReader* reader, LogRecord* out) {
+    for (;;) {
+        const uint32_t head = __atomic_load_n(&log_head, __ATOMIC_ACQUIRE);
+        if (reader->next == head)
+            return false;
+
+        /* The writers lapped us, skip to the oldest record in the buffer */
+        if (head - reader->next > LOG_SLOTS) {
+            reader->lost += head - LOG_SLOTS - reader->next;
+            reader->next = head - LOG_SLOTS;
+        }
+
+        const LogRecord* slot = &log_ring[reader->next % LOG_SLOTS];
+        const uint32_t want   = reader->next + 1;
+
+        uint32_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        if (seq != want) {
+            /* Reserved but not published yet (a writer we interrupted, or one
+             * that was interrupted), try again later */
+            if (seq == 0 || (int32_t)(seq - want) < 0)
+                return false;
+
+            /* Already overwritten by a newer record */
+            reader->lost++;
+            reader->next++;
+            continue;
+        }
+
+        *out = *slot;
+
+        /* Check that it didn't change while copying */
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+        reader->next++;
+        if (seq != want) {
+            reader->lost++;
+            continue;
+        }
+
+        return true;
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Print a record to the console, like the boot messages.
+ * @param[in] rec Record to print
+ */
+static void console_print(const LogRecord* rec) {
+    uint32_t bullet_col, msg_col;
+    switch (rec->level) {
+        case LOG_ERR:
+            bullet_col = COLOR_RED_B;
+            msg_col    = COLOR_RED;
+            break;
+        case LOG_WARN:
+            bullet_col = COLOR_GRAY_B;
+            msg_col    = COLOR_GRAY_B;
+            break;
+        default:
+            bullet_col = COLOR_MAGENTA_B;
+            msg_col    = COLOR_MAGENTA;
+            break;
+    }
+
+    uint32_t old_fg, old_bg;
+    fbc_getcols(&old_fg, &old_bg);
+
+    fbc_setfore(bullet_col);
+    printf(" * ");
+    fbc_setfore(msg_col);
+    printf("%s\n", rec->msg);
+
+    fbc_setfore(old_fg);
+}
+
+/**
+ * @brief Send a record to the serial port as a single line.
+ * @details Format: "[seconds.micros] level: message"
+ * @param[in] rec Record to send
+ */
+static void serial_print(const LogRecord* rec) {
+    const uint64_t us = tsc_to_us(rec->tsc);
+
+    char line[LOG_MSG_SZ + 48];
+    snprintf(line, sizeof(line), "[%5llu.%06llu] %s: %s\n", us / 1000000,
+             us % 1000000, log_level_name(rec->level), rec->msg);
+    serial_sprint(line);
+}
+
+/**
+ * @brief Print the lost records of a reader, and reset the count.
+ * @param[inout] reader Reader of log_drain()
+ * @param[in] print Where to print it
+ */
+static void report_lost(LogReader* reader, void (*print)(const LogRecord*)) {
+    if (reader->lost == 0)
+        return;
+
+    LogRecord rec = { .tsc = tsc_read(), .level = LOG_WARN };
+    snprintf(rec.msg, sizeof(rec.msg), "log: %lu records lost",
+             (unsigned long)reader->lost);
+    reader->lost = 0;
+
+    print(&rec);
+}
+
+void log_flush_serial(void) {
+    LogRecord rec;
+
+    if (!serial_available())
+        return;
+
+    while (log_read(&serial_reader, &rec))
+        serial_print(&rec);
+
+    report_lost(&serial_reader, serial_print);
+}
+
+void log_drain(void) {
+    LogRecord rec;
+
+    while (log_read(&console_reader, &rec))
+        if (rec.level <= console_level)
+            console_print(&rec);
+
+    report_lost(&console_reader, console_print);
+
+    log_flush_serial();
+}
+
+void log_set_console_level(enum log_level level) {
+    console_level = level;
+}
+
+const char* log_level_name(enum log_level level) {
+    if ((unsigned)level >= sizeof(level_names) / sizeof(level_names[0]))
+        return "???";
+
+    return level_names[level];
+}
@@ -1,6 +1,12 @@
 
 %include "structs.asm"      ; ctx_t
 
+; Same as in enum tracepoint_ids, see src/kernel/include/kernel/tracepoint.h
+%define TP_MT_SWITCH 0
+
+; Interrupt flag of EFLAGS, see src/kernel/include/kernel/irq.h
+%define EFLAGS_IF 0x200
+
 section .bss
     global mt_current_task
     mt_current_task: resd 1
@@ -14,6 +20,9 @@ section .bss
             at ctx_t.cr3,   resd 1
             at ctx_t.state, resd 1
             at ctx_t.name,  resd 1
+            at ctx_t.rand,  resd 4
+            at ctx_t.wait_next, resd 1
+            at ctx_t.tty,   resd 1
         iend
 
 section .data
@@ -23,6 +32,10 @@ section .text
     extern stack_bottom         ; src/kernel/boot.asm
     extern malloc:function      ; src/libk/stdlib.c
     extern free:function        ; src/libk/stdlib.c
+    extern tp_enabled           ; src/kernel/tracepoint.c
+    extern tp_record            ; src/kernel/tracepoint.c
+    extern irqoff_begin         ; src/kernel/irqoff.c
+    extern irqoff_end           ; src/kernel/irqoff.c
 
 ; void mt_init(void);
 ; Initialize multitasking. Creates the first task for the kernel.
@@ -42,8 +55,12 @@ mt_init:
     mov     eax, cr3
     mov     [first_ctx + ctx_t.cr3], eax
 
-    ; TODO: State
+    ; TASK_READY, see src/kernel/include/kernel/multitask.h
     mov     [first_ctx + ctx_t.state], dword 0x00000000
+    mov     [first_ctx + ctx_t.wait_next], dword 0x00000000
+
+    ; No stdin, use the one of its virtual terminal. See tty_stdin()
+    mov     [first_ctx + ctx_t.tty], dword 0x00000000
 
     ; "kernel_main"
     mov     [first_ctx + ctx_t.name],  dword first_task_name
@@ -70,7 +87,19 @@ mt_newtask:
                                 ; by new allocated stack.
 
     mov     [eax + ctx_t.name], edx ; Program name (char*), first arg
-    mov     [eax + ctx_t.state], dword 0x00000000 ; TODO: State
+    mov     [eax + ctx_t.state], dword 0x00000000 ; TASK_READY
+    mov     [eax + ctx_t.wait_next], dword 0x00000000
+
+    ; Same stdin as the current task
+    mov     edx, [mt_current_task]
+    mov     edx, [edx + ctx_t.tty]
+    mov     [eax + ctx_t.tty], edx
+
+    ; Unseeded generator, see cur_state() in src/libk/stdlib.c
+    mov     [eax + ctx_t.rand],      dword 0x00000000
+    mov     [eax + ctx_t.rand + 4],  dword 0x00000000
+    mov     [eax + ctx_t.rand + 8],  dword 0x00000000
+    mov     [eax + ctx_t.rand + 12], dword 0x00000000
 
     mov     edx, cr3
     mov     [eax + ctx_t.cr3], edx  ; TODO: For now save current cr3 for new
@@ -150,8 +179,32 @@ mt_newtask:
 ; Switch to task "next".
 global mt_switch:function
 mt_switch:
+    pushfd
+    pop     eax
     cli             ; Clear interrupts
 
+    ; Measure the window if we disabled them, like irq_save(). mt_yield() calls
+    ; us with the interrupts already disabled, and its window ends in the sti
+    ; below, in the context of the next task
+    test    eax, EFLAGS_IF
+    jz      .irqs_off
+    call    irqoff_begin                ; src/kernel/irqoff.c
+
+.irqs_off:
+    ; TRACEPOINT(TP_MT_SWITCH, mt_current_task->name, next->name). Before
+    ; saving the registers, we don't need eax, ecx and edx
+    test    dword [tp_enabled], 1 << TP_MT_SWITCH
+    jz      .no_trace
+    mov     eax, [esp + 4]              ; First argument, next
+    push    dword [eax + ctx_t.name]
+    mov     eax, [mt_current_task]
+    push    dword [eax + ctx_t.name]
+    push    dword TP_MT_SWITCH
+    call    tp_record                   ; src/kernel/tracepoint.c
+    add     esp, 12
+
+.no_trace:
+
     push    edi     ; edi will be the current task
     push    esi     ; esi will be the first argument (new ctx)
     push    ebp     ; ebp and ebx are unused in mt_swtich, we still need to save
@@ -188,6 +241,9 @@ mt_switch:
     pop     esi
     pop     edi
 
+    ; Like irq_enable(). We already restored the registers, and the caller
+    ; doesn't expect eax, ecx and edx to be preserved
+    call    irqoff_end                  ; src/kernel/irqoff.c
     sti             ; Enable interrupts again
 
     ret
@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <kernel/multitask.h>
+#include <kernel/irq.h> /* irq_disable, irq_enable, irqoff_end */
 
 void dump_task_list(void) {
     puts("Dumping task list:");
@@ -26,3 +27,39 @@ void dump_task_list(void) {
     }
 }
 
+void mt_yield(void) {
+    Ctx* const self = mt_current_task;
+
+    for (;;) {
+        /* An IRQ could wake a task while we look for one */
+        irq_disable();
+
+        Ctx* next = self->next;
+        while (next != self && next->state != TASK_READY)
+            next = next->next;
+
+        if (next != self) {
+            /* Enables the interrupts again. If someone switched to us while
+             * we were blocked, keep looking */
+            mt_switch(next);
+            if (self->state == TASK_READY)
+                return;
+
+            continue;
+        }
+
+        if (self->state == TASK_READY) {
+            irq_enable();
+            return;
+        }
+
+        /* Nothing to run. The instruction after sti can't be interrupted, so
+         * we can't miss the IRQ that wakes a task */
+        irqoff_end();
+        asm volatile("sti\n\t"
+                     "hlt"
+                     :
+                     :
+                     : "memory");
+    }
+}
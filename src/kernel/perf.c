@@ -0,0 +1,273 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h> /* malloc, free, qsort */
+#include <stdio.h>  /* printf */
+#include <kernel/perf.h>
+#include <kernel/ksyms.h>
+#include <kernel/irq.h> /* irq_get_frame, irq_save, irq_restore */
+
+/**
+ * @brief Max distance between 2 saved frame pointers. Task stacks are 16KiB,
+ * see src/kernel/multitask.asm
+ */
+#define MAX_FRAME_SZ 16384
+
+/**
+ * @name Values of chain.syms that are not indexes of ksyms_table
+ * @{ */
+#define SYM_UNKNOWN (-1) /**< @brief Address outside of the symbol table */
+#define SYM_NONE    (-2) /**< @brief Past the end of the backtrace */
+/** @} */
+
+/**
+ * @brief Samples with the same functions, used by perf_report()
+ */
+typedef struct {
+    int32_t syms[1 + PERF_STACK_DEPTH]; /**< @brief EIP and callers */
+    uint32_t count;                     /**< @brief Number of samples */
+} chain;
+
+static PerfSample samples[PERF_MAX_SAMPLES];
+static volatile size_t samples_count = 0;
+static volatile uint32_t dropped     = 0;
+
+static volatile bool running = false;
+static uint32_t period       = 1;
+
+/**
+ * @brief PIT ticks until the next sample.
+ */
+static uint32_t countdown = 1;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Store the return addresses of the callers of a frame.
+ * @details Stops when a saved frame pointer doesn't look valid, since the code
+ * without frame pointers (e.g. assembly) uses ebp for other things.
+ * @param ebp Frame pointer of the interrupted function.
+ * @param[out] callers Return addresses, the unused ones are 0.
+ */
+static void backtrace(uint32_t ebp, uint32_t* callers) {
+    int i = 0;
+
+    while (i < PERF_STACK_DEPTH && ebp != 0 && (ebp & 3) == 0) {
+        /* Saved frame pointer, then return address */
+        const uint32_t* frame = (const uint32_t*)ebp;
+        if (!ksyms_in_text(frame[1]))
+            break;
+
+        callers[i++] = frame[1];
+
+        /* The frames of the callers are above in the same stack */
+        const uint32_t next = frame[0];
+        if (next <= ebp || next - ebp > MAX_FRAME_SZ)
+            break;
+
+        ebp = next;
+    }
+
+    for (; i < PERF_STACK_DEPTH; i++)
+        callers[i] = 0;
+}
+
+/**
+ * @brief Get the index in ksyms_table of the function containing an address.
+ * @param addr Target address, or 0.
+ * @return Index, SYM_UNKNOWN or SYM_NONE if \p addr is 0.
+ */
+static int32_t resolve(uint32_t addr) {
+    if (addr == 0)
+        return SYM_NONE;
+
+    const KSym* sym = ksyms_find(addr);
+    return (sym != NULL) ? sym - ksyms_table : SYM_UNKNOWN;
+}
+
+/**
+ * @brief Order chains by their functions, for grouping them.
+ */
+static int cmp_syms(const void* a, const void* b) {
+    const chain* ca = a;
+    const chain* cb = b;
+
+    for (int i = 0; i < 1 + PERF_STACK_DEPTH; i++)
+        if (ca->syms[i] != cb->syms[i])
+            return (ca->syms[i] < cb->syms[i]) ? -1 : 1;
+
+    return 0;
+}
+
+/**
+ * @brief Order chains by sample count, from the biggest one.
+ */
+static int cmp_count(const void* a, const void* b) {
+    const chain* ca = a;
+    const chain* cb = b;
+
+    if (ca->count != cb->count)
+        return (ca->count > cb->count) ? -1 : 1;
+
+    return cmp_syms(a, b);
+}
+
+/**
+ * @brief Merge the chains with the same functions, and sort them by count.
+ * @param[inout] chains Chains with a count of 1.
+ * @param n Number of chains.
+ * @return Number of different chains, at the start of \p chains.
+ */
+static size_t group_chains(chain* chains, size_t n) {
+    qsort(chains, n, sizeof(chain), cmp_syms);
+
+    size_t groups = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (groups > 0 && cmp_syms(&chains[groups - 1], &chains[i]) == 0) {
+            chains[groups - 1].count++;
+        } else {
+            chains[groups]       = chains[i];
+            chains[groups].count = 1;
+            groups++;
+        }
+    }
+
+    qsort(chains, groups, sizeof(chain), cmp_count);
+    return groups;
+}
+
+/**
+ * @brief Print the name of a function of a chain.
+ * @param sym Index in ksyms_table, or SYM_UNKNOWN.
+ */
+static void print_sym(int32_t sym) {
+    if (sym >= 0)
+        printf("%s", ksyms_table[sym].name);
+    else
+        printf("(unknown)");
+}
+
+/**
+ * @brief Print the sample count and percentage of a chain.
+ * @param count Samples of the chain.
+ * @param total Total samples.
+ */
+static void print_count(uint32_t count, size_t total) {
+    const uint32_t permille = (uint64_t)count * 1000 / total;
+    printf("%8lu %4lu.%lu%%  ", count, permille / 10, permille % 10);
+}
+
+/* -------------------------------------------------------------------------- */
+
+void perf_start(uint32_t new_period) {
+    const uint32_t eflags = irq_save();
+
+    samples_count = 0;
+    dropped       = 0;
+    period        = (new_period > 0) ? new_period : 1;
+    countdown     = period;
+    running       = true;
+
+    irq_restore(eflags);
+}
+
+void perf_stop(void) {
+    running = false;
+}
+
+bool perf_running(void) {
+    return running;
+}
+
+const PerfSample* perf_get_samples(size_t* count, uint32_t* out_dropped) {
+    *count       = samples_count;
+    *out_dropped = dropped;
+    return samples;
+}
+
+void perf_tick(uint64_t ticks) {
+    (void)ticks;
+
+    if (!running || --countdown > 0)
+        return;
+
+    countdown = period;
+
+    const IrqFrame* frame = irq_get_frame();
+    if (frame == NULL)
+        return;
+
+    if (samples_count >= PERF_MAX_SAMPLES) {
+        dropped++;
+        return;
+    }
+
+    PerfSample* sample = &samples[samples_count];
+    sample->eip        = frame->eip;
+    backtrace(frame->ebp, sample->callers);
+
+    samples_count++;
+}
+
+bool perf_report(size_t top) {
+    perf_stop();
+
+    const size_t n = samples_count;
+    if (n == 0)
+        return false;
+
+    chain* chains = malloc(n * sizeof(chain));
+    if (chains == NULL)
+        return false;
+
+    printf("%lu samples, %lu dropped, %lu symbols\n\n", n, dropped,
+           ksyms_count);
+
+    /* Flat profile, only the interrupted function */
+    for (size_t i = 0; i < n; i++) {
+        chains[i].syms[0] = resolve(samples[i].eip);
+        for (int j = 1; j < 1 + PERF_STACK_DEPTH; j++)
+            chains[i].syms[j] = SYM_NONE;
+    }
+
+    size_t groups = group_chains(chains, n);
+
+    printf(" samples      %%  function\n");
+    for (size_t i = 0; i < groups && i < top; i++) {
+        print_count(chains[i].count, n);
+        print_sym(chains[i].syms[0]);
+        putchar('\n');
+    }
+
+    /* Call chains. The return addresses point after the call, which might be
+     * the start of the next function */
+    for (size_t i = 0; i < n; i++) {
+        chains[i].syms[0] = resolve(samples[i].eip);
+        for (int j = 0; j < PERF_STACK_DEPTH; j++) {
+            const uint32_t ret    = samples[i].callers[j];
+            chains[i].syms[j + 1] = resolve((ret != 0) ? ret - 1 : 0);
+        }
+    }
+
+    groups = group_chains(chains, n);
+
+    printf("\n samples      %%  call chain\n");
+    for (size_t i = 0; i < groups && i < top; i++) {
+        print_count(chains[i].count, n);
+        print_sym(chains[i].syms[0]);
+
+        for (int j = 1; j < 1 + PERF_STACK_DEPTH; j++) {
+            if (chains[i].syms[j] == SYM_NONE)
+                break;
+
+            printf(" <- ");
+            print_sym(chains[i].syms[j]);
+        }
+
+        putchar('\n');
+    }
+
+    free(chains);
+    return true;
+}
@@ -9,6 +9,11 @@
 
 #include <kernel/pit.h>
 #include <kernel/io.h>
+#include <kernel/framebuffer_console.h> /* fbc_render_tick */
+#include <kernel/compositor.h>          /* comp_render_tick */
+#include <kernel/poll.h>                /* poll_tick */
+#include <kernel/perf.h>                /* perf_tick */
+#include <kernel/irq.h>                 /* irq_register, irq_disable */
 
 void pit_init(uint32_t freq) {
     /* freq should be how many HZs it should wait between sending interrupt. We
@@ -23,17 +28,19 @@ void pit_init(uint32_t freq) {
     /* Set reload values to the current ms */
     io_outb(PIT_CHANNEL_0, (uint8_t)(freq & 0xFF));
     io_outb(PIT_CHANNEL_0, (uint8_t)((freq & 0xFF00) >> 8));
+
+    irq_register(IRQ_PIT, "pit", pit_inc);
 }
 
 uint16_t pit_read_count(enum pit_io_ports channel_port,
                         enum pit_cmd_flags channel_flag) {
     uint16_t ret = 0;
 
-    asm("cli");                             /* Disable interrupts */
+    irq_disable();
     io_outb(PIT_CHANNEL_CMD, channel_flag); /* Select current channel */
     ret = io_inb(channel_port);             /* Low byte */
     ret |= io_inb(channel_port) << 8;       /* High byte */
-    asm("sti");                             /* Re-enable interrupts */
+    irq_enable();
 
     return ret;
 }
@@ -48,18 +55,21 @@ static volatile uint64_t ticks = 0;
 void pit_dec(void) {
     if (ticks > 0)
         ticks--;
-
-    /* Tell CPU that it's okay to resume interrupts. See:
-     * https://wiki.osdev.org/Interrupts#From_the_OS.27s_perspective */
-    io_outb(0x20, 0x20);
 }
 
 void pit_inc(void) {
     ticks++;
 
-    /* Tell CPU that it's okay to resume interrupts. See:
-     * https://wiki.osdev.org/Interrupts#From_the_OS.27s_perspective */
-    io_outb(0x20, 0x20);
+    /* Wake the tasks whose timeout passed */
+    poll_tick(ticks);
+
+    /* Sample the interrupted code if the profiler is running */
+    perf_tick(ticks);
+
+    /* Redraw the console if it's deferred, and the damaged surfaces. Needs to
+     * be after the EOI, which irq_dispatch() sends before calling us */
+    fbc_render_tick(ticks);
+    comp_render_tick(ticks);
 }
 
 void pit_set_ticks(uint64_t num) {
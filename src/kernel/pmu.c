@@ -0,0 +1,217 @@
+
+/**
+ * @brief Architectural performance monitoring of Intel CPUs.
+ *
+ * See: Intel SDM, Vol. 3B, Chapter 20 "Performance Monitoring"
+ *
+ * @file
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/pmu.h>
+#include <kernel/irq.h> /* irq_save, irq_restore */
+
+/**
+ * @brief Vendor string of cpuid leaf 0, "GenuineIntel", in EBX, EDX and ECX.
+ * AMD uses leaf 0xA for SVM, and has different MSRs.
+ */
+#define CPUID_INTEL_EBX 0x756E6547
+#define CPUID_INTEL_EDX 0x49656E69
+#define CPUID_INTEL_ECX 0x6C65746E
+
+/**
+ * @brief Architectural event, see pmu_events.
+ */
+typedef struct {
+    const char* name;
+    uint8_t event; /**< @brief Event select of IA32_PERFEVTSELx */
+    uint8_t umask; /**< @brief Unit mask of IA32_PERFEVTSELx */
+    uint8_t bit;   /**< @brief Bit of EBX of cpuid 0xA, set if not available */
+} pmu_event;
+
+static const pmu_event events[PMU_EVENT_COUNT] = {
+    [PMU_CYCLES]        = { "cycles", 0x3C, 0x00, 0 },
+    [PMU_INSTRUCTIONS]  = { "instructions", 0xC0, 0x00, 1 },
+    [PMU_LLC_MISSES]    = { "LLC-misses", 0x2E, 0x41, 4 },
+    [PMU_BRANCH_MISSES] = { "branch-misses", 0xC5, 0x00, 6 },
+};
+
+/**
+ * @brief Values from cpuid leaf 0xA, set by pmu_init()
+ */
+static uint8_t version     = 0;
+static uint8_t counters    = 0;
+static uint64_t width_mask = 0;
+
+/**
+ * @brief Counter of each event, or -1 if it's not counted. Set by pmu_init()
+ */
+static int8_t event_counter[PMU_EVENT_COUNT] = { -1, -1, -1, -1 };
+
+/**
+ * @brief Bit N is set if counter N is used by some event.
+ */
+static uint32_t used_counters = 0;
+
+/**
+ * @brief True between pmu_start() and pmu_stop()
+ */
+static bool running = false;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Run the cpuid instruction.
+ * @param leaf, subleaf Values of EAX and ECX
+ * @param[out] a, b, c, d Values of EAX, EBX, ECX and EDX after cpuid
+ */
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* a,
+                         uint32_t* b, uint32_t* c, uint32_t* d) {
+    asm volatile("cpuid"
+                 : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                 : "a"(leaf), "c"(subleaf));
+}
+
+/**
+ * @brief Read a Model Specific Register.
+ * @param msr Address of the register.
+ * @return Value of the register.
+ */
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint64_t ret;
+    asm volatile("rdmsr" : "=A"(ret) : "c"(msr));
+    return ret;
+}
+
+/**
+ * @brief Write a Model Specific Register.
+ * @param msr Address of the register.
+ * @param value New value of the register.
+ */
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "A"(value) : "memory");
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool pmu_init(void) {
+    uint32_t a, b, c, d;
+
+    cpuid(0, 0, &a, &b, &c, &d);
+    if (a < 0xA || b != CPUID_INTEL_EBX || d != CPUID_INTEL_EDX ||
+        c != CPUID_INTEL_ECX)
+        return false;
+
+    /* EAX: version, counters, width of the counters and number of bits in
+     * EBX. Under QEMU without KVM, it's all 0 */
+    cpuid(0xA, 0, &a, &b, &c, &d);
+    const uint8_t ver        = a & 0xFF;
+    const uint8_t num        = (a >> 8) & 0xFF;
+    const uint8_t width      = (a >> 16) & 0xFF;
+    const uint8_t event_bits = (a >> 24) & 0xFF;
+
+    if (ver == 0 || num == 0 || width == 0)
+        return false;
+
+    version    = ver;
+    counters   = num;
+    width_mask = (width >= 64) ? UINT64_MAX : (1ULL << width) - 1;
+
+    /* One counter for each available event, in order */
+    uint8_t next = 0;
+    for (int i = 0; i < PMU_EVENT_COUNT; i++) {
+        const bool available =
+          events[i].bit < event_bits && !(b & (1 << events[i].bit));
+
+        if (available && next < counters) {
+            event_counter[i] = next;
+            used_counters |= 1 << next;
+            next++;
+        }
+    }
+
+    /* Stop the counters we use, whatever the firmware left */
+    for (uint8_t i = 0; i < next; i++)
+        wrmsr(MSR_PERFEVTSEL0 + i, 0);
+
+    return used_counters != 0;
+}
+
+bool pmu_available(void) {
+    return used_counters != 0;
+}
+
+uint8_t pmu_version(void) {
+    return version;
+}
+
+uint8_t pmu_counters(void) {
+    return counters;
+}
+
+const char* pmu_event_name(uint8_t id) {
+    return (id < PMU_EVENT_COUNT) ? events[id].name : NULL;
+}
+
+bool pmu_start(void) {
+    if (!pmu_available())
+        return false;
+
+    const uint32_t eflags = irq_save();
+
+    if (running) {
+        irq_restore(eflags);
+        return false;
+    }
+
+    running = true;
+
+    for (int i = 0; i < PMU_EVENT_COUNT; i++) {
+        if (event_counter[i] < 0)
+            continue;
+
+        wrmsr(MSR_PMC0 + event_counter[i], 0);
+        wrmsr(MSR_PERFEVTSEL0 + event_counter[i],
+              events[i].event | (events[i].umask << 8) | PERFEVTSEL_USR |
+                PERFEVTSEL_OS | PERFEVTSEL_EN);
+    }
+
+    /* Since version 2, the counters also need to be enabled globally */
+    if (version >= 2)
+        wrmsr(MSR_PERF_GLOBAL_CTRL, used_counters);
+
+    irq_restore(eflags);
+    return true;
+}
+
+void pmu_stop(PmuCounts* out) {
+    out->counted = 0;
+    for (int i = 0; i < PMU_EVENT_COUNT; i++)
+        out->values[i] = 0;
+
+    if (!running)
+        return;
+
+    const uint32_t eflags = irq_save();
+
+    /* Stop all of them before reading, so they count the same */
+    if (version >= 2)
+        wrmsr(MSR_PERF_GLOBAL_CTRL, 0);
+
+    for (int i = 0; i < PMU_EVENT_COUNT; i++)
+        if (event_counter[i] >= 0)
+            wrmsr(MSR_PERFEVTSEL0 + event_counter[i], 0);
+
+    for (int i = 0; i < PMU_EVENT_COUNT; i++) {
+        if (event_counter[i] < 0)
+            continue;
+
+        out->values[i] = rdmsr(MSR_PMC0 + event_counter[i]) & width_mask;
+        out->counted |= 1 << i;
+    }
+
+    running = false;
+    irq_restore(eflags);
+}
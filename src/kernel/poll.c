@@ -0,0 +1,135 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/poll.h>
+#include <kernel/waitqueue.h>
+#include <kernel/tty.h>
+#include <kernel/keyboard.h> /* kb_has_event */
+#include <kernel/serial.h>   /* serial_rx_ready */
+#include <kernel/pit.h>      /* pit_get_ticks */
+
+/**
+ * @brief Tasks in poll_wait()
+ */
+static WaitQueue pollers = { NULL };
+
+/**
+ * @brief Earliest deadline of the tasks in poll_wait(). Only changed with the
+ * interrupts disabled.
+ */
+static volatile uint64_t next_deadline = POLL_FOREVER;
+
+/**
+ * @brief Arguments of wait_cond()
+ */
+typedef struct {
+    wq_cond_t cond;
+    const void* arg;
+    uint64_t deadline;
+} wait_args;
+
+/**
+ * @brief Arguments of any_ready()
+ */
+typedef struct {
+    const PollFd* fds;
+    size_t n;
+} poll_args;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Condition of wq_wait() in poll_wait()
+ * @details Called with the interrupts disabled, so poll_tick() can't miss the
+ * deadline we set here.
+ * @param[in] arg Pointer to wait_args
+ * @return True if the condition is true or the deadline passed.
+ */
+static bool wait_cond(const void* arg) {
+    const wait_args* w = arg;
+
+    if (w->cond(w->arg) || pit_get_ticks() >= w->deadline)
+        return true;
+
+    if (w->deadline < next_deadline)
+        next_deadline = w->deadline;
+
+    return false;
+}
+
+/**
+ * @brief Check if a source of poll() has input.
+ * @param[in] fd Target source
+ * @return True if reading from it wouldn't block.
+ */
+static bool source_ready(const PollFd* fd) {
+    switch (fd->source) {
+        case POLL_TTY:
+            return tty_readable((fd->tty != NULL) ? fd->tty : tty_stdin());
+        case POLL_KB_EVENTS:
+            return kb_has_event();
+        case POLL_SERIAL:
+            return serial_rx_ready();
+        default:
+            return false;
+    }
+}
+
+/**
+ * @brief Condition of poll_wait() in poll()
+ * @param[in] arg Pointer to poll_args
+ * @return True if any of the sources has input.
+ */
+static bool any_ready(const void* arg) {
+    const poll_args* p = arg;
+
+    for (size_t i = 0; i < p->n; i++)
+        if (source_ready(&p->fds[i]))
+            return true;
+
+    return false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+int poll(PollFd* fds, size_t n, int32_t timeout_ms) {
+    const poll_args args = { fds, n };
+
+    if (timeout_ms != 0) {
+        const uint64_t deadline =
+          (timeout_ms < 0) ? POLL_FOREVER : pit_get_ticks() + timeout_ms;
+
+        poll_wait(any_ready, &args, deadline);
+    }
+
+    int ret = 0;
+    for (size_t i = 0; i < n; i++) {
+        fds[i].ready = source_ready(&fds[i]);
+        if (fds[i].ready)
+            ret++;
+    }
+
+    return ret;
+}
+
+bool poll_wait(wq_cond_t cond, const void* arg, uint64_t deadline) {
+    const wait_args w = { cond, arg, deadline };
+
+    wq_wait(&pollers, wait_cond, &w);
+
+    return cond(arg);
+}
+
+void poll_notify(void) {
+    wq_wake_all(&pollers);
+}
+
+void poll_tick(uint64_t ticks) {
+    if (ticks < next_deadline)
+        return;
+
+    /* The tasks with later deadlines set it again in wait_cond() */
+    next_deadline = POLL_FOREVER;
+    wq_wake_all(&pollers);
+}
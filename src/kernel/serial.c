@@ -0,0 +1,277 @@
+
+/**
+ * @brief Serial port driver for the 16550 UART.
+ *
+ * See: https://wiki.osdev.org/Serial_Ports
+ *
+ * @file
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <kernel/serial.h>
+#include <kernel/io.h>
+#include <kernel/irq.h>  /* irq_register, irq_save, irq_restore */
+#include <kernel/poll.h> /* poll_notify */
+
+/**
+ * @brief True if the loopback test of serial_init() passed
+ */
+static bool serial_ok = false;
+
+/**
+ * @brief TX ring buffer. The positions only increment, the index of position
+ * `pos` is `pos % SERIAL_TX_SZ`. Only changed with the interrupts disabled.
+ */
+static char tx_ring[SERIAL_TX_SZ];
+static volatile uint32_t tx_head = 0; /**< @brief Position of the next write */
+static volatile uint32_t tx_tail = 0; /**< @brief Position of the next send */
+
+/**
+ * @brief True if the THRE interrupt is enabled, so serial_handler() will send
+ * the rest of the TX ring.
+ */
+static volatile bool tx_running = false;
+
+/**
+ * @brief RX ring buffer. Written by serial_handler() and read by
+ * serial_getchar(), so it doesn't need to disable the interrupts.
+ */
+static char rx_ring[SERIAL_RX_SZ];
+static volatile uint32_t rx_head = 0; /**< @brief Position of the next write */
+static volatile uint32_t rx_tail = 0; /**< @brief Position of the next read */
+
+static SerialStats stats = { 0 };
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Move up to SERIAL_FIFO_SZ bytes from the TX ring to the UART.
+ * @details The interrupts need to be disabled, and the FIFO empty (THRE set).
+ */
+static void tx_fill(void) {
+    uint32_t tail = tx_tail;
+
+    for (int i = 0; i < SERIAL_FIFO_SZ && tail != tx_head; i++, tail++)
+        io_outb(SERIAL_PORT + SERIAL_REG_DATA,
+                tx_ring[tail & (SERIAL_TX_SZ - 1)]);
+
+    tx_tail = tail;
+}
+
+/**
+ * @brief Start sending the TX ring if the THRE interrupt is not doing it
+ * already.
+ * @details The interrupts need to be disabled. The first bytes are sent here,
+ * and the THRE interrupt sends the rest when the FIFO gets empty.
+ */
+static void tx_start(void) {
+    if (tx_running || tx_tail == tx_head)
+        return;
+
+    if (io_inb(SERIAL_PORT + SERIAL_REG_LSR) & SERIAL_LSR_THRE)
+        tx_fill();
+
+    tx_running = true;
+    io_outb(SERIAL_PORT + SERIAL_REG_IER, SERIAL_IER_RX | SERIAL_IER_THRE);
+}
+
+/**
+ * @brief Send all of the TX ring by polling the UART.
+ * @details For when the interrupts are disabled, and the THRE interrupt can't
+ * empty the ring.
+ */
+static void tx_drain_polled(void) {
+    while (tx_tail != tx_head) {
+        while (!(io_inb(SERIAL_PORT + SERIAL_REG_LSR) & SERIAL_LSR_THRE))
+            ;
+
+        tx_fill();
+    }
+}
+
+/**
+ * @brief Move the received bytes from the UART to the RX ring.
+ */
+static void rx_drain(void) {
+    while (io_inb(SERIAL_PORT + SERIAL_REG_LSR) & SERIAL_LSR_DATA_READY) {
+        const char c = io_inb(SERIAL_PORT + SERIAL_REG_DATA);
+
+        if (rx_head - rx_tail >= SERIAL_RX_SZ) {
+            stats.rx_dropped++;
+            continue;
+        }
+
+        rx_ring[rx_head & (SERIAL_RX_SZ - 1)] = c;
+        __atomic_store_n(&rx_head, rx_head + 1, __ATOMIC_RELEASE);
+        stats.rx_bytes++;
+    }
+
+    poll_notify();
+}
+
+/**
+ * @brief Add bytes to the TX ring, waiting if it's full. See serial_write()
+ * @param[in] s Bytes to send.
+ * @param len Number of bytes.
+ * @param crlf If true, newlines are sent as "\r\n".
+ */
+static void write_bytes(const char* s, size_t len, bool crlf) {
+    if (!serial_ok)
+        return;
+
+    uint32_t eflags = irq_save();
+
+    for (size_t i = 0; i < len; i++) {
+        /* Newlines need 2 slots */
+        const uint32_t needed = (crlf && s[i] == '\n') ? 2 : 1;
+
+        if (tx_head - tx_tail > SERIAL_TX_SZ - needed)
+            stats.tx_waits++;
+
+        while (tx_head - tx_tail > SERIAL_TX_SZ - needed) {
+            tx_start();
+
+            if (eflags & EFLAGS_IF) {
+                /* Let serial_handler() make some space */
+                irq_restore(eflags);
+                asm volatile("pause" : : : "memory");
+                eflags = irq_save();
+            } else {
+                tx_drain_polled();
+            }
+        }
+
+        if (crlf && s[i] == '\n')
+            tx_ring[tx_head++ & (SERIAL_TX_SZ - 1)] = '\r';
+
+        tx_ring[tx_head++ & (SERIAL_TX_SZ - 1)] = s[i];
+
+        /* Including the '\r' we added */
+        stats.tx_bytes += needed;
+    }
+
+    /* Without interrupts, nobody would send the rest */
+    if (eflags & EFLAGS_IF)
+        tx_start();
+    else
+        tx_drain_polled();
+
+    irq_restore(eflags);
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool serial_init(void) {
+    const uint16_t divisor = 115200 / SERIAL_BAUD;
+
+    io_outb(SERIAL_PORT + SERIAL_REG_IER, 0x00); /* Disable interrupts */
+    io_outb(SERIAL_PORT + SERIAL_REG_LCR, 0x80); /* Set DLAB for the divisor */
+    io_outb(SERIAL_PORT + SERIAL_REG_DIV_LO, divisor & 0xFF);
+    io_outb(SERIAL_PORT + SERIAL_REG_DIV_HI, (divisor >> 8) & 0xFF);
+    io_outb(SERIAL_PORT + SERIAL_REG_LCR, 0x03); /* 8N1, clear DLAB */
+    io_outb(SERIAL_PORT + SERIAL_REG_FCR, 0xC7); /* Enable and clear FIFOs */
+
+    /* Loopback mode, send a byte and check that we get it back */
+    io_outb(SERIAL_PORT + SERIAL_REG_MCR, 0x1E);
+    io_outb(SERIAL_PORT + SERIAL_REG_DATA, 0xAE);
+    if (io_inb(SERIAL_PORT + SERIAL_REG_DATA) != 0xAE)
+        return false;
+
+    /* Normal mode: DTR, RTS, OUT1 and OUT2. OUT2 connects the interrupts of
+     * the UART to the PIC */
+    io_outb(SERIAL_PORT + SERIAL_REG_MCR, 0x0F);
+
+    /* The THRE interrupt is only enabled while there is something to send, see
+     * tx_start() */
+    io_outb(SERIAL_PORT + SERIAL_REG_IER, SERIAL_IER_RX);
+    irq_register(IRQ_COM1, "com1", serial_handler);
+
+    serial_ok = true;
+    return true;
+}
+
+bool serial_available(void) {
+    return serial_ok;
+}
+
+void serial_handler(void) {
+    stats.irqs++;
+
+    uint8_t iir;
+    while (!((iir = io_inb(SERIAL_PORT + SERIAL_REG_IIR)) & SERIAL_IIR_NONE)) {
+        switch (iir & SERIAL_IIR_ID) {
+            case SERIAL_IIR_THRE:
+                /* Reading the IIR cleared it */
+                if (tx_tail != tx_head) {
+                    tx_fill();
+                } else {
+                    tx_running = false;
+                    io_outb(SERIAL_PORT + SERIAL_REG_IER, SERIAL_IER_RX);
+                }
+                break;
+            case SERIAL_IIR_RX:
+            case SERIAL_IIR_RX_TIMEOUT:
+                rx_drain();
+                break;
+            case SERIAL_IIR_LINE:
+                io_inb(SERIAL_PORT + SERIAL_REG_LSR);
+                break;
+            case SERIAL_IIR_MODEM:
+            default:
+                io_inb(SERIAL_PORT + SERIAL_REG_MSR);
+                break;
+        }
+    }
+}
+
+void serial_write(const char* s, size_t len) {
+    write_bytes(s, len, true);
+}
+
+void serial_write_raw(const void* data, size_t len) {
+    write_bytes(data, len, false);
+}
+
+void serial_putchar(char c) {
+    serial_write(&c, 1);
+}
+
+void serial_sprint(const char* s) {
+    serial_write(s, strlen(s));
+}
+
+void serial_flush(void) {
+    if (!serial_ok)
+        return;
+
+    const uint32_t eflags = irq_save();
+    tx_drain_polled();
+    irq_restore(eflags);
+
+    while (!(io_inb(SERIAL_PORT + SERIAL_REG_LSR) & SERIAL_LSR_TEMT))
+        ;
+}
+
+int serial_getchar(void) {
+    const uint32_t tail = rx_tail;
+    if (tail == __atomic_load_n(&rx_head, __ATOMIC_ACQUIRE))
+        return -1;
+
+    const unsigned char c = rx_ring[tail & (SERIAL_RX_SZ - 1)];
+    __atomic_store_n(&rx_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return c;
+}
+
+bool serial_rx_ready(void) {
+    return rx_tail != __atomic_load_n(&rx_head, __ATOMIC_ACQUIRE);
+}
+
+void serial_get_stats(SerialStats* out) {
+    const uint32_t eflags = irq_save();
+    *out                  = stats;
+    irq_restore(eflags);
+}
@@ -73,6 +73,9 @@ struc ctx_t
                                 ; address space/page directory)
     .state:     resd 1
     .name:      resd 1          ; char* to the task name
+    .rand:      resd 4          ; RandState, all zero until the first rand()
+    .wait_next: resd 1          ; Next task of the WaitQueue it's blocked in
+    .tty:       resd 1          ; Tty* of stdin, copied from the creator
 endstruc
 
 %endif ; STRUCTS_ASM
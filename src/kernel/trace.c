@@ -0,0 +1,273 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h> /* malloc, free, qsort, bsearch */
+#include <string.h> /* strlen */
+#include <kernel/trace.h>
+#include <kernel/ksyms.h>  /* ksyms_find */
+#include <kernel/serial.h> /* serial_write_raw */
+#include <kernel/tsc.h>    /* tsc_get_hz */
+#include <kernel/irq.h>    /* EFLAGS_IF */
+
+/* The hooks can't call instrumented functions, including the inline ones */
+#define NO_TRACE __attribute__((no_instrument_function))
+
+/* Without -finstrument-functions nothing adds events, so don't waste the
+ * memory */
+#ifdef CONFIG_TRACE
+#define RING_SZ TRACE_RING_SZ
+#else
+#define RING_SZ 1
+#endif
+
+/**
+ * @brief Bit of TraceEvent.tsc for the exit events.
+ */
+#define EVENT_EXIT (1ULL << 63)
+
+/**
+ * @brief Size of the buffer used for sending the dump.
+ */
+#define DUMP_BUF_SZ 256
+
+/**
+ * @brief Event of the ring.
+ */
+typedef struct {
+    uint64_t tsc; /**< @brief TSC of the event, and EVENT_EXIT */
+    uint32_t fn;  /**< @brief Address of the function */
+} __attribute__((packed)) TraceEvent;
+
+/**
+ * @brief Bytes waiting to be sent by trace_dump()
+ */
+typedef struct {
+    uint8_t data[DUMP_BUF_SZ];
+    size_t len;
+} dump_buf;
+
+static TraceEvent ring[RING_SZ];
+
+/**
+ * @brief Position of the next event. Only increments, the index of position
+ * `pos` is `pos % RING_SZ`.
+ */
+static volatile uint32_t ring_head = 0;
+
+/**
+ * @brief Trace the boot if the kernel was built for it. See trace.h
+ */
+static volatile bool running = (RING_SZ > 1);
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Add an event to the ring.
+ * @details Called from any function, including IRQ handlers, so it disables
+ * the interrupts itself.
+ * @param fn Address of the function.
+ * @param exit EVENT_EXIT or 0.
+ */
+static inline NO_TRACE void record(void* fn, uint64_t exit) {
+    if (!running)
+        return;
+
+    uint32_t eflags;
+    asm volatile("pushfd\n\t"
+                 "pop %0\n\t"
+                 "cli"
+                 : "=r"(eflags)
+                 :
+                 : "memory");
+
+    ring[ring_head++ & (RING_SZ - 1)] = (TraceEvent){
+        .tsc = __builtin_ia32_rdtsc() | exit,
+        .fn  = (uint32_t)fn,
+    };
+
+    if (eflags & EFLAGS_IF)
+        asm volatile("sti" : : : "memory");
+}
+
+/**
+ * @brief Send the bytes of a buffer and empty it.
+ * @param[inout] buf Target buffer.
+ */
+static void dump_flush(dump_buf* buf) {
+    serial_write_raw(buf->data, buf->len);
+    buf->len = 0;
+}
+
+/**
+ * @brief Add bytes to the buffer of the dump, sending it if it's full.
+ * @param[inout] buf Target buffer.
+ * @param[in] data Bytes to add.
+ * @param len Number of bytes, up to DUMP_BUF_SZ.
+ */
+static void dump_write(dump_buf* buf, const void* data, size_t len) {
+    if (buf->len + len > DUMP_BUF_SZ)
+        dump_flush(buf);
+
+    memcpy(&buf->data[buf->len], data, len);
+    buf->len += len;
+}
+
+/**
+ * @brief Add an integer to the dump in little endian.
+ * @param[inout] buf Target buffer.
+ * @param num Integer to add.
+ * @param sz Number of bytes of \p num to add.
+ */
+static void dump_int(dump_buf* buf, uint64_t num, size_t sz) {
+    uint8_t bytes[sizeof(uint64_t)];
+
+    for (size_t i = 0; i < sz; i++)
+        bytes[i] = (num >> (i * 8)) & 0xFF;
+
+    dump_write(buf, bytes, sz);
+}
+
+/**
+ * @brief Add an integer to the dump as ULEB128, 7 bits per byte.
+ * @param[inout] buf Target buffer.
+ * @param num Integer to add.
+ */
+static void dump_uleb(dump_buf* buf, uint64_t num) {
+    uint8_t bytes[10];
+    size_t len = 0;
+
+    do {
+        bytes[len] = num & 0x7F;
+        num >>= 7;
+        if (num != 0)
+            bytes[len] |= 0x80;
+        len++;
+    } while (num != 0);
+
+    dump_write(buf, bytes, len);
+}
+
+/**
+ * @brief Compare 2 function addresses, for qsort() and bsearch()
+ */
+static int cmp_addr(const void* a, const void* b) {
+    const uint32_t aa = *(const uint32_t*)a;
+    const uint32_t bb = *(const uint32_t*)b;
+    return (aa > bb) - (aa < bb);
+}
+
+/* -------------------------------------------------------------------------- */
+
+NO_TRACE void __cyg_profile_func_enter(void* fn, void* call_site) {
+    (void)call_site;
+    record(fn, 0);
+}
+
+NO_TRACE void __cyg_profile_func_exit(void* fn, void* call_site) {
+    (void)call_site;
+    record(fn, EVENT_EXIT);
+}
+
+bool trace_available(void) {
+    return RING_SZ > 1;
+}
+
+void trace_start(void) {
+    if (!trace_available())
+        return;
+
+    ring_head = 0;
+    running   = true;
+}
+
+void trace_stop(void) {
+    running = false;
+}
+
+bool trace_running(void) {
+    return running;
+}
+
+size_t trace_count(uint32_t* overwritten) {
+    const uint32_t head = ring_head;
+    const uint32_t n    = (head < RING_SZ) ? head : RING_SZ;
+
+    if (overwritten != NULL)
+        *overwritten = head - n;
+
+    return n;
+}
+
+bool trace_dump(void) {
+    trace_stop();
+
+    if (!serial_available())
+        return false;
+
+    const size_t n       = trace_count(NULL);
+    const uint32_t first = ring_head - n;
+
+    /* Different functions of the events, sorted */
+    uint32_t* fns = malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    if (fns == NULL)
+        return false;
+
+    for (size_t i = 0; i < n; i++)
+        fns[i] = ring[(first + i) & (RING_SZ - 1)].fn;
+
+    qsort(fns, n, sizeof(uint32_t), cmp_addr);
+
+    size_t nsyms = 0;
+    for (size_t i = 0; i < n; i++)
+        if (nsyms == 0 || fns[nsyms - 1] != fns[i])
+            fns[nsyms++] = fns[i];
+
+    const uint64_t start_tsc =
+      (n > 0) ? ring[first & (RING_SZ - 1)].tsc & ~EVENT_EXIT : 0;
+
+    static dump_buf buf;
+    buf.len = 0;
+
+    dump_write(&buf, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    dump_int(&buf, TRACE_VERSION, 1);
+    dump_int(&buf, tsc_get_hz(), 8);
+    dump_int(&buf, start_tsc, 8);
+    dump_int(&buf, nsyms, 4);
+    dump_int(&buf, n, 4);
+
+    for (size_t i = 0; i < nsyms; i++) {
+        const KSym* sym  = ksyms_find(fns[i]);
+        const char* name = (sym != NULL) ? sym->name : "";
+        size_t len       = strlen(name);
+        if (len > UINT8_MAX)
+            len = UINT8_MAX;
+
+        dump_int(&buf, fns[i], 4);
+        dump_int(&buf, len, 1);
+        dump_write(&buf, name, len);
+    }
+
+    uint64_t prev_tsc = start_tsc;
+    for (size_t i = 0; i < n; i++) {
+        const TraceEvent* ev = &ring[(first + i) & (RING_SZ - 1)];
+        const uint64_t tsc   = ev->tsc & ~EVENT_EXIT;
+        const uint32_t fn    = ev->fn;
+
+        /* Not expected, but a negative delta would break the encoding */
+        const uint64_t delta = (tsc > prev_tsc) ? tsc - prev_tsc : 0;
+        prev_tsc             = tsc;
+
+        const uint32_t* sym = bsearch(&fn, fns, nsyms, sizeof(uint32_t),
+                                      cmp_addr);
+
+        dump_uleb(&buf, (delta << 1) | ((ev->tsc & EVENT_EXIT) ? 1 : 0));
+        dump_uleb(&buf, sym - fns);
+    }
+
+    dump_write(&buf, TRACE_END_MAGIC, sizeof(TRACE_END_MAGIC));
+    dump_flush(&buf);
+
+    free(fns);
+    return true;
+}
@@ -0,0 +1,95 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/tracepoint.h>
+#include <kernel/irq.h> /* irq_save, irq_restore */
+#include <kernel/tsc.h> /* tsc_read */
+
+volatile uint32_t tp_enabled = 0;
+
+/**
+ * @brief Names of the tracepoints, indexed by tracepoint_ids.
+ */
+static const char* names[TP_COUNT] = {
+    [TP_MT_SWITCH]  = "mt_switch",
+    [TP_IRQ_ENTRY]  = "irq_entry",
+    [TP_IRQ_EXIT]   = "irq_exit",
+    [TP_HEAP_ALLOC] = "heap_alloc",
+    [TP_HEAP_FREE]  = "heap_free",
+    [TP_FBC_SHIFT]  = "fbc_shift_rows",
+    [TP_KB_EVENT]   = "kb_event",
+};
+
+static TpEvent ring[TP_RING_SZ];
+
+/**
+ * @brief Position of the next event. Only increments, the index of position
+ * `pos` is `pos % TP_RING_SZ`. Only changed with the interrupts disabled.
+ */
+static volatile uint32_t ring_head = 0;
+
+/**
+ * @brief Position of the oldest event that was not cleared by tp_clear()
+ */
+static volatile uint32_t ring_start = 0;
+
+/* -------------------------------------------------------------------------- */
+
+void tp_record(uint32_t id, uint32_t arg0, uint32_t arg1) {
+    const uint32_t eflags = irq_save();
+
+    ring[ring_head++ & (TP_RING_SZ - 1)] = (TpEvent){
+        .tsc  = tsc_read(),
+        .arg0 = arg0,
+        .arg1 = arg1,
+        .id   = id,
+    };
+
+    irq_restore(eflags);
+}
+
+void tp_enable(uint8_t id, bool on) {
+    if (id >= TP_COUNT)
+        return;
+
+    if (on)
+        __atomic_or_fetch(&tp_enabled, 1u << id, __ATOMIC_RELAXED);
+    else
+        __atomic_and_fetch(&tp_enabled, ~(1u << id), __ATOMIC_RELAXED);
+}
+
+const char* tp_name(uint8_t id) {
+    return (id < TP_COUNT) ? names[id] : NULL;
+}
+
+size_t tp_read(TpEvent* out, size_t max, uint32_t* lost) {
+    const uint32_t eflags = irq_save();
+
+    /* Oldest event still in the ring */
+    uint32_t first = ring_start;
+    if (ring_head - first > TP_RING_SZ)
+        first = ring_head - TP_RING_SZ;
+
+    if (lost != NULL)
+        *lost = first - ring_start;
+
+    /* Only the last ones */
+    size_t n = ring_head - first;
+    if (n > max) {
+        first += n - max;
+        n = max;
+    }
+
+    for (size_t i = 0; i < n; i++)
+        out[i] = ring[(first + i) & (TP_RING_SZ - 1)];
+
+    irq_restore(eflags);
+    return n;
+}
+
+void tp_clear(void) {
+    const uint32_t eflags = irq_save();
+    ring_start            = ring_head;
+    irq_restore(eflags);
+}
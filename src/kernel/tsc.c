@@ -0,0 +1,40 @@
+
+#include <stdint.h>
+#include <kernel/tsc.h>
+#include <kernel/pit.h>
+
+/**
+ * @brief Frequency of the TSC in Hz. Set by tsc_calibrate()
+ */
+static uint64_t tsc_hz = 0;
+
+void tsc_calibrate(void) {
+    /* Wait for the start of a tick, so we measure whole ticks */
+    uint64_t start_tick = pit_get_ticks();
+    while (pit_get_ticks() == start_tick)
+        ;
+
+    start_tick               = pit_get_ticks();
+    const uint64_t start_tsc = tsc_read();
+
+    while (pit_get_ticks() < start_tick + TSC_CALIBRATE_MS)
+        ;
+
+    const uint64_t end_tsc = tsc_read();
+
+    /* Each tick is 1ms, see pit_init() call in kernel_main() */
+    tsc_hz = (end_tsc - start_tsc) * (1000 / TSC_CALIBRATE_MS);
+}
+
+uint64_t tsc_get_hz(void) {
+    return tsc_hz;
+}
+
+uint64_t tsc_to_us(uint64_t cycles) {
+    if (tsc_hz < 1000000)
+        return 0;
+
+    /* Dividing the frequency first is less precise, but we avoid overflowing
+     * for long durations */
+    return cycles / (tsc_hz / 1000000);
+}
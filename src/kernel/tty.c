@@ -0,0 +1,323 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h> /* putchar, EOF */
+#include <kernel/tty.h>
+#include <kernel/poll.h>
+#include <kernel/keyboard.h> /* kb_latency_add, kb_echo_done */
+#include <kernel/vt.h>
+#include <kernel/framebuffer_console.h>
+#include <kernel/multitask.h>
+#include <kernel/pit.h> /* pit_get_ticks */
+#include <kernel/irq.h> /* irq_save, irq_restore */
+#include <kernel/log.h> /* log_write */
+#include <kernel/tsc.h> /* tsc_read */
+
+/**
+ * @brief Line moved to the buffer of tty_read(), for the KB_LAT_READ latency.
+ */
+typedef struct {
+    uint32_t pos; /**< @brief Position of the first char in the ring */
+    uint64_t tsc; /**< @brief TSC of the IRQ that moved it to the ring */
+} tty_stamp;
+
+/**
+ * @struct Tty
+ * @brief Terminal of a virtual terminal.
+ */
+struct Tty {
+    /** @brief Virtual terminal of the terminal, where we echo */
+    uint8_t vt;
+
+    /** @brief Settings, see tty_set_mode() */
+    TtyMode mode;
+
+    /** @name Chars ready for tty_read()
+     * @details Lock-free ring with a single producer, tty_input(), and a
+     * single consumer, the reader. The positions only increment, the index of
+     * position `pos` is `pos % TTY_BUF_SZ`.
+     * @{ */
+    uint8_t ring[TTY_BUF_SZ];
+    volatile uint32_t ring_head; /**< @brief Only written by tty_input() */
+    volatile uint32_t ring_tail; /**< @brief Only written by tty_read() */
+    /** @} */
+
+    /** @brief Line being edited, moved to the ring on '\n'. Only used by
+     * tty_input() */
+    uint8_t line[TTY_LINE_SZ];
+    uint16_t line_len;
+
+    /** @name Stamps of the lines in the ring
+     * @details Same kind of ring as the chars, written before them. If it's
+     * full, the stamp is dropped and that line is not measured.
+     * @{ */
+    tty_stamp stamps[TTY_STAMP_RING_SZ];
+    volatile uint32_t stamps_head; /**< @brief Only written by tty_input() */
+    volatile uint32_t stamps_tail; /**< @brief Only written by tty_read() */
+    /** @} */
+
+    /** @brief Chars dropped because the ring or the line were full */
+    uint32_t dropped;
+};
+
+/**
+ * @brief Terminal of each virtual terminal. Initialized by tty_init()
+ */
+static Tty ttys[VT_COUNT];
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Print a char in the virtual terminal of a terminal, and measure its
+ * KB_LAT_ECHO latency.
+ * @details The task that was interrupted might be using the context of another
+ * virtual terminal.
+ * @param[in] tty Target terminal
+ * @param c Char to print
+ * @param tsc TSC of the keyboard IRQ
+ */
+static void echo_char(const Tty* tty, char c, uint64_t tsc) {
+    fbc_ctx* const old_ctx = fbc_get_ctx();
+
+    fbc_change_ctx(fbc_get_vt_ctx(tty->vt));
+    putchar(c);
+    fbc_change_ctx(old_ctx);
+
+    kb_echo_done(tsc);
+}
+
+/**
+ * @brief Move the chars of the edited line to the ring, and wake the readers.
+ * @details The line is dropped if it doesn't fit, so tty_read() never returns
+ * part of a line.
+ * @param[inout] tty Target terminal
+ * @param tsc TSC of the keyboard IRQ, for the KB_LAT_READ latency
+ */
+static void commit_line(Tty* tty, uint64_t tsc) {
+    const uint32_t head = tty->ring_head;
+    const uint32_t tail = __atomic_load_n(&tty->ring_tail, __ATOMIC_ACQUIRE);
+
+    if (TTY_BUF_SZ - (head - tail) < tty->line_len) {
+        log_write(LOG_WARN, "tty%d: input buffer full, dropped %d chars",
+                  tty->vt, tty->line_len);
+        tty->dropped += tty->line_len;
+        tty->line_len = 0;
+        return;
+    }
+
+    /* The stamp is published first, so tty_read() can't read the line before
+     * it */
+    const uint32_t stamp = tty->stamps_head;
+    if (stamp - __atomic_load_n(&tty->stamps_tail, __ATOMIC_ACQUIRE) <
+        TTY_STAMP_RING_SZ) {
+        tty->stamps[stamp & (TTY_STAMP_RING_SZ - 1)] = (tty_stamp){
+            .pos = head,
+            .tsc = tsc,
+        };
+        __atomic_store_n(&tty->stamps_head, stamp + 1, __ATOMIC_RELEASE);
+    }
+
+    for (uint16_t i = 0; i < tty->line_len; i++)
+        tty->ring[(head + i) & (TTY_BUF_SZ - 1)] = tty->line[i];
+
+    /* Publish the chars after writing them */
+    __atomic_store_n(&tty->ring_head, head + tty->line_len, __ATOMIC_RELEASE);
+    tty->line_len = 0;
+
+    poll_notify();
+}
+
+/**
+ * @brief Add the KB_LAT_READ latency of a char read by tty_read(), if it's the
+ * first of a line.
+ * @param[inout] tty Target terminal
+ * @param pos Position of the char in the ring
+ */
+static void check_stamp(Tty* tty, uint32_t pos) {
+    const uint32_t tail = tty->stamps_tail;
+    if (tail == __atomic_load_n(&tty->stamps_head, __ATOMIC_ACQUIRE))
+        return;
+
+    const tty_stamp* stamp = &tty->stamps[tail & (TTY_STAMP_RING_SZ - 1)];
+    if (stamp->pos != pos)
+        return;
+
+    kb_latency_add(KB_LAT_READ, tsc_read() - stamp->tsc);
+    __atomic_store_n(&tty->stamps_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Condition of poll_wait() in tty_read()
+ * @param[in] arg Target terminal
+ * @return True if the ring is not empty
+ */
+static bool ring_ready(const void* arg) {
+    return tty_readable(arg);
+}
+
+/**
+ * @brief Move the chars that are ready from the ring to a buffer.
+ * @details In canonical mode, stops after the first '\n'.
+ * @param[inout] tty Target terminal
+ * @param[out] buf Where to store the chars
+ * @param sz Max number of chars
+ * @return Number of chars moved.
+ */
+static size_t read_ready(Tty* tty, char* buf, size_t sz) {
+    const bool canonical = tty->mode.lflag & TTY_ICANON;
+    const uint32_t head  = __atomic_load_n(&tty->ring_head, __ATOMIC_ACQUIRE);
+    uint32_t tail        = tty->ring_tail;
+
+    size_t i = 0;
+    while (i < sz && tail != head) {
+        const char c = tty->ring[tail & (TTY_BUF_SZ - 1)];
+        check_stamp(tty, tail);
+
+        buf[i++] = c;
+        tail++;
+
+        if (canonical && c == '\n')
+            break;
+    }
+
+    /* Free the slots after reading them */
+    __atomic_store_n(&tty->ring_tail, tail, __ATOMIC_RELEASE);
+
+    return i;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void tty_init(void) {
+    for (uint8_t vt = 0; vt < VT_COUNT; vt++) {
+        Tty* const tty = &ttys[vt];
+
+        tty->vt          = vt;
+        tty->mode        = (TtyMode){ TTY_ICANON | TTY_ECHO, 1, 0 };
+        tty->ring_head   = 0;
+        tty->ring_tail   = 0;
+        tty->line_len    = 0;
+        tty->stamps_head = 0;
+        tty->stamps_tail = 0;
+        tty->dropped     = 0;
+    }
+}
+
+Tty* tty_get(uint8_t vt) {
+    return (vt < VT_COUNT) ? &ttys[vt] : NULL;
+}
+
+Tty* tty_stdin(void) {
+    Tty* const tty = mt_gettask()->tty;
+    return (tty != NULL) ? tty : &ttys[vt_current()];
+}
+
+void tty_get_mode(const Tty* tty, TtyMode* out) {
+    *out = tty->mode;
+}
+
+void tty_set_mode(Tty* tty, const TtyMode* mode) {
+    const uint32_t eflags = irq_save();
+
+    /* The chars typed so far are readable in raw mode */
+    if ((tty->mode.lflag & TTY_ICANON) && !(mode->lflag & TTY_ICANON) &&
+        tty->line_len > 0)
+        commit_line(tty, tsc_read());
+
+    tty->mode = *mode;
+
+    irq_restore(eflags);
+}
+
+void tty_flush(Tty* tty) {
+    const uint32_t eflags = irq_save();
+
+    tty->line_len = 0;
+    __atomic_store_n(&tty->stamps_tail, tty->stamps_head, __ATOMIC_RELEASE);
+    __atomic_store_n(&tty->ring_tail, tty->ring_head, __ATOMIC_RELEASE);
+
+    irq_restore(eflags);
+}
+
+bool tty_readable(const Tty* tty) {
+    return __atomic_load_n(&tty->ring_head, __ATOMIC_ACQUIRE) !=
+           tty->ring_tail;
+}
+
+size_t tty_read(Tty* tty, char* buf, size_t sz) {
+    if (sz == 0)
+        return 0;
+
+    const TtyMode mode = tty->mode;
+
+    /* Block until there is a line, or until the first char */
+    if ((mode.lflag & TTY_ICANON) || mode.vmin > 0)
+        poll_wait(ring_ready, tty, POLL_FOREVER);
+    else if (mode.vtime > 0)
+        poll_wait(ring_ready, tty, pit_get_ticks() + mode.vtime * 100);
+
+    size_t ret = read_ready(tty, buf, sz);
+    if ((mode.lflag & TTY_ICANON) || mode.vmin == 0)
+        return ret;
+
+    /* Wait for the rest of VMIN. With VTIME, the timer restarts with each
+     * char */
+    const size_t want = (mode.vmin < sz) ? mode.vmin : sz;
+    while (ret < want) {
+        const uint64_t deadline = (mode.vtime > 0)
+                                    ? pit_get_ticks() + mode.vtime * 100
+                                    : POLL_FOREVER;
+        if (!poll_wait(ring_ready, tty, deadline))
+            break;
+
+        ret += read_ready(tty, &buf[ret], sz - ret);
+    }
+
+    return ret;
+}
+
+int tty_getchar(Tty* tty) {
+    char c;
+    if (tty_read(tty, &c, 1) == 0)
+        return EOF;
+
+    return (unsigned char)c;
+}
+
+void tty_input(Tty* tty, char c, uint64_t tsc) {
+    /* In raw mode, each char is a line */
+    if (!(tty->mode.lflag & TTY_ICANON)) {
+        tty->line[0]  = c;
+        tty->line_len = 1;
+        commit_line(tty, tsc);
+
+        if (tty->mode.lflag & TTY_ECHO)
+            echo_char(tty, c, tsc);
+
+        return;
+    }
+
+    if (c == '\b') {
+        /* Delete the last char and print '\b', only if we have something to
+         * delete */
+        if (tty->line_len > 0) {
+            tty->line_len--;
+            echo_char(tty, c, tsc);
+        }
+    } else if (c != '\n' && tty->line_len >= TTY_LINE_SZ - 1) {
+        /* Keep the last slot for the '\n' */
+        tty->dropped++;
+    } else {
+        tty->line[tty->line_len++] = c;
+
+        /* If the char we just saved is '\n', the user is done with the input
+         * line so we can send it to tty_read(). The '\n' is always printed */
+        if (c == '\n') {
+            commit_line(tty, tsc);
+            echo_char(tty, c, tsc);
+        } else if (tty->mode.lflag & TTY_ECHO) {
+            echo_char(tty, c, tsc);
+        }
+    }
+}
@@ -1,6 +1,8 @@
 
+#include <stdbool.h>
 #include <string.h>
 #include <kernel/vga.h>
+#include <kernel/io.h>
 
 const size_t VGA_WIDTH  = 80;
 const size_t VGA_HEIGHT = 25;
@@ -93,3 +95,6 @@ void vga_sprint(const char* s) {
     vga_write(s, strlen(s));
 }
 
+bool vga_in_retrace(void) {
+    return io_inb(VGA_PORT_INPUT_STATUS) & VGA_STATUS_VRETRACE;
+}
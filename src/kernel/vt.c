@@ -0,0 +1,111 @@
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdio.h> /* snprintf */
+#include <kernel/vt.h>
+#include <kernel/framebuffer_console.h>
+#include <kernel/multitask.h>
+#include <kernel/log.h> /* log_drain */
+#include <kernel/tty.h> /* tty_get */
+
+/**
+ * @brief Contexts allocated by vt_init() for each virtual terminal.
+ * @details The first one is the context we were using when calling vt_init()
+ */
+static fbc_ctx* vt_ctxs[VT_COUNT] = { NULL };
+
+/**
+ * @brief Shell task of each virtual terminal.
+ * @details The first one is the task that called vt_init()
+ */
+static Ctx* vt_tasks[VT_COUNT] = { NULL };
+
+/**
+ * @brief Entry point of the virtual terminal tasks, set by vt_init()
+ */
+static int (*vt_shell)(void) = NULL;
+
+/**
+ * @brief Names of the tasks created by vt_init(), "vt" and their index.
+ * @details The tasks keep a pointer to their name, so they can't be local.
+ */
+static char vt_task_names[VT_COUNT][8];
+
+/**
+ * @brief Entry point of the tasks created by vt_init()
+ * @details Tasks don't get arguments, so we look for the current task in the
+ * vt_tasks array.
+ */
+static void vt_task(void) {
+    Ctx* const self = mt_gettask();
+
+    uint8_t vt = 0;
+    while (vt < VT_COUNT && vt_tasks[vt] != self)
+        vt++;
+
+    fbc_change_ctx(vt_ctxs[vt]);
+    vt_shell();
+
+    /* Tasks can't return, just let the rest of the terminals run */
+    for (;;)
+        vt_yield();
+}
+
+/* -------------------------------------------------------------------------- */
+
+void vt_init(int (*shell)(void)) {
+    fbc_ctx* const cur = fbc_get_ctx();
+
+    vt_shell    = shell;
+    vt_ctxs[0]  = cur;
+    vt_tasks[0] = mt_gettask();
+
+    vt_tasks[0]->tty = tty_get(0);
+
+    for (uint8_t i = 1; i < VT_COUNT; i++) {
+        vt_ctxs[i] = malloc(sizeof(fbc_ctx));
+        fbc_init_ctx(vt_ctxs[i], cur->y, cur->x, cur->h, cur->w, cur->font,
+                     FBC_SCROLLBACK_ROWS, i);
+
+        /* Make it the top context of the virtual terminal before the task
+         * runs, in case we switch to it */
+        fbc_change_ctx(vt_ctxs[i]);
+
+        snprintf(vt_task_names[i], sizeof(vt_task_names[i]), "vt%d", i);
+        vt_tasks[i]      = mt_newtask(vt_task_names[i], (void*)vt_task);
+        vt_tasks[i]->tty = tty_get(i);
+    }
+
+    fbc_change_ctx(cur);
+}
+
+void vt_switch(uint8_t vt) {
+    if (vt >= VT_COUNT || vt_ctxs[vt] == NULL || vt == fbc_shown_vt())
+        return;
+
+    fbc_show_vt(vt);
+}
+
+uint8_t vt_active(void) {
+    return fbc_shown_vt();
+}
+
+uint8_t vt_current(void) {
+    return fbc_get_ctx()->vt;
+}
+
+void vt_yield(void) {
+    fbc_ctx* const cur = fbc_get_ctx();
+
+    /* The kernel messages are printed in the first virtual terminal, while
+     * it's idle. Only on its base console: the curses windows also belong to
+     * the first terminal, and the messages would be drawn over them */
+    if (cur == vt_ctxs[0])
+        log_drain();
+
+    /* Skips the tasks blocked in a WaitQueue */
+    mt_yield();
+
+    /* The task we switched to might have changed the context */
+    fbc_change_ctx(cur);
+}
@@ -0,0 +1,48 @@
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/waitqueue.h>
+#include <kernel/multitask.h>
+#include <kernel/irq.h>
+#include <kernel/vt.h> /* vt_yield */
+
+void wq_wait(WaitQueue* wq, wq_cond_t cond, const void* arg) {
+    Ctx* const self = mt_gettask();
+
+    for (;;) {
+        const uint32_t eflags = irq_save();
+
+        if (cond(arg)) {
+            irq_restore(eflags);
+            return;
+        }
+
+        self->state     = TASK_BLOCKED;
+        self->wait_next = wq->head;
+        wq->head        = self;
+
+        irq_restore(eflags);
+
+        /* If we were woken after enabling the interrupts, we are ready again
+         * and this just lets the other tasks run once */
+        vt_yield();
+    }
+}
+
+void wq_wake_all(WaitQueue* wq) {
+    const uint32_t eflags = irq_save();
+
+    Ctx* task = wq->head;
+    wq->head  = NULL;
+
+    while (task != NULL) {
+        Ctx* const next = task->wait_next;
+
+        task->wait_next = NULL;
+        task->state     = TASK_READY;
+
+        task = next;
+    }
+
+    irq_restore(eflags);
+}
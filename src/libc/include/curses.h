@@ -9,7 +9,6 @@
  *  - mvwaddch  (move & window putchar)
  *
  * Error:
- *  - keypad    (arrow keys, numpad)
  *  - mousemask (cursor)
  *  - getmouse
  *
@@ -23,6 +22,7 @@
 #include <stdbool.h>
 #include <kernel/color.h>
 #include <kernel/framebuffer_console.h>
+#include <kernel/tty.h> /* TtyMode */
 
 #undef ERR
 #define ERR (-1)
@@ -30,6 +30,22 @@
 #undef OK
 #define OK (0)
 
+/**
+ * @name Keys returned by getch() after keypad()
+ * @details Same values as ncurses.
+ * @{ */
+#define KEY_DOWN  0402 /**< @brief Down arrow */
+#define KEY_UP    0403 /**< @brief Up arrow */
+#define KEY_LEFT  0404 /**< @brief Left arrow */
+#define KEY_RIGHT 0405 /**< @brief Right arrow */
+#define KEY_HOME  0406 /**< @brief Home */
+#define KEY_DC    0512 /**< @brief Delete */
+#define KEY_IC    0513 /**< @brief Insert */
+#define KEY_NPAGE 0522 /**< @brief Page down */
+#define KEY_PPAGE 0523 /**< @brief Page up */
+#define KEY_END   0550 /**< @brief End */
+/** @} */
+
 /**
  * @def CURSES_MAX_PAIRS
  * @brief Maximum color pairs that a WINDOW can support after calling
@@ -47,6 +63,9 @@ typedef struct {
     fbc_ctx* old_ctx;  /**< @brief Last ctx */
     fbc_ctx* ctx;      /**< @brief Framebuffer console context */
     color_pair* pairs; /**< @brief Array of color pairs */
+    bool keypad;       /**< @brief Set by keypad() */
+    int delay;         /**< @brief Set by timeout(), -1 for blocking */
+    TtyMode old_mode;  /**< @brief Mode of stdin, restored by endwin() */
 } WINDOW;
 
 #if defined(_IN_CURSES_LIB) /* We included from curses.c */
@@ -80,7 +99,9 @@ WINDOW* initscr(void);
 
 /**
  * @brief End curses window.
- * @details Switch to the old fbc context and free the allocated window.
+ * @details Switch to the old fbc context and free the allocated window. The
+ * mode of stdin is restored to the one before initscr(), and the input that
+ * was not read is discarded.
  * @return OK if success, ERR otherwise.
  */
 int endwin(void);
@@ -110,6 +131,34 @@ int echo(void);
  */
 int noecho(void);
 
+/**
+ * @brief Enable or disable the special keys in getch(), like the arrows.
+ * @details With the keypad enabled, getch() reads key events instead of the
+ * chars of the line buffer, and returns each key as soon as it's pressed, like
+ * in raw(). Ctrl+letter returns the control char, like 3 for Ctrl+C.
+ * @param[out] win Window, only stdscr is supported.
+ * @param bf True for enabling the keypad.
+ * @return OK if success, ERR otherwise.
+ */
+int keypad(WINDOW* win, bool bf);
+
+/**
+ * @brief Set how long getch() waits for input.
+ * @details The task is blocked while waiting, other tasks can run.
+ * @param delay Milliseconds. Negative values block until there is input, and 0
+ * doesn't wait.
+ */
+void timeout(int delay);
+
+/**
+ * @brief Make getch() return ERR instead of blocking if there is no input.
+ * @details Same as `timeout(0)` or `timeout(-1)`.
+ * @param[out] win Window, only stdscr is supported.
+ * @param bf True for not blocking.
+ * @return OK if success, ERR otherwise.
+ */
+int nodelay(WINDOW* win, bool bf);
+
 /**
  * @brief refreshes the current WINDOW (fbc context).
  * @return OK if success, ERR otherwise.
@@ -206,7 +255,9 @@ int wclrtoeol(WINDOW* win);
 
 /**
  * @brief Get character from user input.
- * @return OK if success, ERR otherwise.
+ * @details After keypad(), it can also return the KEY_* values. Waits as
+ * specified with timeout()
+ * @return The char or key, or ERR if there was no input in time.
  */
 int getch(void);
 
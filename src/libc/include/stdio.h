@@ -3,6 +3,7 @@
 #define _STDIO_H
 
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 
 /**
@@ -31,6 +32,24 @@ typedef uint32_t FILE;
 #define stderr (FILE*)2 /**< @brief Standard error */
 /** @} */
 
+/**
+ * @brief Output function of vfctprintf().
+ * @param[inout] arg Argument passed to vfctprintf().
+ * @param[in] s Formatted chars, not zero-terminated.
+ * @param len Number of chars in \p s.
+ */
+typedef void (*printf_cb)(void* arg, const char* s, size_t len);
+
+/**
+ * @enum stdio_sinks
+ * @brief Devices where `stdout` and `stderr` are written. See
+ * stdio_set_sinks().
+ */
+enum stdio_sinks {
+    STDIO_SINK_CONSOLE = 0x1, /**< @brief Framebuffer or VGA console */
+    STDIO_SINK_SERIAL  = 0x2, /**< @brief Serial port, see kernel/serial.h */
+};
+
 /**
  * @brief Prints with the specified format using the specified variable argument
  * list.
@@ -48,6 +67,8 @@ typedef uint32_t FILE;
  *   - "%25u", "%25lu", "%25llu"
  *   - "%25f", "%25lf", "%.3f", "%25.3f"
  *   - "%25x", "%25lx", "%25llx", "%25X", "%25lX", "%25llX"
+ *   - "%-25s", "%-25d", ... Pad on the right.
+ *   - "%025d", "%08x", "%08.3f", ... Pad numbers with zeros after the sign.
  *
  * @param[in] fmt Format string.
  * @param[in] va Variable argument list.
@@ -55,6 +76,64 @@ typedef uint32_t FILE;
  */
 int vprintf(const char* fmt, va_list va);
 
+/**
+ * @brief Format into a buffer of \p sz chars using the specified variable
+ * argument list.
+ * @details The chars that don't fit are dropped. The result is always
+ * zero-terminated, unless \p sz is 0. See vprintf() for the formats.
+ * @param[out] str Output buffer.
+ * @param sz Size of \p str, including the '\0'.
+ * @param[in] fmt Format string.
+ * @param[in] va Variable argument list.
+ * @return Length of the full formatted string, without the '\0'. The output
+ * was truncated if it's \p sz or more.
+ */
+int vsnprintf(char* str, size_t sz, const char* fmt, va_list va);
+
+/**
+ * @brief Format into a buffer of \p sz chars. See vsnprintf().
+ * @param[out] str Output buffer.
+ * @param sz Size of \p str, including the '\0'.
+ * @param[in] fmt Format string.
+ * @return Length of the full formatted string, without the '\0'.
+ */
+int snprintf(char* str, size_t sz, const char* fmt, ...)
+  __attribute__((format(printf, 3, 4)));
+
+/**
+ * @brief Format into a buffer without checking its size.
+ * @details Prefer snprintf().
+ * @param[out] str Output buffer, big enough for the result and the '\0'.
+ * @param[in] fmt Format string.
+ * @return Length of the formatted string, without the '\0'.
+ */
+int sprintf(char* str, const char* fmt, ...)
+  __attribute__((format(printf, 2, 3)));
+
+/**
+ * @brief Format with the specified variable argument list and pass the result
+ * to \p out.
+ * @details The chars are formatted into a small stack buffer, and \p out is
+ * called each time it's full and at the end, so most calls only call \p out
+ * once. Used for writing to devices or logs without going char by char.
+ * @param[in] out Output function.
+ * @param[inout] arg First argument of \p out.
+ * @param[in] fmt Format string.
+ * @param[in] va Variable argument list.
+ * @return Bytes written.
+ */
+int vfctprintf(printf_cb out, void* arg, const char* fmt, va_list va);
+
+/**
+ * @brief Format and pass the result to \p out. See vfctprintf().
+ * @param[in] out Output function.
+ * @param[inout] arg First argument of \p out.
+ * @param[in] fmt Format string.
+ * @return Bytes written.
+ */
+int fctprintf(printf_cb out, void* arg, const char* fmt, ...)
+  __attribute__((format(printf, 3, 4)));
+
 /**
  * @brief Prints the specified string and a newline char.
  * @param[in] str Zero-terminated string to print.
@@ -65,8 +144,8 @@ int puts(const char* str);
 
 /**
  * @brief Write to the specified stream with the specified format.
- * @details For now, only `stdin` and `stdout` are supported, and the change is
- * just visual.
+ * @details Only `stdout` and `stderr` are supported. Each one is written to
+ * its sinks, see stdio_set_sinks(), and `stderr` is red in the console.
  * @param[out] stream Stream for writing.
  * @param[in] fmt Format string.
  * @return Bytes written.
@@ -77,8 +156,7 @@ int fprintf(FILE* stream, const char* fmt, ...)
 /**
  * @brief Write to the specified stream with the specified format using the
  * specified variable argument list.
- * @details For now, only `stdin` and `stdout` are supported, and the change is
- * just visual.
+ * @details See fprintf().
  * @param[out] stream Stream for writing.
  * @param[in] fmt Format string.
  * @param[in] va Variable argument list.
@@ -86,6 +164,23 @@ int fprintf(FILE* stream, const char* fmt, ...)
  */
 int vfprintf(FILE* stream, const char* fmt, va_list va);
 
+/**
+ * @brief Select the devices where a stream is written.
+ * @details By default, `stdout` and `stderr` go to the console. The serial
+ * port is useful for capturing the output with QEMU's `-serial stdio`.
+ * @param[in] stream `stdout` or `stderr`.
+ * @param sinks Bitwise OR of stdio_sinks, or 0 for discarding the output.
+ * @return Old sinks of the stream, or -1 if the stream is not supported.
+ */
+int stdio_set_sinks(FILE* stream, int sinks);
+
+/**
+ * @brief Get the devices where a stream is written.
+ * @param[in] stream `stdout` or `stderr`.
+ * @return Bitwise OR of stdio_sinks, or -1 if the stream is not supported.
+ */
+int stdio_get_sinks(FILE* stream);
+
 /**
  * @brief Prints with the specified format.
  * @param[in] fmt Format string.
@@ -102,8 +197,8 @@ int putchar(int c);
 
 /**
  * @brief Get the next char from the user input.
- * @details Wrapper for kb_getchar(). See kb_getchar() function for more
- * information.
+ * @details Reads from the stdin of the task. See tty_getchar() and
+ * tty_read() for more information.
  * @return Next character from user input.
  */
 int getchar(void);
@@ -7,6 +7,14 @@
 
 #define RAND_MAX 32768
 
+/**
+ * @brief State of a xoshiro128** pseudo-random generator.
+ * @details Seed with rand_seed(). Must not be all zero.
+ */
+typedef struct {
+    uint32_t s[4];
+} RandState;
+
 /**
  * @def panic_line
  * @brief Macro for calling panic() using the current function and line in the
@@ -105,14 +113,85 @@ void free(void* ptr);
 
 /**
  * @brief Generate a pseudo-random number from 0 to RAND_MAX.
+ * @details Uses the generator of the current task, see rand_u32().
  * @return Pseudo-random integer.
  */
 int rand(void);
 
 /**
  * @brief Set the rand seed.
+ * @details Seeds the generator of the current task, for repeating a sequence.
+ * Only \p seed is used, not the hardware generator.
  * @param[in] seed New rand seed.
  */
 void srand(unsigned int seed);
 
+/**
+ * @brief Initialize a generator from a 64 bit seed.
+ * @param[out] st Generator to seed.
+ * @param seed Any value, including 0.
+ */
+void rand_seed(RandState* st, uint64_t seed);
+
+/**
+ * @brief Get the next 32 random bits of a generator.
+ * @param[inout] st Generator seeded with rand_seed().
+ * @return Pseudo-random integer.
+ */
+uint32_t rand_next(RandState* st);
+
+/**
+ * @brief Get 32 random bits from the generator of the current task.
+ * @details In the kernel each task has its own generator, seeded with the
+ * hardware generator and the TSC on the first use. In libc there is one
+ * generator, seeded as if srand(1) was called.
+ * @return Pseudo-random integer.
+ */
+uint32_t rand_u32(void);
+
+/**
+ * @brief Get a random number from 0 to \p n (not included) without the bias
+ * of `rand() % n`.
+ * @param n Number of possible values. Returns 0 if it's 0.
+ * @return Pseudo-random integer lower than \p n.
+ */
+uint32_t rand_range(uint32_t n);
+
+/**
+ * @brief Fill a buffer with random bytes from the generator of the current
+ * task.
+ * @details Much faster than calling rand() for each byte, 4 bytes per step of
+ * the generator.
+ * @param[out] buf Buffer to fill.
+ * @param sz Size of \p buf in bytes.
+ */
+void rand_fill(void* buf, size_t sz);
+
+/**
+ * @brief Sort an array.
+ * @details Quicksort with a median of 3 pivot, and insertion sort for the
+ * small ranges. Not stable. Doesn't allocate, and uses O(log n) stack.
+ * @param[inout] base Array to sort.
+ * @param n Number of items.
+ * @param sz Size of each item in bytes.
+ * @param[in] cmp Comparison function. Returns less than, equal to or greater
+ * than 0 if the first item goes before, is equal to or goes after the second
+ * one.
+ */
+void qsort(void* base, size_t n, size_t sz,
+           int (*cmp)(const void*, const void*));
+
+/**
+ * @brief Search an item in a sorted array.
+ * @param[in] key Item to search. First argument of \p cmp.
+ * @param[in] base Array sorted with the same order as \p cmp.
+ * @param n Number of items.
+ * @param sz Size of each item in bytes.
+ * @param[in] cmp Comparison function, see qsort(). The second argument is an
+ * item of the array.
+ * @return Pointer to a matching item, or NULL if there isn't one.
+ */
+void* bsearch(const void* key, const void* base, size_t n, size_t sz,
+              int (*cmp)(const void*, const void*));
+
 #endif /* _STDLIB_H */
@@ -51,6 +51,15 @@ void* memset(void* ptr, int val, size_t sz) __attribute__((nonnull));
 void* memcpy(void* restrict dst, const void* restrict src, size_t sz)
   __attribute__((nonnull));
 
+/**
+ * @brief Copy `sz` bytes of `src` into `dst`. The regions can overlap.
+ * @param[out] dst Destination address.
+ * @param[in] src Source address.
+ * @param[in] sz Number of bytes to copy from `src` to `dst`.
+ * @return The `dst` argument.
+ */
+void* memmove(void* dst, const void* src, size_t sz) __attribute__((nonnull));
+
 /**
  * @brief Compare 2 strings.
  * @param[in] a First string to compare.
@@ -4,6 +4,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 
+/**
+ * @brief 32 bit integer that can alias other types, for reading and writing
+ * 4 bytes at a time.
+ */
+typedef uint32_t __attribute__((may_alias)) u32_alias;
+
 int digits_int(int64_t num) {
     int ret = 1;
 
@@ -171,16 +177,256 @@ void free(void* ptr) {
 }
 
 /**
- * @var rand_next
- * @brief Used by the rand and srand functions
+ * @brief Generator of the process.
+ */
+static RandState state;
+
+/**
+ * @brief Get the generator, seeding it on the first use.
+ * @details Seeded as if srand(1) was called, like the standard says.
+ * @return Generator of the process
+ */
+static RandState* cur_state(void) {
+    if ((state.s[0] | state.s[1] | state.s[2] | state.s[3]) == 0)
+        rand_seed(&state, 1);
+
+    return &state;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Step of SplitMix64, used for expanding the seeds.
+ * @param[inout] x State of SplitMix64
+ * @return Next output
+ */
+static inline uint64_t splitmix64(uint64_t* x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z          = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z          = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline uint32_t rotl32(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+/**
+ * @brief Step of xoshiro128**.
+ * @details Only 32 bit operations, so it's a few instructions on i686. See:
+ * https://prng.di.unimi.it/
+ * @param[inout] s State of the generator, not all zero
+ * @return Next output
  */
-static uint32_t rand_next = 1;
+static inline uint32_t xoshiro_next(uint32_t* s) {
+    const uint32_t ret = rotl32(s[1] * 5, 7) * 9;
+    const uint32_t t   = s[1] << 9;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl32(s[3], 11);
+
+    return ret;
+}
+
+void rand_seed(RandState* st, uint64_t seed) {
+    const uint64_t a = splitmix64(&seed);
+    const uint64_t b = splitmix64(&seed);
+
+    st->s[0] = (uint32_t)a;
+    st->s[1] = (uint32_t)(a >> 32);
+    st->s[2] = (uint32_t)b;
+    st->s[3] = (uint32_t)(b >> 32);
+
+    /* All zero would only output zeros */
+    if ((st->s[0] | st->s[1] | st->s[2] | st->s[3]) == 0)
+        st->s[0] = 1;
+}
+
+uint32_t rand_next(RandState* st) {
+    return xoshiro_next(st->s);
+}
+
+uint32_t rand_u32(void) {
+    return xoshiro_next(cur_state()->s);
+}
+
+uint32_t rand_range(uint32_t n) {
+    uint32_t* s = cur_state()->s;
+
+    /* Take the high half of rand * n. The low half tells if the result would
+     * be biased, and then we try again. See: https://arxiv.org/abs/1805.10941 */
+    uint64_t m   = (uint64_t)xoshiro_next(s) * n;
+    uint32_t low = (uint32_t)m;
+    if (low < n) {
+        const uint32_t threshold = -n % n;
+        while (low < threshold) {
+            m   = (uint64_t)xoshiro_next(s) * n;
+            low = (uint32_t)m;
+        }
+    }
+
+    return (uint32_t)(m >> 32);
+}
+
+void rand_fill(void* buf, size_t sz) {
+    RandState* st = cur_state();
+    uint8_t* dst  = buf;
+
+    /* Work on a local copy, so the state stays in registers */
+    uint32_t s[4] = { st->s[0], st->s[1], st->s[2], st->s[3] };
+
+    for (; sz >= sizeof(uint32_t); sz -= sizeof(uint32_t)) {
+        *(u32_alias*)dst = xoshiro_next(s);
+        dst += sizeof(uint32_t);
+    }
+
+    if (sz > 0) {
+        uint32_t r = xoshiro_next(s);
+        while (sz-- > 0) {
+            *dst++ = (uint8_t)r;
+            r >>= 8;
+        }
+    }
+
+    st->s[0] = s[0];
+    st->s[1] = s[1];
+    st->s[2] = s[2];
+    st->s[3] = s[3];
+}
 
 int rand(void) {
-    rand_next = (rand_next * 1103515245) + 12345;
-    return (unsigned int)(rand_next / 65536) % RAND_MAX;
+    /* The high bits are the best ones */
+    return rand_u32() >> 17;
 }
 
 void srand(unsigned int seed) {
-    rand_next = seed;
+    rand_seed(&state, seed);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Ranges with this many items or less are sorted with insertion sort.
+ */
+#define QSORT_INSERTION_MAX 12
+
+/**
+ * @brief Swap 2 items of \p sz bytes.
+ * @details The items are usually integers, pointers or small structs, so swap
+ * them a word at a time when their size and alignment allow it.
+ * @param[inout] a, b Items to swap
+ * @param sz Size of each item
+ */
+static inline void swap_items(char* a, char* b, size_t sz) {
+    if (((uintptr_t)a | (uintptr_t)b | sz) % sizeof(uint32_t) == 0) {
+        u32_alias* x = (u32_alias*)a;
+        u32_alias* y = (u32_alias*)b;
+
+        for (size_t i = 0; i < sz / sizeof(uint32_t); i++) {
+            const uint32_t tmp = x[i];
+            x[i]               = y[i];
+            y[i]               = tmp;
+        }
+    } else {
+        for (size_t i = 0; i < sz; i++) {
+            const char tmp = a[i];
+            a[i]           = b[i];
+            b[i]           = tmp;
+        }
+    }
+}
+
+/**
+ * @brief Sort a small range with insertion sort.
+ * @param[inout] base First item
+ * @param n Number of items
+ * @param sz Size of each item
+ * @param[in] cmp Comparison function, see qsort()
+ */
+static void insertion_sort(char* base, size_t n, size_t sz,
+                           int (*cmp)(const void*, const void*)) {
+    for (size_t i = 1; i < n; i++)
+        for (char* p = base + i * sz; p > base && cmp(p - sz, p) > 0; p -= sz)
+            swap_items(p - sz, p, sz);
+}
+
+void qsort(void* base, size_t n, size_t sz,
+           int (*cmp)(const void*, const void*)) {
+    char* lo = base;
+
+    while (n > QSORT_INSERTION_MAX) {
+        /* Median of the first, middle and last items as pivot, so sorted
+         * arrays don't hit the worst case. Keep it in the first position */
+        char* mid = lo + (n / 2) * sz;
+        char* hi  = lo + (n - 1) * sz;
+        if (cmp(mid, lo) < 0)
+            swap_items(mid, lo, sz);
+        if (cmp(hi, mid) < 0) {
+            swap_items(hi, mid, sz);
+            if (cmp(mid, lo) < 0)
+                swap_items(mid, lo, sz);
+        }
+        swap_items(lo, mid, sz);
+
+        /* Hoare partition. Items equal to the pivot stop both sides, so ranges
+         * of equal items are split in half */
+        char* i = lo;
+        char* j = lo + n * sz;
+        for (;;) {
+            do {
+                i += sz;
+            } while (i < j && cmp(i, lo) < 0);
+
+            do {
+                j -= sz;
+            } while (cmp(j, lo) > 0);
+
+            if (i >= j)
+                break;
+
+            swap_items(i, j, sz);
+        }
+        swap_items(lo, j, sz);
+
+        /* Recurse into the smaller side and loop with the bigger one, so the
+         * stack depth is O(log n) */
+        const size_t n_left  = (j - lo) / sz;
+        const size_t n_right = n - n_left - 1;
+        if (n_left < n_right) {
+            qsort(lo, n_left, sz, cmp);
+            lo = j + sz;
+            n  = n_right;
+        } else {
+            qsort(j + sz, n_right, sz, cmp);
+            n = n_left;
+        }
+    }
+
+    insertion_sort(lo, n, sz, cmp);
+}
+
+void* bsearch(const void* key, const void* base, size_t n, size_t sz,
+              int (*cmp)(const void*, const void*)) {
+    const char* lo = base;
+
+    while (n > 0) {
+        const char* mid = lo + (n / 2) * sz;
+        const int ret   = cmp(key, mid);
+
+        if (ret == 0)
+            return (void*)mid;
+
+        if (ret > 0) {
+            lo = mid + sz;
+            n  = n - n / 2 - 1;
+        } else {
+            n = n / 2;
+        }
+    }
+
+    return NULL;
 }
@@ -1,8 +1,149 @@
 
 #include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
-size_t strlen(const char* str) {
+/**
+ * @name CPU features used for choosing the mem* implementations
+ * @details See: https://en.wikipedia.org/wiki/CPUID
+ * @{ */
+#define CPUID_1_EDX_SSE2 (1 << 26) /**< @brief EAX=1: EDX bit 26 */
+#define CPUID_7_EBX_ERMS (1 << 9)  /**< @brief EAX=7, ECX=0: EBX bit 9 */
+/** @} */
+
+/**
+ * @brief Sizes up to this one are not worth the SSE2 loops.
+ */
+#define SSE2_MIN_SZ 64
+
+/**
+ * @brief Minimum size for using `rep movsb` and `rep stosb` on CPUs with ERMS.
+ * They have a startup cost, so smaller sizes use the SSE2 loops.
+ */
+#define ERMS_MIN_SZ 2048
+
+/**
+ * @brief 16 byte vector, for keeping values in SSE registers between asm
+ * statements.
+ */
+typedef char vec16 __attribute__((vector_size(16)));
+
+/**
+ * @brief 32 bit integer that can alias other types, for reading and writing
+ * 4 bytes at once.
+ */
+typedef uint32_t __attribute__((may_alias)) u32_alias;
+
+/**
+ * @brief Run the cpuid instruction.
+ * @param leaf, subleaf Values of EAX and ECX
+ * @param[out] a, b, c, d Values of EAX, EBX, ECX and EDX after cpuid
+ */
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t* a,
+                         uint32_t* b, uint32_t* c, uint32_t* d) {
+    asm volatile("cpuid"
+                 : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d)
+                 : "a"(leaf), "c"(subleaf));
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Generic implementations, using the x86 string instructions. We use inline asm
+ * for all the loops, because the compiler could replace a byte loop with a call
+ * to the function we are implementing.
+ */
+
+/**
+ * @brief Copy \p sz bytes forward with `rep movsb`.
+ * @details Used by all the memcpy implementations for the last bytes.
+ */
+static inline void copy_bytes(unsigned char* dp, const unsigned char* sp,
+                              size_t sz) {
+    asm volatile("rep movsb" : "+D"(dp), "+S"(sp), "+c"(sz) : : "memory");
+}
+
+/**
+ * @brief Set \p sz bytes to \p val with `rep stosb`.
+ * @details Used by all the memset implementations for the last bytes.
+ */
+static inline void set_bytes(unsigned char* p, unsigned char val, size_t sz) {
+    asm volatile("rep stosb" : "+D"(p), "+c"(sz) : "a"(val) : "memory");
+}
+
+static void* memcpy_words(void* restrict dst, const void* restrict src,
+                          size_t sz) {
+    unsigned char* dp       = dst;
+    const unsigned char* sp = src;
+    size_t words            = sz / 4;
+
+    asm volatile("rep movsd" : "+D"(dp), "+S"(sp), "+c"(words) : : "memory");
+    copy_bytes(dp, sp, sz % 4);
+
+    return dst;
+}
+
+static void* memset_words(void* ptr, int val, size_t sz) {
+    unsigned char* p    = ptr;
+    const uint32_t word = (unsigned char)val * 0x01010101;
+    size_t words        = sz / 4;
+
+    asm volatile("rep stosd" : "+D"(p), "+c"(words) : "a"(word) : "memory");
+    set_bytes(p, val, sz % 4);
+
+    return ptr;
+}
+
+static int memcmp_words(const void* a, const void* b, size_t sz) {
+    const unsigned char* ap = a;
+    const unsigned char* bp = b;
+
+    /* Skip the words that match, then look for the byte */
+    while (sz >= 4 && *(const u32_alias*)ap == *(const u32_alias*)bp) {
+        ap += 4;
+        bp += 4;
+        sz -= 4;
+    }
+
+    for (; sz > 0; sz--, ap++, bp++) {
+        if (*ap < *bp)
+            return -1;
+        else if (*ap > *bp)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Copy \p sz bytes backwards, for memmove() with the destination after
+ * the source.
+ * @details The bytes that don't fill a word are the last ones, so they are
+ * copied first with `rep movsb`, then the words with `rep movsd`. The
+ * direction flag needs to be clear for the rest of the code.
+ */
+static void memmove_back_words(unsigned char* dp, const unsigned char* sp,
+                               size_t sz) {
+    dp += sz - 1;
+    sp += sz - 1;
+    size_t n = sz % 4;
+
+    /* After the bytes, the pointers are 3 bytes after the start of the last
+     * word */
+    asm volatile("std\n\t"
+                 "rep movsb\n\t"
+                 "sub %0, 3\n\t"
+                 "sub %1, 3\n\t"
+                 "mov %2, %3\n\t"
+                 "rep movsd\n\t"
+                 "cld"
+                 : "+D"(dp), "+S"(sp), "+c"(n)
+                 : "r"(sz / 4)
+                 : "memory");
+}
+
+static size_t strlen_bytes(const char* str) {
     size_t ret = 0;
 
     while (str[ret] != '\0')
@@ -11,6 +152,499 @@ size_t strlen(const char* str) {
     return ret;
 }
 
+/* -------------------------------------------------------------------------- */
+
+/*
+ * SSE2: 64 bytes per iteration, with aligned stores. Sizes up to 64 bytes, and
+ * the ends of the bigger ones, are done with overlapping loads and stores
+ * instead of the string instructions, which have a startup cost.
+ */
+
+/**
+ * @brief Copy up to 64 bytes.
+ * @details All the loads are done before the stores, so the regions can
+ * overlap.
+ */
+static inline void copy_small(unsigned char* dp, const unsigned char* sp,
+                              size_t sz) {
+    if (sz >= 32) {
+        asm volatile("movdqu xmm0, [%1]\n\t"
+                     "movdqu xmm1, [%1 + 16]\n\t"
+                     "movdqu xmm2, [%1 + %2 - 32]\n\t"
+                     "movdqu xmm3, [%1 + %2 - 16]\n\t"
+                     "movdqu [%0], xmm0\n\t"
+                     "movdqu [%0 + 16], xmm1\n\t"
+                     "movdqu [%0 + %2 - 32], xmm2\n\t"
+                     "movdqu [%0 + %2 - 16], xmm3"
+                     :
+                     : "r"(dp), "r"(sp), "r"(sz)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    } else if (sz >= 16) {
+        asm volatile("movdqu xmm0, [%1]\n\t"
+                     "movdqu xmm1, [%1 + %2 - 16]\n\t"
+                     "movdqu [%0], xmm0\n\t"
+                     "movdqu [%0 + %2 - 16], xmm1"
+                     :
+                     : "r"(dp), "r"(sp), "r"(sz)
+                     : "memory", "xmm0", "xmm1");
+    } else if (sz >= 8) {
+        asm volatile("movq xmm0, [%1]\n\t"
+                     "movq xmm1, [%1 + %2 - 8]\n\t"
+                     "movq [%0], xmm0\n\t"
+                     "movq [%0 + %2 - 8], xmm1"
+                     :
+                     : "r"(dp), "r"(sp), "r"(sz)
+                     : "memory", "xmm0", "xmm1");
+    } else if (sz >= 4) {
+        const uint32_t first = *(const u32_alias*)sp;
+        const uint32_t last  = *(const u32_alias*)(sp + sz - 4);
+
+        *(u32_alias*)dp            = first;
+        *(u32_alias*)(dp + sz - 4) = last;
+    } else if (sz > 0) {
+        /* First, middle and last bytes, some of them are the same */
+        const unsigned char first  = sp[0];
+        const unsigned char middle = sp[sz / 2];
+        const unsigned char last   = sp[sz - 1];
+
+        dp[0]      = first;
+        dp[sz / 2] = middle;
+        dp[sz - 1] = last;
+    }
+}
+
+/**
+ * @brief Set up to 64 bytes.
+ * @param[out] p Destination
+ * @param v Value of the bytes, in all the bytes of the vector
+ * @param sz Number of bytes
+ */
+static inline void set_small(unsigned char* p, vec16 v, size_t sz) {
+    if (sz >= 32) {
+        asm volatile("movdqu [%0], %2\n\t"
+                     "movdqu [%0 + 16], %2\n\t"
+                     "movdqu [%0 + %1 - 32], %2\n\t"
+                     "movdqu [%0 + %1 - 16], %2"
+                     :
+                     : "r"(p), "r"(sz), "x"(v)
+                     : "memory");
+    } else if (sz >= 16) {
+        asm volatile("movdqu [%0], %2\n\t"
+                     "movdqu [%0 + %1 - 16], %2"
+                     :
+                     : "r"(p), "r"(sz), "x"(v)
+                     : "memory");
+    } else if (sz >= 8) {
+        asm volatile("movq [%0], %2\n\t"
+                     "movq [%0 + %1 - 8], %2"
+                     :
+                     : "r"(p), "r"(sz), "x"(v)
+                     : "memory");
+    } else if (sz >= 4) {
+        const uint32_t word = ((u32_alias*)&v)[0];
+
+        *(u32_alias*)p            = word;
+        *(u32_alias*)(p + sz - 4) = word;
+    } else if (sz > 0) {
+        const unsigned char byte = v[0];
+
+        p[0]      = byte;
+        p[sz / 2] = byte;
+        p[sz - 1] = byte;
+    }
+}
+
+static void* memcpy_sse2(void* restrict dst, const void* restrict src,
+                         size_t sz) {
+    unsigned char* dp       = dst;
+    const unsigned char* sp = src;
+
+    if (sz <= SSE2_MIN_SZ) {
+        copy_small(dp, sp, sz);
+        return dst;
+    }
+
+    /* Keep the first 16 bytes, and skip the bytes until the destination is
+     * aligned to 16. They are stored at the end, since memmove() uses this
+     * function when the destination is before the source, and storing them
+     * now could overwrite the source. */
+    vec16 head;
+    asm volatile("movdqu %0, [%1]" : "=x"(head) : "r"(sp) : "memory");
+
+    const size_t skip = 16 - ((uintptr_t)dp & 15);
+    unsigned char* p  = dp + skip;
+    sp += skip;
+    sz -= skip;
+
+    for (; sz >= 64; sz -= 64, p += 64, sp += 64) {
+        asm volatile("movdqu xmm0, [%1]\n\t"
+                     "movdqu xmm1, [%1 + 16]\n\t"
+                     "movdqu xmm2, [%1 + 32]\n\t"
+                     "movdqu xmm3, [%1 + 48]\n\t"
+                     "movdqa [%0], xmm0\n\t"
+                     "movdqa [%0 + 16], xmm1\n\t"
+                     "movdqa [%0 + 32], xmm2\n\t"
+                     "movdqa [%0 + 48], xmm3"
+                     :
+                     : "r"(p), "r"(sp)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    }
+
+    copy_small(p, sp, sz);
+    asm volatile("movdqu [%0], %1" : : "r"(dp), "x"(head) : "memory");
+
+    return dst;
+}
+
+static void* memset_sse2(void* ptr, int val, size_t sz) {
+    unsigned char* p    = ptr;
+    const uint32_t word = (unsigned char)val * 0x01010101;
+
+    /* Fill the 4 dwords of the register with the value */
+    vec16 v;
+    asm("movd %0, %1\n\t"
+        "pshufd %0, %0, 0"
+        : "=x"(v)
+        : "r"(word));
+
+    if (sz <= SSE2_MIN_SZ) {
+        set_small(p, v, sz);
+        return ptr;
+    }
+
+    /* Set the first 16 bytes, then continue from the first aligned address */
+    asm volatile("movdqu [%0], %1" : : "r"(p), "x"(v) : "memory");
+
+    const size_t skip = 16 - ((uintptr_t)p & 15);
+    p += skip;
+    sz -= skip;
+
+    for (; sz >= 64; sz -= 64, p += 64) {
+        asm volatile("movdqa [%0], %1\n\t"
+                     "movdqa [%0 + 16], %1\n\t"
+                     "movdqa [%0 + 32], %1\n\t"
+                     "movdqa [%0 + 48], %1"
+                     :
+                     : "r"(p), "x"(v)
+                     : "memory");
+    }
+
+    set_small(p, v, sz);
+    return ptr;
+}
+
+/**
+ * @brief Compare 16 bytes.
+ * @return Bit N is set if byte N is different
+ */
+static inline uint32_t diff_mask16(const unsigned char* a,
+                                   const unsigned char* b) {
+    uint32_t mask;
+    asm volatile("movdqu xmm0, [%1]\n\t"
+                 "movdqu xmm1, [%2]\n\t"
+                 "pcmpeqb xmm0, xmm1\n\t"
+                 "pmovmskb %0, xmm0"
+                 : "=r"(mask)
+                 : "r"(a), "r"(b)
+                 : "memory", "xmm0", "xmm1");
+    return mask ^ 0xFFFF;
+}
+
+/**
+ * @brief Check if 64 bytes are equal.
+ * @details The results of the 4 blocks are combined with `pand`, so there is a
+ * single branch for the 64 bytes.
+ */
+static inline bool equal64(const unsigned char* a, const unsigned char* b) {
+    uint32_t mask;
+    asm volatile("movdqu xmm0, [%1]\n\t"
+                 "movdqu xmm1, [%1 + 16]\n\t"
+                 "movdqu xmm2, [%1 + 32]\n\t"
+                 "movdqu xmm3, [%1 + 48]\n\t"
+                 "movdqu xmm4, [%2]\n\t"
+                 "movdqu xmm5, [%2 + 16]\n\t"
+                 "movdqu xmm6, [%2 + 32]\n\t"
+                 "movdqu xmm7, [%2 + 48]\n\t"
+                 "pcmpeqb xmm0, xmm4\n\t"
+                 "pcmpeqb xmm1, xmm5\n\t"
+                 "pcmpeqb xmm2, xmm6\n\t"
+                 "pcmpeqb xmm3, xmm7\n\t"
+                 "pand xmm0, xmm1\n\t"
+                 "pand xmm2, xmm3\n\t"
+                 "pand xmm0, xmm2\n\t"
+                 "pmovmskb %0, xmm0"
+                 : "=r"(mask)
+                 : "r"(a), "r"(b)
+                 : "memory", "xmm0", "xmm1", "xmm2", "xmm3", "xmm4", "xmm5",
+                   "xmm6", "xmm7");
+    return mask == 0xFFFF;
+}
+
+static int memcmp_sse2(const void* a, const void* b, size_t sz) {
+    const unsigned char* ap = a;
+    const unsigned char* bp = b;
+
+    if (sz < 16)
+        return memcmp_words(ap, bp, sz);
+
+    while (sz >= 64 && equal64(ap, bp)) {
+        ap += 64;
+        bp += 64;
+        sz -= 64;
+    }
+
+    uint32_t mask;
+    for (; sz >= 16; sz -= 16, ap += 16, bp += 16) {
+        mask = diff_mask16(ap, bp);
+        if (mask != 0)
+            goto found;
+    }
+
+    if (sz == 0)
+        return 0;
+
+    /* Last 16 bytes, overlapping the ones we already compared. They are equal,
+     * so the first difference is the one we are looking for. */
+    ap -= 16 - sz;
+    bp -= 16 - sz;
+    mask = diff_mask16(ap, bp);
+    if (mask == 0)
+        return 0;
+
+found:;
+    const int i = __builtin_ctz(mask);
+    return (ap[i] < bp[i]) ? -1 : 1;
+}
+
+/**
+ * @brief Get a mask of the zero bytes of an aligned 16 byte block.
+ * @param[in] p Pointer aligned to 16
+ * @return Bit N is set if byte N is zero
+ */
+static inline uint32_t zero_mask16(const char* p) {
+    uint32_t mask;
+    asm volatile("pxor xmm1, xmm1\n\t"
+                 "pcmpeqb xmm1, [%1]\n\t"
+                 "pmovmskb %0, xmm1"
+                 : "=r"(mask)
+                 : "r"(p)
+                 : "memory", "xmm1");
+    return mask;
+}
+
+/**
+ * @brief Check if an aligned 64 byte block has a zero byte.
+ * @details The minimum of the 4 blocks has a zero byte if any of them does.
+ * @param[in] p Pointer aligned to 16
+ * @return True if there is a zero byte in the block.
+ */
+static inline bool has_zero64(const char* p) {
+    uint32_t mask;
+    asm volatile("movdqa xmm0, [%1]\n\t"
+                 "pminub xmm0, [%1 + 16]\n\t"
+                 "pminub xmm0, [%1 + 32]\n\t"
+                 "pminub xmm0, [%1 + 48]\n\t"
+                 "pxor xmm1, xmm1\n\t"
+                 "pcmpeqb xmm0, xmm1\n\t"
+                 "pmovmskb %0, xmm0"
+                 : "=r"(mask)
+                 : "r"(p)
+                 : "memory", "xmm0", "xmm1");
+    return mask != 0;
+}
+
+static size_t strlen_sse2(const char* str) {
+    /* Aligned loads never cross a page, so we can read the bytes before the
+     * string and after the terminator, as long as we ignore them. */
+    const char* p  = (const char*)((uintptr_t)str & ~15);
+    const int skip = str - p;
+
+    /* Ignore the bytes before str */
+    uint32_t mask = zero_mask16(p) & (0xFFFF << skip);
+    if (mask != 0)
+        return p + __builtin_ctz(mask) - str;
+
+    /* Blocks of 16 until we are aligned to 64 */
+    for (p += 16; ((uintptr_t)p & 63) != 0; p += 16) {
+        mask = zero_mask16(p);
+        if (mask != 0)
+            return p + __builtin_ctz(mask) - str;
+    }
+
+    /* Blocks of 64, then look for the zero inside the block */
+    while (!has_zero64(p))
+        p += 64;
+
+    while ((mask = zero_mask16(p)) == 0)
+        p += 16;
+
+    return p + __builtin_ctz(mask) - str;
+}
+
+/**
+ * @brief SSE2 version of memmove_back_words()
+ */
+static void memmove_back_sse2(unsigned char* dp, const unsigned char* sp,
+                              size_t sz) {
+    if (sz <= SSE2_MIN_SZ) {
+        copy_small(dp, sp, sz);
+        return;
+    }
+
+    /* Keep the first and last 16 bytes, and copy the rest from the last
+     * aligned address of the destination. The first and last bytes are
+     * stored at the end, since the loop can overlap them. */
+    vec16 head, tail;
+    asm volatile("movdqu %0, [%2]\n\t"
+                 "movdqu %1, [%2 + %3 - 16]"
+                 : "=x"(head), "=x"(tail)
+                 : "r"(sp), "r"(sz)
+                 : "memory");
+
+    size_t i = sz - ((uintptr_t)(dp + sz) & 15);
+
+    for (; i >= 64 + 16; i -= 64) {
+        asm volatile("movdqu xmm0, [%1 - 16]\n\t"
+                     "movdqu xmm1, [%1 - 32]\n\t"
+                     "movdqu xmm2, [%1 - 48]\n\t"
+                     "movdqu xmm3, [%1 - 64]\n\t"
+                     "movdqa [%0 - 16], xmm0\n\t"
+                     "movdqa [%0 - 32], xmm1\n\t"
+                     "movdqa [%0 - 48], xmm2\n\t"
+                     "movdqa [%0 - 64], xmm3"
+                     :
+                     : "r"(dp + i), "r"(sp + i)
+                     : "memory", "xmm0", "xmm1", "xmm2", "xmm3");
+    }
+
+    for (; i > 16; i -= 16) {
+        asm volatile("movdqu xmm0, [%1 - 16]\n\t"
+                     "movdqa [%0 - 16], xmm0"
+                     :
+                     : "r"(dp + i), "r"(sp + i)
+                     : "memory", "xmm0");
+    }
+
+    asm volatile("movdqu [%0], %2\n\t"
+                 "movdqu [%0 + %1 - 16], %3"
+                 :
+                 : "r"(dp), "r"(sz), "x"(head), "x"(tail)
+                 : "memory");
+}
+
+/* -------------------------------------------------------------------------- */
+
+/* ERMS (Enhanced REP MOVSB/STOSB): the CPU copies whole cache lines with the
+ * byte instructions, so they are the fastest option for big sizes. */
+
+static void* memcpy_erms(void* restrict dst, const void* restrict src,
+                         size_t sz) {
+    if (sz < ERMS_MIN_SZ)
+        return memcpy_sse2(dst, src, sz);
+
+    copy_bytes(dst, src, sz);
+    return dst;
+}
+
+static void* memset_erms(void* ptr, int val, size_t sz) {
+    if (sz < ERMS_MIN_SZ)
+        return memset_sse2(ptr, val, sz);
+
+    set_bytes(ptr, val, sz);
+    return ptr;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/*
+ * Dispatch. The pointers start with the resolvers, which check the CPU features
+ * once and replace all the pointers with the best implementations.
+ */
+
+static void* memcpy_resolve(void* restrict dst, const void* restrict src,
+                            size_t sz);
+static void* memset_resolve(void* ptr, int val, size_t sz);
+static int memcmp_resolve(const void* a, const void* b, size_t sz);
+static size_t strlen_resolve(const char* str);
+
+static void* (*memcpy_impl)(void* restrict, const void* restrict,
+                            size_t) = memcpy_resolve;
+static void* (*memset_impl)(void*, int, size_t)             = memset_resolve;
+static int (*memcmp_impl)(const void*, const void*, size_t) = memcmp_resolve;
+static size_t (*strlen_impl)(const char*)                   = strlen_resolve;
+
+/**
+ * @brief Backwards copy of memmove().
+ * @details Doesn't start with a resolver, since memmove() only calls it after
+ * memcpy() when they overlap. Until then, the words are good enough (e.g. for
+ * the console scroll of early boot).
+ */
+static void (*memmove_back_impl)(unsigned char*, const unsigned char*,
+                                 size_t) = memmove_back_words;
+
+/**
+ * @brief Check the CPU features and choose the implementations.
+ */
+static void resolve_impls(void) {
+    uint32_t a, b, c, d;
+
+    cpuid(0, 0, &a, &b, &c, &d);
+    const uint32_t max_leaf = a;
+
+    cpuid(1, 0, &a, &b, &c, &d);
+    const bool has_sse2 = d & CPUID_1_EDX_SSE2;
+
+    bool has_erms = false;
+    if (max_leaf >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        has_erms = b & CPUID_7_EBX_ERMS;
+    }
+
+    if (has_erms && has_sse2) {
+        memcpy_impl = memcpy_erms;
+        memset_impl = memset_erms;
+    } else if (has_sse2) {
+        memcpy_impl = memcpy_sse2;
+        memset_impl = memset_sse2;
+    } else {
+        memcpy_impl = memcpy_words;
+        memset_impl = memset_words;
+    }
+
+    memcmp_impl = has_sse2 ? memcmp_sse2 : memcmp_words;
+    strlen_impl = has_sse2 ? strlen_sse2 : strlen_bytes;
+
+    if (has_sse2)
+        memmove_back_impl = memmove_back_sse2;
+}
+
+static void* memcpy_resolve(void* restrict dst, const void* restrict src,
+                            size_t sz) {
+    resolve_impls();
+    return memcpy_impl(dst, src, sz);
+}
+
+static void* memset_resolve(void* ptr, int val, size_t sz) {
+    resolve_impls();
+    return memset_impl(ptr, val, sz);
+}
+
+static int memcmp_resolve(const void* a, const void* b, size_t sz) {
+    resolve_impls();
+    return memcmp_impl(a, b, sz);
+}
+
+static size_t strlen_resolve(const char* str) {
+    resolve_impls();
+    return strlen_impl(str);
+}
+
+/* -------------------------------------------------------------------------- */
+
+size_t strlen(const char* str) {
+    return strlen_impl(str);
+}
+
 char* strrev(char* str) {
     const int len = strlen(str);
     char c        = 0;
@@ -35,38 +669,28 @@ char* strrev(char* str) {
 }
 
 int memcmp(const void* a, const void* b, size_t sz) {
-    unsigned char* ap = (unsigned char*)a;
-    unsigned char* bp = (unsigned char*)b;
-
-    while (sz-- > 0) {
-        if (*ap < *bp)
-            return -1;
-        else if (*ap > *bp)
-            return 1;
-
-        ap++;
-        bp++;
-    }
-
-    return 0;
+    return memcmp_impl(a, b, sz);
 }
 
 void* memset(void* ptr, int val, size_t sz) {
-    unsigned char* p = (unsigned char*)ptr;
-
-    while (sz-- > 0)
-        *p++ = (unsigned char)val;
-
-    return ptr;
+    return memset_impl(ptr, val, sz);
 }
 
 void* memcpy(void* restrict dst, const void* restrict src, size_t sz) {
-    unsigned char* dp = (unsigned char*)dst;
-    unsigned char* sp = (unsigned char*)src;
+    return memcpy_impl(dst, src, sz);
+}
+
+void* memmove(void* dst, const void* src, size_t sz) {
+    unsigned char* dp       = dst;
+    const unsigned char* sp = src;
 
-    while (sz-- > 0)
-        *dp++ = *sp++;
+    /* All the memcpy implementations copy forward, reading each block before
+     * writing it, so they work if the destination is before the source. */
+    if (dp <= sp || dp >= sp + sz)
+        return memcpy(dst, src, sz);
 
+    /* The destination overlaps the end of the source, copy backwards */
+    memmove_back_impl(dp, sp, sz);
     return dst;
 }
 
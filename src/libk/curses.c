@@ -7,9 +7,29 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <ctype.h>
 #include <kernel/color.h>
+#include <kernel/framebuffer.h> /* fb_begin_frame, fb_end_frame */
 #include <kernel/framebuffer_console.h>
 #include <kernel/keyboard.h>
+#include <kernel/tty.h>
+#include <kernel/poll.h> /* poll */
+#include <kernel/pit.h>  /* pit_get_ticks */
+
+/**
+ * @brief Set and clear bits of the lflag of the mode of stdin.
+ * @param set Bits of tty_lflags to set
+ * @param clear Bits of tty_lflags to clear
+ */
+static void set_lflag(uint32_t set, uint32_t clear) {
+    Tty* const tty = tty_stdin();
+
+    TtyMode mode;
+    tty_get_mode(tty, &mode);
+    mode.lflag = (mode.lflag | set) & ~clear;
+    tty_set_mode(tty, &mode);
+}
 
 WINDOW* initscr(void) {
     fbc_ctx* cur = fbc_get_ctx();
@@ -23,29 +43,23 @@ WINDOW* initscr(void) {
     win->old_ctx = cur;
     win->ctx     = malloc(sizeof(fbc_ctx));
     win->pairs   = NULL; /* Initialized by start_color */
+    win->keypad  = false;
+    win->delay   = -1;
 
-    /* Fill the new framebuffer console context */
-    win->ctx->fbc = malloc(cur->ch_h * cur->ch_w * sizeof(fbc_entry));
-
-    win->ctx->y = cur->y;
-    win->ctx->x = cur->x;
-    win->ctx->h = cur->h;
-    win->ctx->w = cur->w;
-
-    win->ctx->ch_h = cur->ch_h;
-    win->ctx->ch_w = cur->ch_w;
+    /* Restored by endwin() */
+    tty_get_mode(tty_stdin(), &win->old_mode);
 
-    win->ctx->font = cur->font;
+    /* Fill the new framebuffer console context. Same size and virtual terminal
+     * as the old one, but without scrollback */
+    fbc_init_ctx(win->ctx, cur->y, cur->x, cur->h, cur->w, cur->font, 0,
+                 cur->vt);
 
-    win->ctx->cur_cols.fg = DEFAULT_FG;
-    win->ctx->cur_cols.bg = DEFAULT_BG;
+    /* Same palette as the old context, so the colors have the same indexes */
+    memcpy(win->ctx->palette, cur->palette, sizeof(cur->palette));
+    win->ctx->palette_sz = cur->palette_sz;
 
-    win->ctx->cur_y = 0;
-    win->ctx->cur_x = 0;
-
-    /* Switch to the new fbc context */
+    /* Switch to the new fbc context. It's already cleared */
     fbc_change_ctx(win->ctx);
-    fbc_clear();
     fbc_refresh_raw();
 
     return win;
@@ -57,18 +71,20 @@ int endwin(void) {
     fbc_change_ctx(stdscr->old_ctx);
     fbc_refresh();
 
-    /* Reset keyboard modes in case they were changed. For now it works until we
-     * can have process-specific settings for keyboard, terminal, etc. */
-    kb_echo();
-    kb_noraw();
+    /* Restore the mode of stdin, and discard the input we didn't read so it
+     * doesn't go to the next program */
+    Tty* const tty = tty_stdin();
+    tty_set_mode(tty, &stdscr->old_mode);
+    tty_flush(tty);
+    kb_events_off();
 
     /* We called start_color, free the allocated array */
     if (COLOR_PAIRS > 0)
         free(stdscr->pairs);
 
-    free(stdscr->ctx->fbc); /* Free the framebuffer console array */
-    free(stdscr->ctx);      /* Free the framebuffer console context */
-    free(stdscr);           /* Free the curses window struct */
+    fbc_free_ctx(stdscr->ctx); /* Free the framebuffer console arrays */
+    free(stdscr->ctx);         /* Free the framebuffer console context */
+    free(stdscr);              /* Free the curses window struct */
 
     /* So next call to initscr uses stdscr */
     stdscr = NULL;
@@ -77,27 +93,58 @@ int endwin(void) {
 }
 
 int raw(void) {
-    kb_raw();
+    set_lflag(0, TTY_ICANON);
     return OK;
 }
 
 int noraw(void) {
-    kb_noraw();
+    set_lflag(TTY_ICANON, 0);
     return OK;
 }
 
 int echo(void) {
-    kb_echo();
+    set_lflag(TTY_ECHO, 0);
     return OK;
 }
 
 int noecho(void) {
-    kb_noecho();
+    set_lflag(0, TTY_ECHO);
+    return OK;
+}
+
+int keypad(WINDOW* win, bool bf) {
+    if (win != stdscr)
+        return ERR;
+
+    win->keypad = bf;
+
+    if (bf)
+        kb_events_on();
+    else
+        kb_events_off();
+
+    return OK;
+}
+
+void timeout(int delay) {
+    if (stdscr != NULL)
+        stdscr->delay = (delay < 0) ? -1 : delay;
+}
+
+int nodelay(WINDOW* win, bool bf) {
+    if (win != stdscr)
+        return ERR;
+
+    win->delay = bf ? 0 : -1;
     return OK;
 }
 
 int refresh(void) {
+    /* Draw the whole window into the off-screen page, if we have one */
+    fb_begin_frame();
     fbc_refresh_raw();
+    fb_end_frame();
+
     return OK;
 }
 
@@ -105,7 +152,10 @@ int wrefresh(WINDOW* win) {
     fbc_ctx* old_ctx = fbc_get_ctx();
 
     fbc_change_ctx(win->ctx);
+
+    fb_begin_frame();
     fbc_refresh_raw();
+    fb_end_frame();
 
     fbc_change_ctx(old_ctx);
     return OK;
@@ -197,7 +247,78 @@ int wclrtoeol(WINDOW* win) {
 }
 
 int getch(void) {
-    return getchar();
+    const int delay    = (stdscr != NULL) ? stdscr->delay : -1;
+    const bool events  = stdscr != NULL && stdscr->keypad;
+    const uint64_t end = pit_get_ticks() + delay;
+
+    /* For waiting with timeout() */
+    PollFd fd = { .source = events ? POLL_KB_EVENTS : POLL_TTY, .tty = NULL };
+
+    if (!events) {
+        if (delay >= 0 && poll(&fd, 1, delay) == 0)
+            return ERR;
+
+        return getchar();
+    }
+
+    for (;;) {
+        KbEvent ev;
+
+        if (delay < 0) {
+            kb_wait_event(&ev);
+        } else {
+            /* The releases we skip don't restart the timeout */
+            const uint64_t now = pit_get_ticks();
+            const int32_t left = (now < end) ? end - now : 0;
+
+            if (poll(&fd, 1, left) == 0 || !kb_poll_event(&ev))
+                return ERR;
+        }
+
+        if (!ev.pressed)
+            continue;
+
+        switch (ev.keycode) {
+            case KB_KEY_UP:
+                return KEY_UP;
+            case KB_KEY_DOWN:
+                return KEY_DOWN;
+            case KB_KEY_LEFT:
+                return KEY_LEFT;
+            case KB_KEY_RIGHT:
+                return KEY_RIGHT;
+            case KB_KEY_HOME:
+                return KEY_HOME;
+            case KB_KEY_END:
+                return KEY_END;
+            case KB_KEY_PAGE_UP:
+                return KEY_PPAGE;
+            case KB_KEY_PAGE_DN:
+                return KEY_NPAGE;
+            case KB_KEY_INSERT:
+                return KEY_IC;
+            case KB_KEY_DELETE:
+                return KEY_DC;
+            default:
+                break;
+        }
+
+        /* Modifiers and other keys without chars */
+        if (ev.ch == 0)
+            continue;
+
+        /* Control chars, from 1 for Ctrl+A to 26 for Ctrl+Z */
+        const int lower = tolower(ev.ch);
+        if ((ev.mods & KB_MOD_CTRL) && lower >= 'a' && lower <= 'z')
+            return lower - 'a' + 1;
+
+        TtyMode mode;
+        tty_get_mode(tty_stdin(), &mode);
+        if (mode.lflag & TTY_ECHO)
+            putchar(ev.ch);
+
+        return (unsigned char)ev.ch;
+    }
 }
 
 int clear(void) {
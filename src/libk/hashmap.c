@@ -0,0 +1,252 @@
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <kernel/hashmap.h>
+
+/**
+ * @brief Number of slots of the smallest map allocated by hashmap_init().
+ */
+#define MIN_CAP 8
+
+/**
+ * @brief Number of slots of the biggest map allocated by hashmap_init().
+ * @details The next power of 2 doesn't fit in the uint32_t capacity.
+ */
+#define MAX_CAP (1u << 31)
+
+/* -------------------------------------------------------------------------- */
+
+uint32_t hash_str(const char* str) {
+    uint32_t hash = 2166136261u;
+
+    while (*str != '\0') {
+        hash ^= (uint8_t)*str++;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+uint32_t hash_int(uintptr_t key) {
+    /* Finalizer of MurmurHash3 */
+    uint32_t hash = (uint32_t)key;
+#if UINTPTR_MAX > UINT32_MAX
+    hash ^= (uint32_t)((uint64_t)key >> 32) * 0x9E3779B9u;
+#endif
+
+    hash ^= hash >> 16;
+    hash *= 0x85EBCA6Bu;
+    hash ^= hash >> 13;
+    hash *= 0xC2B2AE35u;
+    hash ^= hash >> 16;
+
+    return hash;
+}
+
+/**
+ * @brief Hash of a key of the map.
+ * @details Never 0, because it's used for empty slots.
+ * @param[in] map Hash map, for the type of key
+ * @param key Key to hash
+ * @return Hash of the key
+ */
+static inline uint32_t key_hash(const HashMap* map, uintptr_t key) {
+    const uint32_t hash =
+      map->str_keys ? hash_str((const char*)key) : hash_int(key);
+
+    return (hash != 0) ? hash : 1;
+}
+
+/**
+ * @brief Check if an entry has the specified key.
+ * @details Compares the hashes first, so strings only get compared if they
+ * are likely to be equal.
+ * @param[in] map Hash map, for the type of key
+ * @param[in] entry Used entry of the map
+ * @param key Key to check
+ * @param hash Hash of \p key
+ * @return True if the entry has the key
+ */
+static inline bool key_equal(const HashMap* map, const HashMapEntry* entry,
+                             uintptr_t key, uint32_t hash) {
+    if (entry->hash != hash)
+        return false;
+
+    if (map->str_keys)
+        return strcmp((const char*)entry->key, (const char*)key) == 0;
+
+    return entry->key == key;
+}
+
+/**
+ * @brief Get the slot of a key, or the empty slot where it would go.
+ * @param[in] map Hash map, needs at least one empty slot
+ * @param key Key to search
+ * @param hash Hash of \p key
+ * @return Slot index
+ */
+static uint32_t find_slot(const HashMap* map, uintptr_t key, uint32_t hash) {
+    const uint32_t mask = map->cap - 1;
+
+    uint32_t i = hash & mask;
+    while (map->entries[i].hash != 0 &&
+           !key_equal(map, &map->entries[i], key, hash))
+        i = (i + 1) & mask;
+
+    return i;
+}
+
+/**
+ * @brief Allocate the entries of a map with \p cap slots and move the old
+ * ones there.
+ * @param[inout] map Hash map, allocated by hashmap_init()
+ * @param cap New number of slots, power of 2 bigger than the entry count
+ * @return False if the entries could not be allocated
+ */
+static bool resize(HashMap* map, uint32_t cap) {
+    HashMapEntry* entries = calloc(cap, sizeof(HashMapEntry));
+    if (entries == NULL)
+        return false;
+
+    HashMapEntry* old_entries = map->entries;
+    const uint32_t old_cap    = map->cap;
+
+    map->entries = entries;
+    map->cap     = cap;
+
+    /* The keys are unique, so just move each entry to the first empty slot */
+    for (uint32_t i = 0; i < old_cap; i++) {
+        if (old_entries[i].hash == 0)
+            continue;
+
+        uint32_t j = old_entries[i].hash & (cap - 1);
+        while (entries[j].hash != 0)
+            j = (j + 1) & (cap - 1);
+
+        entries[j] = old_entries[i];
+    }
+
+    free(old_entries);
+    return true;
+}
+
+/* -------------------------------------------------------------------------- */
+
+bool hashmap_init(HashMap* map, uint32_t n, bool str_keys) {
+    map->entries  = NULL;
+    map->cap      = 0;
+    map->count    = 0;
+    map->str_keys = str_keys;
+    map->fixed    = false;
+
+    /* The capacity would overflow while rounding it up */
+    if (n >= MAX_CAP / 4 * 3)
+        return false;
+
+    /* Smallest power of 2 where n entries are less than 3/4 of the slots */
+    uint32_t cap = MIN_CAP;
+    while (cap / 4 * 3 <= n)
+        cap *= 2;
+
+    return resize(map, cap);
+}
+
+void hashmap_init_static(HashMap* map, HashMapEntry* entries, uint32_t cap,
+                         bool str_keys) {
+    for (uint32_t i = 0; i < cap; i++)
+        entries[i].hash = 0;
+
+    map->entries  = entries;
+    map->cap      = cap;
+    map->count    = 0;
+    map->str_keys = str_keys;
+    map->fixed    = true;
+}
+
+void hashmap_destroy(HashMap* map) {
+    if (!map->fixed)
+        free(map->entries);
+
+    map->entries = NULL;
+    map->cap     = 0;
+    map->count   = 0;
+}
+
+bool hashmap_put(HashMap* map, uintptr_t key, void* val) {
+    const uint32_t hash = key_hash(map, key);
+
+    uint32_t i = find_slot(map, key, hash);
+    if (map->entries[i].hash != 0) {
+        map->entries[i].val = val;
+        return true;
+    }
+
+    /* New key. Keep the load under 3/4, or at least one slot empty for fixed
+     * maps */
+    if (map->fixed) {
+        if (map->count + 1 >= map->cap)
+            return false;
+    } else if ((map->count + 1) * 4 > map->cap * 3) {
+        if (!resize(map, map->cap * 2))
+            return false;
+
+        i = find_slot(map, key, hash);
+    }
+
+    map->entries[i].key  = key;
+    map->entries[i].val  = val;
+    map->entries[i].hash = hash;
+    map->count++;
+
+    return true;
+}
+
+HashMapEntry* hashmap_find(const HashMap* map, uintptr_t key) {
+    if (map->count == 0)
+        return NULL;
+
+    const uint32_t i = find_slot(map, key, key_hash(map, key));
+    return (map->entries[i].hash != 0) ? &map->entries[i] : NULL;
+}
+
+void* hashmap_get(const HashMap* map, uintptr_t key) {
+    const HashMapEntry* entry = hashmap_find(map, key);
+    return (entry != NULL) ? entry->val : NULL;
+}
+
+bool hashmap_del(HashMap* map, uintptr_t key) {
+    if (map->count == 0)
+        return false;
+
+    const uint32_t mask = map->cap - 1;
+
+    uint32_t i = find_slot(map, key, key_hash(map, key));
+    if (map->entries[i].hash == 0)
+        return false;
+
+    /* Backward shift: move back the next entries of the run that can't be
+     * found anymore with the hole at i */
+    for (uint32_t j = i;;) {
+        map->entries[i].hash = 0;
+
+        for (;;) {
+            j = (j + 1) & mask;
+            if (map->entries[j].hash == 0) {
+                map->count--;
+                return true;
+            }
+
+            /* Ideal slot of the entry. It can stay if it's in (i, j] */
+            const uint32_t k = map->entries[j].hash & mask;
+            if ((i < j) ? (i < k && k <= j) : (i < k || k <= j))
+                continue;
+
+            break;
+        }
+
+        map->entries[i] = map->entries[j];
+        i               = j;
+    }
+}
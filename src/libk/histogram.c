@@ -0,0 +1,79 @@
+
+#include <stdint.h>
+#include <string.h>
+#include <kernel/histogram.h>
+
+/**
+ * @brief Get the bucket of a value.
+ * @details The values below HIST_SUB_BUCKETS have their own bucket. The rest
+ * use the position of their highest bit for the power of 2, and the next
+ * HIST_SUB_BITS bits for the bucket inside it.
+ */
+static inline uint32_t bucket_of(uint64_t val) {
+    if (val < HIST_SUB_BUCKETS)
+        return val;
+
+    const uint32_t msb   = 63 - __builtin_clzll(val);
+    const uint32_t shift = msb - HIST_SUB_BITS;
+    const uint32_t sub   = (val >> shift) & (HIST_SUB_BUCKETS - 1);
+
+    return (shift + 1) * HIST_SUB_BUCKETS + sub;
+}
+
+/**
+ * @brief Get the biggest value that goes in a bucket.
+ * @details Inverse of bucket_of()
+ */
+static inline uint64_t bucket_max(uint32_t idx) {
+    if (idx < HIST_SUB_BUCKETS)
+        return idx;
+
+    const uint32_t shift = idx / HIST_SUB_BUCKETS - 1;
+    const uint64_t sub   = idx % HIST_SUB_BUCKETS;
+    const uint64_t min   = (HIST_SUB_BUCKETS + sub) << shift;
+
+    return min + ((uint64_t)1 << shift) - 1;
+}
+
+/* -------------------------------------------------------------------------- */
+
+void hist_init(Histogram* hist) {
+    memset(hist, 0, sizeof(Histogram));
+    hist->min = UINT64_MAX;
+}
+
+void hist_add(Histogram* hist, uint64_t val) {
+    hist->buckets[bucket_of(val)]++;
+    hist->count++;
+    hist->sum += val;
+
+    if (val < hist->min)
+        hist->min = val;
+    if (val > hist->max)
+        hist->max = val;
+}
+
+uint64_t hist_percentile(const Histogram* hist, uint32_t pct) {
+    if (hist->count == 0)
+        return 0;
+
+    if (pct > 100)
+        pct = 100;
+
+    /* Number of values up to the percentile, rounding up. At least one, so
+     * the 0th percentile is the first bucket with values */
+    uint32_t rank = ((uint64_t)hist->count * pct + 99) / 100;
+    if (rank == 0)
+        rank = 1;
+
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            const uint64_t ret = bucket_max(i);
+            return (ret < hist->max) ? ret : hist->max;
+        }
+    }
+
+    return hist->max;
+}
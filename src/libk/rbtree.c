@@ -0,0 +1,346 @@
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <kernel/rbtree.h>
+
+/**
+ * @brief Check the color of a node. NULL leaves are black.
+ */
+#define IS_RED(node) ((node) != NULL && (node)->red)
+
+/**
+ * @brief Put \p new in the place of \p old in the parent of \p old.
+ * @param[inout] tree Red-black tree, for changing the root
+ * @param[in] old Node being replaced
+ * @param[out] new Node that takes its place. Can be NULL.
+ */
+static inline void replace_child(RbTree* tree, RbNode* old, RbNode* new) {
+    RbNode* parent = old->parent;
+
+    if (parent == NULL)
+        tree->root = new;
+    else if (parent->left == old)
+        parent->left = new;
+    else
+        parent->right = new;
+
+    if (new != NULL)
+        new->parent = parent;
+}
+
+/**
+ * @brief Rotate left around \p x. Its right child takes its place.
+ */
+static void rotate_left(RbTree* tree, RbNode* x) {
+    RbNode* y = x->right;
+
+    x->right = y->left;
+    if (y->left != NULL)
+        y->left->parent = x;
+
+    replace_child(tree, x, y);
+    y->left   = x;
+    x->parent = y;
+}
+
+/**
+ * @brief Rotate right around \p x. Its left child takes its place.
+ */
+static void rotate_right(RbTree* tree, RbNode* x) {
+    RbNode* y = x->left;
+
+    x->left = y->right;
+    if (y->right != NULL)
+        y->right->parent = x;
+
+    replace_child(tree, x, y);
+    y->right  = x;
+    x->parent = y;
+}
+
+/**
+ * @brief Get the smallest node of a subtree.
+ */
+static inline RbNode* subtree_min(RbNode* node) {
+    while (node->left != NULL)
+        node = node->left;
+
+    return node;
+}
+
+/**
+ * @brief Get the biggest node of a subtree.
+ */
+static inline RbNode* subtree_max(RbNode* node) {
+    while (node->right != NULL)
+        node = node->right;
+
+    return node;
+}
+
+/**
+ * @brief Fix the red-black properties after inserting a red node.
+ * @param[inout] tree Red-black tree
+ * @param[inout] node New node
+ */
+static void insert_fixup(RbTree* tree, RbNode* node) {
+    RbNode* parent;
+
+    /* Two red nodes in a row. The parent is red, so it's not the root and the
+     * grandparent exists */
+    while ((parent = node->parent) != NULL && parent->red) {
+        RbNode* grandparent = parent->parent;
+
+        if (parent == grandparent->left) {
+            RbNode* uncle = grandparent->right;
+
+            if (IS_RED(uncle)) {
+                /* Move the red up and check the grandparent */
+                parent->red      = false;
+                uncle->red       = false;
+                grandparent->red = true;
+                node             = grandparent;
+                continue;
+            }
+
+            if (node == parent->right) {
+                rotate_left(tree, parent);
+                node   = parent;
+                parent = node->parent;
+            }
+
+            parent->red      = false;
+            grandparent->red = true;
+            rotate_right(tree, grandparent);
+        } else {
+            RbNode* uncle = grandparent->left;
+
+            if (IS_RED(uncle)) {
+                parent->red      = false;
+                uncle->red       = false;
+                grandparent->red = true;
+                node             = grandparent;
+                continue;
+            }
+
+            if (node == parent->left) {
+                rotate_right(tree, parent);
+                node   = parent;
+                parent = node->parent;
+            }
+
+            parent->red      = false;
+            grandparent->red = true;
+            rotate_left(tree, grandparent);
+        }
+    }
+
+    tree->root->red = false;
+}
+
+/**
+ * @brief Fix the red-black properties after removing a black node.
+ * @param[inout] tree Red-black tree
+ * @param[inout] node Node that took the place of the removed one, has one
+ * black less in its paths. Can be NULL.
+ * @param[inout] parent Parent of \p node
+ */
+static void remove_fixup(RbTree* tree, RbNode* node, RbNode* parent) {
+    while (node != tree->root && !IS_RED(node)) {
+        /* The sibling can't be NULL: its paths have at least one black more
+         * than the ones of node */
+        if (node == parent->left) {
+            RbNode* sibling = parent->right;
+
+            if (sibling->red) {
+                sibling->red = false;
+                parent->red  = true;
+                rotate_left(tree, parent);
+                sibling = parent->right;
+            }
+
+            if (!IS_RED(sibling->left) && !IS_RED(sibling->right)) {
+                /* Remove a black from the sibling and check the parent */
+                sibling->red = true;
+                node         = parent;
+                parent       = node->parent;
+                continue;
+            }
+
+            if (!IS_RED(sibling->right)) {
+                sibling->left->red = false;
+                sibling->red       = true;
+                rotate_right(tree, sibling);
+                sibling = parent->right;
+            }
+
+            sibling->red        = parent->red;
+            parent->red         = false;
+            sibling->right->red = false;
+            rotate_left(tree, parent);
+        } else {
+            RbNode* sibling = parent->left;
+
+            if (sibling->red) {
+                sibling->red = false;
+                parent->red  = true;
+                rotate_right(tree, parent);
+                sibling = parent->left;
+            }
+
+            if (!IS_RED(sibling->left) && !IS_RED(sibling->right)) {
+                sibling->red = true;
+                node         = parent;
+                parent       = node->parent;
+                continue;
+            }
+
+            if (!IS_RED(sibling->left)) {
+                sibling->right->red = false;
+                sibling->red        = true;
+                rotate_left(tree, sibling);
+                sibling = parent->left;
+            }
+
+            sibling->red       = parent->red;
+            parent->red        = false;
+            sibling->left->red = false;
+            rotate_right(tree, parent);
+        }
+
+        /* Balanced */
+        node = tree->root;
+        break;
+    }
+
+    if (node != NULL)
+        node->red = false;
+}
+
+/* -------------------------------------------------------------------------- */
+
+RbNode* rb_insert(RbTree* tree, RbNode* node, rb_cmp_t cmp) {
+    RbNode* parent = NULL;
+    RbNode** link  = &tree->root;
+
+    while (*link != NULL) {
+        parent = *link;
+
+        const int ret = cmp(node, parent);
+        if (ret == 0)
+            return parent;
+
+        link = (ret < 0) ? &parent->left : &parent->right;
+    }
+
+    node->parent = parent;
+    node->left   = NULL;
+    node->right  = NULL;
+    node->red    = true;
+    *link        = node;
+
+    insert_fixup(tree, node);
+    return NULL;
+}
+
+void rb_remove(RbTree* tree, RbNode* node) {
+    RbNode* child;
+    RbNode* parent;
+    bool removed_red;
+
+    if (node->left == NULL || node->right == NULL) {
+        /* At most one child, it takes the place of the node */
+        child       = (node->left != NULL) ? node->left : node->right;
+        parent      = node->parent;
+        removed_red = node->red;
+
+        replace_child(tree, node, child);
+    } else {
+        /* Two children. The next node takes its place and color, so the one
+         * removed from its position is the next node */
+        RbNode* next = subtree_min(node->right);
+        child        = next->right;
+        removed_red  = next->red;
+
+        if (next->parent == node) {
+            parent = next;
+        } else {
+            parent = next->parent;
+            replace_child(tree, next, child);
+
+            next->right         = node->right;
+            next->right->parent = next;
+        }
+
+        replace_child(tree, node, next);
+        next->left         = node->left;
+        next->left->parent = next;
+        next->red          = node->red;
+    }
+
+    if (!removed_red)
+        remove_fixup(tree, child, parent);
+}
+
+RbNode* rb_find(const RbTree* tree, const void* key, rb_key_cmp_t cmp) {
+    RbNode* node = tree->root;
+
+    while (node != NULL) {
+        const int ret = cmp(key, node);
+        if (ret == 0)
+            return node;
+
+        node = (ret < 0) ? node->left : node->right;
+    }
+
+    return NULL;
+}
+
+RbNode* rb_floor(const RbTree* tree, const void* key, rb_key_cmp_t cmp) {
+    RbNode* node = tree->root;
+    RbNode* best = NULL;
+
+    while (node != NULL) {
+        const int ret = cmp(key, node);
+        if (ret == 0)
+            return node;
+
+        if (ret < 0) {
+            node = node->left;
+        } else {
+            best = node;
+            node = node->right;
+        }
+    }
+
+    return best;
+}
+
+RbNode* rb_first(const RbTree* tree) {
+    return (tree->root != NULL) ? subtree_min(tree->root) : NULL;
+}
+
+RbNode* rb_last(const RbTree* tree) {
+    return (tree->root != NULL) ? subtree_max(tree->root) : NULL;
+}
+
+RbNode* rb_next(const RbNode* node) {
+    if (node->right != NULL)
+        return subtree_min(node->right);
+
+    /* Go up until we come from a left child */
+    while (node->parent != NULL && node == node->parent->right)
+        node = node->parent;
+
+    return node->parent;
+}
+
+RbNode* rb_prev(const RbNode* node) {
+    if (node->left != NULL)
+        return subtree_max(node->left);
+
+    while (node->parent != NULL && node == node->parent->left)
+        node = node->parent;
+
+    return node->parent;
+}
@@ -1,6 +1,5 @@
 
 #include <stdarg.h>
-#include <limits.h>
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
@@ -12,506 +11,584 @@
 #include <kernel/framebuffer_console.h>
 #endif
 
-#include <kernel/keyboard.h> /* kb_getchar */
+#include <kernel/tty.h>    /* tty_getchar */
+#include <kernel/serial.h> /* serial_write */
 
 /**
- * @brief Prints the speicified string using putchar.
- * @param[in] str Zero terminated string to print.
- * @return Bytes written.
+ * @brief Size of the stack buffer used by vprintf() and vfctprintf().
+ * @details The buffer is passed to the output function when it's full and at
+ * the end of the call, so most calls write to the output once.
  */
-static inline int print(const char* str) {
-    while (*str != '\0')
-        putchar(*str++);
+#define PRINTF_BUF_SZ 128
 
-    return 0;
-}
+/**
+ * @brief Max chars of a formatted integer: 20 digits of UINT64_MAX.
+ */
+#define INT_STR_SZ 20
 
 /**
- * @brief Print string with padding.
- * @details Similar to print(), but adds `strlen(str) - pad` spaces before
- * "str". Used for "%123s"
- * @param[in] str String to print.
- * @param[in] pad Padding for the string.
+ * @brief Where the formatted chars go.
+ * @details The chars are added to \p data, and when it's full they are passed
+ * to \p out. Sinks without \p out write into memory, and the chars that don't
+ * fit are dropped but still counted in \p written.
  */
-static void prints_n(const char* str, uint32_t pad) {
-    int final_pad = pad - strlen(str);
+typedef struct {
+    char* data;    /**< @brief Chars not written yet */
+    size_t size;   /**< @brief Capacity of data */
+    size_t pos;    /**< @brief Number of chars in data */
+    int written;   /**< @brief Chars formatted in the call */
+    printf_cb out; /**< @brief Output function, or NULL for memory */
+    void* arg;     /**< @brief First argument of out */
+} printf_sink;
 
-    while (final_pad-- > 0)
-        putchar(' ');
+/**
+ * @brief Options of a single conversion: "%-8d", "%08.3f", ...
+ */
+typedef struct {
+    uint32_t width;    /**< @brief Minimum number of chars */
+    uint32_t decimals; /**< @brief Decimal places of "%f" */
+    bool left;         /**< @brief Pad on the right, "-" flag */
+    bool zero;         /**< @brief Pad numbers with zeros, "0" flag */
+} printf_spec;
 
-    print(str);
-}
+/**
+ * @brief Pairs of decimal digits from "00" to "99".
+ * @details Used for converting integers 2 digits at a time, so we only need a
+ * division for each pair.
+ */
+static const char digit_pairs[] = "00010203040506070809"
+                                  "10111213141516171819"
+                                  "20212223242526272829"
+                                  "30313233343536373839"
+                                  "40414243444546474849"
+                                  "50515253545556575859"
+                                  "60616263646566676869"
+                                  "70717273747576777879"
+                                  "80818283848586878889"
+                                  "90919293949596979899";
 
 /**
- * @brief Similar to stdlib's itoan, but instead of writing to buffer, prints.
- * @details Used by printf's "%i".
- * @param[in] num Number to print.
+ * @brief Sinks of `stdout` and `stderr`, indexed by the FILE value. See
+ * stdio_set_sinks().
  */
-static void printi(int64_t num) {
-    /* Write '-' for negative numbers and convert it to positive */
-    if (num < 0) {
-        putchar('-');
-        num = -num;
-    }
+static int stream_sinks[] = {
+    [1] = STDIO_SINK_CONSOLE,
+    [2] = STDIO_SINK_CONSOLE,
+};
 
-    /* For more information about this loop, see stdlib's itoan. */
-    for (int cur_digit = digits_int(num) - 1; cur_digit >= 0; cur_digit--)
-        putchar((num / ipow(10, cur_digit)) % 10 + '0');
-}
+static const char hex_lower[] = "0123456789abcdef";
+static const char hex_upper[] = "0123456789ABCDEF";
+
+/* -------------------------------------------------------------------------- */
 
 /**
- * @brief Print integer with padding.
- * @details Similar to printi(), but adds `digits(num) - pad` zeros before num.
- * Used for "%123d"
- * @param[in] num Number to print.
- * @param[in] pad Padding for the number.
+ * @brief Write \p len chars to the console with a single call.
+ * @details Output function of vprintf(), see printf_cb.
+ * @param arg Unused
+ * @param[in] s Chars to write, don't need to be zero-terminated.
+ * @param len Number of chars
  */
-static void printi_n(int64_t num, uint32_t pad) {
-    uint8_t sign = (num < 0) ? 1 : 0;
-    if (sign)
-        num = -num;
+static void write_console(void* arg, const char* s, size_t len) {
+    (void)arg;
+
+#ifdef USE_VGA
+    vga_write(s, len);
+#else /* Framebuffer console */
+    fbc_write(s, len);
+#endif
+}
 
-    char converted_num[21] = { 0 };
-    itoa(converted_num, num);
+/**
+ * @brief Write \p len chars to the sinks of a stream.
+ * @details Output function of vprintf() and vfprintf() when they don't just
+ * write to the console, see printf_cb.
+ * @param arg Sinks of the stream, see stdio_sinks
+ * @param[in] s Chars to write, don't need to be zero-terminated.
+ * @param len Number of chars
+ */
+static void write_sinks(void* arg, const char* s, size_t len) {
+    const int sinks = (int)(uintptr_t)arg;
 
-    if (sign)
-        putchar('-');
+    if (sinks & STDIO_SINK_CONSOLE)
+        write_console(NULL, s, len);
 
-    int final_pad = (pad - strlen(converted_num)) - sign;
-    while (final_pad-- > 0)
-        putchar(' ');
-    print(converted_num);
+    if (sinks & STDIO_SINK_SERIAL)
+        serial_write(s, len);
 }
 
 /**
- * @brief Print double.
- * @details Used by vprintf()
- * @param[in] num Number to print.
- * @param[in] decimals Number of decimal places to print.
+ * @brief Format and write to the sinks of a stream.
+ * @param sinks Bitwise OR of stdio_sinks
+ * @param[in] fmt Format string
+ * @param[in] va Variable argument list
+ * @return Chars formatted
  */
-static void print_double(double num, uint32_t decimals) {
-    /* First print the integer part using printi, and remove it from num for
-     * only keeping decimals */
-    int int_part = (int)num;
-    printi(int_part);
-    num -= int_part;
+static inline int vprintf_sinks(int sinks, const char* restrict fmt,
+                                va_list va) {
+    /* Skip a call for each flush in the common case */
+    if (sinks == STDIO_SINK_CONSOLE)
+        return vfctprintf(write_console, NULL, fmt, va);
 
-    if (num < 0)
-        num = -num;
+    return vfctprintf(write_sinks, (void*)(uintptr_t)sinks, fmt, va);
+}
 
-    /* If the double doesn't have decimals (12.0) */
-    if (num == 0) {
-        print(".0");
+/**
+ * @brief Pass the buffered chars to the output function and empty the buffer.
+ * @details Memory sinks are left as they are, so they stay full.
+ * @param[inout] buf Output sink
+ */
+static void buf_flush(printf_sink* buf) {
+    if (buf->out == NULL)
         return;
-    }
 
-    putchar('.');
+    if (buf->pos > 0)
+        buf->out(buf->arg, buf->data, buf->pos);
 
-    while (decimals-- > 0) {
-        num *= 10;
-        putchar((int)num + '0');
-        num -= (int)num;
-    }
+    buf->pos = 0;
 }
 
 /**
- * @brief Print double with decimal places and padding.
- * @details Used by vprintf()
- * @param[in] num Number to print.
- * @param[in] pad Padding. Same ass printi_n(). Used for "%123f"
- * @param[in] num Decimals. Used for "%.5f"
+ * @brief Add a char to the output sink.
+ * @param[inout] buf Output sink
+ * @param c Char to add
  */
-static void print_double_n(double num, uint32_t pad, uint32_t decimals) {
-    /* Print spaces for each digit we need to reach the padding */
-    for (uint32_t i = 0; i < pad - digits_double(num, decimals); i++)
-        putchar(' ');
+static inline void buf_putc(printf_sink* buf, char c) {
+    buf->written++;
+
+    if (buf->pos >= buf->size) {
+        buf_flush(buf);
+        if (buf->pos >= buf->size)
+            return;
+    }
 
-    print_double(num, decimals);
+    buf->data[buf->pos++] = c;
 }
 
 /**
- * @brief Print integer in hexadecimal format (lowercase).
- * @details Does not support sign.
- * @param[in] num Number to print in hex format.
+ * @brief Add \p len chars to the output sink.
+ * @param[inout] buf Output sink
+ * @param[in] s Chars to add
+ * @param len Number of chars
  */
-static void printx(int64_t num) {
-    if (num <= 0)
-        print("0");
+static void buf_write(printf_sink* buf, const char* s, size_t len) {
+    buf->written += len;
 
-    /* max digits of an unsigned long */
-    char hex_str[17] = { 0 };
+    /* Most of the strings are short (numbers, small parts of the format), so
+     * avoid the memcpy() call if they fit */
+    if (len <= 16 && buf->size - buf->pos >= len) {
+        char* dst = &buf->data[buf->pos];
+        buf->pos += len;
 
-    int tmp = 0;
-    size_t i;
-    for (i = 0; num > 0 && i < sizeof(hex_str) - 1; i++) {
-        tmp = num % 16;
-        num /= 16;
+        while (len-- > 0)
+            *dst++ = *s++;
 
-        /* Convert to char */
-        tmp += (tmp < 10) ? '0' : 'a' - 10;
-
-        hex_str[i] = tmp;
+        return;
     }
 
-    hex_str[i] = '\0';
+    while (len > 0) {
+        if (buf->pos >= buf->size) {
+            buf_flush(buf);
+            if (buf->pos >= buf->size)
+                return;
+        }
+
+        size_t n = buf->size - buf->pos;
+        if (n > len)
+            n = len;
 
-    /* Reverse string and print */
-    strrev(hex_str);
-    print(hex_str);
+        memcpy(&buf->data[buf->pos], s, n);
+        buf->pos += n;
+        s += n;
+        len -= n;
+    }
 }
 
 /**
- * @brief Print integer in hexadecimal format with padding.
- * @details Similar to printx(), but adds `digits(num) - pad` zeros before num.
- * Used for "%123x", "%123X"
- * @param[in] num Number to print in hex format.
- * @param[in] pad Padding for the number.
- * @param[in] uppercase If true will use uppercase hex chars.
+ * @brief Add \p n copies of \p c to the output sink.
+ * @details Used for padding. Does nothing if \p n is negative.
+ * @param[inout] buf Output sink
+ * @param c Char to add
+ * @param n Number of chars
  */
-static void printx_n(int64_t num, uint32_t pad, bool uppercase) {
-    const char upper_c = uppercase ? 'A' : 'a';
+static void buf_pad(printf_sink* buf, char c, int n) {
+    while (n-- > 0)
+        buf_putc(buf, c);
+}
 
-    /* max digits of an unsigned long */
-    char hex_str[17] = { 0 };
+/**
+ * @brief Add the padding and sign before a number of \p len chars.
+ * @details The sign goes after the spaces but before the zeros.
+ * @param[inout] buf Output sink
+ * @param[in] spec Options of the conversion
+ * @param len Chars of the number, without the sign
+ * @param negative If true, add a '-'
+ */
+static void pad_number(printf_sink* buf, const printf_spec* spec, int len,
+                       bool negative) {
+    const int pad = (int)spec->width - len - negative;
+
+    if (!spec->left && !spec->zero)
+        buf_pad(buf, ' ', pad);
+    if (negative)
+        buf_putc(buf, '-');
+    if (!spec->left && spec->zero)
+        buf_pad(buf, '0', pad);
+}
 
-    int tmp = 0;
-    size_t i;
-    for (i = 0; num > 0 && i < sizeof(hex_str) - 1; i++) {
-        tmp = num % 16;
-        num /= 16;
+/**
+ * @brief Add the padding after a field of \p len chars, for the "-" flag.
+ * @param[inout] buf Output sink
+ * @param[in] spec Options of the conversion
+ * @param len Chars of the field, including the sign
+ */
+static inline void pad_right(printf_sink* buf, const printf_spec* spec,
+                             int len) {
+    if (spec->left)
+        buf_pad(buf, ' ', (int)spec->width - len);
+}
 
-        /* Convert to char */
-        tmp += (tmp < 10) ? '0' : upper_c - 10;
+/* -------------------------------------------------------------------------- */
 
-        hex_str[i] = tmp;
+/**
+ * @brief Convert an integer to decimal, writing backwards from \p end
+ * @details Numbers that fit in 32 bits only use 32 bit divisions, the 64 bit
+ * ones are calls to libgcc on i686.
+ * @param num Number to convert
+ * @param[out] end Pointer after the last digit. Needs INT_STR_SZ chars before
+ * it.
+ * @return Pointer to the first digit
+ */
+static char* fmt_dec(uint64_t num, char* end) {
+    while (num > UINT32_MAX) {
+        const uint64_t q = num / 100;
+        const uint32_t r = num - q * 100;
+
+        end -= 2;
+        end[0] = digit_pairs[r * 2];
+        end[1] = digit_pairs[r * 2 + 1];
+        num    = q;
     }
 
-    hex_str[i] = '\0';
+    uint32_t n = num;
+    while (n >= 100) {
+        const uint32_t q = n / 100;
+        const uint32_t r = n - q * 100;
 
-    /* Reverse string and print */
-    strrev(hex_str);
+        end -= 2;
+        end[0] = digit_pairs[r * 2];
+        end[1] = digit_pairs[r * 2 + 1];
+        n      = q;
+    }
 
-    /* i is now the length of the final str */
-    int final_pad = pad - i;
-    while (final_pad-- > 0)
-        putchar(' ');
+    if (n >= 10) {
+        end -= 2;
+        end[0] = digit_pairs[n * 2];
+        end[1] = digit_pairs[n * 2 + 1];
+    } else {
+        *--end = n + '0';
+    }
 
-    print(hex_str);
+    return end;
 }
 
 /**
- * @brief Print integer in hexadecimal format (uppercase).
- * @details Does not support sign.
- * @param[in] num Number to print in hex format.
+ * @brief Convert an integer to hexadecimal, writing backwards from \p end
+ * @param num Number to convert
+ * @param[out] end Pointer after the last digit. Needs 16 chars before it.
+ * @param[in] digits Either hex_lower or hex_upper
+ * @return Pointer to the first digit
  */
-static void printX(int64_t num) {
-    if (num <= 0)
-        print("0");
+static char* fmt_hex(uint64_t num, char* end, const char* digits) {
+    do {
+        *--end = digits[num & 0xF];
+        num >>= 4;
+    } while (num != 0);
 
-    /* max digits of an unsigned long */
-    char hex_str[17] = { 0 };
+    return end;
+}
 
-    int tmp = 0;
-    size_t i;
-    for (i = 0; num > 0 && i < sizeof(hex_str) - 1; i++) {
-        tmp = num % 16;
-        num /= 16;
+/**
+ * @brief Add an integer to the output sink.
+ * @param[inout] buf Output sink
+ * @param num Absolute value of the number
+ * @param negative If true, add a '-' before the number
+ * @param base 10 or 16
+ * @param uppercase Use uppercase hex digits
+ * @param[in] spec Width and flags of the conversion
+ */
+static void print_int(printf_sink* buf, uint64_t num, bool negative, int base,
+                      bool uppercase, const printf_spec* spec) {
+    char str[INT_STR_SZ];
+    char* const end = &str[INT_STR_SZ];
+
+    const char* start =
+      (base == 10) ? fmt_dec(num, end)
+                   : fmt_hex(num, end, uppercase ? hex_upper : hex_lower);
+    const int len = end - start;
+
+    pad_number(buf, spec, len, negative);
+    buf_write(buf, start, len);
+    pad_right(buf, spec, len + negative);
+}
 
-        /* Convert to char */
-        tmp += (tmp < 10) ? '0' : 'A' - 10;
+/**
+ * @brief Add a signed integer in decimal to the output sink.
+ * @param[inout] buf Output sink
+ * @param num Number to add
+ * @param[in] spec Width and flags of the conversion, see print_int()
+ */
+static inline void print_signed(printf_sink* buf, int64_t num,
+                                const printf_spec* spec) {
+    /* Negate as unsigned, so INT64_MIN works */
+    if (num < 0)
+        print_int(buf, -(uint64_t)num, true, 10, false, spec);
+    else
+        print_int(buf, num, false, 10, false, spec);
+}
 
-        hex_str[i] = tmp;
-    }
+/**
+ * @brief Add \p len chars to the output sink, padded with spaces.
+ * @param[inout] buf Output sink
+ * @param[in] str Chars to add
+ * @param len Number of chars
+ * @param[in] spec Width and "-" flag of the conversion
+ */
+static void print_chars(printf_sink* buf, const char* str, size_t len,
+                        const printf_spec* spec) {
+    if (!spec->left)
+        buf_pad(buf, ' ', (int)spec->width - (int)len);
+    buf_write(buf, str, len);
+    pad_right(buf, spec, len);
+}
 
-    hex_str[i] = '\0';
+/**
+ * @brief Add a string to the output sink.
+ * @param[inout] buf Output sink
+ * @param[in] str String to add, "(null)" if NULL.
+ * @param[in] spec Width and "-" flag of the conversion
+ */
+static inline void print_str(printf_sink* buf, const char* str,
+                             const printf_spec* spec) {
+    if (str == NULL)
+        str = "(null)";
 
-    /* Reverse string and print */
-    strrev(hex_str);
-    print(hex_str);
+    print_chars(buf, str, strlen(str), spec);
 }
 
 /**
- * @brief Print the address of the specified pointer in hex format.
- * @details Prints "(null)" if NULL.
- * @param[inout] ptr Pointer to print.
+ * @brief Add a double to the output sink.
+ * @details The integer part needs to fit in 64 bits.
+ * @param[inout] buf Output sink
+ * @param num Number to add
+ * @param[in] spec Width, flags and decimal places of the conversion. The last
+ * decimal is rounded.
  */
-static inline void printp(void* ptr) {
-    if (ptr == NULL) {
-        print("(null)");
-    } else {
-        print("0x");
-        printX((uint32_t)ptr);
+static void print_double(printf_sink* buf, double num,
+                         const printf_spec* spec) {
+    const bool negative = num < 0;
+    if (negative)
+        num = -num;
+
+    /* Round the last decimal */
+    uint32_t decimals = spec->decimals;
+    double round      = 0.5;
+    for (uint32_t i = 0; i < decimals; i++)
+        round /= 10;
+    num += round;
+
+    const uint64_t int_part = (uint64_t)num;
+    num -= int_part;
+
+    char str[INT_STR_SZ];
+    char* const end   = &str[INT_STR_SZ];
+    const char* start = fmt_dec(int_part, end);
+    const int len     = end - start;
+
+    /* Integer part, dot and decimals */
+    pad_number(buf, spec, len + 1 + (int)decimals, negative);
+    buf_write(buf, start, len);
+    buf_putc(buf, '.');
+
+    while (decimals-- > 0) {
+        num *= 10;
+        const int digit = (int)num;
+        buf_putc(buf, digit + '0');
+        num -= digit;
     }
+
+    pad_right(buf, spec, negative + len + 1 + (int)spec->decimals);
 }
 
-int vprintf(const char* restrict fmt, va_list va) {
-    int written = 0;
+/* -------------------------------------------------------------------------- */
 
+/**
+ * @brief Format \p fmt into the output sink. Used by all the printf functions.
+ * @details Doesn't flush the sink at the end.
+ * @param[inout] buf Output sink
+ * @param[in] fmt Format string, see vprintf()
+ * @param[in] va Variable argument list
+ */
+static void vformat(printf_sink* buf, const char* restrict fmt, va_list va) {
     while (*fmt != '\0') {
-        /* If we get a '%', expect format, if not, just print normal char */
-        if (*fmt == '%') {
-            fmt++;
-            if (written < INT_MAX)
-                written++;
+        /* Add the normal chars until the next format at once */
+        if (*fmt != '%') {
+            const char* start = fmt;
+            while (*fmt != '\0' && *fmt != '%')
+                fmt++;
+
+            buf_write(buf, start, fmt - start);
+            continue;
+        }
+
+        /* Skip the '%' */
+        fmt++;
+
+        printf_spec spec = {
+            .width    = 0,
+            .decimals = _DEFAULT_DOUBLE_DECIMALS,
+            .left     = false,
+            .zero     = false,
+        };
+
+        /* Flags: "%-8s", "%08x", ... */
+        for (;; fmt++) {
+            if (*fmt == '-')
+                spec.left = true;
+            else if (*fmt == '0')
+                spec.zero = true;
             else
-                return -1; /**< @todo Set errno to EOVERFLOW */
-
-            switch (*fmt) {
-                case 'c':
-                    putchar((char)va_arg(va, int));
-                    break;
-                case 's':
-                    const char* va_str = va_arg(va, const char*);
-                    print(va_str);
-
-                    /* Add len to "written" if printing a string from va_list */
-                    int va_strlen = strlen(va_str);
-                    if (written + va_strlen < INT_MAX)
-                        written += va_strlen;
-                    else
-                        return -1; /**< @todo Set errno to EOVERFLOW */
-
-                    break;
-                case 'd':
-                    printi(va_arg(va, int));
-                    break;
-                case 'u':
-                    printi(va_arg(va, unsigned int));
-                    break;
-                case 'f':
-                    /* Floats get promoted to doubles when calling printf */
-                    print_double(va_arg(va, double), _DEFAULT_DOUBLE_DECIMALS);
-                    break;
-                case 'x':
-                    printx(va_arg(va, int));
-                    break;
-                case 'X':
-                    printX(va_arg(va, int));
-                    break;
-                case 'p':
-                    printp(va_arg(va, void*));
-                    break;
-                case '.': /* "%.123f" */
-                    /* Skip the dot */
-                    fmt++;
-
-                    uint32_t dot_fmt_num = 0;
-                    do {
-                        dot_fmt_num *= 10;
-                        dot_fmt_num += *fmt - '0';
-                        fmt++;
-                    } while (*fmt >= '0' && *fmt <= '9');
-
-                    print_double(va_arg(va, double), dot_fmt_num);
-                    break;
-                case 'l':
-                    /* Skip the first 'l' */
-                    fmt++;
-
-                    /* Check pattern  */
-                    switch (*fmt) {
-                        default: /* "%l?" -> "%ld" */
-                            /* If it is an unknown char, subtract one and print
-                             * int. We subtract one here because we want to
-                             * analize the char on the next iteration, and it
-                             * will get increased after the format switch. */
-                            fmt--;
-
-                            /* Adding this again is better than falling through
-                             * to 'd' */
-                            printi(va_arg(va, long));
-                            break;
-                        case 'd': /* "%ld" */
-                            printi(va_arg(va, long));
-                            break;
-                        case 'u': /* "%lu" */
-                            printi(va_arg(va, unsigned long));
-                            break;
-                        case 'f': /* "%lf" */
-                            /* Same as "%f", see comment there */
-                            print_double(va_arg(va, double),
-                                         _DEFAULT_DOUBLE_DECIMALS);
-                            break;
-                        case 'x': /* "%lx" */
-                            printx(va_arg(va, long));
-                            break;
-                        case 'X': /* "%lX" */
-                            printX(va_arg(va, long));
-                            break;
-                        case 'l':
-                            fmt++; /* Skip the second 'l' */
-
-                            switch (*fmt) {
-                                default: /* "%ll?" -> "%lld" */
-                                    /* See previous comment on "%ld" */
-                                    fmt--;
-                                    printi(va_arg(va, long long));
-                                    break;
-                                case 'd': /* "%lld" */
-                                    printi(va_arg(va, long long));
-                                    break;
-                                case 'u': /* "%llu" */
-                                    printi(va_arg(va, unsigned long long));
-                                    break;
-                                case 'x': /* "%llx" */
-                                    printx(va_arg(va, long long));
-                                    break;
-                                case 'X': /* "%llX" */
-                                    printX(va_arg(va, long long));
-                                    break;
-                            } /* %lld switch */
-                            break;
-                    } /* %ld switch */
-
-                    break;
-                case '0': /* Not necessary */
-                case '1':
-                case '2':
-                case '3':
-                case '4':
-                case '5':
-                case '6':
-                case '7':
-                case '8':
-                case '9':
-                    /* "%123s", "%123d", ... */
-                    /* Read all the numbers from the format */
-                    uint32_t fmt_num = 0;
-                    do {
-                        fmt_num *= 10;
-                        fmt_num += *fmt - '0';
-                        fmt++;
-                    } while (*fmt >= '0' && *fmt <= '9');
-
-                    /*
-                     * Now fmt points to the format char:
-                     *  "%123lld"
-                     *       ^
-                     */
-                    switch (*fmt) {
-                        case 'd': /* "%123d" */
-                            printi_n(va_arg(va, int), fmt_num);
-                            break;
-                        case 'u': /* "%123u" */
-                            printi_n(va_arg(va, unsigned int), fmt_num);
-                            break;
-                        case 'f': /* "%123f" */
-                            print_double_n(va_arg(va, double), fmt_num,
-                                           _DEFAULT_DOUBLE_DECIMALS);
-                            break;
-                        case 'x': /* "%123x" */
-                            printx_n(va_arg(va, int), fmt_num, false);
-                            break;
-                        case 'X': /* "%123X" */
-                            printx_n(va_arg(va, int), fmt_num, true);
-                            break;
-                        case '.': /* "%123.5f" */
-                            /* Skip the dot */
-                            fmt++;
-
-                            /* Not a digit after the dot */
-                            if (*fmt < '0' || *fmt > '9')
-                                break;
-
-                            uint32_t dot_fmt_num = 0;
-                            do {
-                                dot_fmt_num *= 10;
-                                dot_fmt_num += *fmt - '0';
-                                fmt++;
-                            } while (*fmt >= '0' && *fmt <= '9');
-
-                            print_double_n(va_arg(va, double), fmt_num,
-                                           dot_fmt_num);
-                            break;
-                        case 'l':  /* "%123ld", "%123lld", ... */
-                            fmt++; /* Skip the first 'l' of "%123lld" */
-
-                            switch (*fmt) {
-                                default: /* "%123l?" -> "%123ld" */
-                                    /* See previous comment on "%ld" */
-                                    fmt--;
-                                    printi_n(va_arg(va, long), fmt_num);
-                                    break;
-                                case 'd': /* "%123ld" */
-                                    printi_n(va_arg(va, long), fmt_num);
-                                    break;
-                                case 'u': /* "%123lu" */
-                                    printi_n(va_arg(va, unsigned long),
-                                             fmt_num);
-                                    break;
-                                case 'f': /* "%123lf" */
-                                    /* Same as "%123f". No "%123.5lf" format */
-                                    print_double_n(va_arg(va, double), fmt_num,
-                                                   _DEFAULT_DOUBLE_DECIMALS);
-                                    break;
-                                case 'x': /* "%123lx" */
-                                    printx_n(va_arg(va, long), fmt_num, false);
-                                    break;
-                                case 'X': /* "%123lX" */
-                                    printx_n(va_arg(va, long), fmt_num, true);
-                                    break;
-                                case 'l': /* "%123lld", "%123llx", ... */
-                                    /* Skip the second 'l' of "%123lld" */
-                                    fmt++;
-
-                                    switch (*fmt) {
-                                        default: /* "%123ll?" -> "%123lld" */
-                                            /* See previous comment on "%ld" */
-                                            fmt--;
-                                            printi_n(va_arg(va, long long),
-                                                     fmt_num);
-                                            break;
-                                        case 'd': /* "%123lld" */
-                                            printi_n(va_arg(va, long long),
-                                                     fmt_num);
-                                            break;
-                                        case 'u': /* "%123llu" */
-                                            printi_n(
-                                              va_arg(va, unsigned long long),
-                                              fmt_num);
-                                            break;
-                                        case 'x': /* "%123llx" */
-                                            printx_n(va_arg(va, long long),
-                                                     fmt_num, false);
-                                            break;
-                                        case 'X': /* "%123llX" */
-                                            printx_n(va_arg(va, long long),
-                                                     fmt_num, true);
-                                            break;
-                                    } /* %123lld switch */
-                                    break;
-                            } /* %123ld switch */
-                            break;
-                        case 's': /* "%132s" */
-                            prints_n(va_arg(va, const char*), fmt_num);
-                            break;
-                        default:
-                            break;
-                    } /* %123 switch */
-
-                    break;
-                case '%': /* "%%" -> "%" */
-                    putchar(*fmt);
-                    break;
-                default:
-                    /* If unknown fmt, print the % and the unknown char */
-                    putchar('%');
-                    putchar(*fmt);
-                    break;
-            } /* Main format char switch */
-        } else {
-            /** @todo Return value check? */
-            putchar(*fmt);
+                break;
+        }
+
+        /* "%123d", "%5.2f", ... */
+        while (*fmt >= '0' && *fmt <= '9')
+            spec.width = spec.width * 10 + *fmt++ - '0';
+
+        if (*fmt == '.') {
+            fmt++;
+
+            spec.decimals = 0;
+            while (*fmt >= '0' && *fmt <= '9')
+                spec.decimals = spec.decimals * 10 + *fmt++ - '0';
+        }
+
+        /* Number of 'l' chars: "%ld", "%lld", ... */
+        int longs = 0;
+        while (*fmt == 'l' && longs < 2) {
+            fmt++;
+            longs++;
+        }
+
+        switch (*fmt) {
+            case 'c': {
+                const char c = (char)va_arg(va, int);
+                print_chars(buf, &c, 1, &spec);
+            } break;
+            case 's':
+                print_str(buf, va_arg(va, const char*), &spec);
+                break;
+            case 'f':
+                /* Floats get promoted to doubles when calling printf */
+                print_double(buf, va_arg(va, double), &spec);
+                break;
+            case 'p': {
+                const void* ptr = va_arg(va, void*);
+                if (ptr == NULL) {
+                    print_str(buf, "(null)", &spec);
+                } else {
+                    const printf_spec none = { 0 };
+                    buf_write(buf, "0x", 2);
+                    print_int(buf, (uintptr_t)ptr, false, 16, true, &none);
+                }
+            } break;
+            case 'd':
+            case 'u':
+            case 'x':
+            case 'X': {
+                /* Get the argument with the right size. Only "%d" is signed */
+                const bool is_signed = *fmt == 'd';
+                uint64_t num;
+                if (longs == 2)
+                    num = va_arg(va, unsigned long long);
+                else if (longs == 1)
+                    num = is_signed ? (uint64_t)(int64_t)va_arg(va, long)
+                                    : va_arg(va, unsigned long);
+                else
+                    num = is_signed ? (uint64_t)(int64_t)va_arg(va, int)
+                                    : va_arg(va, unsigned int);
+
+                if (is_signed)
+                    print_signed(buf, (int64_t)num, &spec);
+                else
+                    print_int(buf, num, false, (*fmt == 'u') ? 10 : 16,
+                              *fmt == 'X', &spec);
+            } break;
+            case '%': /* "%%" -> "%" */
+                buf_putc(buf, '%');
+                break;
+            default:
+                if (longs > 0) {
+                    /* "%l?" -> "%ld" and the unknown char is printed normally
+                     * on the next iteration */
+                    const int64_t num = (longs == 2) ? va_arg(va, long long)
+                                                     : va_arg(va, long);
+                    print_signed(buf, num, &spec);
+                    continue;
+                }
+
+                /* If unknown fmt, print the % and the unknown char */
+                buf_putc(buf, '%');
+                if (*fmt == '\0')
+                    continue;
+                buf_putc(buf, *fmt);
+                break;
         }
 
         fmt++;
-        if (written < INT_MAX)
-            written++;
-        else
-            return -1; /**< @todo Set errno to EOVERFLOW */
     }
+}
+
+int vfctprintf(printf_cb out, void* arg, const char* restrict fmt,
+               va_list va) {
+    char data[PRINTF_BUF_SZ];
+
+    printf_sink buf = {
+        .data    = data,
+        .size    = PRINTF_BUF_SZ,
+        .pos     = 0,
+        .written = 0,
+        .out     = out,
+        .arg     = arg,
+    };
+
+    vformat(&buf, fmt, va);
+    buf_flush(&buf);
+
+    return buf.written;
+}
+
+int vsnprintf(char* restrict str, size_t sz, const char* restrict fmt,
+              va_list va) {
+    /* Leave space for the '\0' */
+    printf_sink buf = {
+        .data    = str,
+        .size    = (sz > 0) ? sz - 1 : 0,
+        .pos     = 0,
+        .written = 0,
+        .out     = NULL,
+        .arg     = NULL,
+    };
 
-    return written;
+    vformat(&buf, fmt, va);
+
+    if (sz > 0)
+        str[buf.pos] = '\0';
+
+    return buf.written;
+}
+
+int vprintf(const char* restrict fmt, va_list va) {
+    return vprintf_sinks(stream_sinks[1], fmt, va);
 }
 
 int puts(const char* str) {
@@ -529,6 +606,36 @@ int printf(const char* restrict fmt, ...) {
     return ret;
 }
 
+int snprintf(char* restrict str, size_t sz, const char* restrict fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+
+    int ret = vsnprintf(str, sz, fmt, va);
+
+    va_end(va);
+    return ret;
+}
+
+int sprintf(char* restrict str, const char* restrict fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+
+    int ret = vsnprintf(str, SIZE_MAX, fmt, va);
+
+    va_end(va);
+    return ret;
+}
+
+int fctprintf(printf_cb out, void* arg, const char* restrict fmt, ...) {
+    va_list va;
+    va_start(va, fmt);
+
+    int ret = vfctprintf(out, arg, fmt, va);
+
+    va_end(va);
+    return ret;
+}
+
 int fprintf(FILE* restrict stream, const char* restrict fmt, ...) {
     va_list va;
     va_start(va, fmt);
@@ -540,36 +647,57 @@ int fprintf(FILE* restrict stream, const char* restrict fmt, ...) {
 }
 
 int vfprintf(FILE* restrict stream, const char* restrict fmt, va_list va) {
-    if (stream == stderr) {
-        /* Save old colors and set fore to red */
-        uint32_t old_fg, old_bg;
-        fbc_getcols(&old_fg, &old_bg);
-        fbc_setfore(COLOR_RED);
-
-        /* Print */
-        const int ret = vprintf(fmt, va);
-
-        /* Reset old colors and return bytes written from vprintf */
-        fbc_setfore(old_fg);
-        return ret;
-    } else {
-        /* Just call normal vprintf */
+    if (stream != stderr)
         return vprintf(fmt, va);
-    }
+
+    const int sinks = stream_sinks[2];
+    if (!(sinks & STDIO_SINK_CONSOLE))
+        return vprintf_sinks(sinks, fmt, va);
+
+    /* Save old colors and set fore to red */
+    uint32_t old_fg, old_bg;
+    fbc_getcols(&old_fg, &old_bg);
+    fbc_setfore(COLOR_RED);
+
+    const int ret = vprintf_sinks(sinks, fmt, va);
+
+    /* Reset old colors and return bytes written */
+    fbc_setfore(old_fg);
+    return ret;
+}
+
+int stdio_set_sinks(FILE* restrict stream, int sinks) {
+    const int old = stdio_get_sinks(stream);
+    if (old >= 0)
+        stream_sinks[(uintptr_t)stream] = sinks;
+
+    return old;
+}
+
+int stdio_get_sinks(FILE* restrict stream) {
+    if (stream != stdout && stream != stderr)
+        return -1;
+
+    return stream_sinks[(uintptr_t)stream];
 }
 
 int putchar(int c) {
     const char tmp = (char)c;
 
+    if (stream_sinks[1] & STDIO_SINK_CONSOLE) {
 #ifdef USE_VGA
-    vga_putchar(tmp);
+        vga_putchar(tmp);
 #else /* Framebuffer console */
-    fbc_putchar(tmp);
+        fbc_putchar(tmp);
 #endif
+    }
+
+    if (stream_sinks[1] & STDIO_SINK_SERIAL)
+        serial_putchar(tmp);
 
     return tmp;
 }
 
 int getchar(void) {
-    return kb_getchar();
+    return tty_getchar(tty_stdin());
 }
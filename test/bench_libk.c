@@ -0,0 +1,205 @@
+
+/*
+ * Microbenchmarks of libk against glibc, built for the host. Run with
+ * "make bench".
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "libk.h"
+
+#define LENGTH(arr) (sizeof(arr) / sizeof(arr[0]))
+
+/**
+ * @brief Minimum time in ns for each benchmark. The iterations are doubled
+ * until we reach it.
+ */
+#define MIN_TIME_NS 100000000ULL
+
+/**
+ * @brief Size of the buffers. Bigger than the biggest size we test.
+ */
+#define BUF_SZ (1 << 20)
+
+/**
+ * @brief Don't let the compiler remove the calls or move them out of the loop.
+ */
+#define CLOBBER() asm volatile("" : : : "memory")
+
+/**
+ * @brief Function to benchmark, called with 2 buffers and a size.
+ */
+typedef void (*bench_fn)(void* dst, void* src, size_t sz);
+
+static char buf_dst[BUF_SZ] __attribute__((aligned(64)));
+static char buf_src[BUF_SZ] __attribute__((aligned(64)));
+
+/* -------------------------------------------------------------------------- */
+
+static void libk_memcpy_fn(void* dst, void* src, size_t sz) {
+    libk_memcpy(dst, src, sz);
+}
+
+static void glibc_memcpy_fn(void* dst, void* src, size_t sz) {
+    memcpy(dst, src, sz);
+}
+
+static void libk_memmove_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    libk_memmove((char*)dst + 1, dst, sz);
+}
+
+static void glibc_memmove_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    memmove((char*)dst + 1, dst, sz);
+}
+
+static void libk_memset_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    libk_memset(dst, 0x55, sz);
+}
+
+static void glibc_memset_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    memset(dst, 0x55, sz);
+}
+
+static void libk_memcmp_fn(void* dst, void* src, size_t sz) {
+    volatile int ret = libk_memcmp(dst, src, sz);
+    (void)ret;
+}
+
+static void glibc_memcmp_fn(void* dst, void* src, size_t sz) {
+    volatile int ret = memcmp(dst, src, sz);
+    (void)ret;
+}
+
+static void libk_strlen_fn(void* dst, void* src, size_t sz) {
+    (void)dst;
+    (void)sz;
+    volatile size_t ret = libk_strlen(src);
+    (void)ret;
+}
+
+static void glibc_strlen_fn(void* dst, void* src, size_t sz) {
+    (void)dst;
+    (void)sz;
+    volatile size_t ret = strlen(src);
+    (void)ret;
+}
+
+static void libk_printf_fn(void* dst, void* src, size_t sz) {
+    (void)dst;
+    (void)src;
+    libk_printf("%d %5d %llu %llx %s\n", (int)sz, -42, 12345678901234ULL,
+                0xDEADBEEFULL, "str");
+    shim_output();
+}
+
+static void glibc_printf_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    snprintf(dst, 64, "%d %5d %llu %llx %s\n", (int)sz, -42,
+             12345678901234ULL, 0xDEADBEEFULL, "str");
+}
+
+static void libk_rand_fill_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    libk_rand_fill(dst, sz);
+}
+
+static void glibc_rand_fill_fn(void* dst, void* src, size_t sz) {
+    (void)src;
+    uint8_t* p = dst;
+    for (size_t i = 0; i < sz; i++)
+        p[i] = rand();
+}
+
+/**
+ * @brief Benchmarks and the sizes for each one.
+ * @details The memcmp buffers are equal, so it compares all the bytes. The
+ * strlen source is a string of `sz` chars.
+ */
+static const struct {
+    const char* name;
+    bench_fn libk;
+    bench_fn glibc;
+    size_t sizes[6];
+} benchmarks[] = {
+    { "memcpy", libk_memcpy_fn, glibc_memcpy_fn, { 8, 64, 512, 4096, 65536 } },
+    { "memmove",
+      libk_memmove_fn,
+      glibc_memmove_fn,
+      { 8, 64, 512, 4096, 65536 } },
+    { "memset", libk_memset_fn, glibc_memset_fn, { 8, 64, 512, 4096, 65536 } },
+    { "memcmp", libk_memcmp_fn, glibc_memcmp_fn, { 8, 64, 512, 4096, 65536 } },
+    { "strlen", libk_strlen_fn, glibc_strlen_fn, { 8, 64, 512, 4096, 65536 } },
+    { "printf", libk_printf_fn, glibc_printf_fn, { 1, 1000000 } },
+    { "rand_fill", libk_rand_fill_fn, glibc_rand_fill_fn, { 64, 4096 } },
+};
+
+/* -------------------------------------------------------------------------- */
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief Run a function until it takes at least MIN_TIME_NS.
+ * @return Nanoseconds per call.
+ */
+static double run(bench_fn fn, size_t sz) {
+    for (uint64_t iters = 1;; iters *= 2) {
+        const uint64_t start = now_ns();
+        for (uint64_t i = 0; i < iters; i++) {
+            fn(buf_dst, buf_src, sz);
+            CLOBBER();
+        }
+        const uint64_t elapsed = now_ns() - start;
+
+        if (elapsed >= MIN_TIME_NS)
+            return (double)elapsed / iters;
+    }
+}
+
+int main(void) {
+    memset(buf_src, 'A', sizeof(buf_src));
+    memset(buf_dst, 'A', sizeof(buf_dst));
+
+    printf("%-16s %12s %12s %10s %10s\n", "Benchmark", "libk ns", "glibc ns",
+           "libk MB/s", "ratio");
+    printf("-----------------------------------------------------------------"
+           "\n");
+
+    for (size_t i = 0; i < LENGTH(benchmarks); i++) {
+        for (size_t j = 0; j < LENGTH(benchmarks[i].sizes); j++) {
+            const size_t sz = benchmarks[i].sizes[j];
+            if (sz == 0)
+                break;
+
+            /* The memcmp buffers need to be equal, and terminate the strlen
+             * source */
+            memcpy(buf_dst, buf_src, sizeof(buf_dst));
+            buf_src[sz] = '\0';
+
+            const double libk_ns  = run(benchmarks[i].libk, sz);
+            const double glibc_ns = run(benchmarks[i].glibc, sz);
+
+            buf_src[sz] = 'A';
+
+            char name[32];
+            snprintf(name, sizeof(name), "%s/%zu", benchmarks[i].name, sz);
+
+            /* Ratio of libk time over glibc time, lower is better */
+            printf("%-16s %12.1f %12.1f %10.0f %9.2fx\n", name, libk_ns,
+                   glibc_ns, sz * 1000.0 / libk_ns, libk_ns / glibc_ns);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,130 @@
+
+#ifndef _TEST_LIBK_H
+#define _TEST_LIBK_H 1
+
+/**
+ * @brief Declarations of the libk functions built for the host.
+ * @details The host objects of libk are renamed with `objcopy --prefix-symbols`
+ * so they don't collide with the glibc functions they are compared against.
+ * See the `test` and `bench` targets of the Makefile.
+ * @file
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Only for the types, the functions are declared below with the prefix */
+#include "../src/kernel/include/kernel/hashmap.h"
+#include "../src/kernel/include/kernel/rbtree.h"
+#include "../src/kernel/include/kernel/histogram.h"
+
+/** @name string.h
+ * @{ */
+size_t libk_strlen(const char* str);
+char* libk_strrev(char* str);
+int libk_memcmp(const void* a, const void* b, size_t sz);
+void* libk_memset(void* ptr, int val, size_t sz);
+void* libk_memcpy(void* restrict dst, const void* restrict src, size_t sz);
+void* libk_memmove(void* dst, const void* src, size_t sz);
+int libk_strcmp(const char* a, const char* b);
+/** @} */
+
+/** @name stdlib.h
+ * @{ */
+/* Can't include the fs-os stdlib.h, it has the same guard as the host one */
+typedef struct {
+    uint32_t s[4];
+} RandState;
+
+int libk_digits_int(int64_t num);
+void libk_itoa(char* str, int64_t num);
+int libk_atoi(const char* str);
+int libk_ipow(int b, int e);
+void libk_itoan(char* str, int64_t num, size_t max_digits);
+void libk_qsort(void* base, size_t n, size_t sz,
+                int (*cmp)(const void*, const void*));
+void* libk_bsearch(const void* key, const void* base, size_t n, size_t sz,
+                   int (*cmp)(const void*, const void*));
+int libk_rand(void);
+void libk_srand(unsigned int seed);
+void libk_rand_seed(RandState* st, uint64_t seed);
+uint32_t libk_rand_next(RandState* st);
+uint32_t libk_rand_u32(void);
+uint32_t libk_rand_range(uint32_t n);
+void libk_rand_fill(void* buf, size_t sz);
+/** @} */
+
+/** @name ctype.h
+ * @{ */
+int libk_tolower(int c);
+int libk_toupper(int c);
+/** @} */
+
+/** @name stdio.h
+ * @{ */
+int libk_printf(const char* fmt, ...);
+int libk_vprintf(const char* fmt, va_list va);
+int libk_snprintf(char* str, size_t sz, const char* fmt, ...);
+int libk_sprintf(char* str, const char* fmt, ...);
+int libk_fctprintf(void (*out)(void* arg, const char* s, size_t len),
+                   void* arg, const char* fmt, ...);
+int libk_fprintf(void* stream, const char* fmt, ...);
+int libk_putchar(int c);
+int libk_stdio_set_sinks(void* stream, int sinks);
+/** @} */
+
+/** @name stdio.h streams and sinks
+ * @{ */
+#define LIBK_STDOUT       ((void*)1)
+#define LIBK_STDERR       ((void*)2)
+#define LIBK_SINK_CONSOLE 0x1
+#define LIBK_SINK_SERIAL  0x2
+/** @} */
+
+/** @name kernel/hashmap.h
+ * @{ */
+bool libk_hashmap_init(HashMap* map, uint32_t n, bool str_keys);
+void libk_hashmap_init_static(HashMap* map, HashMapEntry* entries,
+                              uint32_t cap, bool str_keys);
+void libk_hashmap_destroy(HashMap* map);
+bool libk_hashmap_put(HashMap* map, uintptr_t key, void* val);
+void* libk_hashmap_get(const HashMap* map, uintptr_t key);
+HashMapEntry* libk_hashmap_find(const HashMap* map, uintptr_t key);
+bool libk_hashmap_del(HashMap* map, uintptr_t key);
+/** @} */
+
+/** @name kernel/rbtree.h
+ * @{ */
+RbNode* libk_rb_insert(RbTree* tree, RbNode* node, rb_cmp_t cmp);
+void libk_rb_remove(RbTree* tree, RbNode* node);
+RbNode* libk_rb_find(const RbTree* tree, const void* key, rb_key_cmp_t cmp);
+RbNode* libk_rb_floor(const RbTree* tree, const void* key, rb_key_cmp_t cmp);
+RbNode* libk_rb_first(const RbTree* tree);
+RbNode* libk_rb_last(const RbTree* tree);
+RbNode* libk_rb_next(const RbNode* node);
+RbNode* libk_rb_prev(const RbNode* node);
+/** @} */
+
+/** @name kernel/histogram.h
+ * @{ */
+void libk_hist_init(Histogram* hist);
+void libk_hist_add(Histogram* hist, uint64_t val);
+uint64_t libk_hist_percentile(const Histogram* hist, uint32_t pct);
+/** @} */
+
+/**
+ * @brief Get the chars printed by libk since the last call.
+ * @details libk prints with fbc_putchar() and fbc_write(), which are replaced
+ * by shim.c to write into a buffer.
+ * @return Zero-terminated string with the output. Valid until the next call.
+ */
+const char* shim_output(void);
+
+/**
+ * @brief Get the chars sent by libk to the serial port since the last call.
+ * @return Zero-terminated string with the output. Valid until the next call.
+ */
+const char* shim_serial_output(void);
+
+#endif /* _TEST_LIBK_H */
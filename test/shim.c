@@ -0,0 +1,113 @@
+
+/*
+ * Host replacements for the kernel functions used by libk. The names have the
+ * same "libk_" prefix as the libk objects.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libk.h"
+
+/**
+ * @brief Size of the buffer for the libk output. Extra chars are dropped.
+ */
+#define OUTPUT_SZ 4096
+
+/**
+ * @brief Chars printed to a device, returned by shim_output() or
+ * shim_serial_output().
+ */
+typedef struct {
+    char data[OUTPUT_SZ];
+    size_t pos;
+} shim_buf;
+
+static shim_buf console = { .pos = 0 };
+static shim_buf serial  = { .pos = 0 };
+
+static void buf_putc(shim_buf* buf, char c) {
+    if (buf->pos < OUTPUT_SZ - 1)
+        buf->data[buf->pos++] = c;
+}
+
+static const char* buf_take(shim_buf* buf) {
+    static char ret[OUTPUT_SZ];
+
+    memcpy(ret, buf->data, buf->pos);
+    ret[buf->pos] = '\0';
+    buf->pos      = 0;
+
+    return ret;
+}
+
+const char* shim_output(void) {
+    return buf_take(&console);
+}
+
+const char* shim_serial_output(void) {
+    return buf_take(&serial);
+}
+
+void libk_fbc_putchar(char c) {
+    buf_putc(&console, c);
+}
+
+void libk_fbc_write(const char* s, size_t len) {
+    while (len-- > 0)
+        libk_fbc_putchar(*s++);
+}
+
+void libk_fbc_getcols(uint32_t* fg, uint32_t* bg) {
+    *fg = 0;
+    *bg = 0;
+}
+
+void libk_fbc_setfore(uint32_t fg) {
+    (void)fg;
+}
+
+/* No tasks on the host, so rand() uses the state before multitasking */
+void* libk_mt_current_task = NULL;
+
+uint32_t libk_cpu_rand(void) {
+    return 0;
+}
+
+/* The kernel log is not part of the host build, panic() just won't log */
+void libk_log_write(int level, const char* fmt, ...) {
+    (void)level;
+    (void)fmt;
+}
+
+void libk_log_flush_serial(void) {}
+
+/* The serial port writes into its own buffer, see shim_serial_output() */
+void libk_serial_write(const char* s, size_t len) {
+    while (len-- > 0)
+        buf_putc(&serial, *s++);
+}
+
+void libk_serial_putchar(char c) {
+    buf_putc(&serial, c);
+}
+
+void libk_serial_flush(void) {}
+
+void* libk_tty_stdin(void) {
+    return NULL;
+}
+
+int libk_tty_getchar(void* tty) {
+    (void)tty;
+    return -1;
+}
+
+void* libk_heap_alloc(size_t sz) {
+    return malloc(sz);
+}
+
+void libk_heap_free(void* ptr) {
+    free(ptr);
+}
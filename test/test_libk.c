@@ -0,0 +1,752 @@
+
+/*
+ * Unit tests of libk, built for the host. Run with "make test".
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libk.h"
+
+#define LENGTH(arr) (sizeof(arr) / sizeof(arr[0]))
+
+/**
+ * @brief Check a condition, printing the location if it's false.
+ * @details The test continues after a failed check.
+ */
+#define CHECK(cond)                                                            \
+    do {                                                                       \
+        checks++;                                                              \
+        if (!(cond)) {                                                         \
+            failed++;                                                          \
+            fprintf(stderr, "%s:%d: %s: CHECK(%s) failed\n", __FILE__,         \
+                    __LINE__, __func__, #cond);                                \
+        }                                                                      \
+    } while (0)
+
+/**
+ * @brief Check that the libk output of a printf call is \p expected
+ */
+#define CHECK_PRINTF(expected, ...)                                            \
+    do {                                                                       \
+        libk_printf(__VA_ARGS__);                                              \
+        const char* out = shim_output();                                       \
+        checks++;                                                              \
+        if (strcmp(out, expected) != 0) {                                      \
+            failed++;                                                          \
+            fprintf(stderr,                                                    \
+                    "%s:%d: printf(%s): expected \"%s\", got \"%s\"\n",       \
+                    __FILE__, __LINE__, #__VA_ARGS__, expected, out);          \
+        }                                                                      \
+    } while (0)
+
+/**
+ * @brief Size of the buffers used for the mem* tests. Big enough for the SSE2
+ * and ERMS sizes, with all the alignments.
+ */
+#define BUF_SZ 8192
+
+/**
+ * @brief Next size for the mem* tests: all the small sizes, then some of the
+ * bigger ones.
+ */
+#define NEXT_SZ(sz) ((sz < 300) ? sz + 1 : sz + 331)
+
+static int checks = 0;
+static int failed = 0;
+
+/* Buffers for the libk and glibc results */
+static unsigned char buf_a[BUF_SZ], buf_b[BUF_SZ];
+static unsigned char src_a[BUF_SZ], src_b[BUF_SZ];
+
+/**
+ * @brief Fill both source and destination buffers with the same random data.
+ */
+static void fill_buffers(void) {
+    for (int i = 0; i < BUF_SZ; i++) {
+        buf_a[i] = buf_b[i] = rand();
+        src_a[i] = src_b[i] = rand();
+    }
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void test_memcpy(void) {
+    for (size_t sz = 0; sz <= 7000; sz = NEXT_SZ(sz)) {
+        for (size_t dst_off = 0; dst_off < 16; dst_off += 3) {
+            for (size_t src_off = 0; src_off < 16; src_off += 5) {
+                fill_buffers();
+
+                void* ret = libk_memcpy(buf_a + dst_off, src_a + src_off, sz);
+                memcpy(buf_b + dst_off, src_b + src_off, sz);
+
+                CHECK(ret == buf_a + dst_off);
+                CHECK(memcmp(buf_a, buf_b, BUF_SZ) == 0);
+            }
+        }
+    }
+}
+
+static void test_memset(void) {
+    for (size_t sz = 0; sz <= 7000; sz = NEXT_SZ(sz)) {
+        for (size_t off = 0; off < 16; off += 3) {
+            fill_buffers();
+
+            void* ret = libk_memset(buf_a + off, 0x1A5, sz);
+            memset(buf_b + off, 0x1A5, sz);
+
+            CHECK(ret == buf_a + off);
+            CHECK(memcmp(buf_a, buf_b, BUF_SZ) == 0);
+        }
+    }
+}
+
+static void test_memmove(void) {
+    /* Overlapping in both directions, and not overlapping */
+    for (size_t sz = 0; sz <= 7000; sz = NEXT_SZ(sz + 6)) {
+        for (size_t dst_off = 0; dst_off < 400; dst_off += 37) {
+            for (size_t src_off = 0; src_off < 400; src_off += 41) {
+                fill_buffers();
+
+                void* ret = libk_memmove(buf_a + dst_off, buf_a + src_off, sz);
+                memmove(buf_b + dst_off, buf_b + src_off, sz);
+
+                CHECK(ret == buf_a + dst_off);
+                CHECK(memcmp(buf_a, buf_b, BUF_SZ) == 0);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Get the sign of a comparison result.
+ */
+static int sign(int n) {
+    return (n > 0) - (n < 0);
+}
+
+static void test_memcmp(void) {
+    fill_buffers();
+    CHECK(libk_memcmp(src_a, src_b, BUF_SZ) == 0);
+    CHECK(libk_memcmp(src_a, src_b, 0) == 0);
+
+    /* Change a single byte in different positions, with different sizes */
+    for (size_t sz = 1; sz <= 300; sz++) {
+        for (size_t pos = 0; pos < sz; pos += 13) {
+            const unsigned char old = src_b[pos];
+
+            src_b[pos] = old + 1;
+            CHECK(libk_memcmp(src_a, src_b, sz) ==
+                  sign(memcmp(src_a, src_b, sz)));
+
+            src_b[pos] = old - 1;
+            CHECK(libk_memcmp(src_a, src_b, sz) ==
+                  sign(memcmp(src_a, src_b, sz)));
+
+            src_b[pos] = old;
+        }
+    }
+
+    /* Bytes are compared as unsigned */
+    CHECK(libk_memcmp("\x80", "\x01", 1) == 1);
+}
+
+static void test_strlen(void) {
+    static char str[BUF_SZ];
+
+    for (size_t off = 0; off < 16; off++) {
+        for (size_t len = 0; len < 200; len++) {
+            memset(str, 'A', sizeof(str));
+            str[off + len] = '\0';
+
+            CHECK(libk_strlen(&str[off]) == len);
+        }
+    }
+}
+
+static void test_strcmp(void) {
+    CHECK(libk_strcmp("abc", "abc") == 0);
+    CHECK(libk_strcmp("", "") == 0);
+    CHECK(libk_strcmp("abc", "abd") < 0);
+    CHECK(libk_strcmp("abd", "abc") > 0);
+    CHECK(libk_strcmp("ab", "abc") < 0);
+    CHECK(libk_strcmp("abc", "ab") > 0);
+}
+
+static void test_strrev(void) {
+    char str[]   = "Hello, world";
+    char empty[] = "";
+
+    CHECK(strcmp(libk_strrev(str), "dlrow ,olleH") == 0);
+    CHECK(strcmp(libk_strrev(empty), "") == 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void test_itoa(void) {
+    char str[21];
+
+    libk_itoa(str, 0);
+    CHECK(strcmp(str, "0") == 0);
+    libk_itoa(str, 1234567890);
+    CHECK(strcmp(str, "1234567890") == 0);
+    libk_itoa(str, -42);
+    CHECK(strcmp(str, "-42") == 0);
+    libk_itoa(str, 9007199254740993LL);
+    CHECK(strcmp(str, "9007199254740993") == 0);
+
+    libk_itoan(str, 123456, 3);
+    CHECK(strcmp(str, "123") == 0);
+    libk_itoan(str, -123456, 3);
+    CHECK(strcmp(str, "-12") == 0);
+}
+
+static void test_atoi(void) {
+    CHECK(libk_atoi("0") == 0);
+    CHECK(libk_atoi("1234") == 1234);
+    CHECK(libk_atoi("-1234") == -1234);
+    CHECK(libk_atoi("  42abc") == 42);
+}
+
+static void test_digits(void) {
+    CHECK(libk_digits_int(0) == 1);
+    CHECK(libk_digits_int(9) == 1);
+    CHECK(libk_digits_int(10) == 2);
+    CHECK(libk_digits_int(-999) == 3);
+    CHECK(libk_digits_int(1000000000000LL) == 13);
+
+    CHECK(libk_ipow(10, 0) == 1);
+    CHECK(libk_ipow(2, 10) == 1024);
+}
+
+static void test_ctype(void) {
+    CHECK(libk_tolower('A') == 'a');
+    CHECK(libk_tolower('z') == 'z');
+    CHECK(libk_tolower('1') == '1');
+    CHECK(libk_toupper('a') == 'A');
+    CHECK(libk_toupper('Z') == 'Z');
+    CHECK(libk_toupper('[') == '[');
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void test_printf(void) {
+    CHECK_PRINTF("Hello", "Hello");
+    CHECK_PRINTF("100%", "100%%");
+    CHECK_PRINTF("c=x", "c=%c", 'x');
+    CHECK_PRINTF("s=abc", "s=%s", "abc");
+    CHECK_PRINTF("  abc", "%5s", "abc");
+
+    CHECK_PRINTF("0", "%d", 0);
+    CHECK_PRINTF("-123", "%d", -123);
+    CHECK_PRINTF("4294967295", "%u", 4294967295U);
+    CHECK_PRINTF("   42", "%5d", 42);
+    CHECK_PRINTF("  -42", "%5d", -42);
+    CHECK_PRINTF("-9000000000", "%lld", -9000000000LL);
+    CHECK_PRINTF("18000000000", "%llu", 18000000000ULL);
+    CHECK_PRINTF("      123456", "%12lld", 123456LL);
+
+    CHECK_PRINTF("ff", "%x", 255);
+    CHECK_PRINTF("FF", "%X", 255);
+    CHECK_PRINTF("0", "%x", 0);
+    CHECK_PRINTF("   ff", "%5x", 255);
+    CHECK_PRINTF("123456789ab", "%llx", 0x123456789abLL);
+
+    CHECK_PRINTF("1.500000", "%f", 1.5);
+    CHECK_PRINTF("3.14", "%.2f", 3.14159);
+    CHECK_PRINTF("  3.14", "%6.2f", 3.14159);
+
+    CHECK_PRINTF("(null)", "%p", NULL);
+    CHECK_PRINTF("0xDEAD", "%p", (void*)0xDEAD);
+
+    CHECK_PRINTF("-9223372036854775808", "%lld", INT64_MIN);
+    CHECK_PRINTF("18446744073709551615", "%llu", UINT64_MAX);
+    CHECK_PRINTF("ffffffff", "%x", -1);
+    CHECK_PRINTF("12.000000", "%f", 12.0);
+    CHECK_PRINTF("-0.50", "%.2f", -0.5);
+    CHECK_PRINTF("2.67", "%.2f", 2.666);
+    CHECK_PRINTF("7 days", "%ld days", 7L);
+    CHECK_PRINTF("%y", "%y");
+
+    CHECK_PRINTF("abc  |", "%-5s|", "abc");
+    CHECK_PRINTF("42   |", "%-5d|", 42);
+    CHECK_PRINTF("00042", "%05d", 42);
+    CHECK_PRINTF("-0042", "%05d", -42);
+    CHECK_PRINTF("-42  |", "%-05d|", -42);
+    CHECK_PRINTF("000000ff", "%08x", 255);
+    CHECK_PRINTF("-001.500", "%08.3f", -1.5);
+    CHECK_PRINTF("x  |", "%-3c|", 'x');
+
+    /* More chars than the printf buffer */
+    static char long_str[1000];
+    memset(long_str, 'a', sizeof(long_str) - 1);
+    CHECK_PRINTF(long_str, "%s", long_str);
+
+    CHECK(libk_printf("abc%d%s", 123, "de") == 8);
+    shim_output();
+}
+
+/**
+ * @brief Output of the fctprintf() test.
+ */
+typedef struct {
+    char str[BUF_SZ];
+    size_t len;
+    int calls;
+} append_out;
+
+static void append_cb(void* arg, const char* s, size_t len) {
+    append_out* out = arg;
+
+    memcpy(&out->str[out->len], s, len);
+    out->len += len;
+    out->str[out->len] = '\0';
+    out->calls++;
+}
+
+static void test_snprintf(void) {
+    char str[16];
+
+    /* Same result and return value as glibc, with all the sizes */
+    const char* fmts[] = { "%s=%05d", "%s=%-6d|", "%s=%lld" };
+    for (size_t i = 0; i < LENGTH(fmts); i++) {
+        for (size_t sz = 0; sz <= sizeof(str); sz++) {
+            char expected[sizeof(str)];
+            memset(str, 'X', sizeof(str));
+            memset(expected, 'X', sizeof(expected));
+
+            const int ret = libk_snprintf(str, sz, fmts[i], "key", -123);
+            CHECK(ret == snprintf(expected, sz, fmts[i], "key", -123));
+            CHECK(memcmp(str, expected, sizeof(str)) == 0);
+        }
+    }
+
+    CHECK(libk_snprintf(NULL, 0, "%d", 12345) == 5);
+
+    CHECK(libk_sprintf(str, "%02d/%02d/%02d", 1, 2, 33) == 8);
+    CHECK(strcmp(str, "01/02/33") == 0);
+
+    /* One call for short strings, and the full string for long ones */
+    static char long_str[1000];
+    memset(long_str, 'a', sizeof(long_str) - 1);
+
+    static append_out out;
+    CHECK(libk_fctprintf(append_cb, &out, "%d-%s", 7, "abc") == 5);
+    CHECK(strcmp(out.str, "7-abc") == 0 && out.calls == 1);
+
+    out.len = 0;
+    CHECK(libk_fctprintf(append_cb, &out, "%s", long_str) == 999);
+    CHECK(strcmp(out.str, long_str) == 0);
+}
+
+static void test_stdio_sinks(void) {
+    /* Only the console by default */
+    libk_printf("a");
+    libk_fprintf(LIBK_STDERR, "b");
+    CHECK(strcmp(shim_output(), "ab") == 0);
+    CHECK(strcmp(shim_serial_output(), "") == 0);
+
+    CHECK(libk_stdio_set_sinks(LIBK_STDERR,
+                               LIBK_SINK_CONSOLE | LIBK_SINK_SERIAL) ==
+          LIBK_SINK_CONSOLE);
+    CHECK(libk_stdio_set_sinks(LIBK_STDOUT, LIBK_SINK_SERIAL) ==
+          LIBK_SINK_CONSOLE);
+
+    libk_printf("%d\n", 12);
+    libk_putchar('c');
+    libk_fprintf(LIBK_STDERR, "err");
+    CHECK(strcmp(shim_output(), "err") == 0);
+    CHECK(strcmp(shim_serial_output(), "12\ncerr") == 0);
+
+    /* stdin can't be written */
+    CHECK(libk_stdio_set_sinks((void*)0, LIBK_SINK_SERIAL) == -1);
+
+    libk_stdio_set_sinks(LIBK_STDOUT, LIBK_SINK_CONSOLE);
+    libk_stdio_set_sinks(LIBK_STDERR, LIBK_SINK_CONSOLE);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static int cmp_int(const void* a, const void* b) {
+    const int x = *(const int*)a;
+    const int y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Item with a size that is not a multiple of 4, for the byte swaps.
+ */
+typedef struct {
+    char key;
+    char pad[2];
+} item3;
+
+static int cmp_item3(const void* a, const void* b) {
+    return ((const item3*)a)->key - ((const item3*)b)->key;
+}
+
+static void test_qsort(void) {
+    static int arr[2000];
+    static item3 items[300];
+
+    for (size_t n = 0; n < LENGTH(arr); n = NEXT_SZ(n)) {
+        /* Random values, few distinct values, sorted and reversed */
+        for (int kind = 0; kind < 4; kind++) {
+            for (size_t i = 0; i < n; i++) {
+                switch (kind) {
+                    case 0: arr[i] = rand(); break;
+                    case 1: arr[i] = rand() % 4; break;
+                    case 2: arr[i] = i; break;
+                    default: arr[i] = n - i; break;
+                }
+            }
+
+            libk_qsort(arr, n, sizeof(int), cmp_int);
+
+            bool sorted = true;
+            for (size_t i = 1; i < n; i++)
+                if (arr[i - 1] > arr[i])
+                    sorted = false;
+            CHECK(sorted);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const int* found =
+              libk_bsearch(&arr[i], arr, n, sizeof(int), cmp_int);
+            CHECK(found != NULL && *found == arr[i]);
+        }
+
+        const int missing = n + 1;
+        CHECK(libk_bsearch(&missing, arr, n, sizeof(int), cmp_int) == NULL);
+    }
+
+    for (size_t i = 0; i < LENGTH(items); i++)
+        items[i].key = rand() % 100;
+
+    libk_qsort(items, LENGTH(items), sizeof(item3), cmp_item3);
+    for (size_t i = 1; i < LENGTH(items); i++)
+        CHECK(items[i - 1].key <= items[i].key);
+}
+
+static void test_hashmap(void) {
+    /* Random integer keys, compared with an array of the expected values */
+    enum { KEYS = 1000 };
+    static void* expected[KEYS];
+    memset(expected, 0, sizeof(expected));
+
+    HashMap map;
+    CHECK(libk_hashmap_init(&map, 0, false));
+
+    for (int i = 0; i < 20000; i++) {
+        const uintptr_t key = (rand() % KEYS) << 12;
+        void* val           = (void*)(uintptr_t)(i + 1);
+
+        if (rand() % 3 == 0) {
+            CHECK(libk_hashmap_del(&map, key) == (expected[key >> 12] != NULL));
+            expected[key >> 12] = NULL;
+        } else {
+            CHECK(libk_hashmap_put(&map, key, val));
+            expected[key >> 12] = val;
+        }
+    }
+
+    uint32_t count = 0;
+    for (uintptr_t i = 0; i < KEYS; i++) {
+        CHECK(libk_hashmap_get(&map, i << 12) == expected[i]);
+        count += expected[i] != NULL;
+    }
+    CHECK(map.count == count);
+    libk_hashmap_destroy(&map);
+
+    /* Sizes that don't fit in the capacity are rejected */
+    CHECK(!libk_hashmap_init(&map, UINT32_MAX, false));
+    CHECK(!libk_hashmap_init(&map, 1u << 31, false));
+
+    /* String keys, the lookups use different pointers */
+    static const char* names[] = { "help", "quit", "clear", "ref", "bga",
+                                   "date", "beep", "play", "" };
+    CHECK(libk_hashmap_init(&map, LENGTH(names), true));
+    for (size_t i = 0; i < LENGTH(names); i++)
+        CHECK(libk_hashmap_put(&map, (uintptr_t)names[i], (void*)names[i]));
+
+    for (size_t i = 0; i < LENGTH(names); i++) {
+        char key[16];
+        strcpy(key, names[i]);
+        CHECK(libk_hashmap_get(&map, (uintptr_t)key) == names[i]);
+    }
+    CHECK(libk_hashmap_find(&map, (uintptr_t)"hel") == NULL);
+    libk_hashmap_destroy(&map);
+
+    /* Static maps don't grow */
+    HashMapEntry entries[8];
+    libk_hashmap_init_static(&map, entries, LENGTH(entries), false);
+    for (uintptr_t i = 0; i < LENGTH(entries) - 1; i++)
+        CHECK(libk_hashmap_put(&map, i, (void*)(i + 1)));
+    CHECK(!libk_hashmap_put(&map, 100, NULL));
+    CHECK(libk_hashmap_get(&map, 3) == (void*)4);
+}
+
+/**
+ * @brief Value stored in the red-black tree test.
+ */
+typedef struct {
+    int key;
+    RbNode node;
+} rb_item;
+
+static int rb_item_cmp(const RbNode* a, const RbNode* b) {
+    return cmp_int(&RB_ENTRY(a, rb_item, node)->key,
+                   &RB_ENTRY(b, rb_item, node)->key);
+}
+
+static int rb_key_cmp(const void* key, const RbNode* node) {
+    return cmp_int(key, &RB_ENTRY(node, rb_item, node)->key);
+}
+
+/**
+ * @brief Check the red-black properties of a subtree.
+ * @return Black height of the subtree, or -1 if it's not valid.
+ */
+static int rb_check(const RbNode* node, const RbNode* parent) {
+    if (node == NULL)
+        return 1;
+
+    if (node->parent != parent)
+        return -1;
+    if (node->red && ((node->left && node->left->red) ||
+                      (node->right && node->right->red)))
+        return -1;
+    if (node->left && rb_item_cmp(node->left, node) >= 0)
+        return -1;
+    if (node->right && rb_item_cmp(node->right, node) <= 0)
+        return -1;
+
+    const int left  = rb_check(node->left, node);
+    const int right = rb_check(node->right, node);
+    if (left < 0 || left != right)
+        return -1;
+
+    return left + !node->red;
+}
+
+static void test_rbtree(void) {
+    enum { ITEMS = 2000 };
+    static rb_item items[ITEMS];
+    static bool in_tree[ITEMS];
+    memset(in_tree, 0, sizeof(in_tree));
+
+    RbTree tree = { NULL };
+    int count   = 0;
+
+    for (int i = 0; i < 10000; i++) {
+        const int idx = rand() % ITEMS;
+
+        if (in_tree[idx]) {
+            libk_rb_remove(&tree, &items[idx].node);
+            in_tree[idx] = false;
+            count--;
+        } else {
+            /* Even keys, for checking rb_floor() with odd ones */
+            items[idx].key = idx * 2;
+            CHECK(libk_rb_insert(&tree, &items[idx].node, rb_item_cmp) == NULL);
+            in_tree[idx] = true;
+            count++;
+        }
+
+        if (i % 500 == 0)
+            CHECK(rb_check(tree.root, NULL) > 0 && !tree.root->red);
+    }
+    CHECK(rb_check(tree.root, NULL) > 0);
+
+    /* In order, with the expected items */
+    int seen     = 0;
+    int last_key = -1;
+    for (RbNode* n = libk_rb_first(&tree); n != NULL; n = libk_rb_next(n)) {
+        const int key = RB_ENTRY(n, rb_item, node)->key;
+        CHECK(key > last_key && in_tree[key / 2]);
+        last_key = key;
+        seen++;
+    }
+    CHECK(seen == count);
+
+    seen = 0;
+    for (RbNode* n = libk_rb_last(&tree); n != NULL; n = libk_rb_prev(n))
+        seen++;
+    CHECK(seen == count);
+
+    for (int idx = 0; idx < ITEMS; idx++) {
+        const int key  = idx * 2;
+        const RbNode* n = libk_rb_find(&tree, &key, rb_key_cmp);
+        CHECK((n != NULL) == in_tree[idx]);
+
+        /* Duplicates are not inserted */
+        if (in_tree[idx]) {
+            rb_item dup = { .key = key };
+            CHECK(libk_rb_insert(&tree, &dup.node, rb_item_cmp) == n);
+        }
+
+        /* Floor of an odd key is the biggest item below it */
+        const int odd = key + 1;
+        n             = libk_rb_floor(&tree, &odd, rb_key_cmp);
+        int expected  = idx;
+        while (expected >= 0 && !in_tree[expected])
+            expected--;
+        CHECK((n == NULL) ? expected < 0
+                          : RB_ENTRY(n, rb_item, node)->key == expected * 2);
+    }
+
+    /* Remove everything */
+    for (int idx = 0; idx < ITEMS; idx++)
+        if (in_tree[idx])
+            libk_rb_remove(&tree, &items[idx].node);
+    CHECK(tree.root == NULL);
+}
+
+static int u64_cmp(const void* a, const void* b) {
+    const uint64_t x = *(const uint64_t*)a;
+    const uint64_t y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void test_histogram(void) {
+    enum { VALUES = 5000 };
+    static uint64_t values[VALUES];
+    static Histogram hist;
+
+    libk_hist_init(&hist);
+    CHECK(hist.count == 0);
+    CHECK(libk_hist_percentile(&hist, 50) == 0);
+
+    /* Small values are exact */
+    for (uint64_t i = 0; i < HIST_SUB_BUCKETS; i++)
+        libk_hist_add(&hist, i);
+    CHECK(libk_hist_percentile(&hist, 0) == 0);
+    CHECK(libk_hist_percentile(&hist, 50) == HIST_SUB_BUCKETS / 2 - 1);
+    CHECK(libk_hist_percentile(&hist, 100) == HIST_SUB_BUCKETS - 1);
+
+    /* Values of every magnitude, including the biggest one */
+    libk_hist_init(&hist);
+    for (int i = 0; i < VALUES; i++) {
+        const int bits = rand() % 64;
+        values[i] = ((uint64_t)rand() << 33 ^ (uint64_t)rand() << 2) >> bits;
+    }
+    values[0] = UINT64_MAX;
+
+    for (int i = 0; i < VALUES; i++)
+        libk_hist_add(&hist, values[i]);
+
+    qsort(values, VALUES, sizeof(uint64_t), u64_cmp);
+    CHECK(hist.count == VALUES);
+    CHECK(hist.min == values[0]);
+    CHECK(hist.max == UINT64_MAX);
+
+    /* Never below the real percentile, and at most 1/8 above it */
+    static const uint32_t pcts[] = { 0, 1, 10, 50, 90, 99, 100 };
+    for (size_t i = 0; i < LENGTH(pcts); i++) {
+        int rank = (VALUES * pcts[i] + 99) / 100;
+        if (rank == 0)
+            rank = 1;
+
+        const uint64_t real = values[rank - 1];
+        const uint64_t got  = libk_hist_percentile(&hist, pcts[i]);
+        CHECK(got >= real && got - real <= real / 8);
+    }
+}
+
+static void test_rand(void) {
+    /* Known outputs of xoshiro128** seeded with SplitMix64 */
+    static const uint32_t expected[] = { 0x69E85A2A, 0xF843FAD0, 0x0105185F,
+                                         0x8A1F1EA6 };
+    RandState st;
+    libk_rand_seed(&st, 42);
+    for (size_t i = 0; i < LENGTH(expected); i++)
+        CHECK(libk_rand_next(&st) == expected[i]);
+
+    /* rand_fill() is the same sequence as rand_u32(), in little endian */
+    for (size_t sz = 0; sz < 64; sz++) {
+        uint8_t buf[80];
+        memset(buf, 0xAA, sizeof(buf));
+
+        libk_srand(sz);
+        libk_rand_fill(&buf[1], sz);
+
+        libk_srand(sz);
+        bool ok = buf[0] == 0xAA && buf[sz + 1] == 0xAA;
+        for (size_t i = 0; i < sz; i += 4) {
+            const uint32_t r = libk_rand_u32();
+            for (size_t j = 0; j < 4 && i + j < sz; j++)
+                ok = ok && buf[1 + i + j] == (uint8_t)(r >> (j * 8));
+        }
+        CHECK(ok);
+    }
+
+    /* Same seed, same sequence */
+    libk_srand(7);
+    const int first = libk_rand();
+    libk_srand(7);
+    CHECK(libk_rand() == first);
+
+    /* Ranges (RAND_MAX of fs-os is 32768), and a rough check of the distribution */
+    int counts[10] = { 0 };
+    bool in_range  = true;
+    for (int i = 0; i < 100000; i++) {
+        const int r = libk_rand();
+        const uint32_t n = libk_rand_range(10);
+        in_range = in_range && r >= 0 && r < 32768 && n < 10;
+        counts[n]++;
+    }
+    CHECK(in_range);
+    for (size_t i = 0; i < LENGTH(counts); i++)
+        CHECK(counts[i] > 9000 && counts[i] < 11000);
+
+    CHECK(libk_rand_range(0) == 0);
+    CHECK(libk_rand_range(1) == 0);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * @brief Test functions and their names.
+ */
+static const struct {
+    const char* name;
+    void (*func)(void);
+} tests[] = {
+    { "memcpy", test_memcpy },
+    { "memset", test_memset },
+    { "memmove", test_memmove },
+    { "memcmp", test_memcmp },
+    { "strlen", test_strlen },
+    { "strcmp", test_strcmp },
+    { "strrev", test_strrev },
+    { "itoa", test_itoa },
+    { "atoi", test_atoi },
+    { "digits", test_digits },
+    { "ctype", test_ctype },
+    { "printf", test_printf },
+    { "snprintf", test_snprintf },
+    { "stdio_sinks", test_stdio_sinks },
+    { "qsort", test_qsort },
+    { "hashmap", test_hashmap },
+    { "rbtree", test_rbtree },
+    { "histogram", test_histogram },
+    { "rand", test_rand },
+};
+
+int main(void) {
+    srand(1);
+
+    for (size_t i = 0; i < LENGTH(tests); i++) {
+        const int old_failed = failed;
+        tests[i].func();
+
+        printf("[%s] %s\n", (failed == old_failed) ? " OK " : "FAIL",
+               tests[i].name);
+    }
+
+    printf("%d/%d checks passed\n", checks - failed, checks);
+    return (failed == 0) ? 0 : 1;
+}